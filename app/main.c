@@ -55,6 +55,25 @@
 #include "wiced_bt_cfg.h"
 #include "wiced_bt_spp.h"
 #include "spp.h"
+#include "spp_xfer.h"
+#include "spp_coalesce.h"
+#include "spp_mux.h"
+#include "spp_scan.h"
+#include "spp_sink.h"
+#include "spp_uring.h"
+#include "spp_echo.h"
+#include "spp_client.h"
+#include "spp_bcast.h"
+#include "spp_shaper.h"
+#include "spp_startup.h"
+#include "spp_gatt.h"
+#include "spp_l2cap.h"
+#include "spp_pattern.h"
+#include "spp_sched.h"
+#include "spp_ctl.h"
+#include "spp_super.h"
+#include "spp_delta.h"
+#include "spp_link.h"
 
 /*******************************************************************************
  *                               MACROS
@@ -67,6 +86,17 @@
 #define PRINT_MENU (1)
 #define SEND_SAMPLE_DATA (2)
 #define SEND_DATA (3)
+#define SEND_RESUMABLE_DATA (4)
+#define RESUME_TRANSFER (5)
+#define PRINT_STATS (6)
+#define FLUSH_COALESCED_DATA (7)
+#define START_SCAN_BURST (8)
+#define TOGGLE_LATENCY_PROBE (9)
+#define CONNECT_TO_PEER (10)
+#define BROADCAST_DATA (11)
+#define SET_RATE_LIMIT (12)
+#define PUSH_DELTA_FILE (13)
+#define CANCEL_TRANSFER (14)
 #define SCAN_ERROR (0)
 
 /*******************************************************************************
@@ -86,7 +116,74 @@ static const char app_menu[] = "\n\
     1.  Print Menu \n\
     2.  Send Large Sample Data \n\
     3.  Send Data \n\
+    4.  Send Resumable Bulk Data \n\
+    5.  Resume Suspended Transfer \n\
+    6.  Print Statistics \n\
+    7.  Flush Coalesced Data \n\
+    8.  Start Fast-Connect Scan Burst \n\
+    9.  Start/Stop Latency Probe \n\
+    10. Connect to Peer \n\
+    11. Broadcast Data to All Sessions \n\
+    12. Set Session Rate Limit \n\
+    13. Push File with Delta Sync \n\
+    14. Cancel Resumable Transfer \n\
 Choose option -> ";
+static const char app_usage[] = "\n\
+Application options (in addition to the porting layer options):\n\
+    --coalesce <deadline_us>    merge small writes into full frames, flushing\n\
+                                after at most deadline_us microseconds\n\
+    --mux                       multiplex control and bulk streams over the\n\
+                                link, control messages overtake bulk data\n\
+    --rx-sink <spec>            where received data goes: print (default),\n\
+                                discard, checksum, file:<path>, fd:<n>,\n\
+                                unix:<path>, tcp:<ipv4>:<port>, ring[:<bytes>],\n\
+                                uring:<path>, verify\n\
+    --rx-fsync <ms>             fsync period of uring:<path>, 0 never syncs\n\
+    --pattern <spec>            sample data sent by option 2 and checked by\n\
+                                the verify sink: incr (default), fixed:<byte>,\n\
+                                xorshift[:<seed>], file:<path>\n\
+    --le                        also offer the serial port as an LE GATT\n\
+                                service (Nordic UART Service UUIDs)\n\
+    --l2cap <mtu>[:ertm|stream] also accept bulk sessions on an L2CAP channel\n\
+                                (PSM 0x1001), opened to the --peer as well\n\
+    --peer <bd_addr>            also act as client, connect and reconnect to\n\
+                                the SPP server at xx:xx:xx:xx:xx:xx\n\
+    --echo                      reflect every received frame back to the peer\n\
+    --ping <size>:<interval_ms>[:<count>]\n\
+                                send latency probes on every connection and\n\
+                                report the RTT, interval 0 is ping-pong\n\
+    --shape <min>:<max>[:<burst>]\n\
+                                guaranteed and maximum rate of every session\n\
+                                in bytes/s, 0 for none, burst in bytes\n\
+    --link-rate <rate>[:<burst>]\n\
+                                rate in bytes/s shared by all sessions\n\
+    --patch-cache <file>        remember the downloaded patch in file and skip\n\
+                                the download while the controller runs it\n\
+    --boot-log <file>           append the startup timings to file as JSON\n\
+    --scan-burst <ms>           high duty scan time after boot and disconnect,\n\
+                                0 keeps the default scan parameters\n\
+    --sched <role>[:other|fifo|rr[:<prio>]][@<cpus>]\n\
+                                scheduling policy and CPU set of a role:\n\
+                                stack (BT stack and HCI threads), menu, io\n\
+                                (worker threads), e.g. stack:fifo:40@1\n\
+    --mlock                     lock the process memory\n\
+    --jitter <period_us>        measure how late each role wakes up every\n\
+                                period, printed with the statistics\n\
+    --daemon <socket>           run headless, serving the control socket at\n\
+                                the given path instead of the menu\n\
+    --daemon-group <group>      let this group use the control socket, which\n\
+                                is otherwise only open to the user\n\
+    --daemon-files <dir>        allow sending the files in dir through the\n\
+                                control socket, refused without it\n\
+    --supervise <config>        drive no controller, run one worker per line\n\
+                                of config (its options) and restart crashed\n\
+                                workers, needs --daemon\n\
+    --delta-dir <dir>           keep files pushed with delta sync (option 13)\n\
+                                in dir, only changed blocks are received\n\
+    --link-profile <profile>[@<bd_addr>]\n\
+                                role, link policy and RFCOMM frame size of\n\
+                                BR/EDR links, of all peers or one: default,\n\
+                                throughput, robust, latency, power\n";
 uint8_t spp_bd_address[LOCAL_BDA_LEN] = {0x11, 0x12, 0x13, 0x21, 0x22, 0x23};
 
 /****************************************************************************
@@ -94,6 +191,7 @@ uint8_t spp_bd_address[LOCAL_BDA_LEN] = {0x11, 0x12, 0x13, 0x21, 0x22, 0x23};
  ***************************************************************************/
 uint32_t hci_control_proc_rx_cmd(uint8_t *p_buffer, uint32_t length);
 void APPLICATION_START(void);
+static int app_parse_args(int argc, char *argv[]);
 
 /******************************************************************************
  *                               FUNCTION DEFINITIONS
@@ -135,9 +233,222 @@ hci_control_proc_rx_cmd(uint8_t *p_buffer, uint32_t length)
  ******************************************************************************/
 void APPLICATION_START(void)
 {
+    spp_startup_mark(SPP_STARTUP_TRANSPORT_UP);
     spp_application_start();
 }
 
+/******************************************************************************
+ * Function Name: app_parse_args()
+ *******************************************************************************
+ * Summary:
+ *   Handles the application options (--name [value]) and removes them from
+ *   argv, so that the remaining arguments can be given to the porting layer
+ *   argument parser unchanged
+ *
+ * Parameters:
+ *   int argc            : argument count
+ *   char *argv[]        : list of arguments, compacted in place
+ *
+ * Return:
+ *   int : remaining argument count, -1 on error
+ *
+ ******************************************************************************/
+static int app_parse_args(int argc, char *argv[])
+{
+    int out = 1;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (0 != strncmp(argv[i], "--", 2))
+        {
+            argv[out++] = argv[i];
+            continue;
+        }
+        if ((0 == strcmp(argv[i], "--coalesce")) && (i + 1 < argc))
+        {
+            spp_coalesce_configure(WICED_TRUE, (uint32_t)strtoul(argv[++i], NULL, 0));
+        }
+        else if ((0 == strcmp(argv[i], "--scan-burst")) && (i + 1 < argc))
+        {
+            spp_scan_configure_burst((uint32_t)strtoul(argv[++i], NULL, 0));
+        }
+        else if ((0 == strcmp(argv[i], "--rx-sink")) && (i + 1 < argc))
+        {
+            if (!spp_sink_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid rx sink %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--pattern")) && (i + 1 < argc))
+        {
+            if (!spp_pattern_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid pattern %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--rx-fsync")) && (i + 1 < argc))
+        {
+            spp_uring_configure_fsync((uint32_t)strtoul(argv[++i], NULL, 0));
+        }
+        else if ((0 == strcmp(argv[i], "--peer")) && (i + 1 < argc))
+        {
+            if (!spp_client_configure_peer(argv[++i]))
+            {
+                fprintf(stderr, "Invalid peer address %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if (0 == strcmp(argv[i], "--echo"))
+        {
+            spp_echo_configure_reflector(WICED_TRUE);
+        }
+        else if ((0 == strcmp(argv[i], "--ping")) && (i + 1 < argc))
+        {
+            unsigned int size = 0;
+            unsigned int interval_ms = 0;
+            unsigned int count = 0;
+
+            if ((sscanf(argv[++i], "%u:%u:%u", &size, &interval_ms, &count) < 2) ||
+                !spp_echo_configure_probe(size, interval_ms, count, WICED_TRUE))
+            {
+                fprintf(stderr, "Invalid probe %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--shape")) && (i + 1 < argc))
+        {
+            spp_shaper_config_t config = { 0 };
+
+            if (sscanf(argv[++i], "%u:%u:%u", &config.min_rate, &config.max_rate, &config.burst) < 2)
+            {
+                fprintf(stderr, "Invalid shaping %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+            spp_shaper_configure_default(&config);
+        }
+        else if ((0 == strcmp(argv[i], "--link-rate")) && (i + 1 < argc))
+        {
+            unsigned int rate = 0;
+            unsigned int burst = 0;
+
+            if (sscanf(argv[++i], "%u:%u", &rate, &burst) < 1)
+            {
+                fprintf(stderr, "Invalid link rate %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+            spp_shaper_configure_link(rate, burst);
+        }
+        else if ((0 == strcmp(argv[i], "--patch-cache")) && (i + 1 < argc))
+        {
+            spp_startup_configure_cache(argv[++i]);
+        }
+        else if ((0 == strcmp(argv[i], "--boot-log")) && (i + 1 < argc))
+        {
+            spp_startup_configure_log(argv[++i]);
+        }
+        else if (0 == strcmp(argv[i], "--mux"))
+        {
+            spp_mux_enable(WICED_TRUE);
+        }
+        else if (0 == strcmp(argv[i], "--le"))
+        {
+            spp_gatt_configure(WICED_TRUE);
+        }
+        else if ((0 == strcmp(argv[i], "--l2cap")) && (i + 1 < argc))
+        {
+            char mode[8] = "ertm";
+            unsigned int mtu = 0;
+
+            if ((sscanf(argv[++i], "%u:%7s", &mtu, mode) < 1) ||
+                ((0 != strcmp(mode, "ertm")) && (0 != strcmp(mode, "stream"))) ||
+                !spp_l2cap_configure(mtu, (0 == strcmp(mode, "stream")) ? SPP_L2CAP_MODE_STREAM
+                                                                        : SPP_L2CAP_MODE_ERTM))
+            {
+                fprintf(stderr, "Invalid L2CAP channel %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--sched")) && (i + 1 < argc))
+        {
+            if (!spp_sched_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid scheduling %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if (0 == strcmp(argv[i], "--mlock"))
+        {
+            spp_sched_configure_mlock(WICED_TRUE);
+        }
+        else if ((0 == strcmp(argv[i], "--jitter")) && (i + 1 < argc))
+        {
+            if (!spp_sched_configure_jitter((uint32_t)strtoul(argv[++i], NULL, 0)))
+            {
+                fprintf(stderr, "Invalid jitter period %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--daemon")) && (i + 1 < argc))
+        {
+            if (!spp_ctl_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid control socket path %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--daemon-group")) && (i + 1 < argc))
+        {
+            if (!spp_ctl_configure_group(argv[++i]))
+            {
+                fprintf(stderr, "Unknown group %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--daemon-files")) && (i + 1 < argc))
+        {
+            if (!spp_ctl_configure_file_dir(argv[++i]))
+            {
+                fprintf(stderr, "Invalid directory %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--link-profile")) && (i + 1 < argc))
+        {
+            if (!spp_link_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid link profile %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--delta-dir")) && (i + 1 < argc))
+        {
+            if (!spp_delta_configure_dir(argv[++i]))
+            {
+                fprintf(stderr, "%s", app_usage);
+                return -1;
+            }
+        }
+        else if ((0 == strcmp(argv[i], "--supervise")) && (i + 1 < argc))
+        {
+            if (!spp_super_configure(argv[++i]))
+            {
+                fprintf(stderr, "Invalid worker configuration %s\n%s", argv[i], app_usage);
+                return -1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option %s\n%s", argv[i], app_usage);
+            return -1;
+        }
+    }
+    argv[out] = NULL;
+    return out;
+}
+
 /******************************************************************************
  * Function Name: main()
  *******************************************************************************
@@ -171,6 +482,18 @@ int main(int argc, char *argv[])
     int choice = 0;
     int spp_buf_size = 0;
 
+    spp_startup_mark(SPP_STARTUP_BEGIN);
+    argc = app_parse_args(argc, argv);
+    if (argc < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    if (spp_super_is_enabled())
+    {
+        /* The workers drive the controllers */
+        return (0 == spp_super_run(argv[0])) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if (PARSE_ERROR ==
         arg_parser_get_args(argc, argv, hci_port, spp_bd_address, &hci_baudrate,
                             &btspy_inst, peer_ip_addr, &btspy_is_tcp_socket,
@@ -184,11 +507,31 @@ int main(int argc, char *argv[])
         filename_len = MAX_PATH - 1;
     }
 
+    if (spp_startup_probe(hci_port, hci_baudrate, fw_patch_file))
+    {
+        /* The controller keeps its patch and baud rate: no download, and no
+         * REG_ON toggle, which would power cycle it
+         */
+        fw_patch_file[0] = '\0';
+        patch_baudrate = hci_baudrate;
+        memset(&autobaud, 0, sizeof(autobaud));
+    }
+
+    /* The porting layer threads inherit the placement of the stack role */
+    spp_sched_lock_memory();
+    spp_sched_apply(SPP_SCHED_ROLE_STACK);
     cy_platform_bluetooth_init(fw_patch_file, hci_port, hci_baudrate,
                                patch_baudrate, &autobaud);
+    spp_sched_apply(SPP_SCHED_ROLE_MENU);
 
     fprintf(stdout, " Linux CE SPP project initialization complete...\n");
 
+    if (spp_ctl_is_enabled())
+    {
+        /* Headless: the control socket takes the place of the menu */
+        exit((0 == spp_ctl_run()) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     for (;;)
     {
         fprintf(stdout, "%s", app_menu);
@@ -222,25 +565,156 @@ int main(int argc, char *argv[])
                 wiced_bool_t ret = WICED_FALSE;
                 fprintf(stdout,
                         "Enter the Data to be Sent (Enter less than 1007 i.e SPP_MAX_PAYLOAD):\n");
-                spp_buf_size = scanf("%1007s", spp_send_buffer);
+                spp_buf_size = scanf("%1006s", spp_send_buffer);
                 if (spp_buf_size == 0)
                 {
                     WICED_BT_TRACE("Error reading buffer to send\b");
                     continue;
                 }
-                ret = wiced_bt_spp_send_session_data(spp_handle, spp_send_buffer,
-                                                   strlen(spp_send_buffer));
+                if (spp_mux_is_enabled())
+                {
+                    /* Sent on the control stream, ahead of bulk data */
+                    ret = spp_send_control_data(spp_send_buffer,
+                                                strlen((char *)spp_send_buffer));
+                }
+                else
+                {
+                    /* Goes through the coalescing stage, which sends at once
+                     * unless coalescing was enabled with --coalesce
+                     */
+                    ret = spp_coalesce_write(spp_handle, spp_send_buffer,
+                                             strlen((char *)spp_send_buffer));
+                }
                 if (ret != WICED_TRUE)
                 {
-                    WICED_BT_TRACE(" error return from wiced_bt_spp_send_session_data, ret = %x\n",
-                                   ret);
+                    WICED_BT_TRACE(" error return from send, ret = %x\n", ret);
+                }
+            }
+            else
+            {
+                fprintf(stdout, "SPP not connected\n");
+            }
+            break;
+        case SEND_RESUMABLE_DATA:
+            if (0 != spp_handle)
+            {
+                unsigned int xfer_len = 0;
+
+                fprintf(stdout, "Enter the number of bytes to transfer:\n");
+                if ((1 != scanf("%u", &xfer_len)) || (0 == xfer_len))
+                {
+                    fprintf(stdout, "Invalid input received, Try again\n");
+                    while (getchar() != '\n');
+                    continue;
+                }
+                spp_send_resumable_data(xfer_len);
+            }
+            else
+            {
+                fprintf(stdout, "SPP not connected\n");
+            }
+            break;
+        case RESUME_TRANSFER:
+            spp_xfer_resume();
+            break;
+        case CANCEL_TRANSFER:
+            if (!spp_xfer_cancel())
+            {
+                fprintf(stdout, "No transfer to cancel\n");
+            }
+            break;
+        case PRINT_STATS:
+            spp_print_stats();
+            break;
+        case FLUSH_COALESCED_DATA:
+            spp_coalesce_flush(spp_handle);
+            break;
+        case START_SCAN_BURST:
+            /* Also lets new peers discover and pair with us */
+            spp_scan_start_burst(SPP_SCAN_BURST_REQUEST);
+            break;
+        case TOGGLE_LATENCY_PROBE:
+            if (spp_echo_is_probing())
+            {
+                spp_echo_stop();
+            }
+            else if (0 != spp_handle)
+            {
+                spp_echo_start(spp_handle);
+            }
+            else
+            {
+                fprintf(stdout, "SPP not connected\n");
+            }
+            break;
+        case BROADCAST_DATA:
+            if (0 != spp_handle)
+            {
+                fprintf(stdout,
+                        "Enter the Data to be Broadcast (Enter less than 1007 i.e SPP_MAX_PAYLOAD):\n");
+                if (1 != scanf("%1006s", spp_send_buffer))
+                {
+                    WICED_BT_TRACE("Error reading buffer to send\n");
+                    continue;
                 }
+                /* One copy shared by every session */
+                fprintf(stdout, "Queued to %d sessions\n",
+                        spp_bcast_send_copy(spp_send_buffer, strlen((char *)spp_send_buffer)));
             }
             else
             {
                 fprintf(stdout, "SPP not connected\n");
             }
             break;
+        case SET_RATE_LIMIT:
+            if (0 != spp_handle)
+            {
+                spp_shaper_config_t config = { 0 };
+
+                fprintf(stdout, "Enter <min>:<max>[:<burst>] in bytes/s, 0 for none:\n");
+                if ((1 != scanf("%63s", spp_send_buffer)) ||
+                    (sscanf((char *)spp_send_buffer, "%u:%u:%u",
+                            &config.min_rate, &config.max_rate, &config.burst) < 2))
+                {
+                    fprintf(stdout, "Invalid input received, Try again\n");
+                    continue;
+                }
+                spp_shaper_configure_session(spp_handle, &config);
+            }
+            else
+            {
+                fprintf(stdout, "SPP not connected\n");
+            }
+            break;
+        case PUSH_DELTA_FILE:
+            if (0 != spp_handle)
+            {
+                char path[MAX_PATH];
+
+                fprintf(stdout, "Enter the path of the file to push:\n");
+                if (1 != scanf("%255s", path))
+                {
+                    fprintf(stdout, "Invalid input received, Try again\n");
+                    continue;
+                }
+                /* The peer keeps the file under its base name in --delta-dir */
+                spp_delta_send(spp_handle, path);
+            }
+            else
+            {
+                fprintf(stdout, "SPP not connected\n");
+            }
+            break;
+        case CONNECT_TO_PEER:
+            if (spp_client_is_enabled())
+            {
+                spp_client_connect(WICED_TRUE);
+            }
+            else
+            {
+                fprintf(stdout, "No peer given, start with --peer <bd_addr>\n");
+            }
+            break;
         default:
             fprintf(stdout, "Invalid input received, Try again\n");
             break;
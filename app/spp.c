@@ -50,9 +50,29 @@
 #include "wiced_memory.h"
 #include "wiced_hal_nvram.h"
 #include "spp.h"
+#include "spp_xfer.h"
+#include "spp_tx.h"
+#include "spp_coalesce.h"
+#include "spp_mux.h"
+#include "spp_lifecycle.h"
+#include "spp_scan.h"
+#include "spp_sink.h"
+#include "spp_echo.h"
+#include "spp_client.h"
+#include "spp_bcast.h"
+#include "spp_shaper.h"
+#include "spp_startup.h"
+#include "spp_gatt.h"
+#include "spp_l2cap.h"
+#include "spp_pattern.h"
+#include "spp_sched.h"
+#include "spp_ctl.h"
+#include "spp_delta.h"
+#include "spp_link.h"
 #include "wiced_spp_int.h"
 #include "wiced_bt_sdp.h"
 #include "wiced_timer.h"
+#include <time.h>
 
 /*******************************************************************************
  *       MACROS
@@ -65,8 +85,6 @@
 #define SPP_NVRAM_ID WICED_NVRAM_VSID_START
 #define WICED_EIR_BUF_MAX_SIZE (264)
 #define SPP_TOTAL_DATA_TO_SEND (10000)
-#define MAX_TX_RETRY (30)
-#define TX_RETRY_TIMEOUT (100) /* msec */
 
 /*******************************************************************************
  *       VARIABLE DEFINITIONS
@@ -76,12 +94,13 @@ extern const uint8_t sdp_database[];
 wiced_bt_heap_t *p_default_heap = NULL;
 uint32_t spp_rx_bytes = 0;
 uint8_t pincode[4] = {0x30, 0x30, 0x30, 0x30};
-int spp_send_offset = 0;
 uint32_t time_start = 0;
-wiced_timer_t spp_tx_timer;
-uint32_t spp_tx_retry_count = 0;
 uint8_t spp_send_buffer[SPP_MAX_PAYLOAD];
 uint16_t spp_handle = 0;
+static uint8_t spp_sample_buffer[SPP_TOTAL_DATA_TO_SEND];
+static wiced_bool_t spp_sample_busy = WICED_FALSE;
+/* Test pattern offset of the next sample byte, restarts with every session */
+static uint64_t spp_sample_offset = 0;
 
 /*******************************************************************************
  *       FUNCTION PROTOTYPES
@@ -95,11 +114,22 @@ static void spp_write_eir(void);
 static void spp_init(void);
 static void spp_connection_up_callback(uint16_t handle, uint8_t *bda);
 static void spp_connection_down_callback(uint16_t handle);
+static void spp_connection_failed_callback(void);
+static void spp_service_not_found_callback(void);
+static void spp_connection_status_callback(wiced_bt_device_address_t bd_addr, uint8_t *p_features,
+                                           wiced_bool_t is_connected, uint16_t handle,
+                                           wiced_bt_transport_t transport, uint8_t reason);
 static wiced_bool_t spp_rx_data_callback(uint16_t handle, uint8_t *p_data, uint32_t data_len);
 extern uint16_t wiced_app_cfg_sdp_record_get_size(void);
 static int spp_write_nvram(int nvram_id, int data_len, void *p_data);
 static int spp_read_nvram(int nvram_id, void *p_data, int data_len);
-static void spp_tx_ack_timeout(WICED_TIMER_PARAM_TYPE arg);
+static wiced_bool_t spp_xfer_sample_fill(uint32_t offset, uint8_t *p_buf, uint32_t len);
+static void spp_xfer_rx_progress(uint16_t handle, uint32_t xfer_id, uint32_t offset,
+                                 uint8_t *p_data, uint32_t len, uint32_t total_len);
+static void spp_mux_stream_rx(uint16_t handle, uint8_t stream_id, uint8_t *p_data, uint32_t len);
+static void spp_sample_sent(void *p_context, wiced_bool_t sent);
+static void spp_control_data_sent(void *p_context, wiced_bool_t sent);
+static void spp_reset_session_state(void);
 
 /*******************************************************************************
  *       STRUCTURES AND ENUMERATIONS
@@ -110,16 +140,30 @@ wiced_bt_spp_reg_t spp_reg =
                                          SPP connection */
         MAX_TX_BUFFER,                /* RFCOMM MTU for SPP connection */
         spp_connection_up_callback,   /* SPP connection established */
-        NULL,                         /* SPP connection establishment failed,
-                                         not used because this app never
-                                         initiates connection */
-        NULL,                         /* SPP service not found, not used
-                                         because this app never initiates
-                                         connection */
+        spp_connection_failed_callback, /* SPP connection establishment
+                                           failed, client role only */
+        spp_service_not_found_callback, /* SPP service not found, client
+                                           role only */
         spp_connection_down_callback, /* SPP connection disconnected */
         spp_rx_data_callback,         /* Data packet received */
 };
 
+/* LE GATT sessions are served by the same callbacks */
+static const spp_gatt_reg_t spp_gatt_reg =
+    {
+        spp_connection_up_callback,
+        spp_connection_down_callback,
+        spp_rx_data_callback,
+};
+
+/* So are sessions on the L2CAP bulk channel */
+static const spp_l2cap_reg_t spp_l2cap_reg =
+    {
+        spp_connection_up_callback,
+        spp_connection_down_callback,
+        spp_rx_data_callback,
+};
+
 /*******************************************************************************
  *       FUNCTION DEFINITION
  ******************************************************************************/
@@ -150,6 +194,7 @@ void spp_application_start()
     if (WICED_BT_SUCCESS == wiced_result)
     {
         WICED_BT_TRACE("Bluetooth Stack Initialization Successful \n");
+        spp_startup_mark(SPP_STARTUP_STACK_INIT);
         /* Create default heap */
         p_default_heap = wiced_bt_create_heap("default_heap", NULL, BT_STACK_HEAP_SIZE, NULL, WICED_TRUE);
         if (p_default_heap == NULL)
@@ -189,6 +234,7 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
     wiced_bt_dev_encryption_status_t *p_encryption_status;
     wiced_bt_power_mgmt_notification_t *p_power_mgmt_notification;
     wiced_bt_dev_pairing_info_t *p_pairing_info;
+    wiced_bt_device_address_t key_bda;
 
     WICED_BT_TRACE("%s: Event: 0x%x %s\n", __FUNCTION__, event, spp_get_bt_event_name(event));
 
@@ -202,7 +248,9 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
             wiced_bt_dev_read_local_addr(bda);
             WICED_BT_TRACE("Local Bluetooth Address: ");
             spp_print_bd_address(bda);
+            spp_startup_stack_enabled();
             spp_init();
+            spp_startup_mark(SPP_STARTUP_READY);
         }
         else
         {
@@ -220,6 +268,8 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
         break;
 
     case BTM_USER_CONFIRMATION_REQUEST_EVT:
+        spp_lifecycle_event(p_event_data->user_confirmation_request.bd_addr,
+                            SPP_LIFECYCLE_USER_CONFIRM, WICED_TRUE);
         /* This application always confirms peer's attempt to pair */
         wiced_bt_dev_confirm_req_reply(WICED_BT_SUCCESS, p_event_data->user_confirmation_request.bd_addr);
         break;
@@ -228,6 +278,8 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
         /* This application supports only Just Works pairing */
         WICED_BT_TRACE("BTM_PAIRING_IO_CAPABILITIES_REQUEST_EVT bda %B\n",
                        p_event_data->pairing_io_capabilities_br_edr_request.bd_addr);
+        spp_lifecycle_event(p_event_data->pairing_io_capabilities_br_edr_request.bd_addr,
+                            SPP_LIFECYCLE_IO_CAP_REQ, WICED_TRUE);
         p_event_data->pairing_io_capabilities_br_edr_request.local_io_cap = BTM_IO_CAPABILITIES_NONE;
         p_event_data->pairing_io_capabilities_br_edr_request.auth_req = BTM_AUTH_SINGLE_PROFILE_GENERAL_BONDING_NO;
         break;
@@ -235,6 +287,8 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
     case BTM_PAIRING_COMPLETE_EVT:
         p_pairing_info = &p_event_data->pairing_complete.pairing_complete_info;
         WICED_BT_TRACE("Pairing Complete: %d\n", p_pairing_info->br_edr.status);
+        spp_lifecycle_event(p_event_data->pairing_complete.bd_addr, SPP_LIFECYCLE_PAIRING_DONE,
+                            WICED_BT_SUCCESS == p_pairing_info->br_edr.status);
         result = WICED_BT_USE_DEFAULT_SECURITY;
         break;
 
@@ -242,6 +296,8 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
         p_encryption_status = &p_event_data->encryption_status;
         WICED_BT_TRACE("Encryption Status Event: bd (%B) res %d\n",
                        p_encryption_status->bd_addr, p_encryption_status->result);
+        spp_lifecycle_event(p_encryption_status->bd_addr, SPP_LIFECYCLE_ENCRYPTED,
+                            WICED_BT_SUCCESS == p_encryption_status->result);
         break;
 
     case BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT:
@@ -250,9 +306,12 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
          */
         (void)spp_write_nvram(SPP_NVRAM_ID, sizeof(wiced_bt_device_link_keys_t),
                               &p_event_data->paired_device_link_keys_update);
+        spp_scan_set_bonded(WICED_TRUE);
         break;
 
     case BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT:
+        /* The read overwrites the requested address with the stored one */
+        memcpy(key_bda, p_event_data->paired_device_link_keys_request.bd_addr, sizeof(key_bda));
         /* read existing key from the NVRAM  */
         if (spp_read_nvram(SPP_NVRAM_ID, &p_event_data->paired_device_link_keys_request,
                            sizeof(wiced_bt_device_link_keys_t)) != 0)
@@ -264,6 +323,11 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
             result = WICED_BT_ERROR;
             WICED_BT_TRACE("Key retrieval failure\n");
         }
+        /* A key stored for another peer counts as a miss, it forces pairing */
+        spp_lifecycle_event(key_bda, SPP_LIFECYCLE_LINK_KEY_REQ,
+                            (WICED_BT_SUCCESS == result) &&
+                            (0 == memcmp(key_bda, p_event_data->paired_device_link_keys_request.bd_addr,
+                                         sizeof(key_bda))));
         break;
 
     case BTM_POWER_MANAGEMENT_STATUS_EVT:
@@ -272,6 +336,23 @@ static wiced_result_t spp_management_callback(wiced_bt_management_evt_t event,
                        p_power_mgmt_notification->status, p_power_mgmt_notification->hci_status);
         break;
 
+    case BTM_BLE_PHY_UPDATE_EVT:
+        WICED_BT_TRACE("PHY update: bd (%B) status:%d tx:%d rx:%d\n",
+                       p_event_data->ble_phy_update_event.bd_address,
+                       p_event_data->ble_phy_update_event.status,
+                       p_event_data->ble_phy_update_event.tx_phy,
+                       p_event_data->ble_phy_update_event.rx_phy);
+        spp_gatt_phy_update(p_event_data->ble_phy_update_event.bd_address,
+                            p_event_data->ble_phy_update_event.tx_phy,
+                            p_event_data->ble_phy_update_event.rx_phy);
+        break;
+
+    case BTM_BLE_DATA_LENGTH_UPDATE_EVENT:
+        spp_gatt_data_length_update(p_event_data->ble_data_length_update_event.bd_address,
+                                    p_event_data->ble_data_length_update_event.max_tx_octets,
+                                    p_event_data->ble_data_length_update_event.max_rx_octets);
+        break;
+
     default:
         result = WICED_BT_USE_DEFAULT_SECURITY;
         break;
@@ -330,6 +411,9 @@ static void spp_write_eir(void)
         /* print EIR data */
         WICED_BT_TRACE_ARRAY(pBuf, MIN(p - pBuf, 100), "EIR :");
         wiced_bt_dev_write_eir(pBuf, eir_length);
+
+        /* The stack keeps its own copy */
+        wiced_bt_free_buffer(pBuf);
     }
 }
 
@@ -349,7 +433,26 @@ static void spp_write_eir(void)
  ******************************************************************************/
 static void spp_init(void)
 {
-    wiced_init_timer(&spp_tx_timer, spp_tx_ack_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+    wiced_bt_device_link_keys_t link_keys;
+
+    /* Placement of the stack thread and jitter monitor, see --sched */
+    spp_sched_init();
+    spp_tx_init();
+    spp_pattern_init();
+    spp_echo_init();
+    spp_coalesce_init();
+    spp_lifecycle_init();
+    wiced_bt_dev_register_connection_status_change(spp_connection_status_callback);
+    spp_mux_init();
+    /* Control messages always overtake bulk data */
+    spp_mux_open_stream(SPP_MUX_STREAM_CONTROL, 0, 1, spp_mux_stream_rx);
+    spp_mux_open_stream(SPP_MUX_STREAM_BULK, 1, 1, spp_mux_stream_rx);
+    spp_xfer_init(spp_xfer_rx_progress);
+    spp_delta_init();
+    /* LE serial service, if enabled with --le */
+    spp_gatt_init(&spp_gatt_reg);
+    /* L2CAP bulk channel, if enabled with --l2cap */
+    spp_l2cap_init(&spp_l2cap_reg);
 
     spp_write_eir();
 
@@ -362,16 +465,15 @@ static void spp_init(void)
     /* Allow peer to pair */
     wiced_bt_set_pairable_mode(WICED_TRUE, 0);
 
-    /* This application will always configure device connectable
-     * and discoverable
+    /* This application is always connectable. Scanning starts with a high
+     * duty burst and steps down to the default parameters; the device is
+     * discoverable only until a peer is bonded.
      */
-    wiced_bt_dev_set_discoverability(BTM_GENERAL_DISCOVERABLE,
-                                     WICED_BT_CFG_DEFAULT_INQUIRY_SCAN_INTERVAL,
-                                     WICED_BT_CFG_DEFAULT_INQUIRY_SCAN_WINDOW);
+    spp_scan_init(0 != spp_read_nvram(SPP_NVRAM_ID, &link_keys, sizeof(link_keys)));
 
-    wiced_bt_dev_set_connectability(BTM_CONNECTABLE,
-                                    WICED_BT_CFG_DEFAULT_PAGE_SCAN_INTERVAL,
-                                    WICED_BT_CFG_DEFAULT_PAGE_SCAN_WINDOW);
+    /* Client role, if a peer was given on the command line */
+    spp_client_init();
+    spp_client_connect(WICED_FALSE);
 }
 
 /*******************************************************************************
@@ -396,8 +498,28 @@ void spp_connection_up_callback(uint16_t handle, uint8_t *bda)
         fprintf(stdout, "%s handle:%d address:%02X:%02X:%02X:%02X:%02X:%02X\n",
                 __FUNCTION__, handle, bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
         fprintf(stdout, "-------------------------------------------------------------\n");
+        spp_reset_session_state();
         spp_handle = handle;
-        spp_rx_bytes = 0;
+        spp_tx_connection_up(handle);
+        spp_mux_connection_up(handle);
+        spp_sink_connection_up(handle);
+        spp_echo_connection_up(handle);
+        if (SPP_TRANSPORT_RFCOMM != spp_tx_get_transport(handle))
+        {
+            /* Resumable transfers, the client role and the lifecycle
+             * tracer are RFCOMM only
+             */
+            return;
+        }
+        spp_xfer_connection_up(handle, bda);
+        spp_client_connection_up(handle, bda);
+        spp_lifecycle_event(bda, SPP_LIFECYCLE_SPP_UP, WICED_TRUE);
+        spp_link_connection_up(handle, bda);
+        if (spp_client_is_enabled())
+        {
+            /* The link is up and encrypted, add the bulk channel */
+            spp_l2cap_connect(bda);
+        }
     }
     else
     {
@@ -405,6 +527,26 @@ void spp_connection_up_callback(uint16_t handle, uint8_t *bda)
     }
 }
 
+/*******************************************************************************
+ * Function Name: spp_reset_session_state
+ *******************************************************************************
+ * Summary:
+ *   Clears the counters and offsets of the menu session, so nothing is
+ *   carried over to the next connection
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_reset_session_state(void)
+{
+    spp_rx_bytes = 0;
+    spp_sample_offset = 0;
+}
+
 /*******************************************************************************
  * Function Name: spp_connection_down_callback
  *******************************************************************************
@@ -423,12 +565,108 @@ void spp_connection_down_callback(uint16_t handle)
     fprintf(stdout, "-------------------------------------------------------------\n");
     fprintf(stdout, "%s handle:%d rx_bytes:%d\n", __FUNCTION__, handle, spp_rx_bytes);
     fprintf(stdout, "-------------------------------------------------------------\n");
-    spp_handle = 0;
-    spp_send_offset = 0;
-    spp_tx_retry_count = 0;
-    if (wiced_is_timer_in_use(&spp_tx_timer))
+    if (handle == spp_handle)
+    {
+        /* Another session may have become the menu session since */
+        spp_reset_session_state();
+        spp_handle = 0;
+    }
+    spp_echo_connection_down(handle);
+    spp_xfer_connection_down(handle);
+    spp_coalesce_connection_down(handle);
+    /* Reads the byte counts of the session before its queue closes */
+    spp_link_connection_down(handle);
+    spp_tx_connection_down(handle);
+    spp_mux_connection_down(handle);
+    spp_sink_connection_down(handle);
+    if (SPP_TRANSPORT_RFCOMM != spp_tx_get_transport(handle))
+    {
+        /* The LE service advertises again by itself and the L2CAP
+         * channel is reopened with the next RFCOMM session
+         */
+        return;
+    }
+    /* The peer is likely to come back soon */
+    spp_scan_start_burst(SPP_SCAN_BURST_DISCONNECT);
+    spp_client_connection_down(handle);
+}
+
+/*******************************************************************************
+ * Function Name: spp_connection_failed_callback
+ *******************************************************************************
+ * Summary:
+ *   SPP connection establishment failed callback, only called for
+ *   connections initiated by the client role
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_connection_failed_callback(void)
+{
+    spp_client_connection_failed();
+}
+
+/*******************************************************************************
+ * Function Name: spp_service_not_found_callback
+ *******************************************************************************
+ * Summary:
+ *   SPP service not found callback, the peer the client role connects to
+ *   has no serial port service
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_service_not_found_callback(void)
+{
+    spp_client_service_not_found();
+}
+
+/*******************************************************************************
+ * Function Name: spp_connection_status_callback
+ *******************************************************************************
+ * Summary:
+ *   ACL link status callback, marks the start and end of a connection for
+ *   the lifecycle tracer
+ *
+ * Parameters:
+ *   wiced_bt_device_address_t bd_addr : peer address
+ *   uint8_t *p_features : peer features
+ *   wiced_bool_t is_connected : WICED_TRUE if the link came up
+ *   uint16_t handle : ACL handle
+ *   wiced_bt_transport_t transport : BR/EDR or LE
+ *   uint8_t reason : disconnection reason
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_connection_status_callback(wiced_bt_device_address_t bd_addr, uint8_t *p_features,
+                                           wiced_bool_t is_connected, uint16_t handle,
+                                           wiced_bt_transport_t transport, uint8_t reason)
+{
+    if (BT_TRANSPORT_BR_EDR != transport)
     {
-        wiced_stop_timer(&spp_tx_timer);
+        return;
+    }
+    if (is_connected)
+    {
+        spp_lifecycle_event(bd_addr, SPP_LIFECYCLE_ACL_UP, WICED_TRUE);
+        spp_scan_acl_up();
+        /* Role, link policy and frame size of the --link-profile */
+        spp_link_acl_up(bd_addr, p_features);
+    }
+    else
+    {
+        spp_lifecycle_acl_down(bd_addr);
+        spp_link_acl_down(bd_addr);
     }
 }
 
@@ -436,7 +674,8 @@ void spp_connection_down_callback(uint16_t handle)
  * Function Name: spp_rx_data_callback
  *******************************************************************************
  * Summary:
- *   Prints the Data received from SPP client
+ *   Hands the data received from SPP client to the transfer layer, the stream
+ *   multiplexer or the rx sink of the session
  *
  * Parameters:
  *   NONE
@@ -452,15 +691,26 @@ wiced_bool_t spp_rx_data_callback(uint16_t handle, uint8_t *p_data, uint32_t dat
     if (NULL != p_data)
     {
         spp_rx_bytes += data_len;
+        spp_tx_note_rx(handle, data_len);
 
-        fprintf(stdout, "%s handle:%d len:%d %02x-%02x, total rx %d\n",
-                __FUNCTION__, handle, data_len, p_data[0], p_data[data_len - 1], spp_rx_bytes);
-        fprintf(stdout, "data: ");
-        for (int i = 0; i < data_len; i++)
+        /* Reflected, or matched against the latency probes sent */
+        if (spp_echo_rx_data(handle, p_data, data_len))
         {
-            fprintf(stdout, " %c ", p_data[i]);
+            return WICED_TRUE;
         }
-        fprintf(stdout, "\n");
+        /* Resumable transfer frames are handled by the transfer layer */
+        if (spp_xfer_rx_data(handle, p_data, data_len))
+        {
+            return WICED_TRUE;
+        }
+        if (spp_mux_is_enabled())
+        {
+            spp_mux_rx_data(handle, p_data, data_len);
+            return WICED_TRUE;
+        }
+
+        /* Prints the data unless another sink was selected with --rx-sink */
+        spp_sink_rx_data(handle, p_data, data_len);
         ret = WICED_TRUE;
     }
     else
@@ -485,74 +735,237 @@ wiced_bool_t spp_rx_data_callback(uint16_t handle, uint8_t *p_data, uint32_t dat
  ******************************************************************************/
 void spp_send_sample_data(void)
 {
-    int i;
-    wiced_bool_t ret;
+    spp_iovec_t iov;
+    wiced_bool_t queued;
 
     WICED_BT_TRACE("spp_send_sample_data entry, spp_handle = %d\n", spp_handle);
 
-    while ((spp_handle != 0) && (spp_send_offset != SPP_TOTAL_DATA_TO_SEND))
+    if (spp_sample_busy)
     {
-        int bytes_to_send = spp_send_offset + SPP_MAX_PAYLOAD < SPP_TOTAL_DATA_TO_SEND ? SPP_MAX_PAYLOAD : SPP_TOTAL_DATA_TO_SEND - spp_send_offset;
-        ret = wiced_bt_spp_can_send_more_data(spp_handle);
-        if (!ret)
-        {
-            WICED_BT_TRACE(" ! return from wiced_bt_spp_can_send_more_data\n");
-            break;
-        }
-        for (i = 0; i < bytes_to_send; i++)
-        {
-            spp_send_buffer[i] = spp_send_offset + i;
-        }
-        WICED_BT_TRACE("spp_send_sample_data: wiced_bt_spp_send_session_data\n");
-        ret = wiced_bt_spp_send_session_data(spp_handle, spp_send_buffer, bytes_to_send);
-        if (ret != WICED_TRUE)
-        {
-            WICED_BT_TRACE(" ! return from wiced_bt_spp_send_session_data\n");
-            break;
-        }
-        spp_send_offset += bytes_to_send;
-        spp_tx_retry_count = 0;
+        fprintf(stdout, "Sample data still being sent\n");
+        return;
     }
-    /* Check if we were able to send everything */
-    if (spp_send_offset < SPP_TOTAL_DATA_TO_SEND)
+    spp_pattern_fill(spp_sample_offset, spp_sample_buffer, SPP_TOTAL_DATA_TO_SEND);
+    /* Set first, the completion may run before the send returns */
+    spp_sample_busy = WICED_TRUE;
+    if (spp_mux_is_enabled())
     {
-        if (spp_tx_retry_count >= MAX_TX_RETRY)
-        {
-            WICED_BT_TRACE("Reached max tx retries! Terminating transfer!\n");
-            WICED_BT_TRACE("Make sure peer device is providing us credits\n");
-            spp_send_offset = 0;
-        }
-        else
-        {
-            WICED_BT_TRACE("wiced_start_timer spp_tx_timer %d\n", spp_send_offset);
-            wiced_start_timer(&spp_tx_timer, TX_RETRY_TIMEOUT);
-            spp_tx_retry_count++;
-        }
+        /* The multiplexer paces the bulk stream and lets control messages
+         * through in between
+         */
+        queued = spp_mux_send(spp_handle, SPP_MUX_STREAM_BULK, spp_sample_buffer,
+                              SPP_TOTAL_DATA_TO_SEND, spp_sample_sent, NULL);
     }
     else
     {
-        WICED_BT_TRACE("sent %d bytes of data\n", SPP_TOTAL_DATA_TO_SEND);
-        spp_send_offset = 0;
+        /* The transmit queue cuts the sample into frames of the link frame
+         * size and retries while the peer is out of credits
+         */
+        iov.p_data = spp_sample_buffer;
+        iov.len = SPP_TOTAL_DATA_TO_SEND;
+        iov.p_complete = spp_sample_sent;
+        iov.p_context = NULL;
+        queued = spp_send_iov(spp_handle, &iov, 1);
+    }
+    if (queued)
+    {
+        spp_sample_offset += SPP_TOTAL_DATA_TO_SEND;
     }
+    else
+    {
+        spp_sample_busy = WICED_FALSE;
+    }
+}
+
+/* Completion of the sample data, the buffer may be refilled */
+static void spp_sample_sent(void *p_context, wiced_bool_t sent)
+{
+    WICED_BT_TRACE("sample data %s\n", sent ? "sent" : "dropped");
+    spp_sample_busy = WICED_FALSE;
+}
+
+/* Multiplexer completion of a control message, the copy is freed */
+static void spp_control_data_sent(void *p_context, wiced_bool_t sent)
+{
+    wiced_bt_free_buffer(p_context);
+}
+
+/*******************************************************************************
+ * Function Name: spp_send_control_data
+ *******************************************************************************
+ * Summary:
+ *   Sends a message on the control stream, ahead of any queued bulk data.
+ *   The data is copied, the caller may reuse p_data on return.
+ *
+ * Parameters:
+ *   uint8_t *p_data : message
+ *   uint32_t len : message length
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the message was queued
+ *
+ ******************************************************************************/
+wiced_bool_t spp_send_control_data(uint8_t *p_data, uint32_t len)
+{
+    uint8_t *p_copy = (uint8_t *)wiced_bt_get_buffer(len);
+
+    if (NULL == p_copy)
+    {
+        return WICED_FALSE;
+    }
+    memcpy(p_copy, p_data, len);
+    if (!spp_mux_send(spp_handle, SPP_MUX_STREAM_CONTROL, p_copy, len, spp_control_data_sent, p_copy))
+    {
+        wiced_bt_free_buffer(p_copy);
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
 }
 
 /*******************************************************************************
- * Function Name: spp_tx_ack_timeout
+ * Function Name: spp_send_resumable_data
  *******************************************************************************
  * Summary:
- *   The timeout function is called to retry the trasnfer of data if transfer
- *   of big data over spp failed for any reason
+ *   Test function which sends large data to the peer as a resumable transfer.
+ *   If the link drops, the transfer continues from the last checkpoint
+ *   confirmed by the peer once the same peer reconnects. The peer must run
+ *   the transfer layer as well.
  *
  * Parameters:
- *   WICED_TIMER_PARAM_TYPE arg
+ *   uint32_t total_len : number of bytes to send
  *
  * Return:
  *   NONE
  *
  ******************************************************************************/
-static void spp_tx_ack_timeout(WICED_TIMER_PARAM_TYPE arg)
+void spp_send_resumable_data(uint32_t total_len)
 {
-    spp_send_sample_data();
+    if (!spp_xfer_start(spp_handle, total_len, spp_xfer_sample_fill))
+    {
+        fprintf(stdout, "Transfer not started, another transfer is in progress\n");
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the application statistics
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_print_stats(void)
+{
+    fprintf(stdout, "spp: handle %d rx_bytes %u\n", spp_handle, spp_rx_bytes);
+    spp_tx_print_stats();
+    spp_gatt_print_stats();
+    spp_l2cap_print_stats();
+    spp_pattern_print_stats();
+    spp_coalesce_print_stats();
+    spp_mux_print_stats();
+    spp_bcast_print_stats();
+    spp_shaper_print_stats();
+    spp_xfer_print_stats();
+    spp_lifecycle_print_stats();
+    spp_scan_print_stats();
+    spp_sink_print_stats();
+    spp_echo_print_stats();
+    spp_client_print_stats();
+    spp_startup_print_stats();
+    spp_sched_print_stats();
+    spp_ctl_print_stats();
+    spp_delta_print_stats();
+    spp_link_print_stats();
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_sample_fill
+ *******************************************************************************
+ * Summary:
+ *   Produces the content of a resumable sample transfer from the configured
+ *   pattern stream, as spp_send_sample_data does. The content depends only on
+ *   the offset, so any part of the transfer can be regenerated when resuming.
+ *
+ * Parameters:
+ *   uint32_t offset : transfer offset of p_buf[0]
+ *   uint8_t *p_buf : buffer to fill
+ *   uint32_t len : number of bytes to fill
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_sample_fill(uint32_t offset, uint8_t *p_buf, uint32_t len)
+{
+    spp_pattern_fill(offset, p_buf, len);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_rx_progress
+ *******************************************************************************
+ * Summary:
+ *   Receives resumable transfer content and reports the progress
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t xfer_id : transfer ID
+ *   uint32_t offset : transfer offset of p_data[0]
+ *   uint8_t *p_data : received content
+ *   uint32_t len : length of p_data
+ *   uint32_t total_len : total transfer length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_rx_progress(uint16_t handle, uint32_t xfer_id, uint32_t offset,
+                                 uint8_t *p_data, uint32_t len, uint32_t total_len)
+{
+    /* Delta sync messages are consumed by spp_delta.c */
+    if (spp_delta_rx_xfer(handle, xfer_id, offset, p_data, len, total_len))
+    {
+        return;
+    }
+    if (((offset + len) / SPP_XFER_ACK_INTERVAL != offset / SPP_XFER_ACK_INTERVAL) ||
+        (offset + len == total_len))
+    {
+        fprintf(stdout, "%s handle:%d xfer 0x%08x %u of %u bytes\n",
+                __FUNCTION__, handle, xfer_id, offset + len, total_len);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_stream_rx
+ *******************************************************************************
+ * Summary:
+ *   Prints a chunk received on the control stream, bulk stream chunks go to
+ *   the rx sink of the session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t stream_id : stream the chunk was received on
+ *   uint8_t *p_data : chunk payload
+ *   uint32_t len : chunk payload length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_mux_stream_rx(uint16_t handle, uint8_t stream_id, uint8_t *p_data, uint32_t len)
+{
+    if (SPP_MUX_STREAM_CONTROL != stream_id)
+    {
+        spp_sink_rx_data(handle, p_data, len);
+        return;
+    }
+    fprintf(stdout, "%s handle:%d stream:%d len:%d\n", __FUNCTION__, handle, stream_id, len);
+    fprintf(stdout, "data: %.*s\n", (int)len, (char *)p_data);
 }
 
 /*******************************************************************************
@@ -640,6 +1053,28 @@ static void spp_print_bd_address(wiced_bt_device_address_t bdadr)
                    bdadr[0], bdadr[1], bdadr[2], bdadr[3], bdadr[4], bdadr[5]);
 }
 
+/******************************************************************************
+ * Function Name: spp_get_time_us()
+ ******************************************************************************
+ * Summary:
+ *   Returns the monotonic time used for the application's latency and
+ *   throughput measurements
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   uint64_t : monotonic time in microseconds
+ *
+ ******************************************************************************/
+uint64_t spp_get_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
 /******************************************************************************
  * Function Name: spp_get_bt_event_name
  ******************************************************************************
@@ -691,6 +1126,8 @@ static const char *spp_get_bt_event_name(wiced_bt_management_evt_t event)
         CASE_RETURN_STR(BTM_SCO_CONNECTION_REQUEST_EVT)
         CASE_RETURN_STR(BTM_SCO_CONNECTION_CHANGE_EVT)
         CASE_RETURN_STR(BTM_BLE_CONNECTION_PARAM_UPDATE)
+        CASE_RETURN_STR(BTM_BLE_PHY_UPDATE_EVT)
+        CASE_RETURN_STR(BTM_BLE_DATA_LENGTH_UPDATE_EVENT)
     }
 
     return NULL;
@@ -0,0 +1,297 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_bcast.c
+ *
+ * Description: Reference-counted broadcast to every connected SPP session.
+ *
+ *              One buffer is queued on the transmit queue of each session,
+ *              holding one reference per session. Each session sends it at
+ *              the pace of its own RFCOMM credits, so a slow peer never holds
+ *              back a fast one, and the last session to finish releases the
+ *              buffer. The transmit queue sends full frames straight from the
+ *              buffer, only a partial last frame is packed per session.
+ *              With the stream multiplexer enabled, broadcasts go out on the
+ *              bulk stream.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_mux.h"
+#include "spp_bcast.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    const uint8_t *p_data;
+    uint32_t len;
+    uint32_t refs;       /* sessions still sending, plus one while queuing */
+    uint32_t delivered;
+    uint32_t dropped;
+    spp_bcast_release_cback_t p_release;
+    void *p_context;
+} spp_bcast_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_bcast_stats_t spp_bcast_stats;
+static pthread_mutex_t spp_bcast_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Drops one reference, the last one releases the broadcast */
+static void spp_bcast_put(spp_bcast_t *p_bcast)
+{
+    wiced_bool_t last;
+
+    pthread_mutex_lock(&spp_bcast_lock);
+    last = (0 == --p_bcast->refs) ? WICED_TRUE : WICED_FALSE;
+    if (last)
+    {
+        spp_bcast_stats.active--;
+        spp_bcast_stats.held_bytes -= p_bcast->len;
+    }
+    pthread_mutex_unlock(&spp_bcast_lock);
+
+    if (last)
+    {
+        if (NULL != p_bcast->p_release)
+        {
+            p_bcast->p_release(p_bcast->p_context, p_bcast->delivered, p_bcast->dropped);
+        }
+        free(p_bcast);
+    }
+}
+
+/* Transmit completion of one session */
+static void spp_bcast_session_done(void *p_context, wiced_bool_t sent)
+{
+    spp_bcast_t *p_bcast = p_context;
+
+    pthread_mutex_lock(&spp_bcast_lock);
+    if (sent)
+    {
+        p_bcast->delivered++;
+        spp_bcast_stats.deliveries++;
+    }
+    else
+    {
+        p_bcast->dropped++;
+        spp_bcast_stats.drops++;
+    }
+    spp_bcast_stats.naive_bytes -= p_bcast->len;
+    pthread_mutex_unlock(&spp_bcast_lock);
+
+    spp_bcast_put(p_bcast);
+}
+
+static void spp_bcast_free_copy(void *p_context, uint32_t delivered, uint32_t dropped)
+{
+    free(p_context);
+}
+
+/*******************************************************************************
+ * Function Name: spp_bcast_send
+ *******************************************************************************
+ * Summary:
+ *   Queues one buffer to every connected session without copying it. The
+ *   release callback is called exactly once, after the last session is done
+ *   with the buffer, which may be before this function returns.
+ *
+ * Parameters:
+ *   const uint8_t *p_data : data to broadcast, valid until released
+ *   uint32_t len : data length
+ *   spp_bcast_release_cback_t p_release : release callback, may be NULL
+ *   void *p_context : passed to the release callback
+ *
+ * Return:
+ *   int : number of sessions the buffer was queued to
+ *
+ ******************************************************************************/
+int spp_bcast_send(const uint8_t *p_data, uint32_t len, spp_bcast_release_cback_t p_release,
+                   void *p_context)
+{
+    uint16_t handles[SPP_MAX_SESSIONS];
+    spp_bcast_t *p_bcast;
+    spp_iovec_t iov;
+    wiced_bool_t queued;
+    int count;
+    int sessions = 0;
+    int i;
+
+    p_bcast = calloc(1, sizeof(*p_bcast));
+    if (NULL == p_bcast)
+    {
+        if (NULL != p_release)
+        {
+            p_release(p_context, 0, 0);
+        }
+        return 0;
+    }
+    p_bcast->p_data = p_data;
+    p_bcast->len = len;
+    p_bcast->p_release = p_release;
+    p_bcast->p_context = p_context;
+    count = spp_tx_get_handles(handles, SPP_MAX_SESSIONS);
+
+    /* The extra reference keeps the broadcast alive while it is queued,
+     * a session may complete before the next one is reached
+     */
+    pthread_mutex_lock(&spp_bcast_lock);
+    p_bcast->refs = count + 1;
+    spp_bcast_stats.broadcasts++;
+    spp_bcast_stats.active++;
+    spp_bcast_stats.held_bytes += len;
+    spp_bcast_stats.held_peak_bytes = MAX(spp_bcast_stats.held_peak_bytes, spp_bcast_stats.held_bytes);
+    spp_bcast_stats.naive_bytes += (uint64_t)len * count;
+    spp_bcast_stats.naive_peak_bytes = MAX(spp_bcast_stats.naive_peak_bytes, spp_bcast_stats.naive_bytes);
+    pthread_mutex_unlock(&spp_bcast_lock);
+
+    for (i = 0; i < count; i++)
+    {
+        if (spp_mux_is_enabled())
+        {
+            queued = spp_mux_send(handles[i], SPP_MUX_STREAM_BULK, p_data, len,
+                                  spp_bcast_session_done, p_bcast);
+        }
+        else
+        {
+            iov.p_data = p_data;
+            iov.len = len;
+            iov.p_complete = spp_bcast_session_done;
+            iov.p_context = p_bcast;
+            queued = spp_send_iov(handles[i], &iov, 1);
+        }
+        if (queued)
+        {
+            sessions++;
+        }
+        else
+        {
+            /* Queue full or session gone, no completion will come */
+            spp_bcast_session_done(p_bcast, WICED_FALSE);
+        }
+    }
+    spp_bcast_put(p_bcast);
+    return sessions;
+}
+
+/*******************************************************************************
+ * Function Name: spp_bcast_send_copy
+ *******************************************************************************
+ * Summary:
+ *   Broadcasts a copy of the data, so the caller may reuse its buffer at
+ *   once. The copy is made once whatever the number of sessions.
+ *
+ * Parameters:
+ *   const uint8_t *p_data : data to broadcast
+ *   uint32_t len : data length
+ *
+ * Return:
+ *   int : number of sessions the data was queued to
+ *
+ ******************************************************************************/
+int spp_bcast_send_copy(const uint8_t *p_data, uint32_t len)
+{
+    uint8_t *p_copy = malloc(len);
+
+    if (NULL == p_copy)
+    {
+        return 0;
+    }
+    memcpy(p_copy, p_data, len);
+    return spp_bcast_send(p_copy, len, spp_bcast_free_copy, p_copy);
+}
+
+/*******************************************************************************
+ * Function Name: spp_bcast_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the broadcast counters
+ *
+ * Parameters:
+ *   spp_bcast_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_bcast_get_stats(spp_bcast_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_bcast_lock);
+    *p_stats = spp_bcast_stats;
+    pthread_mutex_unlock(&spp_bcast_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_bcast_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the broadcast counters and the memory held, compared with one
+ *   copy per session
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_bcast_print_stats(void)
+{
+    spp_bcast_stats_t stats;
+
+    spp_bcast_get_stats(&stats);
+    fprintf(stdout, "bcast: %u broadcasts, %u active, %u deliveries, %u drops\n",
+            stats.broadcasts, stats.active, stats.deliveries, stats.drops);
+    fprintf(stdout, "bcast: held %llu bytes (peak %llu), per-session copies would hold %llu (peak %llu)\n",
+            (unsigned long long)stats.held_bytes, (unsigned long long)stats.held_peak_bytes,
+            (unsigned long long)stats.naive_bytes, (unsigned long long)stats.naive_peak_bytes);
+}
+
+/* END OF FILE [] */
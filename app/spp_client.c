@@ -0,0 +1,465 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_client.c
+ *
+ * Description: SPP client (initiator) role.
+ *
+ *              When a peer BD address is given, the application connects to
+ *              it once the stack is up, in addition to accepting incoming
+ *              connections. Once connected the session is served by the same
+ *              send and receive paths as an incoming one, so two instances
+ *              can benchmark each other. Lost or failed connections are
+ *              retried with exponential backoff.
+ *
+ *              wiced_bt_spp_connect() runs the SDP search for the serial port
+ *              service itself and has no variant taking a known RFCOMM
+ *              channel, so the search cannot be skipped from here. The
+ *              result of each search is cached per peer instead: a peer
+ *              known not to offer SPP is not paged again until a connection
+ *              is forced, and the connection latency of first connections
+ *              and reconnects is reported separately.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_spp.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_client.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SPP_CLIENT_IDLE,
+    SPP_CLIENT_CONNECTING,
+    SPP_CLIENT_CONNECTED,
+    SPP_CLIENT_RETRY_WAIT,
+} spp_client_state_t;
+
+/* Service discovery result of one peer */
+typedef struct
+{
+    wiced_bool_t in_use;
+    BD_ADDR bda;
+    wiced_bool_t has_spp;  /* a connection succeeded */
+    wiced_bool_t no_spp;   /* the search found no serial port service */
+} spp_client_peer_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *spp_client_state_names[] = { "idle", "connecting", "connected", "retry wait" };
+
+static wiced_bool_t spp_client_enabled = WICED_FALSE;
+static BD_ADDR spp_client_peer_bda;
+static spp_client_state_t spp_client_state = SPP_CLIENT_IDLE;
+static uint16_t spp_client_handle = 0;
+static uint32_t spp_client_retry_ms = SPP_CLIENT_RETRY_MIN_MS;
+static uint64_t spp_client_connect_start_us;
+static spp_client_peer_t spp_client_peers[SPP_CLIENT_MAX_CACHED_PEERS];
+static spp_client_stats_t spp_client_stats;
+static wiced_timer_t spp_client_timer;
+static pthread_mutex_t spp_client_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Must be called with spp_client_lock held, allocates the entry if needed */
+static spp_client_peer_t *spp_client_find_peer(const uint8_t *bda)
+{
+    spp_client_peer_t *p_free = NULL;
+    int i;
+
+    for (i = 0; i < SPP_CLIENT_MAX_CACHED_PEERS; i++)
+    {
+        if (spp_client_peers[i].in_use)
+        {
+            if (0 == memcmp(spp_client_peers[i].bda, bda, BD_ADDR_LEN))
+            {
+                return &spp_client_peers[i];
+            }
+        }
+        else if (NULL == p_free)
+        {
+            p_free = &spp_client_peers[i];
+        }
+    }
+    /* Full, the first entry is replaced */
+    p_free = (NULL != p_free) ? p_free : &spp_client_peers[0];
+    memset(p_free, 0, sizeof(*p_free));
+    p_free->in_use = WICED_TRUE;
+    memcpy(p_free->bda, bda, BD_ADDR_LEN);
+    return p_free;
+}
+
+static void spp_client_retry_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    spp_client_connect(WICED_FALSE);
+}
+
+/* Schedules the next attempt, doubling the delay after every failure */
+static void spp_client_schedule_retry(wiced_bool_t backoff)
+{
+    uint32_t delay_ms;
+
+    pthread_mutex_lock(&spp_client_lock);
+    spp_client_state = SPP_CLIENT_RETRY_WAIT;
+    delay_ms = spp_client_retry_ms;
+    spp_client_retry_ms = backoff ? MIN(spp_client_retry_ms * 2, SPP_CLIENT_RETRY_MAX_MS)
+                                  : SPP_CLIENT_RETRY_MIN_MS;
+    pthread_mutex_unlock(&spp_client_lock);
+
+    fprintf(stdout, "Reconnecting to peer in %u ms\n", delay_ms);
+    if (wiced_is_timer_in_use(&spp_client_timer))
+    {
+        wiced_stop_timer(&spp_client_timer);
+    }
+    wiced_start_timer(&spp_client_timer, delay_ms);
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_configure_peer
+ *******************************************************************************
+ * Summary:
+ *   Enables the client role towards a peer
+ *
+ * Parameters:
+ *   const char *p_bd_addr : peer address, "xx:xx:xx:xx:xx:xx"
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the address is not valid
+ *
+ ******************************************************************************/
+wiced_bool_t spp_client_configure_peer(const char *p_bd_addr)
+{
+    unsigned int bytes[BD_ADDR_LEN];
+    char end;
+    int i;
+
+    if (BD_ADDR_LEN != sscanf(p_bd_addr, "%2x:%2x:%2x:%2x:%2x:%2x%c", &bytes[0], &bytes[1],
+                              &bytes[2], &bytes[3], &bytes[4], &bytes[5], &end))
+    {
+        return WICED_FALSE;
+    }
+    for (i = 0; i < BD_ADDR_LEN; i++)
+    {
+        spp_client_peer_bda[i] = (uint8_t)bytes[i];
+    }
+    spp_client_enabled = WICED_TRUE;
+    return WICED_TRUE;
+}
+
+wiced_bool_t spp_client_is_enabled(void)
+{
+    return spp_client_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the client role, once the stack is up
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_init(void)
+{
+    wiced_init_timer(&spp_client_timer, spp_client_retry_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_connect
+ *******************************************************************************
+ * Summary:
+ *   Connects to the configured peer, unless it is connected or a connection
+ *   is in progress. A peer known not to offer SPP is skipped unless force
+ *   is set, which also clears what was cached about it.
+ *
+ * Parameters:
+ *   wiced_bool_t force : WICED_TRUE to connect even if the peer is known
+ *                        not to offer SPP
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_connect(wiced_bool_t force)
+{
+    spp_client_peer_t *p_peer;
+    wiced_result_t result;
+
+    if (!spp_client_enabled)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_client_lock);
+    if ((SPP_CLIENT_CONNECTING == spp_client_state) || (SPP_CLIENT_CONNECTED == spp_client_state))
+    {
+        pthread_mutex_unlock(&spp_client_lock);
+        return;
+    }
+    p_peer = spp_client_find_peer(spp_client_peer_bda);
+    if (force)
+    {
+        p_peer->no_spp = WICED_FALSE;
+        spp_client_retry_ms = SPP_CLIENT_RETRY_MIN_MS;
+    }
+    if (p_peer->no_spp)
+    {
+        spp_client_stats.skipped++;
+        spp_client_state = SPP_CLIENT_IDLE;
+        pthread_mutex_unlock(&spp_client_lock);
+        fprintf(stdout, "Peer has no serial port service, not connecting\n");
+        return;
+    }
+    spp_client_state = SPP_CLIENT_CONNECTING;
+    spp_client_stats.attempts++;
+    spp_client_connect_start_us = spp_get_time_us();
+    pthread_mutex_unlock(&spp_client_lock);
+
+    if (wiced_is_timer_in_use(&spp_client_timer))
+    {
+        wiced_stop_timer(&spp_client_timer);
+    }
+    fprintf(stdout, "Connecting to %02X:%02X:%02X:%02X:%02X:%02X\n", spp_client_peer_bda[0],
+            spp_client_peer_bda[1], spp_client_peer_bda[2], spp_client_peer_bda[3],
+            spp_client_peer_bda[4], spp_client_peer_bda[5]);
+    result = wiced_bt_spp_connect(spp_client_peer_bda);
+    if (WICED_BT_SUCCESS != result)
+    {
+        WICED_BT_TRACE("%s: wiced_bt_spp_connect failed %d\n", __FUNCTION__, result);
+        spp_client_connection_failed();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Records a connection to the peer and its latency. Connections from other
+ *   devices are ignored.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *bda : peer address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_connection_up(uint16_t handle, uint8_t *bda)
+{
+    spp_client_peer_t *p_peer;
+    uint64_t latency_us;
+
+    if (!spp_client_enabled || (0 != memcmp(bda, spp_client_peer_bda, BD_ADDR_LEN)))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_client_lock);
+    if (SPP_CLIENT_CONNECTING == spp_client_state)
+    {
+        latency_us = spp_get_time_us() - spp_client_connect_start_us;
+        p_peer = spp_client_find_peer(bda);
+        if (!p_peer->has_spp)
+        {
+            spp_client_stats.first_connect_us = latency_us;
+        }
+        else
+        {
+            spp_client_stats.reconnect_sum_us += latency_us;
+            spp_client_stats.reconnect_max_us = MAX(spp_client_stats.reconnect_max_us, latency_us);
+        }
+        p_peer->has_spp = WICED_TRUE;
+        spp_client_stats.connects++;
+    }
+    /* The peer may also have connected to us first */
+    spp_client_state = SPP_CLIENT_CONNECTED;
+    spp_client_handle = handle;
+    spp_client_retry_ms = SPP_CLIENT_RETRY_MIN_MS;
+    pthread_mutex_unlock(&spp_client_lock);
+
+    if (wiced_is_timer_in_use(&spp_client_timer))
+    {
+        wiced_stop_timer(&spp_client_timer);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Reconnects when the session with the peer goes down
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_connection_down(uint16_t handle)
+{
+    if (!spp_client_enabled || (handle != spp_client_handle))
+    {
+        return;
+    }
+    spp_client_handle = 0;
+    spp_client_schedule_retry(WICED_FALSE);
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_connection_failed
+ *******************************************************************************
+ * Summary:
+ *   SPP connection establishment failed callback, retries with backoff
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_connection_failed(void)
+{
+    pthread_mutex_lock(&spp_client_lock);
+    spp_client_stats.failures++;
+    pthread_mutex_unlock(&spp_client_lock);
+    fprintf(stdout, "Connection to peer failed\n");
+    if (spp_client_enabled)
+    {
+        spp_client_schedule_retry(WICED_TRUE);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_service_not_found
+ *******************************************************************************
+ * Summary:
+ *   SPP service not found callback. The peer is cached as not offering SPP
+ *   and is not paged again until a connection is forced.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_service_not_found(void)
+{
+    pthread_mutex_lock(&spp_client_lock);
+    spp_client_stats.not_found++;
+    spp_client_find_peer(spp_client_peer_bda)->no_spp = WICED_TRUE;
+    spp_client_state = SPP_CLIENT_IDLE;
+    pthread_mutex_unlock(&spp_client_lock);
+    fprintf(stdout, "Peer has no serial port service\n");
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the client role counters
+ *
+ * Parameters:
+ *   spp_client_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_get_stats(spp_client_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_client_lock);
+    *p_stats = spp_client_stats;
+    pthread_mutex_unlock(&spp_client_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_client_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the client role state, counters and connection latencies
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_client_print_stats(void)
+{
+    spp_client_stats_t stats;
+    uint32_t reconnects;
+
+    if (!spp_client_enabled)
+    {
+        fprintf(stdout, "client: disabled\n");
+        return;
+    }
+    spp_client_get_stats(&stats);
+    reconnects = (0 != stats.connects) ? stats.connects - 1 : 0;
+    fprintf(stdout, "client: peer %02X:%02X:%02X:%02X:%02X:%02X %s, %u attempts, %u connects, "
+            "%u failures, %u not found, %u skipped\n",
+            spp_client_peer_bda[0], spp_client_peer_bda[1], spp_client_peer_bda[2],
+            spp_client_peer_bda[3], spp_client_peer_bda[4], spp_client_peer_bda[5],
+            spp_client_state_names[spp_client_state], stats.attempts, stats.connects,
+            stats.failures, stats.not_found, stats.skipped);
+    fprintf(stdout, "client: first connect %llu ms, reconnect avg %llu ms max %llu ms\n",
+            (unsigned long long)(stats.first_connect_us / 1000),
+            (unsigned long long)((0 != reconnects) ? stats.reconnect_sum_us / reconnects / 1000 : 0),
+            (unsigned long long)(stats.reconnect_max_us / 1000));
+}
+
+/* END OF FILE [] */
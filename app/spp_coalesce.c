@@ -0,0 +1,556 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_coalesce.c
+ *
+ * Description: Optional small-write coalescing stage (Nagle-style batching)
+ *              in front of the SPP transmit queue.
+ *
+ *              Small writes to a session are appended to one frame buffer
+ *              taken from the stack heap. The frame is handed to the transmit
+ *              queue when it reaches the session's current frame size
+ *              (spp_tx_get_frame_size(), at most SPP_MAX_PAYLOAD), when its
+ *              oldest byte has waited for the configured deadline, or on an
+ *              explicit spp_coalesce_flush(). With coalescing disabled every
+ *              write is flushed at once.
+ *
+ *              Entries are only created for sessions the transmit queue
+ *              reports open. A frame which can no longer be queued because
+ *              its session is gone is freed and the entry dropped.
+ *
+ *              The deadline is configured in microseconds and enforced both
+ *              on every write and by a WICED timer. WICED timers have
+ *              millisecond resolution, so a frame which receives no further
+ *              writes is flushed up to 1 ms after its deadline.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_memory.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_coalesce.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SPP_COALESCE_FLUSH_FULL,
+    SPP_COALESCE_FLUSH_DEADLINE,
+    SPP_COALESCE_FLUSH_EXPLICIT,
+} spp_coalesce_reason_t;
+
+typedef struct
+{
+    uint16_t handle;   /* 0 if the entry is free */
+    uint8_t *p_frame;  /* frame being filled, NULL if empty */
+    uint32_t len;      /* bytes in p_frame */
+    uint32_t limit;    /* flush threshold, the session frame size */
+    uint64_t first_us; /* time the oldest byte in p_frame was written */
+} spp_coalesce_session_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_coalesce_session_t spp_coalesce_sessions[SPP_MAX_SESSIONS];
+static spp_coalesce_stats_t spp_coalesce_stats;
+static wiced_bool_t spp_coalesce_enabled = WICED_FALSE;
+static uint32_t spp_coalesce_deadline_us = SPP_COALESCE_DEFAULT_DEADLINE_US;
+static pthread_mutex_t spp_coalesce_lock = PTHREAD_MUTEX_INITIALIZER;
+static wiced_timer_t spp_coalesce_timer;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static void spp_coalesce_timeout(WICED_TIMER_PARAM_TYPE arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Transmit queue completion, the frame buffer goes back to the stack heap */
+static void spp_coalesce_frame_sent(void *p_context, wiced_bool_t sent)
+{
+    wiced_bt_free_buffer(p_context);
+}
+
+/* Must be called with spp_coalesce_lock held */
+static spp_coalesce_session_t *spp_coalesce_find(uint16_t handle, wiced_bool_t create)
+{
+    spp_coalesce_session_t *p_free = NULL;
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if (spp_coalesce_sessions[i].handle == handle)
+        {
+            return &spp_coalesce_sessions[i];
+        }
+        if ((NULL == p_free) && (0 == spp_coalesce_sessions[i].handle))
+        {
+            p_free = &spp_coalesce_sessions[i];
+        }
+    }
+    if (create && (NULL != p_free))
+    {
+        memset(p_free, 0, sizeof(*p_free));
+        p_free->handle = handle;
+        return p_free;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_flush_locked
+ *******************************************************************************
+ * Summary:
+ *   Hands the frame being filled to the transmit queue. Queueing happens
+ *   under spp_coalesce_lock so frames of a session keep their order; the
+ *   caller sends them with spp_tx_kick() once the lock is released. If the
+ *   transmit queue no longer knows the session the frame is freed and the
+ *   entry dropped, the caller sees p_session->handle == 0.
+ *
+ * Parameters:
+ *   spp_coalesce_session_t *p_session : session
+ *   spp_coalesce_reason_t reason : why the frame is flushed
+ *   uint64_t now_us : current time
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if a frame was queued
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_coalesce_flush_locked(spp_coalesce_session_t *p_session,
+                                              spp_coalesce_reason_t reason, uint64_t now_us)
+{
+    spp_iovec_t iov;
+    uint32_t delay_us;
+
+    if ((NULL == p_session->p_frame) || (0 == p_session->len))
+    {
+        return WICED_FALSE;
+    }
+
+    iov.p_data = p_session->p_frame;
+    iov.len = p_session->len;
+    iov.p_complete = spp_coalesce_frame_sent;
+    iov.p_context = p_session->p_frame;
+    if (!spp_tx_enqueue(p_session->handle, &iov, 1))
+    {
+        if (0 == spp_tx_get_frame_size(p_session->handle))
+        {
+            /* Session is gone, nothing will ever take this frame */
+            wiced_bt_free_buffer(p_session->p_frame);
+            memset(p_session, 0, sizeof(*p_session));
+        }
+        /* Otherwise the transmit queue is full, keep filling and try again later */
+        return WICED_FALSE;
+    }
+
+    delay_us = (uint32_t)(now_us - p_session->first_us);
+    spp_coalesce_stats.frames++;
+    spp_coalesce_stats.bytes += p_session->len;
+    spp_coalesce_stats.capacity += p_session->limit;
+    spp_coalesce_stats.delay_total_us += delay_us;
+    spp_coalesce_stats.delay_max_us = MAX(spp_coalesce_stats.delay_max_us, delay_us);
+    switch (reason)
+    {
+    case SPP_COALESCE_FLUSH_FULL:
+        spp_coalesce_stats.flush_full++;
+        break;
+    case SPP_COALESCE_FLUSH_DEADLINE:
+        spp_coalesce_stats.flush_deadline++;
+        break;
+    default:
+        spp_coalesce_stats.flush_explicit++;
+        break;
+    }
+
+    p_session->p_frame = NULL;
+    p_session->len = 0;
+    return WICED_TRUE;
+}
+
+/* Starts the deadline timer if it is not already running */
+static void spp_coalesce_arm_timer(uint32_t wait_us)
+{
+    if (!wiced_is_timer_in_use(&spp_coalesce_timer))
+    {
+        wiced_start_timer(&spp_coalesce_timer, (wait_us + 999) / 1000);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_timeout
+ *******************************************************************************
+ * Summary:
+ *   Flushes every frame whose oldest byte has reached the deadline and
+ *   re-arms the timer for the next one
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_coalesce_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    uint16_t kick[SPP_MAX_SESSIONS];
+    spp_coalesce_session_t *p_session;
+    uint64_t now_us = spp_get_time_us();
+    uint32_t next_us = 0;
+    uint32_t age_us;
+    int kick_count = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_coalesce_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        p_session = &spp_coalesce_sessions[i];
+        if ((0 == p_session->handle) || (0 == p_session->len))
+        {
+            continue;
+        }
+        age_us = (uint32_t)(now_us - p_session->first_us);
+        if ((age_us >= spp_coalesce_deadline_us) &&
+            spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_DEADLINE, now_us))
+        {
+            kick[kick_count++] = p_session->handle;
+            continue;
+        }
+        if (0 == p_session->handle)
+        {
+            continue;
+        }
+        age_us = (age_us >= spp_coalesce_deadline_us) ? 1000 : spp_coalesce_deadline_us - age_us;
+        next_us = (0 == next_us) ? age_us : MIN(next_us, age_us);
+    }
+    if (0 != next_us)
+    {
+        spp_coalesce_arm_timer(next_us);
+    }
+    pthread_mutex_unlock(&spp_coalesce_lock);
+
+    for (i = 0; i < kick_count; i++)
+    {
+        spp_tx_kick(kick[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the coalescing stage
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_init(void)
+{
+    wiced_init_timer(&spp_coalesce_timer, spp_coalesce_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_configure
+ *******************************************************************************
+ * Summary:
+ *   Enables or disables coalescing and sets the flush deadline
+ *
+ * Parameters:
+ *   wiced_bool_t enable : WICED_TRUE to merge small writes
+ *   uint32_t deadline_us : longest time a byte may wait, in microseconds
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_configure(wiced_bool_t enable, uint32_t deadline_us)
+{
+    pthread_mutex_lock(&spp_coalesce_lock);
+    spp_coalesce_enabled = enable;
+    spp_coalesce_deadline_us = (0 != deadline_us) ? deadline_us : SPP_COALESCE_DEFAULT_DEADLINE_US;
+    pthread_mutex_unlock(&spp_coalesce_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_write
+ *******************************************************************************
+ * Summary:
+ *   Writes data to a session through the coalescing stage. The data is
+ *   copied, the caller may reuse p_data on return.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const uint8_t *p_data : data to send
+ *   uint32_t len : length of p_data
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if (part of) the data could not be queued
+ *
+ ******************************************************************************/
+wiced_bool_t spp_coalesce_write(uint16_t handle, const uint8_t *p_data, uint32_t len)
+{
+    spp_coalesce_session_t *p_session;
+    wiced_bool_t ret = WICED_TRUE;
+    wiced_bool_t queued = WICED_FALSE;
+    uint64_t now_us = spp_get_time_us();
+    uint32_t frame_size;
+    uint32_t chunk;
+
+    pthread_mutex_lock(&spp_coalesce_lock);
+    spp_coalesce_stats.writes++;
+    frame_size = spp_tx_get_frame_size(handle);
+    p_session = spp_coalesce_find(handle, (0 != frame_size) ? WICED_TRUE : WICED_FALSE);
+    if ((0 == frame_size) && (NULL != p_session))
+    {
+        /* Session closed without spp_coalesce_connection_down() yet */
+        if (NULL != p_session->p_frame)
+        {
+            wiced_bt_free_buffer(p_session->p_frame);
+        }
+        memset(p_session, 0, sizeof(*p_session));
+        p_session = NULL;
+    }
+    if (NULL == p_session)
+    {
+        spp_coalesce_stats.write_failures++;
+        pthread_mutex_unlock(&spp_coalesce_lock);
+        return WICED_FALSE;
+    }
+    /* The frame size follows the link profile, the buffer is always SPP_MAX_PAYLOAD */
+    p_session->limit = MIN(frame_size, SPP_MAX_PAYLOAD);
+
+    if ((0 != p_session->len) && (now_us - p_session->first_us >= spp_coalesce_deadline_us))
+    {
+        queued |= spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_DEADLINE, now_us);
+    }
+    if ((0 != p_session->len) && (p_session->len >= p_session->limit))
+    {
+        /* Frame size shrank below what is already buffered */
+        queued |= spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_FULL, now_us);
+    }
+    while ((0 != len) && (0 != p_session->handle))
+    {
+        if (NULL == p_session->p_frame)
+        {
+            p_session->p_frame = (uint8_t *)wiced_bt_get_buffer(SPP_MAX_PAYLOAD);
+            if (NULL == p_session->p_frame)
+            {
+                ret = WICED_FALSE;
+                break;
+            }
+            p_session->len = 0;
+        }
+        if (p_session->len >= p_session->limit)
+        {
+            /* A full frame the transmit queue could not take yet */
+            ret = WICED_FALSE;
+            break;
+        }
+        if (0 == p_session->len)
+        {
+            p_session->first_us = now_us;
+        }
+        chunk = MIN(len, p_session->limit - p_session->len);
+        memcpy(&p_session->p_frame[p_session->len], p_data, chunk);
+        p_session->len += chunk;
+        p_data += chunk;
+        len -= chunk;
+        if (p_session->len == p_session->limit)
+        {
+            queued |= spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_FULL, now_us);
+        }
+    }
+    if (0 == p_session->handle)
+    {
+        /* Dropped by spp_coalesce_flush_locked(), the session is gone */
+        ret = WICED_FALSE;
+    }
+    if (!spp_coalesce_enabled)
+    {
+        queued |= spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_EXPLICIT, now_us);
+    }
+    if ((0 != p_session->handle) && (0 != p_session->len))
+    {
+        chunk = (uint32_t)(now_us - p_session->first_us);
+        spp_coalesce_arm_timer((chunk < spp_coalesce_deadline_us) ? spp_coalesce_deadline_us - chunk : 1000);
+    }
+    if (!ret)
+    {
+        spp_coalesce_stats.write_failures++;
+    }
+    pthread_mutex_unlock(&spp_coalesce_lock);
+
+    if (queued)
+    {
+        spp_tx_kick(handle);
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_flush
+ *******************************************************************************
+ * Summary:
+ *   Sends the data coalesced so far on a session without waiting for the
+ *   deadline
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_flush(uint16_t handle)
+{
+    spp_coalesce_session_t *p_session;
+    wiced_bool_t queued = WICED_FALSE;
+
+    pthread_mutex_lock(&spp_coalesce_lock);
+    p_session = spp_coalesce_find(handle, WICED_FALSE);
+    if (NULL != p_session)
+    {
+        queued = spp_coalesce_flush_locked(p_session, SPP_COALESCE_FLUSH_EXPLICIT, spp_get_time_us());
+    }
+    pthread_mutex_unlock(&spp_coalesce_lock);
+
+    if (queued)
+    {
+        spp_tx_kick(handle);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Drops data coalesced for a session which went down
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_connection_down(uint16_t handle)
+{
+    spp_coalesce_session_t *p_session;
+    uint8_t *p_frame = NULL;
+
+    pthread_mutex_lock(&spp_coalesce_lock);
+    p_session = spp_coalesce_find(handle, WICED_FALSE);
+    if (NULL != p_session)
+    {
+        p_frame = p_session->p_frame;
+        memset(p_session, 0, sizeof(*p_session));
+    }
+    pthread_mutex_unlock(&spp_coalesce_lock);
+
+    if (NULL != p_frame)
+    {
+        wiced_bt_free_buffer(p_frame);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the coalescing counters
+ *
+ * Parameters:
+ *   spp_coalesce_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_get_stats(spp_coalesce_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_coalesce_lock);
+    *p_stats = spp_coalesce_stats;
+    pthread_mutex_unlock(&spp_coalesce_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_coalesce_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the coalescing counters, the average frame fill ratio and the
+ *   queueing delay added by coalescing
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_coalesce_print_stats(void)
+{
+    spp_coalesce_stats_t stats;
+    double fill = 0;
+    double delay = 0;
+
+    spp_coalesce_get_stats(&stats);
+    if (0 != stats.frames)
+    {
+        fill = 100.0 * stats.bytes / (double)stats.capacity;
+        delay = (double)stats.delay_total_us / stats.frames;
+    }
+    fprintf(stdout, "coalesce: %s deadline %u us, writes %llu frames %llu bytes %llu\n",
+            spp_coalesce_enabled ? "on" : "off", spp_coalesce_deadline_us,
+            (unsigned long long)stats.writes, (unsigned long long)stats.frames,
+            (unsigned long long)stats.bytes);
+    fprintf(stdout, "coalesce: fill %.1f%%, delay avg %.0f us max %u us, flush full %llu deadline %llu explicit %llu\n",
+            fill, delay, stats.delay_max_us, (unsigned long long)stats.flush_full,
+            (unsigned long long)stats.flush_deadline, (unsigned long long)stats.flush_explicit);
+}
+
+/* END OF FILE [] */
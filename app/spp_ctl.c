@@ -0,0 +1,1515 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_ctl.c
+ *
+ * Description: Control socket of the headless (daemon) mode.
+ *
+ *              With --daemon <path> the main thread serves a Unix stream
+ *              socket instead of the menu. Tools and services connect to it
+ *              to send data or files on a session, list the sessions,
+ *              disconnect one or read the statistics. Requests and
+ *              responses are length prefixed binary messages (see
+ *              spp_ctl.h), list and statistics responses carry JSON.
+ *
+ *              One epoll loop serves every client with non-blocking
+ *              sockets, so a slow or stuck client never holds up another
+ *              one or the BT stack thread. The payload of a send request is
+ *              received straight into the buffer handed to spp_send_iov(),
+ *              so the data is not copied again before the transport takes
+ *              it. A file is read with pread() in chunks of
+ *              SPP_CTL_FILE_CHUNK bytes, each queued once the one before it
+ *              was sent. Transmit completions wake the loop through an
+ *              eventfd. If the transmit queue of the session is full, or a
+ *              file of the client is being sent, the loop stops reading from
+ *              that client until the queue drains or the file is sent.
+ *
+ *              The socket is only accessible to the user running the
+ *              application, or also to one group with --daemon-group, and
+ *              the credentials of every client are checked on accept.
+ *              SEND_FILE is refused unless --daemon-files names the
+ *              directory files may be sent from. A file truncated while it
+ *              is sent fails only its own request with FILE_ERROR, after
+ *              the bytes read so far were sent.
+ *
+ *              SIGINT and SIGTERM stop the loop and remove the socket.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <limits.h>
+#include <pthread.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_scan.h"
+#include "spp_ctl.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* epoll tags of the loop's own descriptors, clients follow */
+#define SPP_CTL_TAG_LISTEN                      ( 0 )
+#define SPP_CTL_TAG_EVENT                       ( 1 )
+#define SPP_CTL_TAG_SIGNAL                      ( 2 )
+#define SPP_CTL_TAG_CLIENT                      ( 16 )
+
+/* How often sends held for a full queue are retried without a completion */
+#define SPP_CTL_RETRY_MS                        ( 100 )
+
+/* Responses not yet read by a client, beyond which it is dropped */
+#define SPP_CTL_MAX_OUT_LEN                     ( 1024 * 1024 )
+
+#define SPP_CTL_JSON_LEN                        ( 4096 )
+
+/* Bytes of a file read and queued at a time by SEND_FILE */
+#define SPP_CTL_FILE_CHUNK                      ( 256 * 1024 )
+
+/* Supplementary groups looked at when checking a client against the group */
+#define SPP_CTL_MAX_GROUPS                      ( 64 )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* A request, owned by the transmit queue from spp_send_iov() until its
+ * completion is collected by the loop
+ */
+typedef struct spp_ctl_req
+{
+    struct spp_ctl_req *p_next;
+    int client;                  /* slot of the client which sent it */
+    uint32_t generation;         /* of the client slot */
+    uint8_t op;
+    uint16_t handle;
+    uint8_t *p_data;             /* payload, or the chunk of a file being sent */
+    uint32_t len;
+    int fd;                      /* file being sent, -1 if none */
+    uint64_t file_offset;        /* of the next chunk */
+    uint64_t file_left;          /* bytes of the file not read yet */
+    wiced_bool_t sent;
+} spp_ctl_req_t;
+
+typedef struct
+{
+    int fd;                      /* -1 if the slot is free */
+    uint32_t generation;         /* bumped on close, stale completions are not answered */
+    uint8_t hdr[SPP_CTL_HDR_LEN];
+    uint32_t hdr_len;            /* header bytes received */
+    spp_ctl_req_t *p_req;        /* request being received */
+    uint32_t payload_len;        /* payload bytes received */
+    spp_ctl_req_t *p_pending;    /* send held until the queue has room */
+    spp_ctl_req_t *p_file;       /* file being sent, requests behind it wait */
+    uint8_t *p_out;              /* responses not yet sent */
+    uint32_t out_len;
+    uint32_t out_size;
+    wiced_bool_t closing;        /* close once the responses are out */
+    uint32_t events;             /* registered with epoll */
+} spp_ctl_client_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static char spp_ctl_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static wiced_bool_t spp_ctl_enabled = WICED_FALSE;
+static wiced_bool_t spp_ctl_group_set = WICED_FALSE;
+static gid_t spp_ctl_group;
+static char spp_ctl_group_name[64];
+static char spp_ctl_file_dir[PATH_MAX];  /* resolved, empty if SEND_FILE is refused */
+static int spp_ctl_epoll_fd = -1;
+static int spp_ctl_event_fd = -1;
+static spp_ctl_client_t spp_ctl_clients[SPP_CTL_MAX_CLIENTS];
+
+/* Completions collected for the loop, and the counters */
+static spp_ctl_req_t *p_spp_ctl_done_head;
+static spp_ctl_req_t *p_spp_ctl_done_tail;
+static spp_ctl_stats_t spp_ctl_stats;
+static pthread_mutex_t spp_ctl_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_ctl_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t spp_ctl_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void spp_ctl_req_free(spp_ctl_req_t *p_req)
+{
+    if (p_req->fd >= 0)
+    {
+        close(p_req->fd);
+    }
+    free(p_req->p_data);
+    free(p_req);
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_update_events
+ *******************************************************************************
+ * Summary:
+ *   Registers the events a client waits for: requests unless a send is held
+ *   or a file is being sent, and room to write while responses are pending
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_update_events(spp_ctl_client_t *p_client)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    if ((NULL == p_client->p_pending) && (NULL == p_client->p_file) && !p_client->closing)
+    {
+        event.events |= EPOLLIN;
+    }
+    if (0 != p_client->out_len)
+    {
+        event.events |= EPOLLOUT;
+    }
+    if (event.events == p_client->events)
+    {
+        return;
+    }
+    event.data.u32 = SPP_CTL_TAG_CLIENT + (uint32_t)(p_client - spp_ctl_clients);
+    epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_MOD, p_client->fd, &event);
+    p_client->events = event.events;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_client_close
+ *******************************************************************************
+ * Summary:
+ *   Closes a client and frees what it had not handed to the transmit queue.
+ *   Its queued sends still go out, their completions are not answered.
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_client_close(spp_ctl_client_t *p_client)
+{
+    if (p_client->fd < 0)
+    {
+        return;
+    }
+    epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_DEL, p_client->fd, NULL);
+    close(p_client->fd);
+    if (NULL != p_client->p_req)
+    {
+        spp_ctl_req_free(p_client->p_req);
+    }
+    if (NULL != p_client->p_pending)
+    {
+        spp_ctl_req_free(p_client->p_pending);
+    }
+    /* A file chunk still queued is freed when its completion is collected */
+    p_client->p_file = NULL;
+    free(p_client->p_out);
+    memset(p_client->hdr, 0, sizeof(p_client->hdr));
+    p_client->fd = -1;
+    p_client->generation++;
+    p_client->hdr_len = 0;
+    p_client->p_req = NULL;
+    p_client->payload_len = 0;
+    p_client->p_pending = NULL;
+    p_client->p_out = NULL;
+    p_client->out_len = 0;
+    p_client->out_size = 0;
+    p_client->closing = WICED_FALSE;
+    p_client->events = 0;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_client_flush
+ *******************************************************************************
+ * Summary:
+ *   Writes as much of the pending responses as the socket takes
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_client_flush(spp_ctl_client_t *p_client)
+{
+    uint32_t done = 0;
+    ssize_t n;
+
+    while ((p_client->fd >= 0) && (done < p_client->out_len))
+    {
+        n = send(p_client->fd, p_client->p_out + done, p_client->out_len - done,
+                 MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+        {
+            done += (uint32_t)n;
+        }
+        else if ((n < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if ((n < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+        {
+            break;
+        }
+        else
+        {
+            spp_ctl_client_close(p_client);
+            return;
+        }
+    }
+    if (p_client->fd < 0)
+    {
+        return;
+    }
+    if (0 != done)
+    {
+        memmove(p_client->p_out, p_client->p_out + done, p_client->out_len - done);
+        p_client->out_len -= done;
+    }
+    if (p_client->closing && (0 == p_client->out_len))
+    {
+        spp_ctl_client_close(p_client);
+        return;
+    }
+    spp_ctl_update_events(p_client);
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_reply
+ *******************************************************************************
+ * Summary:
+ *   Queues a response to a client and tries to send it
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *   uint8_t op : request answered
+ *   uint8_t status : SPP_CTL_STATUS_*
+ *   uint16_t handle : session the request was for
+ *   const char *p_payload : response payload, may be NULL
+ *   uint32_t len : payload length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_reply(spp_ctl_client_t *p_client, uint8_t op, uint8_t status, uint16_t handle,
+                          const char *p_payload, uint32_t len)
+{
+    uint32_t needed = p_client->out_len + SPP_CTL_HDR_LEN + len;
+    uint8_t *p_out;
+
+    if (p_client->fd < 0)
+    {
+        return;
+    }
+    if (needed > SPP_CTL_MAX_OUT_LEN)
+    {
+        /* It does not read its responses */
+        WICED_BT_TRACE("ctl: client %d not reading, dropped\n", (int)(p_client - spp_ctl_clients));
+        spp_ctl_client_close(p_client);
+        return;
+    }
+    if (needed > p_client->out_size)
+    {
+        p_out = realloc(p_client->p_out, needed);
+        if (NULL == p_out)
+        {
+            spp_ctl_client_close(p_client);
+            return;
+        }
+        p_client->p_out = p_out;
+        p_client->out_size = needed;
+    }
+    p_out = p_client->p_out + p_client->out_len;
+    spp_ctl_put_u32(p_out, len);
+    p_out[4] = op;
+    p_out[5] = status;
+    p_out[6] = (uint8_t)handle;
+    p_out[7] = (uint8_t)(handle >> 8);
+    if (0 != len)
+    {
+        memcpy(p_out + SPP_CTL_HDR_LEN, p_payload, len);
+    }
+    p_client->out_len = needed;
+    spp_ctl_client_flush(p_client);
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_send_complete
+ *******************************************************************************
+ * Summary:
+ *   Transmit completion of a send request. Runs on whichever thread released
+ *   the segment, so it only hands the request over to the loop.
+ *
+ * Parameters:
+ *   void *p_context : request
+ *   wiced_bool_t sent : WICED_FALSE if dropped on disconnect
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_send_complete(void *p_context, wiced_bool_t sent)
+{
+    spp_ctl_req_t *p_req = (spp_ctl_req_t *)p_context;
+    uint64_t one = 1;
+
+    p_req->sent = sent;
+    p_req->p_next = NULL;
+    pthread_mutex_lock(&spp_ctl_lock);
+    if (NULL == p_spp_ctl_done_tail)
+    {
+        p_spp_ctl_done_head = p_req;
+    }
+    else
+    {
+        p_spp_ctl_done_tail->p_next = p_req;
+    }
+    p_spp_ctl_done_tail = p_req;
+    if (sent)
+    {
+        spp_ctl_stats.bytes_sent += p_req->len;
+    }
+    if ((spp_ctl_event_fd >= 0) && (write(spp_ctl_event_fd, &one, sizeof(one)) < 0))
+    {
+        /* The counter is already set, the loop wakes up anyway */
+    }
+    pthread_mutex_unlock(&spp_ctl_lock);
+}
+
+static wiced_bool_t spp_ctl_session_exists(uint16_t handle)
+{
+    uint16_t handles[SPP_MAX_SESSIONS];
+    int count = spp_tx_get_handles(handles, SPP_MAX_SESSIONS);
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((0 != handle) && (handles[i] == handle))
+        {
+            return WICED_TRUE;
+        }
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_submit
+ *******************************************************************************
+ * Summary:
+ *   Hands the payload of a send request to the transmit queue. If the queue
+ *   is full, the request is held and the client is not read until it fits.
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client which sent the request
+ *   spp_ctl_req_t *p_req : send request
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_submit(spp_ctl_client_t *p_client, spp_ctl_req_t *p_req)
+{
+    spp_iovec_t iov;
+    wiced_bool_t held = (p_client->p_pending == p_req);
+
+    iov.p_data = p_req->p_data;
+    iov.len = p_req->len;
+    iov.p_complete = spp_ctl_send_complete;
+    iov.p_context = p_req;
+    p_client->p_pending = NULL;
+
+    /* Counted first, the completion may run before spp_send_iov() returns */
+    pthread_mutex_lock(&spp_ctl_lock);
+    spp_ctl_stats.bytes_queued += p_req->len;
+    pthread_mutex_unlock(&spp_ctl_lock);
+    if (spp_send_iov(p_req->handle, &iov, 1))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_ctl_lock);
+    spp_ctl_stats.bytes_queued -= p_req->len;
+    if (!held)
+    {
+        spp_ctl_stats.queue_waits++;
+    }
+    pthread_mutex_unlock(&spp_ctl_lock);
+    if (!spp_ctl_session_exists(p_req->handle))
+    {
+        if (p_client->p_file == p_req)
+        {
+            p_client->p_file = NULL;
+        }
+        spp_ctl_reply(p_client, p_req->op, SPP_CTL_STATUS_NO_SESSION, p_req->handle, NULL, 0);
+        spp_ctl_req_free(p_req);
+        return;
+    }
+    p_client->p_pending = p_req;
+}
+
+/* Tells whether a resolved path lies in the --daemon-files directory */
+static wiced_bool_t spp_ctl_in_file_dir(const char *p_real)
+{
+    size_t len = strlen(spp_ctl_file_dir);
+
+    if ((0 == len) || (0 != strncmp(p_real, spp_ctl_file_dir, len)))
+    {
+        return WICED_FALSE;
+    }
+    return (('/' == p_real[len]) || ((1 == len) && ('\0' != p_real[1]))) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_read_chunk
+ *******************************************************************************
+ * Summary:
+ *   Reads the next chunk of the file of a send file request into its buffer.
+ *   The file is read, not mapped, so one truncated while it is sent fails
+ *   this request instead of faulting the application.
+ *
+ * Parameters:
+ *   spp_ctl_req_t *p_req : send file request with file_left not 0
+ *
+ * Return:
+ *   uint8_t : SPP_CTL_STATUS_OK, or SPP_CTL_STATUS_FILE_ERROR if the file
+ *             could not be read or is shorter than it was when opened
+ *
+ ******************************************************************************/
+static uint8_t spp_ctl_read_chunk(spp_ctl_req_t *p_req)
+{
+    uint32_t want = (uint32_t)MIN(p_req->file_left, SPP_CTL_FILE_CHUNK);
+    uint32_t got = 0;
+    ssize_t n;
+
+    while (got < want)
+    {
+        n = pread(p_req->fd, p_req->p_data + got, want - got, (off_t)(p_req->file_offset + got));
+        if ((n < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return SPP_CTL_STATUS_FILE_ERROR;
+        }
+        got += (uint32_t)n;
+    }
+    p_req->file_offset += got;
+    p_req->file_left -= got;
+    p_req->len = got;
+    return SPP_CTL_STATUS_OK;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_open_file
+ *******************************************************************************
+ * Summary:
+ *   Opens the file named by a send file request and reads its first chunk
+ *   in place of the path. A relative path is taken from the --daemon-files
+ *   directory, and the file opened must lie inside it once symbolic links
+ *   are resolved.
+ *
+ * Parameters:
+ *   spp_ctl_req_t *p_req : request, p_data holds the NUL terminated path
+ *
+ * Return:
+ *   uint8_t : SPP_CTL_STATUS_OK, SPP_CTL_STATUS_FILE_ERROR or
+ *             SPP_CTL_STATUS_FORBIDDEN
+ *
+ ******************************************************************************/
+static uint8_t spp_ctl_open_file(spp_ctl_req_t *p_req)
+{
+    char path[PATH_MAX];
+    char real[PATH_MAX];
+    char link[32];
+    struct stat st;
+    ssize_t n;
+    int fd;
+
+    if (0 == spp_ctl_file_dir[0])
+    {
+        return SPP_CTL_STATUS_FORBIDDEN;
+    }
+    if ('/' == p_req->p_data[0])
+    {
+        snprintf(path, sizeof(path), "%s", (char *)p_req->p_data);
+    }
+    else if ((size_t)snprintf(path, sizeof(path), "%s/%s", spp_ctl_file_dir, (char *)p_req->p_data) >=
+             sizeof(path))
+    {
+        return SPP_CTL_STATUS_FILE_ERROR;
+    }
+    /* Checked before opening, so nothing outside is even opened, and again on
+     * the open file in case a link was swapped in between
+     */
+    if (NULL == realpath(path, real))
+    {
+        return SPP_CTL_STATUS_FILE_ERROR;
+    }
+    if (!spp_ctl_in_file_dir(real))
+    {
+        return SPP_CTL_STATUS_FORBIDDEN;
+    }
+    fd = open(real, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return SPP_CTL_STATUS_FILE_ERROR;
+    }
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    n = readlink(link, real, sizeof(real) - 1);
+    real[(n > 0) ? n : 0] = '\0';
+    if (!spp_ctl_in_file_dir(real))
+    {
+        close(fd);
+        return SPP_CTL_STATUS_FORBIDDEN;
+    }
+    if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode) || (st.st_size > (off_t)UINT32_MAX))
+    {
+        close(fd);
+        return SPP_CTL_STATUS_FILE_ERROR;
+    }
+    free(p_req->p_data);
+    p_req->p_data = NULL;
+    p_req->len = 0;
+    p_req->fd = fd;
+    p_req->file_offset = 0;
+    p_req->file_left = (uint64_t)st.st_size;
+    if (0 == p_req->file_left)
+    {
+        return SPP_CTL_STATUS_OK;
+    }
+    p_req->p_data = malloc((size_t)MIN(p_req->file_left, SPP_CTL_FILE_CHUNK));
+    if (NULL == p_req->p_data)
+    {
+        return SPP_CTL_STATUS_NO_RESOURCES;
+    }
+    return spp_ctl_read_chunk(p_req);
+}
+
+static uint32_t spp_ctl_list_json(char *p_json, uint32_t size)
+{
+    uint16_t handles[SPP_MAX_SESSIONS];
+    int count = spp_tx_get_handles(handles, SPP_MAX_SESSIONS);
+    uint32_t len;
+    int i;
+
+    len = (uint32_t)snprintf(p_json, size, "[");
+    for (i = 0; i < count; i++)
+    {
+        len += (uint32_t)snprintf(p_json + len, size - len,
+                                  "%s{\"handle\":%u,\"transport\":\"%s\",\"queued\":%u,\"default\":%s}",
+                                  (0 != i) ? "," : "", handles[i],
+                                  spp_tx_get_transport_name(spp_tx_get_transport(handles[i])),
+                                  spp_tx_queued_bytes(handles[i]),
+                                  (handles[i] == spp_handle) ? "true" : "false");
+    }
+    len += (uint32_t)snprintf(p_json + len, size - len, "]");
+    return len;
+}
+
+static uint32_t spp_ctl_stats_json(char *p_json, uint32_t size)
+{
+    spp_tx_stats_t tx;
+    spp_tx_transport_stats_t transport;
+    spp_ctl_stats_t ctl;
+    uint32_t len;
+    int i;
+
+    spp_tx_get_stats(&tx);
+    spp_ctl_get_stats(&ctl);
+    len = (uint32_t)snprintf(p_json, size,
+                             "{\"tx\":{\"frames_sent\":%llu,\"bytes_sent\":%llu,\"bytes_packed\":%llu,"
+                             "\"bytes_direct\":%llu,\"segments_completed\":%llu,\"segments_dropped\":%llu,"
+                             "\"credit_stalls\":%u},\"transports\":{",
+                             (unsigned long long)tx.frames_sent, (unsigned long long)tx.bytes_sent,
+                             (unsigned long long)tx.bytes_packed, (unsigned long long)tx.bytes_direct,
+                             (unsigned long long)tx.segments_completed, (unsigned long long)tx.segments_dropped,
+                             tx.credit_stalls);
+    for (i = 0; i < SPP_TRANSPORT_MAX; i++)
+    {
+        spp_tx_get_transport_stats((spp_transport_t)i, &transport);
+        len += (uint32_t)snprintf(p_json + len, size - len,
+                                  "%s\"%s\":{\"sessions\":%u,\"connected_us\":%llu,\"tx_bytes\":%llu,"
+                                  "\"rx_bytes\":%llu,\"stalls\":%u}",
+                                  (0 != i) ? "," : "", spp_tx_get_transport_name((spp_transport_t)i),
+                                  transport.sessions, (unsigned long long)transport.connected_us,
+                                  (unsigned long long)transport.tx_bytes,
+                                  (unsigned long long)transport.rx_bytes, transport.stalls);
+    }
+    len += (uint32_t)snprintf(p_json + len, size - len,
+                              "},\"ctl\":{\"clients\":%u,\"rejected\":%u,\"requests\":%llu,\"bad_requests\":%llu,"
+                              "\"bytes_queued\":%llu,\"bytes_sent\":%llu,\"queue_waits\":%u,\"denied\":%u}}",
+                              ctl.clients, ctl.rejected, (unsigned long long)ctl.requests,
+                              (unsigned long long)ctl.bad_requests, (unsigned long long)ctl.bytes_queued,
+                              (unsigned long long)ctl.bytes_sent, ctl.queue_waits, ctl.denied);
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_dispatch
+ *******************************************************************************
+ * Summary:
+ *   Carries out a fully received request
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *   spp_ctl_req_t *p_req : request, owned by this function
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_dispatch(spp_ctl_client_t *p_client, spp_ctl_req_t *p_req)
+{
+    char json[SPP_CTL_JSON_LEN];
+    uint8_t status = SPP_CTL_STATUS_OK;
+    uint32_t len = 0;
+
+    if (0 == p_req->handle)
+    {
+        p_req->handle = spp_handle;
+    }
+    pthread_mutex_lock(&spp_ctl_lock);
+    spp_ctl_stats.requests++;
+    pthread_mutex_unlock(&spp_ctl_lock);
+
+    switch (p_req->op)
+    {
+    case SPP_CTL_OP_SEND_FILE:
+        p_req->p_data[p_req->len] = '\0';
+        status = spp_ctl_open_file(p_req);
+        if ((SPP_CTL_STATUS_OK != status) || (0 == p_req->len))
+        {
+            break;
+        }
+        p_client->p_file = p_req;
+        spp_ctl_submit(p_client, p_req);
+        return;
+    case SPP_CTL_OP_SEND:
+        if (0 == p_req->len)
+        {
+            break;
+        }
+        spp_ctl_submit(p_client, p_req);
+        return;
+    case SPP_CTL_OP_LIST:
+        len = spp_ctl_list_json(json, sizeof(json));
+        break;
+    case SPP_CTL_OP_DISCONNECT:
+        status = spp_tx_disconnect(p_req->handle) ? SPP_CTL_STATUS_OK : SPP_CTL_STATUS_NO_SESSION;
+        break;
+    case SPP_CTL_OP_STATS:
+        len = spp_ctl_stats_json(json, sizeof(json));
+        break;
+    case SPP_CTL_OP_SET_HIDDEN:
+        if (1 != p_req->len)
+        {
+            status = SPP_CTL_STATUS_BAD_REQUEST;
+            break;
+        }
+        spp_scan_set_hidden((0 != p_req->p_data[0]) ? WICED_TRUE : WICED_FALSE);
+        break;
+    default:
+        pthread_mutex_lock(&spp_ctl_lock);
+        spp_ctl_stats.bad_requests++;
+        pthread_mutex_unlock(&spp_ctl_lock);
+        status = SPP_CTL_STATUS_BAD_REQUEST;
+        break;
+    }
+    spp_ctl_reply(p_client, p_req->op, status, p_req->handle, json, (len < sizeof(json)) ? len : 0);
+    spp_ctl_req_free(p_req);
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_start_request
+ *******************************************************************************
+ * Summary:
+ *   Checks a received request header and allocates the buffer the payload is
+ *   received into
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client, hdr holds the header
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the client is to be dropped
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_ctl_start_request(spp_ctl_client_t *p_client)
+{
+    uint32_t len = spp_ctl_get_u32(p_client->hdr);
+    uint8_t op = p_client->hdr[4];
+    uint16_t handle = (uint16_t)(p_client->hdr[6] | (p_client->hdr[7] << 8));
+    uint8_t status = SPP_CTL_STATUS_OK;
+    spp_ctl_req_t *p_req = NULL;
+
+    if (len > ((SPP_CTL_OP_SEND == op) ? SPP_CTL_MAX_SEND_LEN : SPP_CTL_MAX_ARG_LEN))
+    {
+        status = SPP_CTL_STATUS_BAD_REQUEST;
+    }
+    else
+    {
+        /* One spare byte terminates a path */
+        p_req = calloc(1, sizeof(*p_req));
+        if ((NULL == p_req) || (NULL == (p_req->p_data = malloc(len + 1))))
+        {
+            free(p_req);
+            p_req = NULL;
+            status = SPP_CTL_STATUS_NO_RESOURCES;
+        }
+    }
+    if (NULL == p_req)
+    {
+        /* The stream cannot be followed past a request it did not take */
+        pthread_mutex_lock(&spp_ctl_lock);
+        spp_ctl_stats.bad_requests++;
+        pthread_mutex_unlock(&spp_ctl_lock);
+        spp_ctl_reply(p_client, op, status, handle, NULL, 0);
+        p_client->closing = WICED_TRUE;
+        if (p_client->fd >= 0)
+        {
+            spp_ctl_client_flush(p_client);
+        }
+        return WICED_FALSE;
+    }
+    p_req->client = (int)(p_client - spp_ctl_clients);
+    p_req->generation = p_client->generation;
+    p_req->op = op;
+    p_req->handle = handle;
+    p_req->len = len;
+    p_req->fd = -1;
+    p_client->p_req = p_req;
+    p_client->payload_len = 0;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_client_read
+ *******************************************************************************
+ * Summary:
+ *   Receives and carries out requests until the socket runs dry or a send
+ *   has to wait for the transmit queue
+ *
+ * Parameters:
+ *   spp_ctl_client_t *p_client : client
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_client_read(spp_ctl_client_t *p_client)
+{
+    spp_ctl_req_t *p_req;
+    uint8_t *p_buf;
+    uint32_t want;
+    ssize_t n;
+
+    while ((p_client->fd >= 0) && !p_client->closing && (NULL == p_client->p_pending) &&
+           (NULL == p_client->p_file))
+    {
+        if (NULL == p_client->p_req)
+        {
+            p_buf = p_client->hdr + p_client->hdr_len;
+            want = SPP_CTL_HDR_LEN - p_client->hdr_len;
+        }
+        else
+        {
+            p_buf = p_client->p_req->p_data + p_client->payload_len;
+            want = p_client->p_req->len - p_client->payload_len;
+        }
+        if (0 != want)
+        {
+            n = recv(p_client->fd, p_buf, want, MSG_DONTWAIT);
+            if ((n < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)))
+            {
+                break;
+            }
+            if (n <= 0)
+            {
+                spp_ctl_client_close(p_client);
+                return;
+            }
+            if (NULL == p_client->p_req)
+            {
+                p_client->hdr_len += (uint32_t)n;
+                if ((SPP_CTL_HDR_LEN == p_client->hdr_len) && !spp_ctl_start_request(p_client))
+                {
+                    return;
+                }
+                continue;
+            }
+            p_client->payload_len += (uint32_t)n;
+            if (p_client->payload_len < p_client->p_req->len)
+            {
+                continue;
+            }
+        }
+        p_req = p_client->p_req;
+        p_client->p_req = NULL;
+        p_client->hdr_len = 0;
+        p_client->payload_len = 0;
+        spp_ctl_dispatch(p_client, p_req);
+    }
+    if (p_client->fd >= 0)
+    {
+        spp_ctl_update_events(p_client);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_accept
+ *******************************************************************************
+ * Summary:
+ *   Accepts the waiting clients into free slots
+ *
+ * Parameters:
+ *   int listen_fd : listening socket
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_accept(int listen_fd)
+{
+    struct epoll_event event;
+    int fd;
+    int i;
+
+    while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        if (!spp_ctl_peer_allowed(fd))
+        {
+            pthread_mutex_lock(&spp_ctl_lock);
+            spp_ctl_stats.denied++;
+            pthread_mutex_unlock(&spp_ctl_lock);
+            close(fd);
+            continue;
+        }
+        for (i = 0; (i < SPP_CTL_MAX_CLIENTS) && (spp_ctl_clients[i].fd >= 0); i++)
+        {
+        }
+        pthread_mutex_lock(&spp_ctl_lock);
+        if (i < SPP_CTL_MAX_CLIENTS)
+        {
+            spp_ctl_stats.clients++;
+        }
+        else
+        {
+            spp_ctl_stats.rejected++;
+        }
+        pthread_mutex_unlock(&spp_ctl_lock);
+        if (i == SPP_CTL_MAX_CLIENTS)
+        {
+            close(fd);
+            continue;
+        }
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = SPP_CTL_TAG_CLIENT + (uint32_t)i;
+        if (0 != epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_ADD, fd, &event))
+        {
+            close(fd);
+            continue;
+        }
+        spp_ctl_clients[i].fd = fd;
+        spp_ctl_clients[i].events = EPOLLIN;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_collect
+ *******************************************************************************
+ * Summary:
+ *   Frees the completed sends and answers them, queues the next chunk of the
+ *   files being sent, then retries the held sends
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_ctl_collect(void)
+{
+    spp_ctl_req_t *p_req;
+    spp_ctl_req_t *p_next;
+    spp_ctl_client_t *p_client;
+    uint64_t count;
+    uint8_t status;
+    int i;
+
+    if (read(spp_ctl_event_fd, &count, sizeof(count)) < 0)
+    {
+        /* Woken by the retry tick */
+    }
+    pthread_mutex_lock(&spp_ctl_lock);
+    p_req = p_spp_ctl_done_head;
+    p_spp_ctl_done_head = NULL;
+    p_spp_ctl_done_tail = NULL;
+    pthread_mutex_unlock(&spp_ctl_lock);
+
+    for (; NULL != p_req; p_req = p_next)
+    {
+        p_next = p_req->p_next;
+        p_client = &spp_ctl_clients[p_req->client];
+        if ((p_client->fd < 0) || (p_client->generation != p_req->generation))
+        {
+            spp_ctl_req_free(p_req);
+            continue;
+        }
+        status = p_req->sent ? SPP_CTL_STATUS_OK : SPP_CTL_STATUS_DROPPED;
+        if (p_client->p_file == p_req)
+        {
+            if ((SPP_CTL_STATUS_OK == status) && (0 != p_req->file_left))
+            {
+                status = spp_ctl_read_chunk(p_req);
+                if (SPP_CTL_STATUS_OK == status)
+                {
+                    spp_ctl_submit(p_client, p_req);
+                    continue;
+                }
+            }
+            /* Done or failed, the requests behind the file may be read */
+            p_client->p_file = NULL;
+            spp_ctl_update_events(p_client);
+        }
+        spp_ctl_reply(p_client, p_req->op, status, p_req->handle, NULL, 0);
+        spp_ctl_req_free(p_req);
+    }
+
+    for (i = 0; i < SPP_CTL_MAX_CLIENTS; i++)
+    {
+        p_client = &spp_ctl_clients[i];
+        if ((p_client->fd >= 0) && (NULL != p_client->p_pending))
+        {
+            spp_ctl_submit(p_client, p_client->p_pending);
+            /* Carry on with the requests behind it */
+            spp_ctl_client_read(p_client);
+        }
+    }
+}
+
+static wiced_bool_t spp_ctl_any_pending(void)
+{
+    int i;
+
+    for (i = 0; i < SPP_CTL_MAX_CLIENTS; i++)
+    {
+        if ((spp_ctl_clients[i].fd >= 0) && (NULL != spp_ctl_clients[i].p_pending))
+        {
+            return WICED_TRUE;
+        }
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_listen
+ *******************************************************************************
+ * Summary:
+ *   Creates a listening control socket, replacing a socket left behind by an
+ *   earlier run. The socket file is made accessible to the owner only, or
+ *   also to the --daemon-group group. Clients which connect before the mode
+ *   is set are caught by spp_ctl_peer_allowed().
+ *
+ * Parameters:
+ *   const char *p_path : socket path
+ *   int backlog : connections waiting to be accepted
+ *
+ * Return:
+ *   int : listening socket, -1 on failure
+ *
+ ******************************************************************************/
+int spp_ctl_listen(const char *p_path, int backlog)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (strlen(p_path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((0 == lstat(p_path, &st)) && S_ISSOCK(st.st_mode))
+    {
+        unlink(p_path);
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, p_path);
+    if ((0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))) ||
+        (spp_ctl_group_set && (0 != chown(p_path, (uid_t)-1, spp_ctl_group))) ||
+        (0 != chmod(p_path, spp_ctl_group_set ? 0660 : 0600)) ||
+        (0 != listen(fd, backlog)))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_peer_allowed
+ *******************************************************************************
+ * Summary:
+ *   Checks the credentials of a connected client: root, the user running
+ *   the application and, with --daemon-group, members of that group are
+ *   allowed
+ *
+ * Parameters:
+ *   int fd : accepted connection
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the client may use the socket
+ *
+ ******************************************************************************/
+wiced_bool_t spp_ctl_peer_allowed(int fd)
+{
+    gid_t groups[SPP_CTL_MAX_GROUPS];
+    struct ucred cred;
+    struct passwd pwd;
+    struct passwd *p_pwd = NULL;
+    socklen_t len = sizeof(cred);
+    char buf[1024];
+    int count = SPP_CTL_MAX_GROUPS;
+    int i;
+
+    if (0 != getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+    {
+        return WICED_FALSE;
+    }
+    if ((0 == cred.uid) || (geteuid() == cred.uid))
+    {
+        return WICED_TRUE;
+    }
+    if (!spp_ctl_group_set)
+    {
+        return WICED_FALSE;
+    }
+    if (cred.gid == spp_ctl_group)
+    {
+        return WICED_TRUE;
+    }
+    if ((0 != getpwuid_r(cred.uid, &pwd, buf, sizeof(buf), &p_pwd)) || (NULL == p_pwd) ||
+        (getgrouplist(p_pwd->pw_name, p_pwd->pw_gid, groups, &count) < 0))
+    {
+        return WICED_FALSE;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (groups[i] == spp_ctl_group)
+        {
+            return WICED_TRUE;
+        }
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_configure
+ *******************************************************************************
+ * Summary:
+ *   Enables the daemon mode. Called before the porting layer starts its
+ *   threads, so that SIGINT and SIGTERM, blocked here, reach the loop only.
+ *
+ * Parameters:
+ *   const char *p_path : path of the control socket
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the path is too long
+ *
+ ******************************************************************************/
+wiced_bool_t spp_ctl_configure(const char *p_path)
+{
+    sigset_t mask;
+
+    if ((NULL == p_path) || (0 == p_path[0]) || (strlen(p_path) >= sizeof(spp_ctl_path)))
+    {
+        return WICED_FALSE;
+    }
+    strcpy(spp_ctl_path, p_path);
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    spp_ctl_enabled = WICED_TRUE;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_configure_group
+ *******************************************************************************
+ * Summary:
+ *   Gives a group access to the control sockets, next to the user running
+ *   the application
+ *
+ * Parameters:
+ *   const char *p_group : group name or number
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the group does not exist
+ *
+ ******************************************************************************/
+wiced_bool_t spp_ctl_configure_group(const char *p_group)
+{
+    struct group grp;
+    struct group *p_grp = NULL;
+    char buf[4096];
+    char *p_end;
+    unsigned long gid;
+
+    if ((NULL == p_group) || (0 == p_group[0]) || (strlen(p_group) >= sizeof(spp_ctl_group_name)))
+    {
+        return WICED_FALSE;
+    }
+    if ((0 == getgrnam_r(p_group, &grp, buf, sizeof(buf), &p_grp)) && (NULL != p_grp))
+    {
+        spp_ctl_group = p_grp->gr_gid;
+    }
+    else
+    {
+        gid = strtoul(p_group, &p_end, 10);
+        if ((0 != *p_end) || (gid > (unsigned long)INT_MAX))
+        {
+            return WICED_FALSE;
+        }
+        spp_ctl_group = (gid_t)gid;
+    }
+    strcpy(spp_ctl_group_name, p_group);
+    spp_ctl_group_set = WICED_TRUE;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_configure_file_dir
+ *******************************************************************************
+ * Summary:
+ *   Allows SEND_FILE for the files below a directory. Without it, SEND_FILE
+ *   is refused.
+ *
+ * Parameters:
+ *   const char *p_dir : directory
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the directory does not exist
+ *
+ ******************************************************************************/
+wiced_bool_t spp_ctl_configure_file_dir(const char *p_dir)
+{
+    struct stat st;
+
+    if ((NULL == p_dir) || (NULL == realpath(p_dir, spp_ctl_file_dir)) ||
+        (0 != stat(spp_ctl_file_dir, &st)) || !S_ISDIR(st.st_mode))
+    {
+        spp_ctl_file_dir[0] = '\0';
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_get_access
+ *******************************************************************************
+ * Summary:
+ *   Returns the access options, for the supervisor to pass them on to its
+ *   workers
+ *
+ * Parameters:
+ *   const char **pp_group : set to the --daemon-group, NULL if not given
+ *   const char **pp_file_dir : set to the --daemon-files directory, NULL if
+ *                              not given
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_ctl_get_access(const char **pp_group, const char **pp_file_dir)
+{
+    *pp_group = spp_ctl_group_set ? spp_ctl_group_name : NULL;
+    *pp_file_dir = (0 != spp_ctl_file_dir[0]) ? spp_ctl_file_dir : NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_is_enabled
+ *******************************************************************************
+ * Summary:
+ *   Tells whether the application runs headless, serving the control socket
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if --daemon was given
+ *
+ ******************************************************************************/
+wiced_bool_t spp_ctl_is_enabled(void)
+{
+    return spp_ctl_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_get_path
+ *******************************************************************************
+ * Summary:
+ *   Returns the path of the control socket
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   const char * : path given with --daemon, NULL if not given
+ *
+ ******************************************************************************/
+const char *spp_ctl_get_path(void)
+{
+    return spp_ctl_enabled ? spp_ctl_path : NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_run
+ *******************************************************************************
+ * Summary:
+ *   Serves the control socket until SIGINT or SIGTERM
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   int : 0 on a signal, -1 if the socket cannot be served
+ *
+ ******************************************************************************/
+int spp_ctl_run(void)
+{
+    struct epoll_event events[SPP_CTL_MAX_CLIENTS + 3];
+    struct epoll_event event;
+    spp_ctl_client_t *p_client;
+    sigset_t mask;
+    int listen_fd;
+    int signal_fd;
+    int event_fd;
+    wiced_bool_t running = WICED_TRUE;
+    uint32_t tag;
+    int count;
+    int i;
+
+    for (i = 0; i < SPP_CTL_MAX_CLIENTS; i++)
+    {
+        spp_ctl_clients[i].fd = -1;
+    }
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    spp_ctl_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    listen_fd = spp_ctl_listen(spp_ctl_path, SPP_CTL_MAX_CLIENTS);
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((spp_ctl_epoll_fd < 0) || (listen_fd < 0) || (signal_fd < 0) || (event_fd < 0))
+    {
+        fprintf(stderr, "Cannot serve control socket %s: %s\n", spp_ctl_path, strerror(errno));
+        return -1;
+    }
+    pthread_mutex_lock(&spp_ctl_lock);
+    spp_ctl_event_fd = event_fd;
+    pthread_mutex_unlock(&spp_ctl_lock);
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = SPP_CTL_TAG_LISTEN;
+    epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.u32 = SPP_CTL_TAG_EVENT;
+    epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_ADD, event_fd, &event);
+    event.data.u32 = SPP_CTL_TAG_SIGNAL;
+    epoll_ctl(spp_ctl_epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+    fprintf(stdout, "Serving control socket %s\n", spp_ctl_path);
+    fflush(stdout);
+
+    while (running)
+    {
+        count = epoll_wait(spp_ctl_epoll_fd, events, SPP_CTL_MAX_CLIENTS + 3,
+                           spp_ctl_any_pending() ? SPP_CTL_RETRY_MS : -1);
+        if (0 == count)
+        {
+            spp_ctl_collect();
+            continue;
+        }
+        for (i = 0; i < count; i++)
+        {
+            tag = events[i].data.u32;
+            if (SPP_CTL_TAG_LISTEN == tag)
+            {
+                spp_ctl_accept(listen_fd);
+            }
+            else if (SPP_CTL_TAG_EVENT == tag)
+            {
+                spp_ctl_collect();
+            }
+            else if (SPP_CTL_TAG_SIGNAL == tag)
+            {
+                running = WICED_FALSE;
+            }
+            else if ((p_client = &spp_ctl_clients[tag - SPP_CTL_TAG_CLIENT])->fd >= 0)
+            {
+                if (events[i].events & EPOLLOUT)
+                {
+                    spp_ctl_client_flush(p_client);
+                }
+                if ((events[i].events & (EPOLLHUP | EPOLLERR)) &&
+                    ((NULL != p_client->p_pending) || p_client->closing))
+                {
+                    /* Gone while not being read, nobody is left to answer */
+                    spp_ctl_client_close(p_client);
+                }
+                else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    spp_ctl_client_read(p_client);
+                }
+            }
+        }
+    }
+
+    /* Sends still queued go out or are dropped with their sessions, their
+     * buffers are released with the process
+     */
+    for (i = 0; i < SPP_CTL_MAX_CLIENTS; i++)
+    {
+        spp_ctl_client_close(&spp_ctl_clients[i]);
+    }
+    pthread_mutex_lock(&spp_ctl_lock);
+    spp_ctl_event_fd = -1;
+    pthread_mutex_unlock(&spp_ctl_lock);
+    close(listen_fd);
+    unlink(spp_ctl_path);
+    close(signal_fd);
+    close(event_fd);
+    close(spp_ctl_epoll_fd);
+    spp_ctl_epoll_fd = -1;
+    fprintf(stdout, "Control socket closed\n");
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the control socket counters
+ *
+ * Parameters:
+ *   spp_ctl_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_ctl_get_stats(spp_ctl_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_ctl_lock);
+    *p_stats = spp_ctl_stats;
+    pthread_mutex_unlock(&spp_ctl_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_ctl_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the control socket counters, if the daemon mode is on
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_ctl_print_stats(void)
+{
+    spp_ctl_stats_t stats;
+
+    if (!spp_ctl_enabled)
+    {
+        return;
+    }
+    spp_ctl_get_stats(&stats);
+    fprintf(stdout, "ctl: clients %u (%u rejected, %u denied), requests %llu (%llu bad), queued %llu bytes, "
+            "sent %llu bytes, %u queue waits\n",
+            stats.clients, stats.rejected, stats.denied, (unsigned long long)stats.requests,
+            (unsigned long long)stats.bad_requests, (unsigned long long)stats.bytes_queued,
+            (unsigned long long)stats.bytes_sent, stats.queue_waits);
+}
+
+/* END OF FILE [] */
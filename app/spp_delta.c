@@ -0,0 +1,1696 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_delta.c
+ *
+ * Description: Block delta sync on top of the resumable bulk transfers.
+ *
+ *              Pushing an image the peer already holds in a slightly older
+ *              version only sends what changed, like rsync:
+ *
+ *              1. The sender sends a request with the image name, its size
+ *                 and the block size.
+ *              2. The receiver cuts its copy of the image into blocks and
+ *                 returns a weak rolling checksum and a strong hash of each.
+ *              3. The sender slides a window over the new image, rolling the
+ *                 weak checksum one byte at a time. Where it matches a
+ *                 block, confirmed by the strong hash, it emits an
+ *                 instruction to copy the block. Everything else is sent as
+ *                 literal data.
+ *              4. The receiver rebuilds the image from its copy and the
+ *                 literal data, checks its length and hash, replaces its
+ *                 copy and reports the result.
+ *
+ *              Each of these messages is a transfer of spp_xfer.c, so each
+ *              one resumes after a reconnect. Its content starts with
+ *              SPP_DELTA_MAGIC and the message type, which is how the
+ *              received transfers are told apart from other transfers. The
+ *              signatures and the delta are computed by a worker thread,
+ *              not by the BT stack thread. The receiver writes the rebuilt
+ *              image as the delta arrives.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_xfer.h"
+#include "spp_delta.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Message header: magic, type, name length, name */
+#define SPP_DELTA_HDR_LEN(name_len)             ( SPP_DELTA_MAGIC_LEN + 2 + (name_len) )
+
+/* Fixed fields following the header of each message type */
+#define SPP_DELTA_REQUEST_LEN                   ( 8 )  /* block size(4) image length(4) */
+#define SPP_DELTA_SIGNATURES_LEN                ( 12 ) /* block size(4) copy length(4) count(4) */
+#define SPP_DELTA_DELTA_LEN                     ( 12 ) /* image length(4) image hash(8) */
+#define SPP_DELTA_RESULT_LEN                    ( 5 )  /* status(1) image length(4) */
+
+/* Weak rolling checksum from its two sums, see spp_delta_weak_sums() */
+#define SPP_DELTA_WEAK(a, b)                    ( ((a) & 0xFFFF) | ((b) << 16) )
+
+/* One signature: weak checksum(4) strong hash(8) */
+#define SPP_DELTA_SIG_LEN                       ( 12 )
+
+/* Delta instructions */
+#define SPP_DELTA_INSN_END                      ( 0x00 )
+#define SPP_DELTA_INSN_COPY                     ( 0x01 ) /* first block(4) count(4) */
+#define SPP_DELTA_INSN_LITERAL                  ( 0x02 ) /* length(4), then the data */
+
+/* Largest message which is received whole, the signatures of an image of
+ * SPP_DELTA_MAX_LEN at the smallest block size its length allows
+ */
+#define SPP_DELTA_MAX_MESSAGE_LEN               ( 1024 * 1024 )
+
+/* A push the receiver stopped answering may be replaced after this time */
+#define SPP_DELTA_STALL_MS                      ( 60 * 1000 )
+
+/* FNV-1a, the strong hash of blocks and images */
+#define SPP_DELTA_FNV_INIT                      ( 0xCBF29CE484222325ULL )
+#define SPP_DELTA_FNV_PRIME                     ( 0x100000001B3ULL )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SPP_DELTA_MSG_REQUEST = 1,   /* sender -> receiver */
+    SPP_DELTA_MSG_SIGNATURES,    /* receiver -> sender */
+    SPP_DELTA_MSG_DELTA,         /* sender -> receiver */
+    SPP_DELTA_MSG_RESULT,        /* receiver -> sender */
+    SPP_DELTA_MSG_TYPES
+} spp_delta_msg_t;
+
+typedef enum
+{
+    SPP_DELTA_STATUS_OK,
+    SPP_DELTA_STATUS_REJECTED,      /* receiver has no directory or is busy */
+    SPP_DELTA_STATUS_VERIFY_FAILED, /* rebuilt image does not match */
+    SPP_DELTA_STATUS_IO_ERROR,
+} spp_delta_status_t;
+
+typedef enum
+{
+    SPP_DELTA_TX_IDLE,
+    SPP_DELTA_TX_WAIT_SIGNATURES,
+    SPP_DELTA_TX_ENCODING,
+    SPP_DELTA_TX_WAIT_RESULT,
+} spp_delta_tx_state_t;
+
+typedef enum
+{
+    SPP_DELTA_RX_IDLE,
+    SPP_DELTA_RX_SIGNING,
+    SPP_DELTA_RX_WAIT_DELTA,
+    SPP_DELTA_RX_APPLYING,
+} spp_delta_rx_state_t;
+
+/* Growing message buffer */
+typedef struct
+{
+    uint8_t *p_data;
+    uint32_t len;
+    uint32_t size;
+    wiced_bool_t failed;         /* out of memory */
+} spp_delta_buf_t;
+
+/* Message to be sent, owned here until the transfer started */
+typedef struct
+{
+    wiced_bool_t pending;
+    uint16_t handle;
+    spp_delta_buf_t msg;
+    uint32_t retries;
+} spp_delta_out_t;
+
+/* Sending side, one push at a time */
+typedef struct
+{
+    spp_delta_tx_state_t state;
+    uint16_t handle;
+    char name[SPP_DELTA_MAX_NAME + 1];
+    uint8_t *p_image;            /* mapping of the image */
+    uint32_t image_len;
+    uint32_t block_size;
+    spp_delta_buf_t signatures;  /* received, for the encoder */
+    uint32_t request_len;
+    uint32_t delta_len;
+    uint32_t literal_len;
+    uint32_t matched_len;
+    uint64_t start_ms;
+} spp_delta_tx_t;
+
+/* Receiving side, one image rebuilt at a time */
+typedef struct
+{
+    spp_delta_rx_state_t state;
+    uint16_t handle;
+    char name[SPP_DELTA_MAX_NAME + 1];
+    uint32_t block_size;
+    uint32_t image_len;
+    int copy_fd;                 /* the copy held, -1 if none */
+    uint32_t copy_len;
+    int part_fd;                 /* image being rebuilt */
+    uint8_t *p_block;            /* block read from the copy */
+
+    /* Delta parser */
+    uint8_t unit[SPP_DELTA_HDR_LEN(SPP_DELTA_MAX_NAME) + SPP_DELTA_DELTA_LEN];
+    uint32_t unit_len;
+    wiced_bool_t hdr_done;
+    wiced_bool_t end;
+    spp_delta_status_t status;   /* first failure */
+    uint32_t literal_left;
+    uint32_t written;
+    uint64_t hash;
+    uint64_t expected_hash;
+} spp_delta_rx_t;
+
+/* Message being received, one per type */
+typedef struct
+{
+    wiced_bool_t in_use;
+    uint32_t xfer_id;
+    uint32_t total_len;
+    spp_delta_buf_t msg;         /* empty for a delta, which is applied as it comes */
+    wiced_bool_t ignored;        /* not expected, consumed and dropped */
+    char name[SPP_DELTA_MAX_NAME + 1]; /* of an ignored delta */
+} spp_delta_in_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *const spp_delta_status_names[] = { "ok", "rejected", "verify failed", "io error" };
+
+static char spp_delta_dir[256];
+static spp_delta_tx_t spp_delta_tx;
+static spp_delta_rx_t spp_delta_rx = { .copy_fd = -1, .part_fd = -1 };
+static spp_delta_in_t spp_delta_in[SPP_DELTA_MSG_TYPES];
+static spp_delta_out_t spp_delta_tx_out;   /* request and delta */
+static spp_delta_out_t spp_delta_rx_out;   /* signatures and result */
+static spp_delta_buf_t spp_delta_fill_msg; /* message the transfer layer sends */
+static spp_delta_stats_t spp_delta_stats;
+static wiced_timer_t spp_delta_timer;
+static pthread_mutex_t spp_delta_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static void spp_delta_timeout(WICED_TIMER_PARAM_TYPE arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_delta_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t spp_delta_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t spp_delta_get_u64(const uint8_t *p)
+{
+    return (uint64_t)spp_delta_get_u32(p) | ((uint64_t)spp_delta_get_u32(p + 4) << 32);
+}
+
+static void spp_delta_buf_free(spp_delta_buf_t *p_buf)
+{
+    free(p_buf->p_data);
+    memset(p_buf, 0, sizeof(*p_buf));
+}
+
+static void spp_delta_buf_put(spp_delta_buf_t *p_buf, const void *p_data, uint32_t len)
+{
+    uint8_t *p_grown;
+    uint32_t size;
+
+    if (p_buf->failed)
+    {
+        return;
+    }
+    if (p_buf->len + len > p_buf->size)
+    {
+        for (size = (0 != p_buf->size) ? p_buf->size : 256; size < p_buf->len + len; size *= 2)
+        {
+        }
+        p_grown = realloc(p_buf->p_data, size);
+        if (NULL == p_grown)
+        {
+            p_buf->failed = WICED_TRUE;
+            return;
+        }
+        p_buf->p_data = p_grown;
+        p_buf->size = size;
+    }
+    memcpy(p_buf->p_data + p_buf->len, p_data, len);
+    p_buf->len += len;
+}
+
+static void spp_delta_buf_put_u32(spp_delta_buf_t *p_buf, uint32_t value)
+{
+    uint8_t bytes[4];
+
+    spp_delta_put_u32(bytes, value);
+    spp_delta_buf_put(p_buf, bytes, sizeof(bytes));
+}
+
+static void spp_delta_buf_put_u64(spp_delta_buf_t *p_buf, uint64_t value)
+{
+    spp_delta_buf_put_u32(p_buf, (uint32_t)value);
+    spp_delta_buf_put_u32(p_buf, (uint32_t)(value >> 32));
+}
+
+static void spp_delta_buf_put_hdr(spp_delta_buf_t *p_buf, spp_delta_msg_t type, const char *p_name)
+{
+    uint8_t bytes[2] = { (uint8_t)type, (uint8_t)strlen(p_name) };
+
+    spp_delta_buf_put(p_buf, SPP_DELTA_MAGIC, SPP_DELTA_MAGIC_LEN);
+    spp_delta_buf_put(p_buf, bytes, sizeof(bytes));
+    spp_delta_buf_put(p_buf, p_name, bytes[1]);
+}
+
+/* Checks the header of a message of the given type and copies its name.
+ * Returns the fixed fields, or NULL if the message is too short.
+ */
+static const uint8_t *spp_delta_parse_hdr(const uint8_t *p_msg, uint32_t len, spp_delta_msg_t type,
+                                          uint32_t fields_len, char *p_name)
+{
+    uint32_t name_len;
+
+    if ((len < SPP_DELTA_HDR_LEN(0)) || (0 != memcmp(p_msg, SPP_DELTA_MAGIC, SPP_DELTA_MAGIC_LEN)) ||
+        (type != p_msg[SPP_DELTA_MAGIC_LEN]))
+    {
+        return NULL;
+    }
+    name_len = p_msg[SPP_DELTA_MAGIC_LEN + 1];
+    if ((name_len > SPP_DELTA_MAX_NAME) || (len < SPP_DELTA_HDR_LEN(name_len) + fields_len))
+    {
+        return NULL;
+    }
+    memcpy(p_name, &p_msg[SPP_DELTA_HDR_LEN(0)], name_len);
+    p_name[name_len] = '\0';
+    return &p_msg[SPP_DELTA_HDR_LEN(name_len)];
+}
+
+/* A name must be a plain file name in the receive directory */
+static wiced_bool_t spp_delta_name_valid(const char *p_name)
+{
+    return (0 != p_name[0]) && ('.' != p_name[0]) && (NULL == strchr(p_name, '/')) &&
+           (strlen(p_name) <= SPP_DELTA_MAX_NAME);
+}
+
+static uint64_t spp_delta_hash(uint64_t hash, const uint8_t *p_data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        hash = (hash ^ p_data[i]) * SPP_DELTA_FNV_PRIME;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_weak_sums
+ *******************************************************************************
+ * Summary:
+ *   Computes the two sums of the weak rolling checksum over a block:
+ *   a = sum of the bytes, b = sum of the bytes weighted by their distance to
+ *   the end of the block. The checksum is (a & 0xFFFF) | (b << 16), both sums
+ *   roll forward by one byte in constant time.
+ *
+ * Parameters:
+ *   const uint8_t *p_data : block
+ *   uint32_t len : block length
+ *   uint32_t *p_a : sum a
+ *   uint32_t *p_b : sum b
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_delta_weak_sums(const uint8_t *p_data, uint32_t len, uint32_t *p_a, uint32_t *p_b)
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        a += p_data[i];
+        b += (len - i) * p_data[i];
+    }
+    *p_a = a;
+    *p_b = b;
+}
+
+/* Block size for an image: about its square root, in whole 64 bytes */
+static uint32_t spp_delta_block_size(uint32_t image_len)
+{
+    uint32_t block = SPP_DELTA_MIN_BLOCK;
+
+    while ((block < SPP_DELTA_MAX_BLOCK) && ((uint64_t)block * block < image_len))
+    {
+        block += 64;
+    }
+    return block;
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_sign
+ *******************************************************************************
+ * Summary:
+ *   Builds the signatures message for the copy of an image. The last block
+ *   may be shorter than the block size.
+ *
+ * Parameters:
+ *   spp_delta_buf_t *p_msg : receives the message
+ *   const char *p_name : image name
+ *   int copy_fd : the copy, -1 if none
+ *   uint32_t copy_len : its length
+ *   uint32_t block_size : block size asked for by the sender
+ *   uint8_t *p_block : buffer of block_size bytes
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the copy cannot be read
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_delta_sign(spp_delta_buf_t *p_msg, const char *p_name, int copy_fd, uint32_t copy_len,
+                                   uint32_t block_size, uint8_t *p_block)
+{
+    uint32_t count = (copy_len + block_size - 1) / block_size;
+    uint32_t offset;
+    uint32_t len;
+    uint32_t a;
+    uint32_t b;
+
+    spp_delta_buf_put_hdr(p_msg, SPP_DELTA_MSG_SIGNATURES, p_name);
+    spp_delta_buf_put_u32(p_msg, block_size);
+    spp_delta_buf_put_u32(p_msg, copy_len);
+    spp_delta_buf_put_u32(p_msg, count);
+    for (offset = 0; offset < copy_len; offset += len)
+    {
+        len = MIN(block_size, copy_len - offset);
+        if ((ssize_t)len != pread(copy_fd, p_block, len, offset))
+        {
+            return WICED_FALSE;
+        }
+        spp_delta_weak_sums(p_block, len, &a, &b);
+        spp_delta_buf_put_u32(p_msg, SPP_DELTA_WEAK(a, b));
+        spp_delta_buf_put_u64(p_msg, spp_delta_hash(SPP_DELTA_FNV_INIT, p_block, len));
+    }
+    return !p_msg->failed;
+}
+
+/* Encoder output, merging copies of consecutive blocks */
+typedef struct
+{
+    spp_delta_buf_t *p_msg;
+    uint32_t copy_at;            /* offset of the count of the last copy, 0 if none */
+    uint32_t copy_next;          /* block which would extend the last copy */
+    uint32_t literal_len;
+    uint32_t matched_len;
+} spp_delta_enc_t;
+
+static void spp_delta_emit_literal(spp_delta_enc_t *p_enc, const uint8_t *p_data, uint32_t len)
+{
+    uint8_t insn = SPP_DELTA_INSN_LITERAL;
+
+    if (0 == len)
+    {
+        return;
+    }
+    spp_delta_buf_put(p_enc->p_msg, &insn, 1);
+    spp_delta_buf_put_u32(p_enc->p_msg, len);
+    spp_delta_buf_put(p_enc->p_msg, p_data, len);
+    p_enc->copy_at = 0;
+    p_enc->literal_len += len;
+}
+
+static void spp_delta_emit_copy(spp_delta_enc_t *p_enc, uint32_t block, uint32_t len)
+{
+    uint8_t insn = SPP_DELTA_INSN_COPY;
+    spp_delta_buf_t *p_msg = p_enc->p_msg;
+
+    p_enc->matched_len += len;
+    if ((0 != p_enc->copy_at) && (block == p_enc->copy_next) && !p_msg->failed)
+    {
+        spp_delta_put_u32(&p_msg->p_data[p_enc->copy_at],
+                          spp_delta_get_u32(&p_msg->p_data[p_enc->copy_at]) + 1);
+    }
+    else
+    {
+        spp_delta_buf_put(p_msg, &insn, 1);
+        spp_delta_buf_put_u32(p_msg, block);
+        p_enc->copy_at = p_msg->len;
+        spp_delta_buf_put_u32(p_msg, 1);
+    }
+    p_enc->copy_next = block + 1;
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_encode
+ *******************************************************************************
+ * Summary:
+ *   Builds the delta message turning the receiver's copy, described by its
+ *   signatures, into the image
+ *
+ * Parameters:
+ *   spp_delta_tx_t *p_tx : push, with the image and the signatures
+ *   spp_delta_buf_t *p_msg : receives the message
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if out of memory or the signatures are invalid
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_delta_encode(spp_delta_tx_t *p_tx, spp_delta_buf_t *p_msg)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    const uint8_t *p_fields;
+    const uint8_t *p_sigs;
+    const uint8_t *p_image = p_tx->p_image;
+    spp_delta_enc_t enc;
+    uint32_t image_len = p_tx->image_len;
+    uint32_t block_size;
+    uint32_t copy_len;
+    uint32_t count;
+    uint32_t full_blocks;
+    uint32_t tail_len;
+    uint32_t table_size;
+    uint32_t bucket;
+    uint32_t weak;
+    uint32_t pos = 0;
+    uint32_t literal_start = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint64_t strong;
+    wiced_bool_t have_sums = WICED_FALSE;
+    wiced_bool_t have_strong;
+    int32_t *p_head = NULL;
+    int32_t *p_next = NULL;
+    int32_t match;
+    int32_t i;
+    uint8_t insn;
+
+    p_fields = spp_delta_parse_hdr(p_tx->signatures.p_data, p_tx->signatures.len, SPP_DELTA_MSG_SIGNATURES,
+                                   SPP_DELTA_SIGNATURES_LEN, name);
+    if (NULL == p_fields)
+    {
+        return WICED_FALSE;
+    }
+    block_size = spp_delta_get_u32(p_fields);
+    copy_len = spp_delta_get_u32(p_fields + 4);
+    count = spp_delta_get_u32(p_fields + 8);
+    p_sigs = p_fields + SPP_DELTA_SIGNATURES_LEN;
+    if ((block_size != p_tx->block_size) || (count != (copy_len + block_size - 1) / block_size) ||
+        ((uint64_t)(p_sigs - p_tx->signatures.p_data) + (uint64_t)count * SPP_DELTA_SIG_LEN !=
+         p_tx->signatures.len))
+    {
+        return WICED_FALSE;
+    }
+    full_blocks = copy_len / block_size;
+    tail_len = copy_len % block_size;
+
+    /* Full blocks, chained by weak checksum */
+    for (table_size = 16; table_size < 2 * count; table_size *= 2)
+    {
+    }
+    p_head = malloc(table_size * sizeof(int32_t));
+    p_next = malloc((count + 1) * sizeof(int32_t));
+    if ((NULL == p_head) || (NULL == p_next))
+    {
+        free(p_head);
+        free(p_next);
+        return WICED_FALSE;
+    }
+    memset(p_head, 0xFF, table_size * sizeof(int32_t));
+    for (i = (int32_t)full_blocks - 1; i >= 0; i--)
+    {
+        weak = spp_delta_get_u32(&p_sigs[i * SPP_DELTA_SIG_LEN]);
+        bucket = (weak ^ (weak >> 16)) & (table_size - 1);
+        p_next[i] = p_head[bucket];
+        p_head[bucket] = i;
+    }
+
+    memset(&enc, 0, sizeof(enc));
+    enc.p_msg = p_msg;
+    spp_delta_buf_put_hdr(p_msg, SPP_DELTA_MSG_DELTA, p_tx->name);
+    spp_delta_buf_put_u32(p_msg, image_len);
+    spp_delta_buf_put_u64(p_msg, spp_delta_hash(SPP_DELTA_FNV_INIT, p_image, image_len));
+
+    while ((0 != full_blocks) && (pos + block_size <= image_len))
+    {
+        if (!have_sums)
+        {
+            spp_delta_weak_sums(&p_image[pos], block_size, &a, &b);
+            have_sums = WICED_TRUE;
+        }
+        weak = SPP_DELTA_WEAK(a, b);
+        have_strong = WICED_FALSE;
+        strong = 0;
+        match = -1;
+        for (i = p_head[(weak ^ (weak >> 16)) & (table_size - 1)]; i >= 0; i = p_next[i])
+        {
+            if (spp_delta_get_u32(&p_sigs[i * SPP_DELTA_SIG_LEN]) != weak)
+            {
+                continue;
+            }
+            if (!have_strong)
+            {
+                strong = spp_delta_hash(SPP_DELTA_FNV_INIT, &p_image[pos], block_size);
+                have_strong = WICED_TRUE;
+            }
+            if (spp_delta_get_u64(&p_sigs[i * SPP_DELTA_SIG_LEN + 4]) == strong)
+            {
+                /* Prefer extending the last copy */
+                match = i;
+                if ((uint32_t)i == enc.copy_next)
+                {
+                    break;
+                }
+            }
+        }
+        if (match >= 0)
+        {
+            spp_delta_emit_literal(&enc, &p_image[literal_start], pos - literal_start);
+            spp_delta_emit_copy(&enc, (uint32_t)match, block_size);
+            pos += block_size;
+            literal_start = pos;
+            have_sums = WICED_FALSE;
+            continue;
+        }
+        if (pos + block_size < image_len)
+        {
+            a += p_image[pos + block_size] - p_image[pos];
+            b += a - block_size * p_image[pos];
+        }
+        pos++;
+    }
+
+    /* The short last block of the copy can only match the end of the image */
+    if ((0 != tail_len) && (image_len >= literal_start + tail_len))
+    {
+        spp_delta_weak_sums(&p_image[image_len - tail_len], tail_len, &a, &b);
+        if ((spp_delta_get_u32(&p_sigs[full_blocks * SPP_DELTA_SIG_LEN]) == SPP_DELTA_WEAK(a, b)) &&
+            (spp_delta_get_u64(&p_sigs[full_blocks * SPP_DELTA_SIG_LEN + 4]) ==
+             spp_delta_hash(SPP_DELTA_FNV_INIT, &p_image[image_len - tail_len], tail_len)))
+        {
+            spp_delta_emit_literal(&enc, &p_image[literal_start], image_len - tail_len - literal_start);
+            spp_delta_emit_copy(&enc, full_blocks, tail_len);
+            literal_start = image_len;
+        }
+    }
+    spp_delta_emit_literal(&enc, &p_image[literal_start], image_len - literal_start);
+    insn = SPP_DELTA_INSN_END;
+    spp_delta_buf_put(p_msg, &insn, 1);
+
+    p_tx->literal_len = enc.literal_len;
+    p_tx->matched_len = enc.matched_len;
+    free(p_head);
+    free(p_next);
+    return !p_msg->failed;
+}
+
+/*******************************************************************************
+ *       Outgoing messages
+ ******************************************************************************/
+
+static wiced_bool_t spp_delta_fill(uint32_t offset, uint8_t *p_buf, uint32_t len)
+{
+    wiced_bool_t ok;
+
+    pthread_mutex_lock(&spp_delta_lock);
+    ok = ((uint64_t)offset + len <= spp_delta_fill_msg.len);
+    if (ok)
+    {
+        memcpy(p_buf, spp_delta_fill_msg.p_data + offset, len);
+    }
+    pthread_mutex_unlock(&spp_delta_lock);
+    return ok;
+}
+
+static void spp_delta_tx_reset(void);
+static void spp_delta_rx_reset(void);
+
+/* A message could not be started in time, the operation it belongs to ends */
+static void spp_delta_out_failed(spp_delta_out_t *p_out)
+{
+    if (p_out == &spp_delta_tx_out)
+    {
+        if ((SPP_DELTA_TX_WAIT_SIGNATURES == spp_delta_tx.state) ||
+            (SPP_DELTA_TX_WAIT_RESULT == spp_delta_tx.state))
+        {
+            WICED_BT_TRACE("delta push of %s failed, transfer layer busy\n", spp_delta_tx.name);
+            spp_delta_stats.pushes_failed++;
+            spp_delta_tx_reset();
+        }
+    }
+    else if (SPP_DELTA_RX_WAIT_DELTA == spp_delta_rx.state)
+    {
+        spp_delta_rx_reset();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_out_start
+ *******************************************************************************
+ * Summary:
+ *   Starts the transfer of a pending message, from an encode worker or the
+ *   retry timer. While the transfer layer is busy, this is retried from the
+ *   timer. The message the transfer layer sends is only freed once it is
+ *   idle again, since a suspended transfer still reads it when the peer
+ *   reconnects.
+ *
+ * Parameters:
+ *   spp_delta_out_t *p_out : message to start
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_delta_out_start(spp_delta_out_t *p_out)
+{
+    static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+    spp_delta_buf_t previous;
+    wiced_bool_t started = WICED_FALSE;
+    wiced_bool_t retry = WICED_FALSE;
+    uint16_t handle;
+    uint32_t len;
+
+    /* Delta starts are serialized, so while spp_xfer_is_idle() holds no delta
+     * message is being read and the fill message may be swapped. Anything
+     * else, e.g. a menu transfer, may still start first: spp_xfer_start()
+     * checks and starts in one step under the transfer layer lock, and the
+     * swap is undone if it refuses.
+     */
+    pthread_mutex_lock(&start_lock);
+    pthread_mutex_lock(&spp_delta_lock);
+    if (!p_out->pending)
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+        pthread_mutex_unlock(&start_lock);
+        return;
+    }
+    handle = p_out->handle;
+    len = p_out->msg.len;
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    if (spp_xfer_is_idle())
+    {
+        pthread_mutex_lock(&spp_delta_lock);
+        previous = spp_delta_fill_msg;
+        spp_delta_fill_msg = p_out->msg;
+        pthread_mutex_unlock(&spp_delta_lock);
+
+        started = spp_xfer_start(handle, len, spp_delta_fill);
+
+        pthread_mutex_lock(&spp_delta_lock);
+        if (started)
+        {
+            free(previous.p_data);
+            memset(&p_out->msg, 0, sizeof(p_out->msg));
+            p_out->pending = WICED_FALSE;
+        }
+        else
+        {
+            spp_delta_fill_msg = previous;
+        }
+        pthread_mutex_unlock(&spp_delta_lock);
+    }
+
+    if (!started)
+    {
+        pthread_mutex_lock(&spp_delta_lock);
+        if (++p_out->retries > SPP_DELTA_MAX_RETRY)
+        {
+            spp_delta_buf_free(&p_out->msg);
+            p_out->pending = WICED_FALSE;
+            spp_delta_out_failed(p_out);
+        }
+        else
+        {
+            retry = WICED_TRUE;
+        }
+        pthread_mutex_unlock(&spp_delta_lock);
+    }
+    pthread_mutex_unlock(&start_lock);
+
+    if (retry && !wiced_is_timer_in_use(&spp_delta_timer))
+    {
+        wiced_start_timer(&spp_delta_timer, SPP_DELTA_RETRY_MS);
+    }
+}
+
+/* Queues a message, taking ownership of its buffer */
+static void spp_delta_out_queue(spp_delta_out_t *p_out, uint16_t handle, spp_delta_buf_t *p_msg)
+{
+    pthread_mutex_lock(&spp_delta_lock);
+    spp_delta_buf_free(&p_out->msg);
+    p_out->msg = *p_msg;
+    p_out->handle = handle;
+    p_out->retries = 0;
+    p_out->pending = WICED_TRUE;
+    memset(p_msg, 0, sizeof(*p_msg));
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    spp_delta_out_start(p_out);
+}
+
+static void spp_delta_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    spp_delta_out_start(&spp_delta_tx_out);
+    spp_delta_out_start(&spp_delta_rx_out);
+}
+
+static void spp_delta_send_result(uint16_t handle, const char *p_name, spp_delta_status_t status,
+                                  uint32_t image_len)
+{
+    spp_delta_buf_t msg;
+    uint8_t status_byte = (uint8_t)status;
+
+    memset(&msg, 0, sizeof(msg));
+    spp_delta_buf_put_hdr(&msg, SPP_DELTA_MSG_RESULT, p_name);
+    spp_delta_buf_put(&msg, &status_byte, 1);
+    spp_delta_buf_put_u32(&msg, image_len);
+    if (msg.failed)
+    {
+        spp_delta_buf_free(&msg);
+        return;
+    }
+    spp_delta_out_queue(&spp_delta_rx_out, handle, &msg);
+}
+
+static uint64_t spp_delta_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*******************************************************************************
+ *       Sending side
+ ******************************************************************************/
+
+/* Ends the push, called with the lock held */
+static void spp_delta_tx_reset(void)
+{
+    if (NULL != spp_delta_tx.p_image)
+    {
+        munmap(spp_delta_tx.p_image, spp_delta_tx.image_len);
+    }
+    spp_delta_buf_free(&spp_delta_tx.signatures);
+    memset(&spp_delta_tx, 0, sizeof(spp_delta_tx));
+}
+
+static void *spp_delta_encode_worker(void *p_arg)
+{
+    spp_delta_buf_t msg;
+    wiced_bool_t ok;
+    uint16_t handle;
+
+    /* The push is ENCODING, nobody else touches it */
+    memset(&msg, 0, sizeof(msg));
+    ok = spp_delta_encode(&spp_delta_tx, &msg);
+
+    pthread_mutex_lock(&spp_delta_lock);
+    if (!ok)
+    {
+        fprintf(stdout, "Delta push of %s failed, invalid signatures or out of memory\n", spp_delta_tx.name);
+        spp_delta_stats.pushes_failed++;
+        spp_delta_tx_reset();
+        pthread_mutex_unlock(&spp_delta_lock);
+        spp_delta_buf_free(&msg);
+        return NULL;
+    }
+    spp_delta_tx.delta_len = msg.len;
+    spp_delta_tx.state = SPP_DELTA_TX_WAIT_RESULT;
+    handle = spp_delta_tx.handle;
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    WICED_BT_TRACE("delta: %d bytes of delta, literal %d, matched %d\n", msg.len,
+                   spp_delta_tx.literal_len, spp_delta_tx.matched_len);
+    spp_delta_out_queue(&spp_delta_tx_out, handle, &msg);
+    return NULL;
+}
+
+static void spp_delta_rx_signatures(uint16_t handle, spp_delta_buf_t *p_msg)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    pthread_t thread;
+
+    if (NULL == spp_delta_parse_hdr(p_msg->p_data, p_msg->len, SPP_DELTA_MSG_SIGNATURES,
+                                    SPP_DELTA_SIGNATURES_LEN, name))
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_delta_lock);
+    if ((SPP_DELTA_TX_WAIT_SIGNATURES != spp_delta_tx.state) || (handle != spp_delta_tx.handle) ||
+        (0 != strcmp(name, spp_delta_tx.name)))
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+        return;
+    }
+    spp_delta_tx.signatures = *p_msg;
+    memset(p_msg, 0, sizeof(*p_msg));
+    spp_delta_tx.state = SPP_DELTA_TX_ENCODING;
+    spp_delta_stats.bytes_signatures += spp_delta_tx.signatures.len;
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    /* Matching a large image takes a while, keep it off the stack thread */
+    if (0 != pthread_create(&thread, NULL, spp_delta_encode_worker, NULL))
+    {
+        spp_delta_encode_worker(NULL);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+static void spp_delta_rx_result(uint16_t handle, const spp_delta_buf_t *p_msg)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    const uint8_t *p_fields;
+    spp_delta_status_t status;
+    uint32_t image_len;
+    uint32_t sent_len;
+    uint32_t saved_len;
+    uint32_t literal_len;
+    uint32_t matched_len;
+    uint32_t elapsed_ms;
+
+    p_fields = spp_delta_parse_hdr(p_msg->p_data, p_msg->len, SPP_DELTA_MSG_RESULT, SPP_DELTA_RESULT_LEN, name);
+    if (NULL == p_fields)
+    {
+        return;
+    }
+    status = (spp_delta_status_t)p_fields[0];
+
+    /* A receiver which cannot take the image rejects the request itself */
+    pthread_mutex_lock(&spp_delta_lock);
+    if (((SPP_DELTA_TX_WAIT_RESULT != spp_delta_tx.state) &&
+         (SPP_DELTA_TX_WAIT_SIGNATURES != spp_delta_tx.state)) ||
+        (handle != spp_delta_tx.handle) || (0 != strcmp(name, spp_delta_tx.name)))
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+        return;
+    }
+    image_len = spp_delta_tx.image_len;
+    sent_len = spp_delta_tx.request_len + spp_delta_tx.delta_len;
+    literal_len = spp_delta_tx.literal_len;
+    matched_len = spp_delta_tx.matched_len;
+    elapsed_ms = (uint32_t)(spp_delta_now_ms() - spp_delta_tx.start_ms);
+    if ((SPP_DELTA_STATUS_OK == status) && (SPP_DELTA_TX_WAIT_RESULT == spp_delta_tx.state) &&
+        (spp_delta_get_u32(p_fields + 1) == image_len))
+    {
+        spp_delta_stats.pushes_completed++;
+        spp_delta_stats.bytes_image += image_len;
+        spp_delta_stats.bytes_sent += sent_len;
+        spp_delta_stats.bytes_literal += literal_len;
+        spp_delta_stats.bytes_matched += matched_len;
+        spp_delta_stats.last_image_len = image_len;
+        spp_delta_stats.last_sent_len = sent_len;
+    }
+    else
+    {
+        if (SPP_DELTA_STATUS_OK == status)
+        {
+            status = SPP_DELTA_STATUS_VERIFY_FAILED;
+        }
+        spp_delta_stats.pushes_failed++;
+    }
+    spp_delta_tx_reset();
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    if (SPP_DELTA_STATUS_OK != status)
+    {
+        fprintf(stdout, "Delta push of %s failed: %s\n", name,
+                (status <= SPP_DELTA_STATUS_IO_ERROR) ? spp_delta_status_names[status] : "unknown");
+        return;
+    }
+    saved_len = (image_len > sent_len) ? (image_len - sent_len) : 0;
+    fprintf(stdout, "Delta push of %s done: image %u bytes, sent %u (literal %u, matched %u), "
+            "saved %u bytes (%u%%) in %u ms\n", name, image_len, sent_len, literal_len, matched_len,
+            saved_len, (uint32_t)((uint64_t)saved_len * 100 / image_len), elapsed_ms);
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_send
+ *******************************************************************************
+ * Summary:
+ *   Pushes a file with delta sync. The peer keeps it under the file's base
+ *   name and only the blocks which differ from its copy are sent.
+ *
+ * Parameters:
+ *   uint16_t handle : RFCOMM session to push to
+ *   const char *p_path : file to push
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the push cannot be started
+ *
+ ******************************************************************************/
+wiced_bool_t spp_delta_send(uint16_t handle, const char *p_path)
+{
+    const char *p_name = strrchr(p_path, '/');
+    spp_delta_buf_t msg;
+    struct stat st;
+    uint8_t *p_image;
+    uint32_t block_size;
+    int fd;
+
+    p_name = (NULL != p_name) ? (p_name + 1) : p_path;
+    if (!spp_delta_name_valid(p_name))
+    {
+        fprintf(stdout, "Delta push: invalid name %s\n", p_name);
+        return WICED_FALSE;
+    }
+    fd = open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stdout, "Delta push: cannot open %s: %s\n", p_path, strerror(errno));
+        return WICED_FALSE;
+    }
+    if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode) || (0 == st.st_size) ||
+        (st.st_size > SPP_DELTA_MAX_LEN))
+    {
+        fprintf(stdout, "Delta push: %s is not a file of 1 to %u bytes\n", p_path, SPP_DELTA_MAX_LEN);
+        close(fd);
+        return WICED_FALSE;
+    }
+    p_image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == p_image)
+    {
+        fprintf(stdout, "Delta push: cannot map %s: %s\n", p_path, strerror(errno));
+        return WICED_FALSE;
+    }
+    block_size = spp_delta_block_size((uint32_t)st.st_size);
+
+    pthread_mutex_lock(&spp_delta_lock);
+    /* A push the peer stopped answering is given up */
+    if ((SPP_DELTA_TX_IDLE != spp_delta_tx.state) && (SPP_DELTA_TX_ENCODING != spp_delta_tx.state) &&
+        !spp_delta_tx_out.pending && (spp_delta_now_ms() - spp_delta_tx.start_ms > SPP_DELTA_STALL_MS))
+    {
+        spp_delta_stats.pushes_failed++;
+        spp_delta_tx_reset();
+    }
+    if (SPP_DELTA_TX_IDLE != spp_delta_tx.state)
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+        munmap(p_image, st.st_size);
+        fprintf(stdout, "Delta push: push of %s still in progress\n", spp_delta_tx.name);
+        return WICED_FALSE;
+    }
+    spp_delta_tx.state = SPP_DELTA_TX_WAIT_SIGNATURES;
+    spp_delta_tx.handle = handle;
+    strcpy(spp_delta_tx.name, p_name);
+    spp_delta_tx.p_image = p_image;
+    spp_delta_tx.image_len = (uint32_t)st.st_size;
+    spp_delta_tx.block_size = block_size;
+    spp_delta_tx.start_ms = spp_delta_now_ms();
+    spp_delta_stats.pushes++;
+
+    memset(&msg, 0, sizeof(msg));
+    spp_delta_buf_put_hdr(&msg, SPP_DELTA_MSG_REQUEST, p_name);
+    spp_delta_buf_put_u32(&msg, block_size);
+    spp_delta_buf_put_u32(&msg, spp_delta_tx.image_len);
+    spp_delta_tx.request_len = msg.len;
+    if (msg.failed)
+    {
+        spp_delta_stats.pushes_failed++;
+        spp_delta_tx_reset();
+        pthread_mutex_unlock(&spp_delta_lock);
+        spp_delta_buf_free(&msg);
+        return WICED_FALSE;
+    }
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    fprintf(stdout, "Delta push of %s started, %u bytes, block size %u\n", p_name, (uint32_t)st.st_size,
+            block_size);
+    spp_delta_out_queue(&spp_delta_tx_out, handle, &msg);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ *       Receiving side
+ ******************************************************************************/
+
+static void spp_delta_path(char *p_path, size_t size, const char *p_name, wiced_bool_t part)
+{
+    snprintf(p_path, size, "%s/%s%s%s", spp_delta_dir, part ? "." : "", p_name, part ? ".part" : "");
+}
+
+/* Ends the rebuild, called with the lock held */
+static void spp_delta_rx_reset(void)
+{
+    char path[sizeof(spp_delta_dir) + SPP_DELTA_MAX_NAME + 8];
+
+    if (spp_delta_rx.copy_fd >= 0)
+    {
+        close(spp_delta_rx.copy_fd);
+    }
+    if (spp_delta_rx.part_fd >= 0)
+    {
+        close(spp_delta_rx.part_fd);
+        spp_delta_path(path, sizeof(path), spp_delta_rx.name, WICED_TRUE);
+        unlink(path);
+    }
+    free(spp_delta_rx.p_block);
+    memset(&spp_delta_rx, 0, sizeof(spp_delta_rx));
+    spp_delta_rx.copy_fd = -1;
+    spp_delta_rx.part_fd = -1;
+}
+
+static void *spp_delta_sign_worker(void *p_arg)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    spp_delta_buf_t msg;
+    wiced_bool_t ok;
+    uint16_t handle;
+    uint32_t image_len;
+
+    /* The rebuild is SIGNING, nobody else touches it */
+    memset(&msg, 0, sizeof(msg));
+    ok = spp_delta_sign(&msg, spp_delta_rx.name, spp_delta_rx.copy_fd, spp_delta_rx.copy_len,
+                        spp_delta_rx.block_size, spp_delta_rx.p_block);
+
+    pthread_mutex_lock(&spp_delta_lock);
+    handle = spp_delta_rx.handle;
+    image_len = spp_delta_rx.image_len;
+    strcpy(name, spp_delta_rx.name);
+    if (ok)
+    {
+        spp_delta_rx.state = SPP_DELTA_RX_WAIT_DELTA;
+    }
+    else
+    {
+        spp_delta_rx_reset();
+    }
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    if (!ok)
+    {
+        spp_delta_buf_free(&msg);
+        spp_delta_send_result(handle, name, SPP_DELTA_STATUS_IO_ERROR, image_len);
+        return NULL;
+    }
+    WICED_BT_TRACE("delta: %s signed, %d bytes of signatures\n", name, msg.len);
+    spp_delta_out_queue(&spp_delta_rx_out, handle, &msg);
+    return NULL;
+}
+
+static void spp_delta_rx_request(uint16_t handle, const spp_delta_buf_t *p_msg)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    char path[sizeof(spp_delta_dir) + SPP_DELTA_MAX_NAME + 8];
+    const uint8_t *p_fields;
+    struct stat st;
+    pthread_t thread;
+    uint32_t block_size;
+    uint32_t image_len;
+
+    p_fields = spp_delta_parse_hdr(p_msg->p_data, p_msg->len, SPP_DELTA_MSG_REQUEST, SPP_DELTA_REQUEST_LEN, name);
+    if (NULL == p_fields)
+    {
+        return;
+    }
+    block_size = spp_delta_get_u32(p_fields);
+    image_len = spp_delta_get_u32(p_fields + 4);
+
+    pthread_mutex_lock(&spp_delta_lock);
+    if ((0 == spp_delta_dir[0]) || !spp_delta_name_valid(name) || (block_size < SPP_DELTA_MIN_BLOCK) ||
+        (block_size > SPP_DELTA_MAX_BLOCK) || (0 == image_len) || (image_len > SPP_DELTA_MAX_LEN) ||
+        (SPP_DELTA_RX_SIGNING == spp_delta_rx.state))
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+        WICED_BT_TRACE("delta: request for %s rejected\n", name);
+        spp_delta_send_result(handle, name, SPP_DELTA_STATUS_REJECTED, image_len);
+        return;
+    }
+
+    /* A new request from the sender replaces the rebuild it gave up */
+    spp_delta_rx_reset();
+    spp_delta_rx.state = SPP_DELTA_RX_SIGNING;
+    spp_delta_rx.handle = handle;
+    strcpy(spp_delta_rx.name, name);
+    spp_delta_rx.block_size = block_size;
+    spp_delta_rx.image_len = image_len;
+    spp_delta_rx.p_block = malloc(block_size);
+
+    /* Without a copy, every byte is sent as literal data */
+    spp_delta_path(path, sizeof(path), name, WICED_FALSE);
+    spp_delta_rx.copy_fd = open(path, O_RDONLY);
+    if ((spp_delta_rx.copy_fd >= 0) &&
+        ((0 != fstat(spp_delta_rx.copy_fd, &st)) || !S_ISREG(st.st_mode) || (st.st_size > SPP_DELTA_MAX_LEN)))
+    {
+        close(spp_delta_rx.copy_fd);
+        spp_delta_rx.copy_fd = -1;
+    }
+    spp_delta_rx.copy_len = (spp_delta_rx.copy_fd >= 0) ? (uint32_t)st.st_size : 0;
+    if (NULL == spp_delta_rx.p_block)
+    {
+        spp_delta_rx_reset();
+        pthread_mutex_unlock(&spp_delta_lock);
+        spp_delta_send_result(handle, name, SPP_DELTA_STATUS_IO_ERROR, image_len);
+        return;
+    }
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    WICED_BT_TRACE("delta: request for %s, %d bytes, copy of %d bytes\n", name, image_len,
+                   spp_delta_rx.copy_len);
+    if (0 != pthread_create(&thread, NULL, spp_delta_sign_worker, NULL))
+    {
+        spp_delta_sign_worker(NULL);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+/* Appends to the rebuilt image */
+static void spp_delta_write(const uint8_t *p_data, uint32_t len)
+{
+    ssize_t written;
+
+    if ((uint64_t)spp_delta_rx.written + len > spp_delta_rx.image_len)
+    {
+        spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+        return;
+    }
+    spp_delta_rx.hash = spp_delta_hash(spp_delta_rx.hash, p_data, len);
+    spp_delta_rx.written += len;
+    while (0 != len)
+    {
+        written = write(spp_delta_rx.part_fd, p_data, len);
+        if (written <= 0)
+        {
+            if ((written < 0) && (EINTR == errno))
+            {
+                continue;
+            }
+            spp_delta_rx.status = SPP_DELTA_STATUS_IO_ERROR;
+            return;
+        }
+        p_data += written;
+        len -= (uint32_t)written;
+    }
+}
+
+/* Length of the unit being parsed, 0 if it is invalid */
+static uint32_t spp_delta_unit_len(void)
+{
+    if (!spp_delta_rx.hdr_done)
+    {
+        if (spp_delta_rx.unit_len < SPP_DELTA_HDR_LEN(0))
+        {
+            return SPP_DELTA_HDR_LEN(0);
+        }
+        if (spp_delta_rx.unit[SPP_DELTA_MAGIC_LEN + 1] > SPP_DELTA_MAX_NAME)
+        {
+            return 0;
+        }
+        return SPP_DELTA_HDR_LEN(spp_delta_rx.unit[SPP_DELTA_MAGIC_LEN + 1]) + SPP_DELTA_DELTA_LEN;
+    }
+    if (0 == spp_delta_rx.unit_len)
+    {
+        return 1;
+    }
+    switch (spp_delta_rx.unit[0])
+    {
+    case SPP_DELTA_INSN_END:
+        return 1;
+    case SPP_DELTA_INSN_COPY:
+        return 9;
+    case SPP_DELTA_INSN_LITERAL:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+static void spp_delta_apply_unit(void)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    const uint8_t *p_fields;
+    uint32_t block;
+    uint32_t count;
+    uint32_t offset;
+    uint32_t len;
+
+    if (!spp_delta_rx.hdr_done)
+    {
+        p_fields = spp_delta_parse_hdr(spp_delta_rx.unit, spp_delta_rx.unit_len, SPP_DELTA_MSG_DELTA,
+                                       SPP_DELTA_DELTA_LEN, name);
+        if ((NULL == p_fields) || (0 != strcmp(name, spp_delta_rx.name)) ||
+            (spp_delta_get_u32(p_fields) != spp_delta_rx.image_len))
+        {
+            spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+            return;
+        }
+        spp_delta_rx.expected_hash = spp_delta_get_u64(p_fields + 4);
+        spp_delta_rx.hdr_done = WICED_TRUE;
+        return;
+    }
+    switch (spp_delta_rx.unit[0])
+    {
+    case SPP_DELTA_INSN_END:
+        spp_delta_rx.end = WICED_TRUE;
+        break;
+
+    case SPP_DELTA_INSN_COPY:
+        block = spp_delta_get_u32(&spp_delta_rx.unit[1]);
+        count = spp_delta_get_u32(&spp_delta_rx.unit[5]);
+        for (; (0 != count) && (SPP_DELTA_STATUS_OK == spp_delta_rx.status); count--, block++)
+        {
+            if ((uint64_t)block * spp_delta_rx.block_size >= spp_delta_rx.copy_len)
+            {
+                spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+                break;
+            }
+            offset = block * spp_delta_rx.block_size;
+            len = MIN(spp_delta_rx.block_size, spp_delta_rx.copy_len - offset);
+            if ((ssize_t)len != pread(spp_delta_rx.copy_fd, spp_delta_rx.p_block, len, offset))
+            {
+                spp_delta_rx.status = SPP_DELTA_STATUS_IO_ERROR;
+                break;
+            }
+            spp_delta_write(spp_delta_rx.p_block, len);
+        }
+        break;
+
+    case SPP_DELTA_INSN_LITERAL:
+        spp_delta_rx.literal_left = spp_delta_get_u32(&spp_delta_rx.unit[1]);
+        if ((uint64_t)spp_delta_rx.written + spp_delta_rx.literal_left > spp_delta_rx.image_len)
+        {
+            spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+        }
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_apply
+ *******************************************************************************
+ * Summary:
+ *   Rebuilds the image from the next part of the delta. Headers and
+ *   instructions may be split across parts and are gathered first.
+ *
+ * Parameters:
+ *   const uint8_t *p_data : part of the delta
+ *   uint32_t len : its length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_delta_apply(const uint8_t *p_data, uint32_t len)
+{
+    uint32_t need;
+    uint32_t take;
+
+    while ((0 != len) && (SPP_DELTA_STATUS_OK == spp_delta_rx.status))
+    {
+        if (spp_delta_rx.end)
+        {
+            /* Nothing may follow the end */
+            spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+            break;
+        }
+        if (0 != spp_delta_rx.literal_left)
+        {
+            take = MIN(len, spp_delta_rx.literal_left);
+            spp_delta_write(p_data, take);
+            spp_delta_rx.literal_left -= take;
+            p_data += take;
+            len -= take;
+            continue;
+        }
+        need = spp_delta_unit_len();
+        if (0 == need)
+        {
+            spp_delta_rx.status = SPP_DELTA_STATUS_VERIFY_FAILED;
+            break;
+        }
+        take = MIN(len, need - spp_delta_rx.unit_len);
+        memcpy(&spp_delta_rx.unit[spp_delta_rx.unit_len], p_data, take);
+        spp_delta_rx.unit_len += take;
+        p_data += take;
+        len -= take;
+        if (spp_delta_rx.unit_len < spp_delta_unit_len())
+        {
+            continue;
+        }
+        spp_delta_apply_unit();
+        spp_delta_rx.unit_len = 0;
+    }
+}
+
+static void spp_delta_rx_delta_begin(spp_delta_in_t *p_in, const uint8_t *p_data, uint32_t len)
+{
+    char path[sizeof(spp_delta_dir) + SPP_DELTA_MAX_NAME + 8];
+
+    pthread_mutex_lock(&spp_delta_lock);
+    if (SPP_DELTA_RX_WAIT_DELTA != spp_delta_rx.state)
+    {
+        pthread_mutex_unlock(&spp_delta_lock);
+
+        /* Answered with a rejection, if the name can be told */
+        p_in->ignored = WICED_TRUE;
+        if (NULL == spp_delta_parse_hdr(p_data, len, SPP_DELTA_MSG_DELTA, SPP_DELTA_DELTA_LEN, p_in->name))
+        {
+            p_in->name[0] = '\0';
+        }
+        return;
+    }
+    spp_delta_rx.state = SPP_DELTA_RX_APPLYING;
+    spp_delta_rx.hash = SPP_DELTA_FNV_INIT;
+    spp_delta_path(path, sizeof(path), spp_delta_rx.name, WICED_TRUE);
+    spp_delta_rx.part_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (spp_delta_rx.part_fd < 0)
+    {
+        spp_delta_rx.status = SPP_DELTA_STATUS_IO_ERROR;
+    }
+    pthread_mutex_unlock(&spp_delta_lock);
+}
+
+static void spp_delta_rx_delta_end(uint16_t handle, spp_delta_in_t *p_in)
+{
+    char name[SPP_DELTA_MAX_NAME + 1];
+    char part[sizeof(spp_delta_dir) + SPP_DELTA_MAX_NAME + 8];
+    char path[sizeof(spp_delta_dir) + SPP_DELTA_MAX_NAME + 8];
+    spp_delta_status_t status;
+    uint32_t image_len;
+
+    if (p_in->ignored)
+    {
+        if (0 != p_in->name[0])
+        {
+            spp_delta_send_result(handle, p_in->name, SPP_DELTA_STATUS_REJECTED, 0);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&spp_delta_lock);
+    status = spp_delta_rx.status;
+    if ((SPP_DELTA_STATUS_OK == status) &&
+        (!spp_delta_rx.end || (spp_delta_rx.written != spp_delta_rx.image_len) ||
+         (spp_delta_rx.hash != spp_delta_rx.expected_hash)))
+    {
+        status = SPP_DELTA_STATUS_VERIFY_FAILED;
+    }
+    if (SPP_DELTA_STATUS_OK == status)
+    {
+        spp_delta_path(part, sizeof(part), spp_delta_rx.name, WICED_TRUE);
+        spp_delta_path(path, sizeof(path), spp_delta_rx.name, WICED_FALSE);
+        if ((0 != fsync(spp_delta_rx.part_fd)) || (0 != rename(part, path)))
+        {
+            status = SPP_DELTA_STATUS_IO_ERROR;
+        }
+        else
+        {
+            /* Renamed, nothing left to clean up */
+            close(spp_delta_rx.part_fd);
+            spp_delta_rx.part_fd = -1;
+        }
+    }
+    if (SPP_DELTA_STATUS_OK == status)
+    {
+        spp_delta_stats.rebuilt++;
+        spp_delta_stats.bytes_rebuilt += spp_delta_rx.image_len;
+    }
+    else if (SPP_DELTA_STATUS_VERIFY_FAILED == status)
+    {
+        spp_delta_stats.verify_failures++;
+    }
+    strcpy(name, spp_delta_rx.name);
+    image_len = spp_delta_rx.image_len;
+    handle = spp_delta_rx.handle;
+    spp_delta_rx_reset();
+    pthread_mutex_unlock(&spp_delta_lock);
+
+    fprintf(stdout, "Delta sync of %s, %u bytes: %s\n", name, image_len, spp_delta_status_names[status]);
+    spp_delta_send_result(handle, name, status, image_len);
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_rx_xfer
+ *******************************************************************************
+ * Summary:
+ *   Takes the content of received transfers. Delta sync messages are
+ *   recognized by their magic at the start of the transfer.
+ *
+ * Parameters:
+ *   uint16_t handle : session the transfer arrives on
+ *   uint32_t xfer_id : transfer ID
+ *   uint32_t offset : offset of the data in the transfer
+ *   uint8_t *p_data : data, in order and without duplicates
+ *   uint32_t len : data length
+ *   uint32_t total_len : transfer length
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the transfer is a delta sync message
+ *
+ ******************************************************************************/
+wiced_bool_t spp_delta_rx_xfer(uint16_t handle, uint32_t xfer_id, uint32_t offset,
+                               uint8_t *p_data, uint32_t len, uint32_t total_len)
+{
+    spp_delta_in_t *p_in = NULL;
+    uint8_t type;
+
+    if (0 == offset)
+    {
+        if ((len < SPP_DELTA_HDR_LEN(0)) || (0 != memcmp(p_data, SPP_DELTA_MAGIC, SPP_DELTA_MAGIC_LEN)))
+        {
+            return WICED_FALSE;
+        }
+        type = p_data[SPP_DELTA_MAGIC_LEN];
+        if ((0 == type) || (type >= SPP_DELTA_MSG_TYPES))
+        {
+            return WICED_FALSE;
+        }
+
+        /* A message of the same type which never completed is dropped */
+        p_in = &spp_delta_in[type];
+        spp_delta_buf_free(&p_in->msg);
+        memset(p_in, 0, sizeof(*p_in));
+        p_in->in_use = WICED_TRUE;
+        p_in->xfer_id = xfer_id;
+        p_in->total_len = total_len;
+        if (SPP_DELTA_MSG_DELTA == type)
+        {
+            spp_delta_rx_delta_begin(p_in, p_data, len);
+        }
+        else if (total_len > SPP_DELTA_MAX_MESSAGE_LEN)
+        {
+            p_in->ignored = WICED_TRUE;
+        }
+    }
+    else
+    {
+        for (type = 1; type < SPP_DELTA_MSG_TYPES; type++)
+        {
+            if (spp_delta_in[type].in_use && (xfer_id == spp_delta_in[type].xfer_id))
+            {
+                p_in = &spp_delta_in[type];
+                break;
+            }
+        }
+        if (NULL == p_in)
+        {
+            return WICED_FALSE;
+        }
+    }
+
+    if (!p_in->ignored)
+    {
+        if (SPP_DELTA_MSG_DELTA == type)
+        {
+            spp_delta_apply(p_data, len);
+        }
+        else
+        {
+            spp_delta_buf_put(&p_in->msg, p_data, len);
+            p_in->ignored = p_in->msg.failed;
+        }
+    }
+    if ((uint64_t)offset + len < total_len)
+    {
+        return WICED_TRUE;
+    }
+
+    p_in->in_use = WICED_FALSE;
+    if ((SPP_DELTA_MSG_DELTA == type) || !p_in->ignored)
+    {
+        switch (type)
+        {
+        case SPP_DELTA_MSG_REQUEST:
+            spp_delta_rx_request(handle, &p_in->msg);
+            break;
+        case SPP_DELTA_MSG_SIGNATURES:
+            spp_delta_rx_signatures(handle, &p_in->msg);
+            break;
+        case SPP_DELTA_MSG_DELTA:
+            spp_delta_rx_delta_end(handle, p_in);
+            break;
+        case SPP_DELTA_MSG_RESULT:
+            spp_delta_rx_result(handle, &p_in->msg);
+            break;
+        }
+    }
+    spp_delta_buf_free(&p_in->msg);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_configure_dir
+ *******************************************************************************
+ * Summary:
+ *   Sets the directory images pushed with delta sync are kept in. Without
+ *   it, requests from the peer are rejected.
+ *
+ * Parameters:
+ *   const char *p_dir : existing directory
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if p_dir is not a directory
+ *
+ ******************************************************************************/
+wiced_bool_t spp_delta_configure_dir(const char *p_dir)
+{
+    struct stat st;
+
+    if ((strlen(p_dir) >= sizeof(spp_delta_dir)) || (0 != stat(p_dir, &st)) || !S_ISDIR(st.st_mode))
+    {
+        fprintf(stderr, "--delta-dir %s is not a directory\n", p_dir);
+        return WICED_FALSE;
+    }
+    strcpy(spp_delta_dir, p_dir);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_init
+ *******************************************************************************
+ * Summary:
+ *   Prepares the retry timer, called once the BT stack is up
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_delta_init(void)
+{
+    wiced_init_timer(&spp_delta_timer, spp_delta_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the delta sync counters
+ *
+ * Parameters:
+ *   spp_delta_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_delta_get_stats(spp_delta_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_delta_lock);
+    *p_stats = spp_delta_stats;
+    pthread_mutex_unlock(&spp_delta_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_delta_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the delta sync counters
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_delta_print_stats(void)
+{
+    spp_delta_stats_t stats;
+    uint64_t saved;
+
+    spp_delta_get_stats(&stats);
+    if ((0 == stats.pushes) && (0 == stats.rebuilt) && (0 == stats.verify_failures))
+    {
+        return;
+    }
+    saved = (stats.bytes_image > stats.bytes_sent) ? (stats.bytes_image - stats.bytes_sent) : 0;
+    fprintf(stdout, "delta tx: pushes %u completed %u failed %u, image %llu bytes, sent %llu, saved %llu\n",
+            stats.pushes, stats.pushes_completed, stats.pushes_failed,
+            (unsigned long long)stats.bytes_image, (unsigned long long)stats.bytes_sent,
+            (unsigned long long)saved);
+    fprintf(stdout, "delta tx: literal %llu bytes, matched %llu, signatures received %llu, "
+            "last push %u of %u bytes sent\n",
+            (unsigned long long)stats.bytes_literal, (unsigned long long)stats.bytes_matched,
+            (unsigned long long)stats.bytes_signatures, stats.last_sent_len, stats.last_image_len);
+    fprintf(stdout, "delta rx: rebuilt %u (%llu bytes), verify failures %u\n",
+            stats.rebuilt, (unsigned long long)stats.bytes_rebuilt, stats.verify_failures);
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,628 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_echo.c
+ *
+ * Description: Echo / ping-pong mode for round-trip time measurement.
+ *
+ *              As a reflector, every frame received is sent straight back on
+ *              the same session. As an initiator, probes carrying a sequence
+ *              number and the local send time are sent at a fixed interval,
+ *              or back to back (interval 0, one probe in flight). The peer
+ *              reflects them and the RTT of each reply is measured against
+ *              the local clock, so the clocks of the two sides never need to
+ *              agree. The run reports min/p50/p99/max RTT and the RFC 3550
+ *              jitter estimate.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_memory.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_echo.h"
+#include "spp_tx.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Time a reply may take before the probe is counted as lost */
+#define SPP_ECHO_REPLY_TIMEOUT_MS               ( 1000 )
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static wiced_bool_t spp_echo_reflect = WICED_FALSE;
+static uint32_t spp_echo_size = SPP_ECHO_DEFAULT_SIZE;
+static uint32_t spp_echo_interval_ms = SPP_ECHO_DEFAULT_INTERVAL_MS;
+static uint32_t spp_echo_count = 0; /* 0 probes until stopped */
+static wiced_bool_t spp_echo_auto_start = WICED_FALSE;
+
+static uint16_t spp_echo_handle = 0; /* session probed, 0 if idle */
+static uint32_t spp_echo_next_seq;
+static uint32_t spp_echo_rx_next_seq; /* one past the newest reply */
+static uint8_t spp_echo_rx_frame[SPP_MAX_PAYLOAD];
+static uint32_t spp_echo_rx_len;
+static uint32_t spp_echo_samples[SPP_ECHO_MAX_SAMPLES];
+static uint32_t spp_echo_last_rtt_us;
+static uint32_t spp_echo_jitter_x16; /* jitter in 1/16 us, as in RFC 3550 */
+static spp_echo_stats_t spp_echo_stats;
+static wiced_timer_t spp_echo_timer;
+static pthread_mutex_t spp_echo_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATIONS
+ ******************************************************************************/
+static void spp_echo_timeout(WICED_TIMER_PARAM_TYPE arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_echo_buffer_sent(void *p_context, wiced_bool_t sent)
+{
+    wiced_bt_free_buffer(p_context);
+}
+
+static void spp_echo_arm_timer(uint32_t ms)
+{
+    if (wiced_is_timer_in_use(&spp_echo_timer))
+    {
+        wiced_stop_timer(&spp_echo_timer);
+    }
+    wiced_start_timer(&spp_echo_timer, ms);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_send_probe
+ *******************************************************************************
+ * Summary:
+ *   Sends the next probe of the run and arms the timer for the one after it,
+ *   or for the reply timeout once the last probe is out
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_echo_send_probe(void)
+{
+    spp_iovec_t iov;
+    uint8_t *p_probe;
+    uint64_t now_us;
+    uint32_t seq;
+    uint32_t i;
+    uint16_t handle;
+    wiced_bool_t last;
+
+    pthread_mutex_lock(&spp_echo_lock);
+    handle = spp_echo_handle;
+    if ((0 == handle) || ((0 != spp_echo_count) && (spp_echo_next_seq >= spp_echo_count)))
+    {
+        pthread_mutex_unlock(&spp_echo_lock);
+        return;
+    }
+    seq = spp_echo_next_seq++;
+    spp_echo_stats.probes_sent++;
+    last = ((0 != spp_echo_count) && (spp_echo_next_seq == spp_echo_count)) ? WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_echo_lock);
+
+    p_probe = (uint8_t *)wiced_bt_get_buffer(spp_echo_size);
+    if (NULL != p_probe)
+    {
+        /* Printable padding, in case the peer is a terminal echoing back */
+        for (i = SPP_ECHO_HDR_LEN; i < spp_echo_size; i++)
+        {
+            p_probe[i] = 'a' + (i % 26);
+        }
+        p_probe[0] = SPP_ECHO_MAGIC_0;
+        p_probe[1] = SPP_ECHO_MAGIC_1;
+        for (i = 0; i < 4; i++)
+        {
+            p_probe[2 + i] = (uint8_t)(seq >> (8 * i));
+        }
+        /* Stamped last, the RTT includes any wait in the transmit queue */
+        now_us = spp_get_time_us();
+        for (i = 0; i < 8; i++)
+        {
+            p_probe[6 + i] = (uint8_t)(now_us >> (8 * i));
+        }
+        iov.p_data = p_probe;
+        iov.len = spp_echo_size;
+        iov.p_complete = spp_echo_buffer_sent;
+        iov.p_context = p_probe;
+    }
+    if ((NULL == p_probe) || !spp_send_iov(handle, &iov, 1))
+    {
+        if (NULL != p_probe)
+        {
+            wiced_bt_free_buffer(p_probe);
+        }
+        pthread_mutex_lock(&spp_echo_lock);
+        spp_echo_stats.send_failures++;
+        pthread_mutex_unlock(&spp_echo_lock);
+    }
+
+    /* In ping-pong mode the reply sends the next probe, the timer only
+     * covers a lost reply
+     */
+    spp_echo_arm_timer((last || (0 == spp_echo_interval_ms)) ? SPP_ECHO_REPLY_TIMEOUT_MS
+                                                              : spp_echo_interval_ms);
+}
+
+static void spp_echo_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    wiced_bool_t done;
+
+    pthread_mutex_lock(&spp_echo_lock);
+    done = ((0 != spp_echo_count) && (spp_echo_next_seq >= spp_echo_count)) ? WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_echo_lock);
+
+    if (done)
+    {
+        spp_echo_stop();
+    }
+    else
+    {
+        spp_echo_send_probe();
+    }
+}
+
+/* Must be called with spp_echo_lock held */
+static void spp_echo_process_reply(const uint8_t *p_frame)
+{
+    uint32_t seq = 0;
+    uint64_t sent_us = 0;
+    uint32_t rtt_us;
+    uint32_t delta_us;
+    int i;
+
+    for (i = 3; i >= 0; i--)
+    {
+        seq = (seq << 8) | p_frame[2 + i];
+    }
+    for (i = 7; i >= 0; i--)
+    {
+        sent_us = (sent_us << 8) | p_frame[6 + i];
+    }
+    if (seq >= spp_echo_next_seq)
+    {
+        /* Not a probe of this run */
+        spp_echo_stats.invalid_bytes += spp_echo_size;
+        return;
+    }
+    rtt_us = (uint32_t)(spp_get_time_us() - sent_us);
+
+    if (seq < spp_echo_rx_next_seq)
+    {
+        spp_echo_stats.reordered++;
+    }
+    else
+    {
+        spp_echo_rx_next_seq = seq + 1;
+    }
+    if (0 != spp_echo_stats.replies)
+    {
+        delta_us = (rtt_us > spp_echo_last_rtt_us) ? rtt_us - spp_echo_last_rtt_us
+                                                   : spp_echo_last_rtt_us - rtt_us;
+        spp_echo_jitter_x16 += delta_us - ((spp_echo_jitter_x16 + 8) >> 4);
+    }
+    spp_echo_last_rtt_us = rtt_us;
+    spp_echo_samples[spp_echo_stats.replies % SPP_ECHO_MAX_SAMPLES] = rtt_us;
+    spp_echo_stats.rtt_min_us = (0 == spp_echo_stats.replies) ? rtt_us
+                                                              : MIN(spp_echo_stats.rtt_min_us, rtt_us);
+    spp_echo_stats.rtt_max_us = MAX(spp_echo_stats.rtt_max_us, rtt_us);
+    spp_echo_stats.replies++;
+    spp_tx_note_rtt(spp_echo_handle, rtt_us);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the echo mode
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_init(void)
+{
+    wiced_init_timer(&spp_echo_timer, spp_echo_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_configure_reflector
+ *******************************************************************************
+ * Summary:
+ *   Enables or disables the reflector. While enabled, every frame received
+ *   is sent back on the same session instead of being processed.
+ *
+ * Parameters:
+ *   wiced_bool_t enable : WICED_TRUE to reflect received frames
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_configure_reflector(wiced_bool_t enable)
+{
+    pthread_mutex_lock(&spp_echo_lock);
+    spp_echo_reflect = enable;
+    pthread_mutex_unlock(&spp_echo_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_configure_probe
+ *******************************************************************************
+ * Summary:
+ *   Sets the probes sent by the next run
+ *
+ * Parameters:
+ *   uint32_t size : probe size, SPP_ECHO_HDR_LEN to SPP_MAX_PAYLOAD bytes
+ *   uint32_t interval_ms : time between probes, 0 sends the next probe as
+ *                          soon as the previous reply arrives
+ *   uint32_t count : probes per run, 0 probes until stopped
+ *   wiced_bool_t auto_start : WICED_TRUE to start a run on every connection
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the size is out of range
+ *
+ ******************************************************************************/
+wiced_bool_t spp_echo_configure_probe(uint32_t size, uint32_t interval_ms, uint32_t count,
+                                      wiced_bool_t auto_start)
+{
+    if ((size < SPP_ECHO_HDR_LEN) || (size > SPP_MAX_PAYLOAD))
+    {
+        return WICED_FALSE;
+    }
+    pthread_mutex_lock(&spp_echo_lock);
+    spp_echo_size = size;
+    spp_echo_interval_ms = interval_ms;
+    spp_echo_count = count;
+    spp_echo_auto_start = auto_start;
+    pthread_mutex_unlock(&spp_echo_lock);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_connection_up / spp_echo_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Starts a run on a new session if configured to, and ends the run of a
+ *   session going down
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_connection_up(uint16_t handle)
+{
+    if (spp_echo_auto_start)
+    {
+        spp_echo_start(handle);
+    }
+}
+
+void spp_echo_connection_down(uint16_t handle)
+{
+    if (handle == spp_echo_handle)
+    {
+        spp_echo_stop();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_start
+ *******************************************************************************
+ * Summary:
+ *   Starts a probe run on a session. The results of the previous run are
+ *   cleared.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if a run is already in progress
+ *
+ ******************************************************************************/
+wiced_bool_t spp_echo_start(uint16_t handle)
+{
+    uint64_t echoed_bytes;
+    uint32_t echo_drops;
+
+    pthread_mutex_lock(&spp_echo_lock);
+    if ((0 != spp_echo_handle) || (0 == handle))
+    {
+        pthread_mutex_unlock(&spp_echo_lock);
+        return WICED_FALSE;
+    }
+    echoed_bytes = spp_echo_stats.echoed_bytes;
+    echo_drops = spp_echo_stats.echo_drops;
+    memset(&spp_echo_stats, 0, sizeof(spp_echo_stats));
+    spp_echo_stats.echoed_bytes = echoed_bytes;
+    spp_echo_stats.echo_drops = echo_drops;
+    spp_echo_next_seq = 0;
+    spp_echo_rx_next_seq = 0;
+    spp_echo_rx_len = 0;
+    spp_echo_jitter_x16 = 0;
+    spp_echo_handle = handle;
+    pthread_mutex_unlock(&spp_echo_lock);
+
+    fprintf(stdout, "Latency probe started: %u byte probes, %s%u ms, %u probes\n", spp_echo_size,
+            (0 == spp_echo_interval_ms) ? "ping-pong, reply timeout " : "every ",
+            (0 == spp_echo_interval_ms) ? SPP_ECHO_REPLY_TIMEOUT_MS : spp_echo_interval_ms,
+            spp_echo_count);
+    spp_echo_send_probe();
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_stop
+ *******************************************************************************
+ * Summary:
+ *   Ends the probe run and prints its results. Probes without a reply are
+ *   counted as lost.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_stop(void)
+{
+    pthread_mutex_lock(&spp_echo_lock);
+    if (0 == spp_echo_handle)
+    {
+        pthread_mutex_unlock(&spp_echo_lock);
+        return;
+    }
+    spp_echo_handle = 0;
+    spp_echo_stats.lost = spp_echo_stats.probes_sent - spp_echo_stats.send_failures -
+                          MIN(spp_echo_stats.replies,
+                              spp_echo_stats.probes_sent - spp_echo_stats.send_failures);
+    pthread_mutex_unlock(&spp_echo_lock);
+
+    if (wiced_is_timer_in_use(&spp_echo_timer))
+    {
+        wiced_stop_timer(&spp_echo_timer);
+    }
+    spp_echo_print_stats();
+}
+
+wiced_bool_t spp_echo_is_probing(void)
+{
+    return (0 != spp_echo_handle) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_rx_data
+ *******************************************************************************
+ * Summary:
+ *   Reflects received data, or matches it against the probes of the run
+ *   in progress. Replies may be split or merged by the link, they are
+ *   reassembled into probes of the configured size first.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_data : received data
+ *   uint32_t data_len : received data length
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the data was consumed by the echo mode
+ *
+ ******************************************************************************/
+wiced_bool_t spp_echo_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len)
+{
+    spp_iovec_t iov;
+    uint8_t *p_copy;
+    uint8_t *p_magic;
+    uint32_t chunk;
+    uint32_t skip;
+    uint32_t replies;
+    wiced_bool_t next = WICED_FALSE;
+    wiced_bool_t done = WICED_FALSE;
+
+    if (spp_echo_reflect)
+    {
+        /* The receive buffer is only valid during the callback */
+        p_copy = (uint8_t *)wiced_bt_get_buffer(data_len);
+        if (NULL != p_copy)
+        {
+            memcpy(p_copy, p_data, data_len);
+            iov.p_data = p_copy;
+            iov.len = data_len;
+            iov.p_complete = spp_echo_buffer_sent;
+            iov.p_context = p_copy;
+        }
+        if ((NULL == p_copy) || !spp_send_iov(handle, &iov, 1))
+        {
+            if (NULL != p_copy)
+            {
+                wiced_bt_free_buffer(p_copy);
+            }
+            pthread_mutex_lock(&spp_echo_lock);
+            spp_echo_stats.echo_drops++;
+            pthread_mutex_unlock(&spp_echo_lock);
+            return WICED_TRUE;
+        }
+        pthread_mutex_lock(&spp_echo_lock);
+        spp_echo_stats.echoed_bytes += data_len;
+        pthread_mutex_unlock(&spp_echo_lock);
+        return WICED_TRUE;
+    }
+
+    pthread_mutex_lock(&spp_echo_lock);
+    if ((0 == spp_echo_handle) || (handle != spp_echo_handle))
+    {
+        pthread_mutex_unlock(&spp_echo_lock);
+        return WICED_FALSE;
+    }
+    replies = spp_echo_stats.replies;
+    while (0 != data_len)
+    {
+        chunk = MIN(data_len, spp_echo_size - spp_echo_rx_len);
+        memcpy(&spp_echo_rx_frame[spp_echo_rx_len], p_data, chunk);
+        spp_echo_rx_len += chunk;
+        p_data += chunk;
+        data_len -= chunk;
+        if (spp_echo_rx_len < spp_echo_size)
+        {
+            break;
+        }
+        if ((SPP_ECHO_MAGIC_0 == spp_echo_rx_frame[0]) && (SPP_ECHO_MAGIC_1 == spp_echo_rx_frame[1]))
+        {
+            spp_echo_process_reply(spp_echo_rx_frame);
+            spp_echo_rx_len = 0;
+            continue;
+        }
+        /* Out of step, resume at the next candidate probe start */
+        p_magic = memchr(&spp_echo_rx_frame[1], SPP_ECHO_MAGIC_0, spp_echo_rx_len - 1);
+        skip = (NULL != p_magic) ? (uint32_t)(p_magic - spp_echo_rx_frame) : spp_echo_rx_len;
+        memmove(spp_echo_rx_frame, &spp_echo_rx_frame[skip], spp_echo_rx_len - skip);
+        spp_echo_rx_len -= skip;
+        spp_echo_stats.invalid_bytes += skip;
+    }
+    if (replies != spp_echo_stats.replies)
+    {
+        done = ((0 != spp_echo_count) && (spp_echo_stats.replies >= spp_echo_count)) ? WICED_TRUE
+                                                                                     : WICED_FALSE;
+        next = (!done && (0 == spp_echo_interval_ms)) ? WICED_TRUE : WICED_FALSE;
+    }
+    pthread_mutex_unlock(&spp_echo_lock);
+
+    if (done)
+    {
+        /* Every reply is in */
+        spp_echo_stop();
+    }
+    else if (next)
+    {
+        spp_echo_send_probe();
+    }
+    return WICED_TRUE;
+}
+
+static int spp_echo_compare_u32(const void *p_a, const void *p_b)
+{
+    uint32_t a = *(const uint32_t *)p_a;
+    uint32_t b = *(const uint32_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the results of the current or last probe run. The percentiles
+ *   cover the last SPP_ECHO_MAX_SAMPLES replies.
+ *
+ * Parameters:
+ *   spp_echo_stats_t *p_stats : filled with the results
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_get_stats(spp_echo_stats_t *p_stats)
+{
+    static uint32_t sorted[SPP_ECHO_MAX_SAMPLES];
+    uint32_t count;
+
+    pthread_mutex_lock(&spp_echo_lock);
+    *p_stats = spp_echo_stats;
+    count = MIN(spp_echo_stats.replies, SPP_ECHO_MAX_SAMPLES);
+    memcpy(sorted, spp_echo_samples, count * sizeof(sorted[0]));
+    p_stats->jitter_us = (spp_echo_jitter_x16 + 8) >> 4;
+    if (0 != count)
+    {
+        qsort(sorted, count, sizeof(sorted[0]), spp_echo_compare_u32);
+        p_stats->rtt_p50_us = sorted[count / 2];
+        p_stats->rtt_p99_us = sorted[MIN(count - 1, count * 99 / 100)];
+    }
+    pthread_mutex_unlock(&spp_echo_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_echo_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the RTT distribution and jitter of the current or last probe run,
+ *   and the reflector counters
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_echo_print_stats(void)
+{
+    spp_echo_stats_t stats;
+
+    spp_echo_get_stats(&stats);
+    fprintf(stdout, "echo: reflector %s, echoed %llu bytes, dropped %u frames\n",
+            spp_echo_reflect ? "on" : "off", (unsigned long long)stats.echoed_bytes,
+            stats.echo_drops);
+    fprintf(stdout, "echo: %s%u probes of %u bytes, %u replies, %u lost, %u reordered, %u send failures, %u bytes skipped\n",
+            spp_echo_is_probing() ? "running, " : "", stats.probes_sent, spp_echo_size,
+            stats.replies, stats.lost, stats.reordered, stats.send_failures, stats.invalid_bytes);
+    if (0 != stats.replies)
+    {
+        fprintf(stdout, "echo: rtt us min %u p50 %u p99 %u max %u, jitter %u us\n",
+                stats.rtt_min_us, stats.rtt_p50_us, stats.rtt_p99_us, stats.rtt_max_us,
+                stats.jitter_us);
+    }
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,1043 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_gatt.c
+ *
+ * Description: LE GATT serial service.
+ *
+ *              Offers the serial port over Bluetooth LE next to RFCOMM, for
+ *              peers such as phones which have no SPP profile. The service
+ *              uses the widely supported Nordic UART Service layout:
+ *              - the peer writes, with or without response, to the RX
+ *                characteristic
+ *              - the server sends notifications on the TX characteristic
+ *                once the peer enabled them in its CCCD
+ *
+ *              Every LE link is a session like an RFCOMM one. Its handle has
+ *              SPP_GATT_HANDLE_FLAG set, it is announced through the same
+ *              connection up / down and receive callbacks as RFCOMM sessions
+ *              and it is sent to through spp_send_iov(). The transmit queue
+ *              sizes frames to the ATT payload of the link and calls back
+ *              into this module to send each one as a notification.
+ *
+ *              After connecting, the server asks for the 2M PHY, the longest
+ *              LL data length and a short connection interval, and it offers
+ *              an ATT MTU of up to SPP_GATT_MAX_MTU. Together they let one
+ *              notification fill a connection event with little overhead.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_cfg.h"
+#include "wiced_bt_ble.h"
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_l2c.h"
+#include "wiced_bt_uuid.h"
+#include "wiced_memory.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_gatt.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Nordic UART Service, 6E40000x-B5A3-F393-E0A9-E50E24DCCA9E, little endian */
+#define SPP_GATT_UUID_SERIAL(x) \
+    0x9E, 0xCA, 0xDC, 0x24, 0x0E, 0xE5, 0xA9, 0xE0, 0x93, 0xF3, 0xA3, 0xB5, (x), 0x00, 0x40, 0x6E
+#define SPP_GATT_UUID_SERVICE                   SPP_GATT_UUID_SERIAL(0x01)
+#define SPP_GATT_UUID_RX                        SPP_GATT_UUID_SERIAL(0x02)
+#define SPP_GATT_UUID_TX                        SPP_GATT_UUID_SERIAL(0x03)
+
+#define SPP_GATT_PHY_2M                         ( 2 )
+/* Generic computer */
+#define SPP_GATT_APPEARANCE                     ( 0x0080 )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    HDLS_GAP = 0x01,
+    HDLC_GAP_DEVICE_NAME,
+    HDLC_GAP_DEVICE_NAME_VALUE,
+    HDLC_GAP_APPEARANCE,
+    HDLC_GAP_APPEARANCE_VALUE,
+
+    HDLS_SERIAL = 0x10,
+    HDLC_SERIAL_RX,
+    HDLC_SERIAL_RX_VALUE,
+    HDLC_SERIAL_TX,
+    HDLC_SERIAL_TX_VALUE,
+    HDLD_SERIAL_TX_CCCD,
+} spp_gatt_db_handle_t;
+
+typedef struct
+{
+    wiced_bool_t in_use;
+    uint16_t conn_id;
+    BD_ADDR bda;
+    uint32_t generation;   /* tells notifications of an earlier link apart */
+    uint16_t mtu;
+    uint8_t cccd[2];
+    wiced_bool_t congested;
+    uint8_t in_flight;     /* notifications not yet transmitted */
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    uint16_t tx_octets;
+    uint16_t rx_octets;
+} spp_gatt_conn_t;
+
+/* Placed in front of the payload of every notification buffer */
+typedef struct
+{
+    uint16_t handle;
+    uint32_t generation;
+} spp_gatt_notify_hdr_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+extern const wiced_bt_cfg_settings_t wiced_bt_cfg_settings;
+
+static const uint8_t spp_gatt_db[] =
+{
+    PRIMARY_SERVICE_UUID16(HDLS_GAP, UUID_SERVICE_GAP),
+        CHARACTERISTIC_UUID16(HDLC_GAP_DEVICE_NAME, HDLC_GAP_DEVICE_NAME_VALUE,
+                              UUID_CHARACTERISTIC_DEVICE_NAME, GATTDB_CHAR_PROP_READ,
+                              GATTDB_PERM_READABLE),
+        CHARACTERISTIC_UUID16(HDLC_GAP_APPEARANCE, HDLC_GAP_APPEARANCE_VALUE,
+                              UUID_CHARACTERISTIC_APPEARANCE, GATTDB_CHAR_PROP_READ,
+                              GATTDB_PERM_READABLE),
+
+    PRIMARY_SERVICE_UUID128(HDLS_SERIAL, SPP_GATT_UUID_SERVICE),
+        CHARACTERISTIC_UUID128_WRITABLE(HDLC_SERIAL_RX, HDLC_SERIAL_RX_VALUE, SPP_GATT_UUID_RX,
+                                        GATTDB_CHAR_PROP_WRITE | GATTDB_CHAR_PROP_WRITE_NO_RESPONSE,
+                                        GATTDB_PERM_VARIABLE_LENGTH | GATTDB_PERM_WRITE_REQ |
+                                        GATTDB_PERM_WRITE_CMD),
+        CHARACTERISTIC_UUID128(HDLC_SERIAL_TX, HDLC_SERIAL_TX_VALUE, SPP_GATT_UUID_TX,
+                               GATTDB_CHAR_PROP_NOTIFY, GATTDB_PERM_NONE),
+            CHAR_DESCRIPTOR_UUID16_WRITABLE(HDLD_SERIAL_TX_CCCD,
+                                            UUID_DESCRIPTOR_CLIENT_CHARACTERISTIC_CONFIGURATION,
+                                            GATTDB_PERM_READABLE | GATTDB_PERM_WRITE_REQ),
+};
+
+static const uint8_t spp_gatt_appearance[2] = { SPP_GATT_APPEARANCE & 0xff, SPP_GATT_APPEARANCE >> 8 };
+static uint8_t spp_gatt_adv_flags = BTM_BLE_GENERAL_DISCOVERABLE_FLAG | BTM_BLE_BREDR_NOT_SUPPORTED;
+static uint8_t spp_gatt_adv_uuid[] = { SPP_GATT_UUID_SERVICE };
+
+static wiced_bool_t spp_gatt_enabled = WICED_FALSE;
+static spp_gatt_reg_t spp_gatt_reg;
+static spp_gatt_conn_t spp_gatt_conns[SPP_GATT_MAX_LINKS];
+static uint32_t spp_gatt_generation = 0;
+static spp_gatt_stats_t spp_gatt_stats;
+static pthread_mutex_t spp_gatt_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static wiced_bool_t spp_gatt_can_send(uint16_t handle);
+static wiced_bool_t spp_gatt_send(uint16_t handle, uint8_t *p_data, uint32_t len);
+static wiced_bool_t spp_gatt_disconnect(uint16_t handle);
+
+static const spp_tx_transport_ops_t spp_gatt_tx_ops = { spp_gatt_can_send, spp_gatt_send, spp_gatt_disconnect };
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static uint16_t spp_gatt_handle_of(const spp_gatt_conn_t *p_conn)
+{
+    return SPP_GATT_HANDLE_FLAG | (uint16_t)(p_conn - spp_gatt_conns + 1);
+}
+
+/* Must be called with spp_gatt_lock held */
+static spp_gatt_conn_t *spp_gatt_find_handle(uint16_t handle)
+{
+    uint16_t idx = handle & ~SPP_GATT_HANDLE_FLAG;
+
+    if (!SPP_GATT_IS_SESSION(handle) || (0 == idx) || (idx > SPP_GATT_MAX_LINKS) ||
+        !spp_gatt_conns[idx - 1].in_use)
+    {
+        return NULL;
+    }
+    return &spp_gatt_conns[idx - 1];
+}
+
+/* Must be called with spp_gatt_lock held */
+static spp_gatt_conn_t *spp_gatt_find_conn_id(uint16_t conn_id)
+{
+    int i;
+
+    for (i = 0; i < SPP_GATT_MAX_LINKS; i++)
+    {
+        if (spp_gatt_conns[i].in_use && (spp_gatt_conns[i].conn_id == conn_id))
+        {
+            return &spp_gatt_conns[i];
+        }
+    }
+    return NULL;
+}
+
+/* Must be called with spp_gatt_lock held */
+static spp_gatt_conn_t *spp_gatt_find_bda(const uint8_t *bda)
+{
+    int i;
+
+    for (i = 0; i < SPP_GATT_MAX_LINKS; i++)
+    {
+        if (spp_gatt_conns[i].in_use && (0 == memcmp(spp_gatt_conns[i].bda, bda, BD_ADDR_LEN)))
+        {
+            return &spp_gatt_conns[i];
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_advertise
+ *******************************************************************************
+ * Summary:
+ *   Advertises the serial service while a link is free. The stack stops
+ *   advertising when a peer connects, so this is called again after every
+ *   connection and disconnection.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_gatt_advertise(void)
+{
+    wiced_bt_ble_advert_elem_t adv[2];
+    wiced_bt_ble_advert_elem_t scan_rsp;
+    wiced_bool_t free_link = WICED_FALSE;
+    int i;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    for (i = 0; i < SPP_GATT_MAX_LINKS; i++)
+    {
+        free_link |= !spp_gatt_conns[i].in_use;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+    if (!free_link)
+    {
+        return;
+    }
+
+    /* The 128-bit UUID leaves no room for the name, it goes to the scan response */
+    adv[0].advert_type = BTM_BLE_ADVERT_TYPE_FLAG;
+    adv[0].len = sizeof(spp_gatt_adv_flags);
+    adv[0].p_data = &spp_gatt_adv_flags;
+    adv[1].advert_type = BTM_BLE_ADVERT_TYPE_128SRV_COMPLETE;
+    adv[1].len = sizeof(spp_gatt_adv_uuid);
+    adv[1].p_data = spp_gatt_adv_uuid;
+    scan_rsp.advert_type = BTM_BLE_ADVERT_TYPE_NAME_COMPLETE;
+    scan_rsp.len = (uint16_t)strlen((char *)wiced_bt_cfg_settings.device_name);
+    scan_rsp.p_data = wiced_bt_cfg_settings.device_name;
+
+    wiced_bt_ble_set_raw_advertisement_data(2, adv);
+    wiced_bt_ble_set_raw_scan_response_data(1, &scan_rsp);
+    if (WICED_BT_SUCCESS != wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL))
+    {
+        WICED_BT_TRACE("%s: advertising failed\n", __FUNCTION__);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Opens a session for a new LE link and asks for the link parameters
+ *   giving the best throughput
+ *
+ * Parameters:
+ *   wiced_bt_gatt_connection_status_t *p_status : connection event
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_gatt_connection_up(wiced_bt_gatt_connection_status_t *p_status)
+{
+    wiced_bt_ble_phy_preferences_t phy;
+    spp_gatt_conn_t *p_conn = NULL;
+    uint16_t handle = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    for (i = 0; i < SPP_GATT_MAX_LINKS; i++)
+    {
+        if (!spp_gatt_conns[i].in_use)
+        {
+            p_conn = &spp_gatt_conns[i];
+            memset(p_conn, 0, sizeof(*p_conn));
+            p_conn->in_use = WICED_TRUE;
+            p_conn->conn_id = p_status->conn_id;
+            memcpy(p_conn->bda, p_status->bd_addr, BD_ADDR_LEN);
+            p_conn->generation = ++spp_gatt_generation;
+            p_conn->mtu = SPP_GATT_DEFAULT_MTU;
+            handle = spp_gatt_handle_of(p_conn);
+            spp_gatt_stats.connects++;
+            break;
+        }
+    }
+    if (NULL == p_conn)
+    {
+        spp_gatt_stats.rejected++;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    if (NULL == p_conn)
+    {
+        WICED_BT_TRACE("%s: no free session for conn_id %d\n", __FUNCTION__, p_status->conn_id);
+        wiced_bt_gatt_disconnect(p_status->conn_id);
+        return;
+    }
+
+    spp_gatt_reg.p_connection_up_callback(handle, p_status->bd_addr);
+    spp_tx_set_frame_size(handle, SPP_GATT_DEFAULT_MTU - SPP_GATT_ATT_HEADER);
+
+    memset(&phy, 0, sizeof(phy));
+    memcpy(phy.remote_bd_addr, p_status->bd_addr, BD_ADDR_LEN);
+    phy.tx_phys = BTM_BLE_PREFER_2M_PHY;
+    phy.rx_phys = BTM_BLE_PREFER_2M_PHY;
+    phy.phy_opts = BTM_BLE_PREFER_NO_LELR;
+    wiced_bt_ble_set_phy(&phy);
+    wiced_bt_ble_set_data_packet_length(p_status->bd_addr, SPP_GATT_DATA_LENGTH);
+    wiced_bt_l2cap_update_ble_conn_params(p_status->bd_addr, SPP_GATT_CONN_INTERVAL_MIN,
+                                          SPP_GATT_CONN_INTERVAL_MAX, SPP_GATT_CONN_LATENCY,
+                                          SPP_GATT_SUPERVISION_TIMEOUT);
+    spp_gatt_advertise();
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Closes the session of an LE link. Notifications still held by the stack
+ *   are freed when it returns them, they no longer count for any link.
+ *
+ * Parameters:
+ *   uint16_t conn_id : GATT connection id
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_gatt_connection_down(uint16_t conn_id)
+{
+    spp_gatt_conn_t *p_conn;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_conn_id(conn_id);
+    if (NULL != p_conn)
+    {
+        handle = spp_gatt_handle_of(p_conn);
+        spp_gatt_stats.disconnects++;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    if (0 == handle)
+    {
+        return;
+    }
+    /* The entry stays in use until the session is closed, so nothing is
+     * sent to a new link reusing it
+     */
+    spp_gatt_reg.p_connection_down_callback(handle);
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    memset(p_conn, 0, sizeof(*p_conn));
+    pthread_mutex_unlock(&spp_gatt_lock);
+    spp_gatt_advertise();
+}
+
+/* Read value of an attribute, NULL if it has none */
+static const uint8_t *spp_gatt_read_value(spp_gatt_conn_t *p_conn, uint16_t attr_handle, uint16_t *p_len)
+{
+    switch (attr_handle)
+    {
+    case HDLC_GAP_DEVICE_NAME_VALUE:
+        *p_len = (uint16_t)strlen((char *)wiced_bt_cfg_settings.device_name);
+        return wiced_bt_cfg_settings.device_name;
+    case HDLC_GAP_APPEARANCE_VALUE:
+        *p_len = sizeof(spp_gatt_appearance);
+        return spp_gatt_appearance;
+    case HDLD_SERIAL_TX_CCCD:
+        *p_len = sizeof(p_conn->cccd);
+        return p_conn->cccd;
+    default:
+        return NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_write
+ *******************************************************************************
+ * Summary:
+ *   Handles a write or write command: data written to the RX value goes to
+ *   the session receive path, the CCCD enables notifications
+ *
+ * Parameters:
+ *   wiced_bt_gatt_attribute_request_t *p_req : request
+ *
+ * Return:
+ *   wiced_bt_gatt_status_t : status of the write
+ *
+ ******************************************************************************/
+static wiced_bt_gatt_status_t spp_gatt_write(wiced_bt_gatt_attribute_request_t *p_req)
+{
+    wiced_bt_gatt_write_req_t *p_write = &p_req->data.write_req;
+    spp_gatt_conn_t *p_conn;
+    wiced_bool_t notify = WICED_FALSE;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_conn_id(p_req->conn_id);
+    if (NULL != p_conn)
+    {
+        handle = spp_gatt_handle_of(p_conn);
+        if (HDLC_SERIAL_RX_VALUE == p_write->handle)
+        {
+            spp_gatt_stats.writes++;
+            spp_gatt_stats.write_bytes += p_write->val_len;
+        }
+        else if ((HDLD_SERIAL_TX_CCCD == p_write->handle) && (sizeof(p_conn->cccd) == p_write->val_len))
+        {
+            memcpy(p_conn->cccd, p_write->p_val, sizeof(p_conn->cccd));
+            notify = (0 != (p_conn->cccd[0] & GATT_CLIENT_CONFIG_NOTIFICATION)) ? WICED_TRUE : WICED_FALSE;
+        }
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    if (0 == handle)
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+    switch (p_write->handle)
+    {
+    case HDLC_SERIAL_RX_VALUE:
+        spp_gatt_reg.p_rx_data_callback(handle, p_write->p_val, p_write->val_len);
+        return WICED_BT_GATT_SUCCESS;
+    case HDLD_SERIAL_TX_CCCD:
+        if (sizeof(p_conn->cccd) != p_write->val_len)
+        {
+            return WICED_BT_GATT_INVALID_ATTR_LEN;
+        }
+        if (notify)
+        {
+            /* Data queued before the peer subscribed goes out now */
+            spp_tx_kick(handle);
+        }
+        return WICED_BT_GATT_SUCCESS;
+    default:
+        return WICED_BT_GATT_WRITE_NOT_PERMIT;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_attribute_request
+ *******************************************************************************
+ * Summary:
+ *   Answers the ATT requests of the peer
+ *
+ * Parameters:
+ *   wiced_bt_gatt_attribute_request_t *p_req : request
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_gatt_attribute_request(wiced_bt_gatt_attribute_request_t *p_req)
+{
+    wiced_bt_gatt_status_t status;
+    spp_gatt_conn_t *p_conn;
+    const uint8_t *p_value = NULL;
+    uint16_t attr_handle;
+    uint16_t handle = 0;
+    uint16_t mtu = 0;
+    uint16_t len = 0;
+
+    switch (p_req->opcode)
+    {
+    case GATT_REQ_MTU:
+        pthread_mutex_lock(&spp_gatt_lock);
+        p_conn = spp_gatt_find_conn_id(p_req->conn_id);
+        if (NULL != p_conn)
+        {
+            p_conn->mtu = MAX(SPP_GATT_DEFAULT_MTU, MIN(p_req->data.remote_mtu, SPP_GATT_MAX_MTU));
+            mtu = p_conn->mtu;
+            handle = spp_gatt_handle_of(p_conn);
+            spp_gatt_stats.mtu_exchanges++;
+        }
+        pthread_mutex_unlock(&spp_gatt_lock);
+        wiced_bt_gatt_server_send_mtu_rsp(p_req->conn_id, p_req->data.remote_mtu, SPP_GATT_MAX_MTU);
+        if (0 != handle)
+        {
+            WICED_BT_TRACE("%s: handle 0x%04x mtu %d\n", __FUNCTION__, handle, mtu);
+            spp_tx_set_frame_size(handle, mtu - SPP_GATT_ATT_HEADER);
+        }
+        break;
+
+    case GATT_REQ_READ:
+    case GATT_REQ_READ_BLOB:
+        attr_handle = p_req->data.read_req.handle;
+        pthread_mutex_lock(&spp_gatt_lock);
+        p_conn = spp_gatt_find_conn_id(p_req->conn_id);
+        if (NULL != p_conn)
+        {
+            p_value = spp_gatt_read_value(p_conn, attr_handle, &len);
+        }
+        pthread_mutex_unlock(&spp_gatt_lock);
+        if (NULL == p_value)
+        {
+            wiced_bt_gatt_server_send_error_rsp(p_req->conn_id, p_req->opcode, attr_handle,
+                                                WICED_BT_GATT_READ_NOT_PERMIT);
+        }
+        else if (p_req->data.read_req.offset > len)
+        {
+            wiced_bt_gatt_server_send_error_rsp(p_req->conn_id, p_req->opcode, attr_handle,
+                                                WICED_BT_GATT_INVALID_OFFSET);
+        }
+        else
+        {
+            len = MIN(len - p_req->data.read_req.offset, p_req->len_requested);
+            wiced_bt_gatt_server_send_read_handle_rsp(p_req->conn_id, p_req->opcode, len,
+                                                      (uint8_t *)p_value + p_req->data.read_req.offset,
+                                                      NULL);
+        }
+        break;
+
+    case GATT_REQ_WRITE:
+    case GATT_CMD_WRITE:
+        attr_handle = p_req->data.write_req.handle;
+        status = spp_gatt_write(p_req);
+        /* Write commands have no response, not even an error */
+        if (GATT_REQ_WRITE != p_req->opcode)
+        {
+            break;
+        }
+        if (WICED_BT_GATT_SUCCESS == status)
+        {
+            wiced_bt_gatt_server_send_write_rsp(p_req->conn_id, p_req->opcode, attr_handle);
+        }
+        else
+        {
+            wiced_bt_gatt_server_send_error_rsp(p_req->conn_id, p_req->opcode, attr_handle, status);
+        }
+        break;
+
+    case GATT_HANDLE_VALUE_CONF:
+        break;
+
+    default:
+        wiced_bt_gatt_server_send_error_rsp(p_req->conn_id, p_req->opcode, 0,
+                                            WICED_BT_GATT_REQ_NOT_SUPPORTED);
+        break;
+    }
+}
+
+/* Frees a response buffer given to the stack on GATT_GET_RESPONSE_BUFFER_EVT */
+static void spp_gatt_free_rsp_buffer(uint8_t *p_data)
+{
+    wiced_bt_free_buffer(p_data);
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_notification_sent
+ *******************************************************************************
+ * Summary:
+ *   Called by the stack once a notification was transmitted, or dropped on
+ *   disconnect. Frees it and lets the session send the next one.
+ *
+ * Parameters:
+ *   uint8_t *p_data : notification payload
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_gatt_notification_sent(uint8_t *p_data)
+{
+    spp_gatt_notify_hdr_t *p_hdr = (spp_gatt_notify_hdr_t *)p_data - 1;
+    spp_gatt_conn_t *p_conn;
+    uint16_t handle = p_hdr->handle;
+    wiced_bool_t kick = WICED_FALSE;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_handle(handle);
+    if ((NULL != p_conn) && (p_conn->generation == p_hdr->generation) && (0 != p_conn->in_flight))
+    {
+        kick = (SPP_GATT_MAX_IN_FLIGHT == p_conn->in_flight--) ? WICED_TRUE : WICED_FALSE;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    wiced_bt_free_buffer(p_hdr);
+    if (kick)
+    {
+        spp_tx_kick(handle);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_can_send
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, tells if the link takes another notification
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if a notification can be sent
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_gatt_can_send(uint16_t handle)
+{
+    spp_gatt_conn_t *p_conn;
+    wiced_bool_t can_send = WICED_FALSE;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_handle(handle);
+    if ((NULL != p_conn) && (0 != (p_conn->cccd[0] & GATT_CLIENT_CONFIG_NOTIFICATION)) &&
+        !p_conn->congested && (p_conn->in_flight < SPP_GATT_MAX_IN_FLIGHT))
+    {
+        can_send = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+    return can_send;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_send
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, sends one frame as a notification of the TX
+ *   value. The frame is copied to a stack buffer which the stack keeps until
+ *   the notification was transmitted.
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *   uint8_t *p_data : frame
+ *   uint32_t len : frame length, at most the ATT payload of the link
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stack took the notification
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_gatt_send(uint16_t handle, uint8_t *p_data, uint32_t len)
+{
+    spp_gatt_notify_hdr_t *p_hdr;
+    spp_gatt_conn_t *p_conn;
+    uint32_t generation = 0;
+    uint16_t conn_id = 0;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_handle(handle);
+    if ((NULL != p_conn) && (len <= (uint32_t)(p_conn->mtu - SPP_GATT_ATT_HEADER)))
+    {
+        /* Counted before sending, the stack may report it sent at once */
+        p_conn->in_flight++;
+        conn_id = p_conn->conn_id;
+        generation = p_conn->generation;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+    if (0 == generation)
+    {
+        return WICED_FALSE;
+    }
+
+    p_hdr = (spp_gatt_notify_hdr_t *)wiced_bt_get_buffer(sizeof(*p_hdr) + len);
+    if (NULL != p_hdr)
+    {
+        p_hdr->handle = handle;
+        p_hdr->generation = generation;
+        memcpy(p_hdr + 1, p_data, len);
+        if (WICED_BT_GATT_SUCCESS == wiced_bt_gatt_server_send_notification(conn_id, HDLC_SERIAL_TX_VALUE,
+                                                                            (uint16_t)len,
+                                                                            (uint8_t *)(p_hdr + 1),
+                                                                            spp_gatt_notification_sent))
+        {
+            pthread_mutex_lock(&spp_gatt_lock);
+            spp_gatt_stats.notifications++;
+            spp_gatt_stats.notify_bytes += len;
+            pthread_mutex_unlock(&spp_gatt_lock);
+            return WICED_TRUE;
+        }
+        wiced_bt_free_buffer(p_hdr);
+    }
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    if (NULL == p_hdr)
+    {
+        spp_gatt_stats.no_buffers++;
+    }
+    p_conn = spp_gatt_find_handle(handle);
+    if ((NULL != p_conn) && (p_conn->generation == generation) && (0 != p_conn->in_flight))
+    {
+        p_conn->in_flight--;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_disconnect
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, closes the LE link of a session
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stack accepted the request
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_gatt_disconnect(uint16_t handle)
+{
+    spp_gatt_conn_t *p_conn;
+    uint32_t generation = 0;
+    uint16_t conn_id = 0;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_handle(handle);
+    if (NULL != p_conn)
+    {
+        conn_id = p_conn->conn_id;
+        generation = p_conn->generation;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    return ((0 != generation) && (WICED_BT_GATT_SUCCESS == wiced_bt_gatt_disconnect(conn_id))) ? WICED_TRUE
+                                                                                             : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_callback
+ *******************************************************************************
+ * Summary:
+ *   GATT event handler
+ *
+ * Parameters:
+ *   wiced_bt_gatt_evt_t event : GATT event
+ *   wiced_bt_gatt_event_data_t *p_event_data : event data
+ *
+ * Return:
+ *   wiced_bt_gatt_status_t : WICED_BT_GATT_SUCCESS
+ *
+ ******************************************************************************/
+static wiced_bt_gatt_status_t spp_gatt_callback(wiced_bt_gatt_evt_t event,
+                                                wiced_bt_gatt_event_data_t *p_event_data)
+{
+    wiced_bt_gatt_buffer_transmitted_t *p_xmitted;
+    spp_gatt_conn_t *p_conn;
+    uint16_t handle = 0;
+
+    switch (event)
+    {
+    case GATT_CONNECTION_STATUS_EVT:
+        if (p_event_data->connection_status.connected)
+        {
+            spp_gatt_connection_up(&p_event_data->connection_status);
+        }
+        else
+        {
+            spp_gatt_connection_down(p_event_data->connection_status.conn_id);
+        }
+        break;
+
+    case GATT_ATTRIBUTE_REQUEST_EVT:
+        spp_gatt_attribute_request(&p_event_data->attribute_request);
+        break;
+
+    case GATT_CONGESTION_EVT:
+        pthread_mutex_lock(&spp_gatt_lock);
+        p_conn = spp_gatt_find_conn_id(p_event_data->congestion.conn_id);
+        if (NULL != p_conn)
+        {
+            p_conn->congested = p_event_data->congestion.congested;
+            handle = p_conn->congested ? 0 : spp_gatt_handle_of(p_conn);
+            spp_gatt_stats.congestions += p_conn->congested ? 1 : 0;
+        }
+        pthread_mutex_unlock(&spp_gatt_lock);
+        if (0 != handle)
+        {
+            spp_tx_kick(handle);
+        }
+        break;
+
+    case GATT_GET_RESPONSE_BUFFER_EVT:
+        p_event_data->buffer_request.p_app_rsp_buffer =
+            (uint8_t *)wiced_bt_get_buffer(p_event_data->buffer_request.len_requested);
+        p_event_data->buffer_request.p_app_ctxt = (void *)spp_gatt_free_rsp_buffer;
+        break;
+
+    case GATT_APP_BUFFER_TRANSMITTED_EVT:
+        p_xmitted = &p_event_data->buffer_xmitted;
+        if (NULL != p_xmitted->p_app_ctxt)
+        {
+            ((pfn_free_buffer_t)p_xmitted->p_app_ctxt)(p_xmitted->p_app_data);
+        }
+        break;
+
+    default:
+        break;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_configure
+ *******************************************************************************
+ * Summary:
+ *   Enables the LE serial service, must be called before spp_gatt_init()
+ *
+ * Parameters:
+ *   wiced_bool_t enable : WICED_TRUE to offer the service
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_configure(wiced_bool_t enable)
+{
+    spp_gatt_enabled = enable;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_is_enabled
+ *******************************************************************************
+ * Summary:
+ *   Tells if the LE serial service is offered
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if enabled
+ *
+ ******************************************************************************/
+wiced_bool_t spp_gatt_is_enabled(void)
+{
+    return spp_gatt_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_init
+ *******************************************************************************
+ * Summary:
+ *   Registers the GATT database and the session send path and starts
+ *   advertising, if the service is enabled. Called once the stack is up and
+ *   after spp_tx_init().
+ *
+ * Parameters:
+ *   const spp_gatt_reg_t *p_reg : session callbacks
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_init(const spp_gatt_reg_t *p_reg)
+{
+    wiced_bt_gatt_status_t status;
+
+    if (!spp_gatt_enabled)
+    {
+        return;
+    }
+    spp_gatt_reg = *p_reg;
+    memset(spp_gatt_conns, 0, sizeof(spp_gatt_conns));
+    spp_tx_register_transport(SPP_TRANSPORT_GATT, SPP_GATT_HANDLE_FLAG,
+                              SPP_GATT_MAX_MTU - SPP_GATT_ATT_HEADER, &spp_gatt_tx_ops);
+
+    status = wiced_bt_gatt_register(spp_gatt_callback);
+    if (WICED_BT_GATT_SUCCESS == status)
+    {
+        status = wiced_bt_gatt_db_init(spp_gatt_db, sizeof(spp_gatt_db), NULL);
+    }
+    if (WICED_BT_GATT_SUCCESS != status)
+    {
+        WICED_BT_TRACE("%s: GATT setup failed %d\n", __FUNCTION__, status);
+        spp_gatt_enabled = WICED_FALSE;
+        return;
+    }
+    spp_gatt_advertise();
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_phy_update
+ *******************************************************************************
+ * Summary:
+ *   Records the PHY of an LE link, from BTM_BLE_PHY_UPDATE_EVT
+ *
+ * Parameters:
+ *   uint8_t *bda : peer address
+ *   uint8_t tx_phy : transmit PHY, 1 for 1M, 2 for 2M, 3 for coded
+ *   uint8_t rx_phy : receive PHY
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_phy_update(uint8_t *bda, uint8_t tx_phy, uint8_t rx_phy)
+{
+    spp_gatt_conn_t *p_conn;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_bda(bda);
+    if (NULL != p_conn)
+    {
+        p_conn->tx_phy = tx_phy;
+        p_conn->rx_phy = rx_phy;
+        if ((SPP_GATT_PHY_2M == tx_phy) && (SPP_GATT_PHY_2M == rx_phy))
+        {
+            spp_gatt_stats.phy_2m++;
+        }
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_data_length_update
+ *******************************************************************************
+ * Summary:
+ *   Records the LL data length of an LE link, from
+ *   BTM_BLE_DATA_LENGTH_UPDATE_EVENT
+ *
+ * Parameters:
+ *   uint8_t *bda : peer address
+ *   uint16_t tx_octets : largest LL payload sent
+ *   uint16_t rx_octets : largest LL payload received
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_data_length_update(uint8_t *bda, uint16_t tx_octets, uint16_t rx_octets)
+{
+    spp_gatt_conn_t *p_conn;
+
+    pthread_mutex_lock(&spp_gatt_lock);
+    p_conn = spp_gatt_find_bda(bda);
+    if (NULL != p_conn)
+    {
+        p_conn->tx_octets = tx_octets;
+        p_conn->rx_octets = rx_octets;
+        spp_gatt_stats.data_length_updates++;
+    }
+    pthread_mutex_unlock(&spp_gatt_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the LE serial service counters
+ *
+ * Parameters:
+ *   spp_gatt_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_get_stats(spp_gatt_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_gatt_lock);
+    *p_stats = spp_gatt_stats;
+    pthread_mutex_unlock(&spp_gatt_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_gatt_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the LE serial service counters and the parameters of every link
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_gatt_print_stats(void)
+{
+    spp_gatt_conn_t conns[SPP_GATT_MAX_LINKS];
+    spp_gatt_stats_t stats;
+    int i;
+
+    if (!spp_gatt_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_gatt_lock);
+    stats = spp_gatt_stats;
+    memcpy(conns, spp_gatt_conns, sizeof(conns));
+    pthread_mutex_unlock(&spp_gatt_lock);
+
+    fprintf(stdout, "gatt: connects %u disconnects %u rejected %u mtu exchanges %u 2M %u "
+            "data length updates %u\n", stats.connects, stats.disconnects, stats.rejected,
+            stats.mtu_exchanges, stats.phy_2m, stats.data_length_updates);
+    fprintf(stdout, "gatt: notifications %llu (%llu bytes) writes %llu (%llu bytes) "
+            "congestions %u no buffers %u\n",
+            (unsigned long long)stats.notifications, (unsigned long long)stats.notify_bytes,
+            (unsigned long long)stats.writes, (unsigned long long)stats.write_bytes,
+            stats.congestions, stats.no_buffers);
+    for (i = 0; i < SPP_GATT_MAX_LINKS; i++)
+    {
+        if (!conns[i].in_use)
+        {
+            continue;
+        }
+        fprintf(stdout, "gatt: handle 0x%04x conn_id %d mtu %d phy %d/%d data length %d/%d "
+                "notify %s in flight %d%s\n", SPP_GATT_HANDLE_FLAG | (i + 1), conns[i].conn_id,
+                conns[i].mtu, conns[i].tx_phy, conns[i].rx_phy, conns[i].tx_octets,
+                conns[i].rx_octets,
+                (0 != (conns[i].cccd[0] & GATT_CLIENT_CONFIG_NOTIFICATION)) ? "on" : "off",
+                conns[i].in_flight, conns[i].congested ? " congested" : "");
+    }
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,674 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_l2cap.c
+ *
+ * Description: L2CAP bulk channel.
+ *
+ *              For bulk transfers between two instances of this application
+ *              RFCOMM costs throughput: every frame carries an RFCOMM header
+ *              and FCS, frames are limited to the RFCOMM MTU and the sender
+ *              stalls whenever the peer is slow to return credits. This
+ *              module registers a dynamic PSM and opens connection-oriented
+ *              channels in enhanced retransmission or streaming mode, with a
+ *              transmit window of SPP_L2CAP_TX_WINDOW I-frames and an MTU of
+ *              up to SPP_L2CAP_MAX_MTU bytes.
+ *
+ *              Every channel is a session like an RFCOMM one. Its handle has
+ *              SPP_L2CAP_HANDLE_FLAG set, it is announced through the same
+ *              connection up / down and receive callbacks, and it is sent to
+ *              through spp_send_iov(), which cuts frames of up to the channel
+ *              MTU. L2CAP segments each frame into I-frames of
+ *              SPP_L2CAP_MPS bytes, each of which fills one 3-DH5 packet.
+ *
+ *              Channels are accepted from any peer. The side started with
+ *              --peer opens one to the peer once its RFCOMM session is up,
+ *              so the link is already paired and encrypted.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_l2c.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_l2cap.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    wiced_bool_t in_use;
+    wiced_bool_t connected;   /* WICED_FALSE while an outgoing request is pending */
+    uint16_t cid;
+    BD_ADDR bda;
+    uint16_t peer_mtu;
+    wiced_bool_t congested;
+} spp_l2cap_chan_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *spp_l2cap_mode_names[] = { "ertm", "stream" };
+
+static wiced_bool_t spp_l2cap_enabled = WICED_FALSE;
+static uint16_t spp_l2cap_mtu = SPP_L2CAP_DEFAULT_MTU;
+static spp_l2cap_mode_t spp_l2cap_mode = SPP_L2CAP_MODE_ERTM;
+static spp_l2cap_reg_t spp_l2cap_reg;
+static wiced_bt_l2cap_appl_information_t spp_l2cap_appl_info;
+static spp_l2cap_chan_t spp_l2cap_chans[SPP_L2CAP_MAX_CHANNELS];
+static spp_l2cap_stats_t spp_l2cap_stats;
+static pthread_mutex_t spp_l2cap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static wiced_bool_t spp_l2cap_can_send(uint16_t handle);
+static wiced_bool_t spp_l2cap_send(uint16_t handle, uint8_t *p_data, uint32_t len);
+static wiced_bool_t spp_l2cap_disconnect(uint16_t handle);
+
+static const spp_tx_transport_ops_t spp_l2cap_tx_ops = { spp_l2cap_can_send, spp_l2cap_send,
+                                                         spp_l2cap_disconnect };
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static uint16_t spp_l2cap_handle_of(const spp_l2cap_chan_t *p_chan)
+{
+    return SPP_L2CAP_HANDLE_FLAG | (uint16_t)(p_chan - spp_l2cap_chans + 1);
+}
+
+/* Must be called with spp_l2cap_lock held */
+static spp_l2cap_chan_t *spp_l2cap_find_handle(uint16_t handle)
+{
+    uint16_t idx = handle & ~SPP_L2CAP_HANDLE_FLAG;
+
+    if (!SPP_L2CAP_IS_SESSION(handle) || (0 == idx) || (idx > SPP_L2CAP_MAX_CHANNELS) ||
+        !spp_l2cap_chans[idx - 1].connected)
+    {
+        return NULL;
+    }
+    return &spp_l2cap_chans[idx - 1];
+}
+
+/* Must be called with spp_l2cap_lock held */
+static spp_l2cap_chan_t *spp_l2cap_find_cid(uint16_t cid)
+{
+    int i;
+
+    for (i = 0; i < SPP_L2CAP_MAX_CHANNELS; i++)
+    {
+        if (spp_l2cap_chans[i].in_use && (spp_l2cap_chans[i].cid == cid))
+        {
+            return &spp_l2cap_chans[i];
+        }
+    }
+    return NULL;
+}
+
+/* Must be called with spp_l2cap_lock held, finds a pending request or a free entry */
+static spp_l2cap_chan_t *spp_l2cap_alloc(const uint8_t *bda)
+{
+    spp_l2cap_chan_t *p_free = NULL;
+    int i;
+
+    for (i = 0; i < SPP_L2CAP_MAX_CHANNELS; i++)
+    {
+        if (spp_l2cap_chans[i].in_use && !spp_l2cap_chans[i].connected &&
+            (0 == memcmp(spp_l2cap_chans[i].bda, bda, BD_ADDR_LEN)))
+        {
+            return &spp_l2cap_chans[i];
+        }
+        if (!spp_l2cap_chans[i].in_use && (NULL == p_free))
+        {
+            p_free = &spp_l2cap_chans[i];
+        }
+    }
+    return p_free;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_connected
+ *******************************************************************************
+ * Summary:
+ *   Opens a session once a channel is configured, in either direction
+ *
+ * Parameters:
+ *   void *context : unused
+ *   wiced_bt_device_address_t bd_addr : peer address
+ *   uint16_t local_cid : channel id
+ *   uint16_t peer_mtu : largest SDU the peer receives
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_l2cap_connected(void *context, wiced_bt_device_address_t bd_addr, uint16_t local_cid,
+                                uint16_t peer_mtu)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_cid(local_cid);
+    if (NULL == p_chan)
+    {
+        p_chan = spp_l2cap_alloc(bd_addr);
+    }
+    if (NULL != p_chan)
+    {
+        p_chan->in_use = WICED_TRUE;
+        p_chan->connected = WICED_TRUE;
+        p_chan->cid = local_cid;
+        memcpy(p_chan->bda, bd_addr, BD_ADDR_LEN);
+        p_chan->peer_mtu = peer_mtu;
+        p_chan->congested = WICED_FALSE;
+        handle = spp_l2cap_handle_of(p_chan);
+        spp_l2cap_stats.connects++;
+    }
+    else
+    {
+        spp_l2cap_stats.rejected++;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    if (0 == handle)
+    {
+        WICED_BT_TRACE("%s: no free session for cid 0x%x\n", __FUNCTION__, local_cid);
+        wiced_bt_l2cap_disconnect_req(local_cid);
+        return;
+    }
+    WICED_BT_TRACE("%s: handle 0x%04x cid 0x%x peer mtu %d\n", __FUNCTION__, handle, local_cid, peer_mtu);
+    spp_l2cap_reg.p_connection_up_callback(handle, bd_addr);
+    spp_tx_set_frame_size(handle, MIN(peer_mtu, spp_l2cap_mtu));
+}
+
+/* Closes the session of a channel, or forgets a request which failed */
+static void spp_l2cap_channel_down(uint16_t cid)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_cid(cid);
+    if ((NULL != p_chan) && p_chan->connected)
+    {
+        handle = spp_l2cap_handle_of(p_chan);
+        spp_l2cap_stats.disconnects++;
+    }
+    else if (NULL != p_chan)
+    {
+        memset(p_chan, 0, sizeof(*p_chan));
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    if (0 == handle)
+    {
+        return;
+    }
+    /* Kept in use until the session is closed, so a new channel cannot
+     * take over the handle while it is being torn down
+     */
+    spp_l2cap_reg.p_connection_down_callback(handle);
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    memset(p_chan, 0, sizeof(*p_chan));
+    pthread_mutex_unlock(&spp_l2cap_lock);
+}
+
+static void spp_l2cap_disconnect_indication(void *context, uint16_t local_cid, wiced_bool_t ack_needed)
+{
+    if (ack_needed)
+    {
+        wiced_bt_l2cap_disconnect_rsp(local_cid);
+    }
+    spp_l2cap_channel_down(local_cid);
+}
+
+static void spp_l2cap_disconnect_confirm(void *context, uint16_t local_cid, uint16_t result)
+{
+    spp_l2cap_channel_down(local_cid);
+}
+
+static void spp_l2cap_data_indication(void *context, uint16_t local_cid, uint8_t *p_data, uint16_t buf_len)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_cid(local_cid);
+    if ((NULL != p_chan) && p_chan->connected)
+    {
+        handle = spp_l2cap_handle_of(p_chan);
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    if (0 != handle)
+    {
+        spp_l2cap_reg.p_rx_data_callback(handle, p_data, buf_len);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_congestion_status
+ *******************************************************************************
+ * Summary:
+ *   Stops the session while the channel transmit queue is above its high
+ *   watermark and resumes it once the queue drained
+ *
+ * Parameters:
+ *   void *context : unused
+ *   uint16_t local_cid : channel id
+ *   wiced_bool_t congested : WICED_TRUE if the channel is congested
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_l2cap_congestion_status(void *context, uint16_t local_cid, wiced_bool_t congested)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t handle = 0;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_cid(local_cid);
+    if ((NULL != p_chan) && p_chan->connected)
+    {
+        p_chan->congested = congested;
+        handle = congested ? 0 : spp_l2cap_handle_of(p_chan);
+        spp_l2cap_stats.congestions += congested ? 1 : 0;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    if (0 != handle)
+    {
+        spp_tx_kick(handle);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_can_send
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, tells if the channel takes another SDU
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the channel is not congested
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_l2cap_can_send(uint16_t handle)
+{
+    spp_l2cap_chan_t *p_chan;
+    wiced_bool_t can_send;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_handle(handle);
+    can_send = ((NULL != p_chan) && !p_chan->congested) ? WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_l2cap_lock);
+    return can_send;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_send
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, sends one frame as an L2CAP SDU. The stack
+ *   copies the SDU before returning.
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *   uint8_t *p_data : frame
+ *   uint32_t len : frame length, at most the channel MTU
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stack took the SDU
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_l2cap_send(uint16_t handle, uint8_t *p_data, uint32_t len)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t cid = 0;
+    uint8_t result;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_handle(handle);
+    if (NULL != p_chan)
+    {
+        cid = p_chan->cid;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+    if (0 == cid)
+    {
+        return WICED_FALSE;
+    }
+
+    /* L2CAP_DW_CONGESTED still means the SDU was queued. The congestion
+     * callback, not this result, stops and resumes the session, so the two
+     * cannot race each other.
+     */
+    result = wiced_bt_l2cap_data_write(cid, p_data, (uint16_t)len, L2CAP_FLUSHABLE_CH_BASED);
+    if (L2CAP_DW_FAILED == result)
+    {
+        pthread_mutex_lock(&spp_l2cap_lock);
+        spp_l2cap_stats.write_failures++;
+        pthread_mutex_unlock(&spp_l2cap_lock);
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_disconnect
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue callback, closes the channel of a session
+ *
+ * Parameters:
+ *   uint16_t handle : session handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stack accepted the request
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_l2cap_disconnect(uint16_t handle)
+{
+    spp_l2cap_chan_t *p_chan;
+    uint16_t cid = 0;
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    p_chan = spp_l2cap_find_handle(handle);
+    if (NULL != p_chan)
+    {
+        cid = p_chan->cid;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    return (0 != cid) ? wiced_bt_l2cap_disconnect_req(cid) : WICED_FALSE;
+}
+
+/* Retransmission and flow control options of the selected mode */
+static void spp_l2cap_fill_fcr(wiced_bt_l2cap_fcr_options_t *p_fcr)
+{
+    p_fcr->mode = (SPP_L2CAP_MODE_STREAM == spp_l2cap_mode) ? L2CAP_FCR_STREAM_MODE : L2CAP_FCR_ERTM_MODE;
+    p_fcr->tx_win_sz = SPP_L2CAP_TX_WINDOW;
+    p_fcr->max_transmit = SPP_L2CAP_MAX_TRANSMIT;
+    p_fcr->rtrans_tout = SPP_L2CAP_RETRANS_TIMEOUT;
+    p_fcr->mon_tout = SPP_L2CAP_MONITOR_TIMEOUT;
+    p_fcr->mps = SPP_L2CAP_MPS;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_configure
+ *******************************************************************************
+ * Summary:
+ *   Enables the L2CAP bulk channel, must be called before spp_l2cap_init()
+ *
+ * Parameters:
+ *   uint32_t mtu : largest SDU sent and received, SPP_L2CAP_MIN_MTU to
+ *                  SPP_L2CAP_MAX_MTU
+ *   spp_l2cap_mode_t mode : ERTM or streaming mode
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if a parameter is out of range
+ *
+ ******************************************************************************/
+wiced_bool_t spp_l2cap_configure(uint32_t mtu, spp_l2cap_mode_t mode)
+{
+    if ((mtu < SPP_L2CAP_MIN_MTU) || (mtu > SPP_L2CAP_MAX_MTU) ||
+        ((SPP_L2CAP_MODE_ERTM != mode) && (SPP_L2CAP_MODE_STREAM != mode)))
+    {
+        return WICED_FALSE;
+    }
+    spp_l2cap_mtu = (uint16_t)mtu;
+    spp_l2cap_mode = mode;
+    spp_l2cap_enabled = WICED_TRUE;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_is_enabled
+ *******************************************************************************
+ * Summary:
+ *   Tells if the L2CAP bulk channel is enabled
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if enabled
+ *
+ ******************************************************************************/
+wiced_bool_t spp_l2cap_is_enabled(void)
+{
+    return spp_l2cap_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_init
+ *******************************************************************************
+ * Summary:
+ *   Registers the bulk channel PSM and the session send path, if enabled.
+ *   Called once the stack is up and after spp_tx_init().
+ *
+ * Parameters:
+ *   const spp_l2cap_reg_t *p_reg : session callbacks
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_l2cap_init(const spp_l2cap_reg_t *p_reg)
+{
+    if (!spp_l2cap_enabled)
+    {
+        return;
+    }
+    spp_l2cap_reg = *p_reg;
+    memset(spp_l2cap_chans, 0, sizeof(spp_l2cap_chans));
+    spp_tx_register_transport(SPP_TRANSPORT_L2CAP, SPP_L2CAP_HANDLE_FLAG, spp_l2cap_mtu, &spp_l2cap_tx_ops);
+
+    memset(&spp_l2cap_appl_info, 0, sizeof(spp_l2cap_appl_info));
+    spp_l2cap_appl_info.connected_cback = spp_l2cap_connected;
+    spp_l2cap_appl_info.disconnect_indication_cback = spp_l2cap_disconnect_indication;
+    spp_l2cap_appl_info.disconnect_confirm_cback = spp_l2cap_disconnect_confirm;
+    spp_l2cap_appl_info.data_indication_cback = spp_l2cap_data_indication;
+    spp_l2cap_appl_info.congestion_status_cback = spp_l2cap_congestion_status;
+    spp_l2cap_appl_info.mtu = spp_l2cap_mtu;
+    spp_l2cap_appl_info.fcr_present = WICED_TRUE;
+    spp_l2cap_fill_fcr(&spp_l2cap_appl_info.fcr);
+    spp_l2cap_appl_info.fcs_present = WICED_TRUE;
+    spp_l2cap_appl_info.fcs = L2CAP_CFG_FCS_USE;
+
+    if (0 == wiced_bt_l2cap_register(SPP_L2CAP_PSM, &spp_l2cap_appl_info, NULL))
+    {
+        WICED_BT_TRACE("%s: PSM 0x%04x registration failed\n", __FUNCTION__, SPP_L2CAP_PSM);
+        spp_l2cap_enabled = WICED_FALSE;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_connect
+ *******************************************************************************
+ * Summary:
+ *   Opens a bulk channel to a peer, unless one is open or pending already.
+ *   The session comes up through the connection up callback.
+ *
+ * Parameters:
+ *   uint8_t *bda : peer address
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if a request was sent
+ *
+ ******************************************************************************/
+wiced_bool_t spp_l2cap_connect(uint8_t *bda)
+{
+    wiced_bt_l2cap_ertm_information_t ertm_info;
+    spp_l2cap_chan_t *p_chan = NULL;
+    uint16_t cid;
+    int i;
+
+    if (!spp_l2cap_enabled)
+    {
+        return WICED_FALSE;
+    }
+    pthread_mutex_lock(&spp_l2cap_lock);
+    for (i = 0; i < SPP_L2CAP_MAX_CHANNELS; i++)
+    {
+        if (spp_l2cap_chans[i].in_use && (0 == memcmp(spp_l2cap_chans[i].bda, bda, BD_ADDR_LEN)))
+        {
+            pthread_mutex_unlock(&spp_l2cap_lock);
+            return WICED_FALSE;
+        }
+        if (!spp_l2cap_chans[i].in_use && (NULL == p_chan))
+        {
+            p_chan = &spp_l2cap_chans[i];
+        }
+    }
+    if (NULL != p_chan)
+    {
+        memset(p_chan, 0, sizeof(*p_chan));
+        p_chan->in_use = WICED_TRUE;
+        memcpy(p_chan->bda, bda, BD_ADDR_LEN);
+        spp_l2cap_stats.connect_requests++;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+    if (NULL == p_chan)
+    {
+        return WICED_FALSE;
+    }
+
+    memset(&ertm_info, 0, sizeof(ertm_info));
+    ertm_info.preferred_mode = (SPP_L2CAP_MODE_STREAM == spp_l2cap_mode) ? L2CAP_FCR_STREAM_MODE
+                                                                         : L2CAP_FCR_ERTM_MODE;
+    /* A peer without ERTM or streaming support still gets a basic channel */
+    ertm_info.allowed_modes = (1 << ertm_info.preferred_mode) | L2CAP_FCR_CHAN_OPT_BASIC;
+    ertm_info.user_rx_buf_size = spp_l2cap_mtu;
+    ertm_info.user_tx_buf_size = spp_l2cap_mtu;
+    ertm_info.fcr_rx_buf_size = SPP_L2CAP_MPS;
+    ertm_info.fcr_tx_buf_size = SPP_L2CAP_MPS;
+
+    cid = wiced_bt_l2cap_connect_req(SPP_L2CAP_PSM, bda, &ertm_info);
+
+    pthread_mutex_lock(&spp_l2cap_lock);
+    if (0 == cid)
+    {
+        spp_l2cap_stats.connect_failures++;
+        memset(p_chan, 0, sizeof(*p_chan));
+    }
+    else if (!p_chan->connected)
+    {
+        p_chan->cid = cid;
+    }
+    pthread_mutex_unlock(&spp_l2cap_lock);
+    return (0 != cid) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the bulk channel counters
+ *
+ * Parameters:
+ *   spp_l2cap_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_l2cap_get_stats(spp_l2cap_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_l2cap_lock);
+    *p_stats = spp_l2cap_stats;
+    pthread_mutex_unlock(&spp_l2cap_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_l2cap_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the bulk channel settings, counters and open channels
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_l2cap_print_stats(void)
+{
+    spp_l2cap_chan_t chans[SPP_L2CAP_MAX_CHANNELS];
+    spp_l2cap_stats_t stats;
+    int i;
+
+    if (!spp_l2cap_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_l2cap_lock);
+    stats = spp_l2cap_stats;
+    memcpy(chans, spp_l2cap_chans, sizeof(chans));
+    pthread_mutex_unlock(&spp_l2cap_lock);
+
+    fprintf(stdout, "l2cap: psm 0x%04x %s mtu %d mps %d window %d\n", SPP_L2CAP_PSM,
+            spp_l2cap_mode_names[spp_l2cap_mode], spp_l2cap_mtu, SPP_L2CAP_MPS, SPP_L2CAP_TX_WINDOW);
+    fprintf(stdout, "l2cap: requests %u failed %u connects %u disconnects %u rejected %u "
+            "congestions %u write failures %u\n", stats.connect_requests, stats.connect_failures,
+            stats.connects, stats.disconnects, stats.rejected, stats.congestions,
+            stats.write_failures);
+    for (i = 0; i < SPP_L2CAP_MAX_CHANNELS; i++)
+    {
+        if (!chans[i].in_use)
+        {
+            continue;
+        }
+        fprintf(stdout, "l2cap: handle 0x%04x cid 0x%04x %s peer mtu %d%s\n",
+                SPP_L2CAP_HANDLE_FLAG | (i + 1), chans[i].cid,
+                chans[i].connected ? "open" : "pending", chans[i].peer_mtu,
+                chans[i].congested ? " congested" : "");
+    }
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,431 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_lifecycle.c
+ *
+ * Description: Connection lifecycle tracer.
+ *
+ *              Setting up an SPP session is spread over several stack events
+ *              (ACL connection, link key request, IO capability request, user
+ *              confirmation, pairing complete, encryption) and finally the
+ *              SPP connection up callback. Every event is timestamped per
+ *              peer BD address; the time since the previous stage of the
+ *              same peer is added to a per-stage histogram with log2
+ *              millisecond buckets, and a stage slower than
+ *              SPP_LIFECYCLE_SLOW_STAGE_MS is reported at once.
+ *
+ *              When the session is up, the setup is classified as a bonded
+ *              reconnect or a full pairing, and a full pairing which followed
+ *              a link key request with no key in NVRAM is reported as caused
+ *              by the key miss.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_lifecycle.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    wiced_bool_t in_use;
+    wiced_bt_device_address_t bda;
+    uint64_t start_us;                  /* first event of this connection */
+    uint64_t last_us;                   /* latest stage reached */
+    spp_lifecycle_stage_t last_stage;
+    wiced_bool_t key_miss;              /* no stored link key was found */
+    wiced_bool_t paired;                /* pairing ran on this connection */
+    wiced_bool_t done;                  /* the SPP session is up */
+} spp_lifecycle_peer_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *spp_lifecycle_stage_names[SPP_LIFECYCLE_STAGES] =
+{
+    "acl_up",
+    "link_key_req",
+    "io_cap_req",
+    "user_confirm",
+    "pairing_done",
+    "encrypted",
+    "spp_up",
+};
+
+static spp_lifecycle_peer_t spp_lifecycle_peers[SPP_LIFECYCLE_MAX_PEERS];
+static spp_lifecycle_stats_t spp_lifecycle_stats;
+static pthread_mutex_t spp_lifecycle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Must be called with spp_lifecycle_lock held */
+static spp_lifecycle_peer_t *spp_lifecycle_find(const wiced_bt_device_address_t bda,
+                                                wiced_bool_t create)
+{
+    spp_lifecycle_peer_t *p_oldest = NULL;
+    int i;
+
+    for (i = 0; i < SPP_LIFECYCLE_MAX_PEERS; i++)
+    {
+        if (spp_lifecycle_peers[i].in_use &&
+            (0 == memcmp(spp_lifecycle_peers[i].bda, bda, sizeof(wiced_bt_device_address_t))))
+        {
+            return &spp_lifecycle_peers[i];
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    /* Take a free entry, else the one idle for the longest time */
+    for (i = 0; i < SPP_LIFECYCLE_MAX_PEERS; i++)
+    {
+        if (!spp_lifecycle_peers[i].in_use)
+        {
+            p_oldest = &spp_lifecycle_peers[i];
+            break;
+        }
+        if ((NULL == p_oldest) || (spp_lifecycle_peers[i].last_us < p_oldest->last_us))
+        {
+            p_oldest = &spp_lifecycle_peers[i];
+        }
+    }
+    memset(p_oldest, 0, sizeof(*p_oldest));
+    p_oldest->in_use = WICED_TRUE;
+    memcpy(p_oldest->bda, bda, sizeof(wiced_bt_device_address_t));
+    return p_oldest;
+}
+
+/* Adds one latency sample to a stage, must be called with spp_lifecycle_lock held */
+static wiced_bool_t spp_lifecycle_record(spp_lifecycle_stage_stats_t *p_stage, uint64_t delta_us)
+{
+    uint32_t ms = (uint32_t)(delta_us / 1000);
+    int bucket = 0;
+
+    while ((0 != ms) && (bucket < SPP_LIFECYCLE_HIST_BUCKETS - 1))
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    p_stage->count++;
+    p_stage->total_us += delta_us;
+    p_stage->max_us = MAX(p_stage->max_us, (uint32_t)delta_us);
+    p_stage->hist[bucket]++;
+    if (delta_us > SPP_LIFECYCLE_SLOW_STAGE_MS * 1000ULL)
+    {
+        p_stage->slow++;
+        return WICED_TRUE;
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_lifecycle_init
+ *******************************************************************************
+ * Summary:
+ *   Clears the traced peers and the statistics
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_lifecycle_init(void)
+{
+    pthread_mutex_lock(&spp_lifecycle_lock);
+    memset(spp_lifecycle_peers, 0, sizeof(spp_lifecycle_peers));
+    memset(&spp_lifecycle_stats, 0, sizeof(spp_lifecycle_stats));
+    pthread_mutex_unlock(&spp_lifecycle_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_lifecycle_event
+ *******************************************************************************
+ * Summary:
+ *   Records that a peer reached a connection setup stage. Events for a peer
+ *   whose session is already up are ignored until its next ACL connection.
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bda : peer address
+ *   spp_lifecycle_stage_t stage : stage reached
+ *   wiced_bool_t success : for SPP_LIFECYCLE_LINK_KEY_REQ whether a stored
+ *                          key was found, for the pairing and encryption
+ *                          stages whether they succeeded
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_lifecycle_event(const wiced_bt_device_address_t bda, spp_lifecycle_stage_t stage,
+                         wiced_bool_t success)
+{
+    spp_lifecycle_peer_t *p_peer;
+    spp_lifecycle_stage_t prev_stage = stage;
+    const char *p_path = NULL;
+    wiced_bool_t slow = WICED_FALSE;
+    uint64_t now_us = spp_get_time_us();
+    uint32_t delta_ms = 0;
+    uint32_t total_ms = 0;
+
+    if ((NULL == bda) || (stage >= SPP_LIFECYCLE_STAGES))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_lifecycle_lock);
+    p_peer = spp_lifecycle_find(bda, WICED_TRUE);
+    if ((SPP_LIFECYCLE_ACL_UP == stage) || p_peer->done)
+    {
+        if (SPP_LIFECYCLE_ACL_UP != stage)
+        {
+            /* e.g. encryption refreshed on a link already set up */
+            pthread_mutex_unlock(&spp_lifecycle_lock);
+            return;
+        }
+        memset(p_peer, 0, sizeof(*p_peer));
+        p_peer->in_use = WICED_TRUE;
+        memcpy(p_peer->bda, bda, sizeof(wiced_bt_device_address_t));
+    }
+
+    if (0 == p_peer->start_us)
+    {
+        /* First event of this connection, it has no previous stage */
+        p_peer->start_us = now_us;
+        spp_lifecycle_stats.stages[stage].count++;
+    }
+    else
+    {
+        prev_stage = p_peer->last_stage;
+        delta_ms = (uint32_t)((now_us - p_peer->last_us) / 1000);
+        slow = spp_lifecycle_record(&spp_lifecycle_stats.stages[stage], now_us - p_peer->last_us);
+    }
+    p_peer->last_us = now_us;
+    p_peer->last_stage = stage;
+
+    switch (stage)
+    {
+    case SPP_LIFECYCLE_LINK_KEY_REQ:
+        if (!success)
+        {
+            p_peer->key_miss = WICED_TRUE;
+            spp_lifecycle_stats.key_misses++;
+        }
+        break;
+    case SPP_LIFECYCLE_IO_CAP_REQ:
+        p_peer->paired = WICED_TRUE;
+        break;
+    case SPP_LIFECYCLE_PAIRING_DONE:
+    case SPP_LIFECYCLE_ENCRYPTED:
+        if (!success)
+        {
+            spp_lifecycle_stats.failures++;
+        }
+        break;
+    case SPP_LIFECYCLE_SPP_UP:
+        p_peer->done = WICED_TRUE;
+        total_ms = (uint32_t)((now_us - p_peer->start_us) / 1000);
+        spp_lifecycle_record(&spp_lifecycle_stats.total, now_us - p_peer->start_us);
+        if (!p_peer->paired)
+        {
+            spp_lifecycle_stats.reconnects++;
+            p_path = "bonded reconnect";
+        }
+        else if (p_peer->key_miss)
+        {
+            spp_lifecycle_stats.full_pairings++;
+            spp_lifecycle_stats.repairs_after_key_miss++;
+            p_path = "full pairing, link key missing from NVRAM";
+        }
+        else
+        {
+            spp_lifecycle_stats.full_pairings++;
+            p_path = "full pairing";
+        }
+        break;
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&spp_lifecycle_lock);
+
+    if (slow)
+    {
+        fprintf(stdout, "lifecycle: %02X:%02X:%02X:%02X:%02X:%02X slow stage %s -> %s: %u ms\n",
+                bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+                spp_lifecycle_stage_names[prev_stage], spp_lifecycle_stage_names[stage], delta_ms);
+    }
+    if (!success && (SPP_LIFECYCLE_LINK_KEY_REQ != stage))
+    {
+        fprintf(stdout, "lifecycle: %02X:%02X:%02X:%02X:%02X:%02X %s failed\n",
+                bda[0], bda[1], bda[2], bda[3], bda[4], bda[5], spp_lifecycle_stage_names[stage]);
+    }
+    if (NULL != p_path)
+    {
+        fprintf(stdout, "lifecycle: %02X:%02X:%02X:%02X:%02X:%02X session up after %u ms (%s)\n",
+                bda[0], bda[1], bda[2], bda[3], bda[4], bda[5], total_ms, p_path);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_lifecycle_acl_down
+ *******************************************************************************
+ * Summary:
+ *   Ends the trace of a peer whose ACL link went down. A link dropped before
+ *   its SPP session came up is counted and reported with the last stage it
+ *   reached.
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bda : peer address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_lifecycle_acl_down(const wiced_bt_device_address_t bda)
+{
+    spp_lifecycle_peer_t *p_peer;
+    spp_lifecycle_stage_t last_stage = SPP_LIFECYCLE_SPP_UP;
+    wiced_bool_t aborted = WICED_FALSE;
+
+    if (NULL == bda)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_lifecycle_lock);
+    p_peer = spp_lifecycle_find(bda, WICED_FALSE);
+    if (NULL != p_peer)
+    {
+        if (!p_peer->done)
+        {
+            aborted = WICED_TRUE;
+            last_stage = p_peer->last_stage;
+            spp_lifecycle_stats.aborted++;
+        }
+        memset(p_peer, 0, sizeof(*p_peer));
+    }
+    pthread_mutex_unlock(&spp_lifecycle_lock);
+
+    if (aborted)
+    {
+        fprintf(stdout, "lifecycle: %02X:%02X:%02X:%02X:%02X:%02X dropped after %s, no SPP session\n",
+                bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+                spp_lifecycle_stage_names[last_stage]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_lifecycle_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the lifecycle statistics
+ *
+ * Parameters:
+ *   spp_lifecycle_stats_t *p_stats : filled with the statistics
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_lifecycle_get_stats(spp_lifecycle_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_lifecycle_lock);
+    *p_stats = spp_lifecycle_stats;
+    pthread_mutex_unlock(&spp_lifecycle_lock);
+}
+
+/* Prints one histogram line */
+static void spp_lifecycle_print_stage(const char *p_name, const spp_lifecycle_stage_stats_t *p_stage)
+{
+    double avg_ms = 0;
+    int i;
+
+    if (0 != p_stage->count)
+    {
+        avg_ms = (double)p_stage->total_us / p_stage->count / 1000.0;
+    }
+    fprintf(stdout, "lifecycle: %-13s %5u %8.1f %8.1f %4u  ", p_name, p_stage->count, avg_ms,
+            p_stage->max_us / 1000.0, p_stage->slow);
+    for (i = 0; i < SPP_LIFECYCLE_HIST_BUCKETS; i++)
+    {
+        fprintf(stdout, " %u", p_stage->hist[i]);
+    }
+    fprintf(stdout, "\n");
+}
+
+/*******************************************************************************
+ * Function Name: spp_lifecycle_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the setup outcomes and the latency histogram of every stage. The
+ *   latency of a stage is the time since the previous stage of the same peer;
+ *   the first stage of a connection is only counted.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_lifecycle_print_stats(void)
+{
+    spp_lifecycle_stats_t stats;
+    int i;
+
+    spp_lifecycle_get_stats(&stats);
+    fprintf(stdout, "lifecycle: reconnects %u, full pairings %u (%u after link key miss), "
+            "key misses %u, failures %u, aborted %u\n",
+            stats.reconnects, stats.full_pairings, stats.repairs_after_key_miss,
+            stats.key_misses, stats.failures, stats.aborted);
+    fprintf(stdout, "lifecycle: stage         count   avg ms   max ms slow   histogram <1 <2 <4 ... <4096 >=4096 ms\n");
+    for (i = 0; i < SPP_LIFECYCLE_STAGES; i++)
+    {
+        spp_lifecycle_print_stage(spp_lifecycle_stage_names[i], &stats.stages[i]);
+    }
+    spp_lifecycle_print_stage("total", &stats.total);
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,759 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_link.c
+ *
+ * Description: Link policy of BR/EDR links, chosen per profile.
+ *
+ *              A profile changes three things only, when the ACL link to a
+ *              peer comes up:
+ *              - the preferred role, requested with a role switch. Being
+ *                central of every link keeps the links out of a scatternet,
+ *                so the controller schedules all of them itself.
+ *              - the link policy settings, whether the peer may switch the
+ *                role back and whether sniff mode is allowed.
+ *              - the RFCOMM frame size of the sessions on the link. The
+ *                fastest packet type of the profile that the LMP features
+ *                of the peer allow is only reported and used to size the
+ *                frames to fill whole packets of that type.
+ *
+ *              Packet types, the link supervision timeout and the automatic
+ *              flush timeout are not changed, they stay as the stack and the
+ *              controller set them. The stack has no call for HCI
+ *              Change_Connection_Packet_Type or Write_Link_Supervision_Timeout,
+ *              and wiced_bt_dev_vendor_specific_command only sends vendor
+ *              (OGF 0x3F) opcodes. When a session closes, the bytes it moved
+ *              and its duration are recorded per profile, so profiles can be
+ *              compared across peers.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_dev.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_link.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* No preferred role, the link keeps the role it came up with */
+#define SPP_LINK_ROLE_ANY                       ( 0xFF )
+
+/* LMP features, page 0 */
+#define SPP_LINK_FEATURE_3_SLOT(f)              ( 0 != ((f)[0] & 0x01) )
+#define SPP_LINK_FEATURE_5_SLOT(f)              ( 0 != ((f)[0] & 0x02) )
+#define SPP_LINK_FEATURE_EDR_2M(f)              ( 0 != ((f)[3] & 0x02) )
+#define SPP_LINK_FEATURE_EDR_3M(f)              ( 0 != ((f)[3] & 0x04) )
+#define SPP_LINK_FEATURE_EDR_3_SLOT(f)          ( 0 != ((f)[4] & 0x80) )
+#define SPP_LINK_FEATURE_EDR_5_SLOT(f)          ( 0 != ((f)[5] & 0x01) )
+
+#define SPP_LINK_BDA_FMT                        "%02X:%02X:%02X:%02X:%02X:%02X"
+#define SPP_LINK_BDA_ARGS(bda)                  (bda)[0], (bda)[1], (bda)[2], (bda)[3], (bda)[4], (bda)[5]
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    const char *p_name;
+    uint16_t payload;            /* largest payload in bytes */
+    uint8_t slots;
+    uint8_t rate;                /* modulation, in Mb/s */
+} spp_link_packet_t;
+
+typedef struct
+{
+    const char *p_name;
+    wiced_bool_t apply;          /* WICED_FALSE leaves the link as the stack set it up */
+    uint8_t role;                /* preferred role, SPP_LINK_ROLE_ANY for none */
+    uint16_t link_policy;        /* HCI_ENABLE_* settings once the role is settled */
+    uint8_t max_rate;            /* fastest modulation allowed, in Mb/s */
+    uint8_t max_slots;           /* longest packets allowed */
+    wiced_bool_t size_frames;    /* size RFCOMM frames to whole packets */
+} spp_link_profile_t;
+
+typedef struct
+{
+    wiced_bool_t in_use;
+    wiced_bt_device_address_t bda;
+    const spp_link_profile_t *p_profile;
+    int packet;                  /* best packet type allowed, -1 if unknown */
+    uint8_t role;
+    wiced_bool_t switch_pending;
+} spp_link_t;
+
+typedef struct
+{
+    uint16_t handle;             /* 0 if the entry is free */
+    wiced_bt_device_address_t bda;
+    const spp_link_profile_t *p_profile;
+    int packet;
+    uint8_t role;
+    uint32_t frame_size;
+    uint64_t up_us;
+} spp_link_session_t;
+
+/* One closed session */
+typedef struct
+{
+    wiced_bt_device_address_t bda;
+    const spp_link_profile_t *p_profile;
+    int packet;
+    uint8_t role;
+    uint32_t frame_size;
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    uint64_t duration_us;
+} spp_link_record_t;
+
+/* Sessions of one profile */
+typedef struct
+{
+    uint32_t sessions;
+    uint64_t bytes;
+    uint64_t duration_us;
+    uint64_t best_rate;          /* bytes/s of the fastest session */
+} spp_link_profile_stats_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t bda;
+    const spp_link_profile_t *p_profile;
+} spp_link_peer_profile_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+/* Fastest first; every BR/EDR device supports DH1 */
+static const spp_link_packet_t spp_link_packets[] =
+{
+    { "3-DH5", 1021, 5, 3 },
+    { "2-DH5", 679,  5, 2 },
+    { "3-DH3", 552,  3, 3 },
+    { "2-DH3", 367,  3, 2 },
+    { "DH5",   339,  5, 1 },
+    { "DH3",   183,  3, 1 },
+    { "3-DH1", 83,   1, 3 },
+    { "2-DH1", 54,   1, 2 },
+    { "DH1",   27,   1, 1 },
+};
+
+static const spp_link_profile_t spp_link_profiles[] =
+{
+    /* Stack defaults, only the throughput is recorded */
+    { "default",    WICED_FALSE, SPP_LINK_ROLE_ANY, 0, 3, 5, WICED_FALSE },
+    /* Central, no sniff mode, frames fill the best packets the peer allows */
+    { "throughput", WICED_TRUE,  HCI_ROLE_CENTRAL,  0, 3, 5, WICED_TRUE },
+    /* Frames sized for 2-DH5, for links the controller keeps at 2 Mb/s */
+    { "robust",     WICED_TRUE,  HCI_ROLE_CENTRAL,  0, 2, 5, WICED_TRUE },
+    /* Frames sized for 3-DH3, a shorter frame leaves the queue sooner */
+    { "latency",    WICED_TRUE,  HCI_ROLE_CENTRAL,  0, 3, 3, WICED_TRUE },
+    /* Sniff mode while idle, the peer may take the central role */
+    { "power",      WICED_TRUE,  SPP_LINK_ROLE_ANY,
+      HCI_ENABLE_CENTRAL_PERIPHERAL_SWITCH | HCI_ENABLE_SNIFF_MODE, 3, 5, WICED_FALSE },
+};
+
+#define SPP_LINK_PROFILES                       ( sizeof(spp_link_profiles) / sizeof(spp_link_profiles[0]) )
+#define SPP_LINK_PACKETS                        ( sizeof(spp_link_packets) / sizeof(spp_link_packets[0]) )
+
+static const spp_link_profile_t *p_spp_link_default = &spp_link_profiles[0];
+static spp_link_peer_profile_t spp_link_peer_profiles[SPP_LINK_MAX_PEER_PROFILES];
+static int spp_link_peer_profile_count;
+
+static spp_link_t spp_link_links[SPP_MAX_SESSIONS];
+static spp_link_session_t spp_link_sessions[SPP_MAX_SESSIONS];
+static spp_link_record_t spp_link_history[SPP_LINK_HISTORY];
+static uint32_t spp_link_history_count;
+static spp_link_profile_stats_t spp_link_profile_stats[SPP_LINK_PROFILES];
+static spp_link_stats_t spp_link_stats;
+static pthread_mutex_t spp_link_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static spp_link_t *spp_link_find(const wiced_bt_device_address_t bda)
+{
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if (spp_link_links[i].in_use && (0 == memcmp(spp_link_links[i].bda, bda, BD_ADDR_LEN)))
+        {
+            return &spp_link_links[i];
+        }
+    }
+    return NULL;
+}
+
+static const spp_link_profile_t *spp_link_profile_of(const wiced_bt_device_address_t bda)
+{
+    int i;
+
+    for (i = 0; i < spp_link_peer_profile_count; i++)
+    {
+        if (0 == memcmp(spp_link_peer_profiles[i].bda, bda, BD_ADDR_LEN))
+        {
+            return spp_link_peer_profiles[i].p_profile;
+        }
+    }
+    return p_spp_link_default;
+}
+
+static wiced_bool_t spp_link_peer_allows(const uint8_t *p_features, const spp_link_packet_t *p_packet)
+{
+    wiced_bool_t edr = (p_packet->rate > 1);
+
+    if (((2 == p_packet->rate) && !SPP_LINK_FEATURE_EDR_2M(p_features)) ||
+        ((3 == p_packet->rate) && !SPP_LINK_FEATURE_EDR_3M(p_features)))
+    {
+        return WICED_FALSE;
+    }
+    if (3 == p_packet->slots)
+    {
+        return edr ? SPP_LINK_FEATURE_EDR_3_SLOT(p_features) : SPP_LINK_FEATURE_3_SLOT(p_features);
+    }
+    if (5 == p_packet->slots)
+    {
+        return edr ? SPP_LINK_FEATURE_EDR_5_SLOT(p_features) : SPP_LINK_FEATURE_5_SLOT(p_features);
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_best_packet
+ *******************************************************************************
+ * Summary:
+ *   Picks the fastest packet type the profile and the peer allow. The local
+ *   controller is taken to support every EDR packet type, as all AIROC
+ *   combo chips do.
+ *
+ * Parameters:
+ *   const uint8_t *p_features : LMP features of the peer, page 0
+ *   const spp_link_profile_t *p_profile : profile of the link
+ *
+ * Return:
+ *   int : index in spp_link_packets, -1 if the features are unknown
+ *
+ ******************************************************************************/
+static int spp_link_best_packet(const uint8_t *p_features, const spp_link_profile_t *p_profile)
+{
+    int i;
+
+    if (NULL == p_features)
+    {
+        return -1;
+    }
+    for (i = 0; i < (int)SPP_LINK_PACKETS; i++)
+    {
+        if ((spp_link_packets[i].rate <= p_profile->max_rate) &&
+            (spp_link_packets[i].slots <= p_profile->max_slots) &&
+            spp_link_peer_allows(p_features, &spp_link_packets[i]))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Largest RFCOMM frame filling whole packets of the given type */
+static uint32_t spp_link_frame_size(const spp_link_packet_t *p_packet)
+{
+    uint32_t packets = (SPP_MAX_PAYLOAD + SPP_LINK_FRAME_OVERHEAD) / p_packet->payload;
+
+    if (0 == packets)
+    {
+        /* The largest frame fits one packet */
+        return SPP_MAX_PAYLOAD;
+    }
+    return packets * p_packet->payload - SPP_LINK_FRAME_OVERHEAD;
+}
+
+static const char *spp_link_role_name(uint8_t role)
+{
+    if (HCI_ROLE_CENTRAL == role)
+    {
+        return "central";
+    }
+    return (HCI_ROLE_PERIPHERAL == role) ? "peripheral" : "unknown";
+}
+
+static void spp_link_set_policy(const wiced_bt_device_address_t bda, uint16_t policy)
+{
+    wiced_bt_device_address_t addr;
+    wiced_result_t result;
+
+    memcpy(addr, bda, BD_ADDR_LEN);
+    result = wiced_bt_dev_set_link_policy(addr, &policy);
+    if ((WICED_BT_SUCCESS != result) && (WICED_BT_PENDING != result))
+    {
+        WICED_BT_TRACE("link: policy 0x%04x not set, result %d\n", policy, result);
+        pthread_mutex_lock(&spp_link_lock);
+        spp_link_stats.policy_failures++;
+        pthread_mutex_unlock(&spp_link_lock);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_role_switched
+ *******************************************************************************
+ * Summary:
+ *   Completion of a role switch. The role each waiting link ended up with is
+ *   read back, then its final link policy is set.
+ *
+ * Parameters:
+ *   void *p_data : result, not used
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_link_role_switched(void *p_data)
+{
+    wiced_bt_device_address_t bda;
+    const spp_link_profile_t *p_profile;
+    uint8_t role;
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        pthread_mutex_lock(&spp_link_lock);
+        if (!spp_link_links[i].in_use || !spp_link_links[i].switch_pending)
+        {
+            pthread_mutex_unlock(&spp_link_lock);
+            continue;
+        }
+        memcpy(bda, spp_link_links[i].bda, BD_ADDR_LEN);
+        p_profile = spp_link_links[i].p_profile;
+        spp_link_links[i].switch_pending = WICED_FALSE;
+        pthread_mutex_unlock(&spp_link_lock);
+
+        if (WICED_BT_SUCCESS != wiced_bt_dev_get_role(bda, &role, BT_TRANSPORT_BR_EDR))
+        {
+            role = SPP_LINK_ROLE_ANY;
+        }
+        pthread_mutex_lock(&spp_link_lock);
+        if (role != p_profile->role)
+        {
+            spp_link_stats.role_switch_failures++;
+        }
+        if (spp_link_links[i].in_use && (0 == memcmp(spp_link_links[i].bda, bda, BD_ADDR_LEN)))
+        {
+            spp_link_links[i].role = role;
+        }
+        pthread_mutex_unlock(&spp_link_lock);
+
+        fprintf(stdout, "link " SPP_LINK_BDA_FMT ": %s\n", SPP_LINK_BDA_ARGS(bda), spp_link_role_name(role));
+        spp_link_set_policy(bda, p_profile->link_policy);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_configure
+ *******************************************************************************
+ * Summary:
+ *   Selects the profile of all links, or of the links to one peer
+ *
+ * Parameters:
+ *   const char *p_spec : <profile>[@<bd_addr>], profile one of default,
+ *                        throughput, robust, latency, power
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the profile or address is not valid
+ *
+ ******************************************************************************/
+wiced_bool_t spp_link_configure(const char *p_spec)
+{
+    const spp_link_profile_t *p_profile = NULL;
+    const char *p_at = strchr(p_spec, '@');
+    size_t name_len = (NULL != p_at) ? (size_t)(p_at - p_spec) : strlen(p_spec);
+    unsigned int bytes[BD_ADDR_LEN];
+    spp_link_peer_profile_t *p_peer;
+    char end;
+    size_t i;
+
+    for (i = 0; i < SPP_LINK_PROFILES; i++)
+    {
+        if ((strlen(spp_link_profiles[i].p_name) == name_len) &&
+            (0 == strncmp(spp_link_profiles[i].p_name, p_spec, name_len)))
+        {
+            p_profile = &spp_link_profiles[i];
+        }
+    }
+    if (NULL == p_profile)
+    {
+        return WICED_FALSE;
+    }
+    if (NULL == p_at)
+    {
+        p_spp_link_default = p_profile;
+        return WICED_TRUE;
+    }
+
+    if ((SPP_LINK_MAX_PEER_PROFILES == spp_link_peer_profile_count) ||
+        (BD_ADDR_LEN != sscanf(p_at + 1, "%2x:%2x:%2x:%2x:%2x:%2x%c", &bytes[0], &bytes[1],
+                               &bytes[2], &bytes[3], &bytes[4], &bytes[5], &end)))
+    {
+        return WICED_FALSE;
+    }
+    p_peer = &spp_link_peer_profiles[spp_link_peer_profile_count++];
+    for (i = 0; i < BD_ADDR_LEN; i++)
+    {
+        p_peer->bda[i] = (uint8_t)bytes[i];
+    }
+    p_peer->p_profile = p_profile;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_acl_up
+ *******************************************************************************
+ * Summary:
+ *   Applies the profile to a new ACL link: requests the preferred role and
+ *   sets the link policy, which follows the role switch if one is needed
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bda : peer address
+ *   const uint8_t *p_features : LMP features of the peer, NULL if unknown
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_acl_up(const wiced_bt_device_address_t bda, const uint8_t *p_features)
+{
+    const spp_link_profile_t *p_profile = spp_link_profile_of(bda);
+    wiced_bt_device_address_t addr;
+    spp_link_t *p_link;
+    wiced_result_t result;
+    uint8_t role = SPP_LINK_ROLE_ANY;
+    int i;
+
+    memcpy(addr, bda, BD_ADDR_LEN);
+    if (WICED_BT_SUCCESS != wiced_bt_dev_get_role(addr, &role, BT_TRANSPORT_BR_EDR))
+    {
+        role = SPP_LINK_ROLE_ANY;
+    }
+
+    pthread_mutex_lock(&spp_link_lock);
+    p_link = spp_link_find(bda);
+    for (i = 0; (NULL == p_link) && (i < SPP_MAX_SESSIONS); i++)
+    {
+        if (!spp_link_links[i].in_use)
+        {
+            p_link = &spp_link_links[i];
+        }
+    }
+    if (NULL == p_link)
+    {
+        pthread_mutex_unlock(&spp_link_lock);
+        WICED_BT_TRACE("link: no free entry\n");
+        return;
+    }
+    memset(p_link, 0, sizeof(*p_link));
+    p_link->in_use = WICED_TRUE;
+    memcpy(p_link->bda, bda, BD_ADDR_LEN);
+    p_link->p_profile = p_profile;
+    p_link->packet = spp_link_best_packet(p_features, p_profile);
+    p_link->role = role;
+    spp_link_stats.links++;
+    pthread_mutex_unlock(&spp_link_lock);
+
+    if (!p_profile->apply)
+    {
+        return;
+    }
+    if ((SPP_LINK_ROLE_ANY != p_profile->role) && (SPP_LINK_ROLE_ANY != role) && (role != p_profile->role))
+    {
+        /* The switch needs the policy to allow it until it is done */
+        spp_link_set_policy(bda, p_profile->link_policy | HCI_ENABLE_CENTRAL_PERIPHERAL_SWITCH);
+        result = wiced_bt_dev_switch_role(addr, p_profile->role, spp_link_role_switched);
+
+        pthread_mutex_lock(&spp_link_lock);
+        if ((WICED_BT_SUCCESS == result) || (WICED_BT_PENDING == result))
+        {
+            p_link->switch_pending = WICED_TRUE;
+            spp_link_stats.role_switches++;
+            pthread_mutex_unlock(&spp_link_lock);
+            return;
+        }
+        spp_link_stats.role_switch_failures++;
+        pthread_mutex_unlock(&spp_link_lock);
+        WICED_BT_TRACE("link: role switch not started, result %d\n", result);
+    }
+    spp_link_set_policy(bda, p_profile->link_policy);
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_acl_down
+ *******************************************************************************
+ * Summary:
+ *   Forgets an ACL link
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bda : peer address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_acl_down(const wiced_bt_device_address_t bda)
+{
+    spp_link_t *p_link;
+
+    pthread_mutex_lock(&spp_link_lock);
+    p_link = spp_link_find(bda);
+    if (NULL != p_link)
+    {
+        memset(p_link, 0, sizeof(*p_link));
+    }
+    pthread_mutex_unlock(&spp_link_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Starts recording an RFCOMM session and sizes its frames to the best
+ *   packet type of its link, if the profile asks for it
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const uint8_t *bda : peer address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_connection_up(uint16_t handle, const uint8_t *bda)
+{
+    spp_link_session_t *p_session = NULL;
+    spp_link_t *p_link;
+    wiced_bool_t resize = WICED_FALSE;
+    const char *p_profile;
+    const char *p_packet;
+    uint32_t frame_size;
+    int i;
+
+    pthread_mutex_lock(&spp_link_lock);
+    p_link = spp_link_find(bda);
+    for (i = 0; (NULL != p_link) && (NULL == p_session) && (i < SPP_MAX_SESSIONS); i++)
+    {
+        if (0 == spp_link_sessions[i].handle)
+        {
+            p_session = &spp_link_sessions[i];
+        }
+    }
+    if (NULL == p_session)
+    {
+        pthread_mutex_unlock(&spp_link_lock);
+        return;
+    }
+    p_session->handle = handle;
+    memcpy(p_session->bda, bda, BD_ADDR_LEN);
+    p_session->p_profile = p_link->p_profile;
+    p_session->packet = p_link->packet;
+    p_session->role = p_link->role;
+    p_session->frame_size = SPP_MAX_PAYLOAD;
+    p_session->up_us = spp_get_time_us();
+    if (p_link->p_profile->size_frames && (p_link->packet >= 0))
+    {
+        p_session->frame_size = spp_link_frame_size(&spp_link_packets[p_link->packet]);
+        resize = (SPP_MAX_PAYLOAD != p_session->frame_size);
+        spp_link_stats.frames_resized += resize ? 1 : 0;
+    }
+    p_profile = p_session->p_profile->p_name;
+    p_packet = (p_session->packet >= 0) ? spp_link_packets[p_session->packet].p_name : "unknown";
+    frame_size = p_session->frame_size;
+    pthread_mutex_unlock(&spp_link_lock);
+
+    if (resize)
+    {
+        spp_tx_set_frame_size(handle, frame_size);
+    }
+    fprintf(stdout, "link " SPP_LINK_BDA_FMT ": profile %s, best packet %s, frame %u bytes\n",
+            SPP_LINK_BDA_ARGS(bda), p_profile, p_packet, frame_size);
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Records the throughput of a closing session. Called before the transmit
+ *   queue of the session is closed, which holds its byte counts.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_connection_down(uint16_t handle)
+{
+    spp_link_record_t record;
+    spp_link_profile_stats_t *p_stats;
+    spp_link_t *p_link;
+    uint64_t rate;
+    int i;
+
+    memset(&record, 0, sizeof(record));
+    if (!spp_tx_get_session_bytes(handle, &record.tx_bytes, &record.rx_bytes))
+    {
+        record.tx_bytes = 0;
+        record.rx_bytes = 0;
+    }
+
+    pthread_mutex_lock(&spp_link_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if (handle == spp_link_sessions[i].handle)
+        {
+            break;
+        }
+    }
+    if ((0 == handle) || (SPP_MAX_SESSIONS == i))
+    {
+        pthread_mutex_unlock(&spp_link_lock);
+        return;
+    }
+    memcpy(record.bda, spp_link_sessions[i].bda, BD_ADDR_LEN);
+    record.p_profile = spp_link_sessions[i].p_profile;
+    record.packet = spp_link_sessions[i].packet;
+    record.frame_size = spp_link_sessions[i].frame_size;
+    record.duration_us = spp_get_time_us() - spp_link_sessions[i].up_us;
+    p_link = spp_link_find(record.bda);
+    record.role = (NULL != p_link) ? p_link->role : spp_link_sessions[i].role;
+    memset(&spp_link_sessions[i], 0, sizeof(spp_link_sessions[i]));
+
+    rate = (0 != record.duration_us) ?
+           ((record.tx_bytes + record.rx_bytes) * 1000000 / record.duration_us) : 0;
+    p_stats = &spp_link_profile_stats[record.p_profile - spp_link_profiles];
+    p_stats->sessions++;
+    p_stats->bytes += record.tx_bytes + record.rx_bytes;
+    p_stats->duration_us += record.duration_us;
+    p_stats->best_rate = MAX(p_stats->best_rate, rate);
+    spp_link_history[spp_link_history_count++ % SPP_LINK_HISTORY] = record;
+    spp_link_stats.sessions++;
+    pthread_mutex_unlock(&spp_link_lock);
+
+    fprintf(stdout, "link " SPP_LINK_BDA_FMT ": sent %llu received %llu bytes in %llu ms, %llu bytes/s\n",
+            SPP_LINK_BDA_ARGS(record.bda), (unsigned long long)record.tx_bytes,
+            (unsigned long long)record.rx_bytes, (unsigned long long)(record.duration_us / 1000),
+            (unsigned long long)rate);
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the link policy counters
+ *
+ * Parameters:
+ *   spp_link_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_get_stats(spp_link_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_link_lock);
+    *p_stats = spp_link_stats;
+    pthread_mutex_unlock(&spp_link_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_link_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the link policy counters, the throughput of each profile and the
+ *   last sessions
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_link_print_stats(void)
+{
+    spp_link_profile_stats_t *p_stats;
+    spp_link_record_t *p_record;
+    uint32_t first;
+    uint32_t n;
+    size_t i;
+
+    pthread_mutex_lock(&spp_link_lock);
+    fprintf(stdout, "link: %u links, role switches %u (failed %u), policy failures %u, "
+            "sessions %u (%u sized to their packet type)\n",
+            spp_link_stats.links, spp_link_stats.role_switches, spp_link_stats.role_switch_failures,
+            spp_link_stats.policy_failures, spp_link_stats.sessions, spp_link_stats.frames_resized);
+    for (i = 0; i < SPP_LINK_PROFILES; i++)
+    {
+        p_stats = &spp_link_profile_stats[i];
+        if (0 == p_stats->sessions)
+        {
+            continue;
+        }
+        fprintf(stdout, "link profile %s: %u sessions, %llu bytes in %llu ms, average %llu bytes/s, best %llu\n",
+                spp_link_profiles[i].p_name, p_stats->sessions, (unsigned long long)p_stats->bytes,
+                (unsigned long long)(p_stats->duration_us / 1000),
+                (unsigned long long)((0 != p_stats->duration_us) ?
+                                     (p_stats->bytes * 1000000 / p_stats->duration_us) : 0),
+                (unsigned long long)p_stats->best_rate);
+    }
+    first = (spp_link_history_count > SPP_LINK_HISTORY) ? (spp_link_history_count - SPP_LINK_HISTORY) : 0;
+    for (n = first; n < spp_link_history_count; n++)
+    {
+        p_record = &spp_link_history[n % SPP_LINK_HISTORY];
+        fprintf(stdout, "link session " SPP_LINK_BDA_FMT " %s %s %s frame %u: sent %llu received %llu in %llu ms\n",
+                SPP_LINK_BDA_ARGS(p_record->bda), p_record->p_profile->p_name,
+                spp_link_role_name(p_record->role),
+                (p_record->packet >= 0) ? spp_link_packets[p_record->packet].p_name : "unknown",
+                p_record->frame_size, (unsigned long long)p_record->tx_bytes,
+                (unsigned long long)p_record->rx_bytes, (unsigned long long)(p_record->duration_us / 1000));
+    }
+    pthread_mutex_unlock(&spp_link_lock);
+}
+
+/* END OF FILE [] */
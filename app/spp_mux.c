@@ -0,0 +1,884 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_mux.c
+ *
+ * Description: Multiplexes several logical streams over one SPP session.
+ *
+ *              Every stream has a priority and a weight. Messages are cut
+ *              into chunks of at most SPP_MUX_MAX_CHUNK bytes, each preceded
+ *              by a SPP_MUX_HDR_LEN byte header carrying the stream id, and
+ *              handed to the transmit queue in app/spp_tx.c. Only
+ *              SPP_MUX_MAX_IN_FLIGHT chunks are queued there at a time, the
+ *              rest waits in per-stream queues so the scheduler can still
+ *              reorder it:
+ *              - streams of a lower priority value are always served first
+ *              - streams of the same priority share the link by deficit round
+ *                robin, each round a stream may send weight * SPP_MUX_QUANTUM
+ *                bytes
+ *              A control message thus waits for at most the chunks already in
+ *              flight, whatever amount of bulk data is queued.
+ *
+ *              Messages are not copied, the caller keeps the buffer until its
+ *              completion callback runs. On the receive side the chunks are
+ *              reassembled from the byte stream and passed to the callback of
+ *              their stream.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_mux.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    wiced_bool_t open;
+    uint8_t priority;
+    uint8_t weight;
+    spp_mux_rx_cback_t p_rx_cback;
+} spp_mux_stream_t;
+
+typedef struct
+{
+    const uint8_t *p_data;
+    uint32_t len;
+    uint32_t offset; /* bytes already handed to the transmit queue */
+    uint64_t queued_us;
+    spp_send_complete_cback_t p_complete;
+    void *p_context;
+} spp_mux_msg_t;
+
+typedef struct
+{
+    spp_mux_msg_t msgs[SPP_MUX_MAX_MESSAGES]; /* ring of waiting messages */
+    uint16_t head;
+    uint16_t count;
+    uint32_t deficit; /* bytes the stream may still send this round */
+} spp_mux_queue_t;
+
+struct spp_mux_session;
+
+typedef struct
+{
+    struct spp_mux_session *p_session;
+    wiced_bool_t in_use;
+    uint8_t hdr[SPP_MUX_HDR_LEN];
+    uint8_t stream_id;
+    uint32_t len;
+    wiced_bool_t last; /* chunk ends its message, the fields below are valid */
+    uint64_t queued_us;
+    spp_send_complete_cback_t p_complete;
+    void *p_context;
+} spp_mux_chunk_t;
+
+typedef struct spp_mux_session
+{
+    uint16_t handle; /* 0 if the entry is free or closing */
+    wiced_bool_t closing; /* down, freed once its chunks in flight complete */
+    spp_mux_queue_t queues[SPP_MUX_MAX_STREAMS];
+    spp_mux_chunk_t chunks[SPP_MUX_MAX_IN_FLIGHT];
+    uint8_t in_flight;
+    uint8_t cursor;             /* stream the round robin is on */
+    wiced_bool_t cursor_served; /* the cursor stream got its quantum */
+    uint8_t rx_buf[SPP_MUX_HDR_LEN + SPP_MUX_MAX_CHUNK];
+    uint32_t rx_len;
+} spp_mux_session_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_mux_session_t spp_mux_sessions[SPP_MAX_SESSIONS];
+static spp_mux_stream_t spp_mux_streams[SPP_MUX_MAX_STREAMS];
+static spp_mux_stream_stats_t spp_mux_stats[SPP_MUX_MAX_STREAMS];
+static uint32_t spp_mux_rx_errors = 0;
+static wiced_bool_t spp_mux_enabled = WICED_FALSE;
+static pthread_mutex_t spp_mux_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static void spp_mux_chunk_sent(void *p_context, wiced_bool_t sent);
+static int spp_mux_release_locked(spp_mux_session_t *p_session, spp_iovec_t *p_dropped);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Must be called with spp_mux_lock held */
+static spp_mux_session_t *spp_mux_find(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != handle) && (spp_mux_sessions[i].handle == handle))
+        {
+            return &spp_mux_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_pick
+ *******************************************************************************
+ * Summary:
+ *   Selects the stream which sends the next chunk. Only streams of the best
+ *   (lowest) priority with waiting messages take part; among them the deficit
+ *   round robin cursor moves on once a stream has used up its quantum. Must
+ *   be called with spp_mux_lock held.
+ *
+ * Parameters:
+ *   spp_mux_session_t *p_session : session
+ *   uint32_t *p_len : set to the length of the chunk to send
+ *
+ * Return:
+ *   int : stream id, -1 if no message is waiting
+ *
+ ******************************************************************************/
+static int spp_mux_pick(spp_mux_session_t *p_session, uint32_t *p_len)
+{
+    spp_mux_queue_t *p_queue;
+    spp_mux_msg_t *p_msg;
+    uint32_t quantum;
+    int best = -1;
+    int tries;
+    int s;
+
+    for (s = 0; s < SPP_MUX_MAX_STREAMS; s++)
+    {
+        if ((0 != p_session->queues[s].count) &&
+            ((best < 0) || (spp_mux_streams[s].priority < best)))
+        {
+            best = spp_mux_streams[s].priority;
+        }
+    }
+    if (best < 0)
+    {
+        return -1;
+    }
+
+    /* Every waiting stream gets at least one chunk worth of quantum per visit,
+     * so two passes always find one
+     */
+    for (tries = 0; tries < 2 * SPP_MUX_MAX_STREAMS; tries++)
+    {
+        s = p_session->cursor;
+        p_queue = &p_session->queues[s];
+        if ((0 != p_queue->count) && (spp_mux_streams[s].priority == best))
+        {
+            if (!p_session->cursor_served)
+            {
+                /* Capped, a stream held back by higher priority traffic must
+                 * not save up quanta and then hog the link
+                 */
+                quantum = spp_mux_streams[s].weight * SPP_MUX_QUANTUM;
+                p_queue->deficit = MIN(p_queue->deficit + quantum, 2 * quantum);
+                p_session->cursor_served = WICED_TRUE;
+            }
+            p_msg = &p_queue->msgs[p_queue->head];
+            *p_len = MIN(p_msg->len - p_msg->offset, SPP_MUX_MAX_CHUNK);
+            if (p_queue->deficit >= *p_len)
+            {
+                p_queue->deficit -= *p_len;
+                return s;
+            }
+        }
+        else if (0 == p_queue->count)
+        {
+            p_queue->deficit = 0;
+        }
+        p_session->cursor = (p_session->cursor + 1) % SPP_MUX_MAX_STREAMS;
+        p_session->cursor_served = WICED_FALSE;
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_schedule_locked
+ *******************************************************************************
+ * Summary:
+ *   Hands chunks to the transmit queue until SPP_MUX_MAX_IN_FLIGHT are
+ *   queued there. Queueing happens under spp_mux_lock so the chunks keep the
+ *   scheduler's order; the caller sends them with spp_tx_kick() once the lock
+ *   is released.
+ *
+ * Parameters:
+ *   spp_mux_session_t *p_session : session
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if a chunk was queued
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_mux_schedule_locked(spp_mux_session_t *p_session)
+{
+    spp_mux_queue_t *p_queue;
+    spp_mux_chunk_t *p_chunk;
+    spp_mux_msg_t *p_msg;
+    spp_iovec_t iov[2];
+    wiced_bool_t queued = WICED_FALSE;
+    uint32_t len;
+    int stream_id;
+    int i;
+
+    while (p_session->in_flight < SPP_MUX_MAX_IN_FLIGHT)
+    {
+        i = 0;
+        while (p_session->chunks[i].in_use)
+        {
+            i++;
+        }
+        p_chunk = &p_session->chunks[i];
+        stream_id = spp_mux_pick(p_session, &len);
+        if (stream_id < 0)
+        {
+            break;
+        }
+        p_queue = &p_session->queues[stream_id];
+        p_msg = &p_queue->msgs[p_queue->head];
+
+        p_chunk->hdr[0] = SPP_MUX_MAGIC;
+        p_chunk->hdr[1] = (uint8_t)stream_id;
+        p_chunk->hdr[2] = (uint8_t)(len & 0xFF);
+        p_chunk->hdr[3] = (uint8_t)(len >> 8);
+        iov[0].p_data = p_chunk->hdr;
+        iov[0].len = SPP_MUX_HDR_LEN;
+        iov[0].p_complete = NULL;
+        iov[0].p_context = NULL;
+        iov[1].p_data = p_msg->p_data + p_msg->offset;
+        iov[1].len = len;
+        iov[1].p_complete = spp_mux_chunk_sent;
+        iov[1].p_context = p_chunk;
+        if (!spp_tx_enqueue(p_session->handle, iov, 2))
+        {
+            /* Transmit queue is full or closed, retried on the next completion */
+            p_queue->deficit += len;
+            break;
+        }
+
+        p_chunk->p_session = p_session;
+        p_chunk->in_use = WICED_TRUE;
+        p_chunk->stream_id = (uint8_t)stream_id;
+        p_chunk->len = len;
+        p_chunk->last = WICED_FALSE;
+        p_session->in_flight++;
+        queued = WICED_TRUE;
+
+        p_msg->offset += len;
+        if (p_msg->offset == p_msg->len)
+        {
+            p_chunk->last = WICED_TRUE;
+            p_chunk->queued_us = p_msg->queued_us;
+            p_chunk->p_complete = p_msg->p_complete;
+            p_chunk->p_context = p_msg->p_context;
+            p_queue->head = (p_queue->head + 1) % SPP_MUX_MAX_MESSAGES;
+            p_queue->count--;
+            spp_mux_stats[stream_id].queue_depth--;
+        }
+    }
+    return queued;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_chunk_sent
+ *******************************************************************************
+ * Summary:
+ *   Transmit queue completion of a chunk. Completes the message the chunk
+ *   ended, if any, and schedules the next chunks.
+ *
+ * Parameters:
+ *   void *p_context : the chunk
+ *   wiced_bool_t sent : WICED_FALSE if the session went down first
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_mux_chunk_sent(void *p_context, wiced_bool_t sent)
+{
+    spp_iovec_t dropped[SPP_MUX_MAX_STREAMS * SPP_MUX_MAX_MESSAGES];
+    spp_mux_chunk_t *p_chunk = (spp_mux_chunk_t *)p_context;
+    spp_mux_session_t *p_session = p_chunk->p_session;
+    spp_mux_stream_stats_t *p_stats;
+    spp_send_complete_cback_t p_complete = NULL;
+    void *p_complete_context = NULL;
+    wiced_bool_t queued = WICED_FALSE;
+    uint16_t handle;
+    uint32_t latency_us;
+    int count = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_mux_lock);
+    if (!p_chunk->in_use)
+    {
+        pthread_mutex_unlock(&spp_mux_lock);
+        return;
+    }
+    p_chunk->in_use = WICED_FALSE;
+    p_session->in_flight--;
+    handle = p_session->handle;
+
+    p_stats = &spp_mux_stats[p_chunk->stream_id];
+    if (sent)
+    {
+        p_stats->chunks_sent++;
+        p_stats->bytes_sent += p_chunk->len;
+    }
+    if (p_chunk->last)
+    {
+        p_complete = p_chunk->p_complete;
+        p_complete_context = p_chunk->p_context;
+        if (sent)
+        {
+            latency_us = (uint32_t)(spp_get_time_us() - p_chunk->queued_us);
+            p_stats->messages_sent++;
+            p_stats->latency_total_us += latency_us;
+            p_stats->latency_max_us = MAX(p_stats->latency_max_us, latency_us);
+        }
+        else
+        {
+            p_stats->messages_dropped++;
+        }
+    }
+    if (p_session->closing)
+    {
+        /* The session went down while the transmit queue still held this
+         * chunk, the last one frees the session
+         */
+        if (0 == p_session->in_flight)
+        {
+            count = spp_mux_release_locked(p_session, dropped);
+        }
+    }
+    else if (sent)
+    {
+        queued = spp_mux_schedule_locked(p_session);
+    }
+    pthread_mutex_unlock(&spp_mux_lock);
+
+    if (NULL != p_complete)
+    {
+        p_complete(p_complete_context, sent);
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (NULL != dropped[i].p_complete)
+        {
+            dropped[i].p_complete(dropped[i].p_context, WICED_FALSE);
+        }
+    }
+    if (queued)
+    {
+        spp_tx_kick(handle);
+    }
+}
+
+/* Passes one received chunk to its stream */
+static void spp_mux_deliver(uint16_t handle, uint8_t *p_chunk, uint32_t len)
+{
+    uint8_t stream_id = p_chunk[1];
+    spp_mux_rx_cback_t p_rx_cback = NULL;
+
+    pthread_mutex_lock(&spp_mux_lock);
+    if ((stream_id < SPP_MUX_MAX_STREAMS) && spp_mux_streams[stream_id].open)
+    {
+        spp_mux_stats[stream_id].bytes_received += len;
+        p_rx_cback = spp_mux_streams[stream_id].p_rx_cback;
+    }
+    else
+    {
+        spp_mux_rx_errors++;
+    }
+    pthread_mutex_unlock(&spp_mux_lock);
+
+    if (NULL != p_rx_cback)
+    {
+        p_rx_cback(handle, stream_id, &p_chunk[SPP_MUX_HDR_LEN], len);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the multiplexer, streams must be opened afterwards
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_init(void)
+{
+    pthread_mutex_lock(&spp_mux_lock);
+    memset(spp_mux_sessions, 0, sizeof(spp_mux_sessions));
+    memset(spp_mux_streams, 0, sizeof(spp_mux_streams));
+    memset(spp_mux_stats, 0, sizeof(spp_mux_stats));
+    spp_mux_rx_errors = 0;
+    pthread_mutex_unlock(&spp_mux_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_enable
+ *******************************************************************************
+ * Summary:
+ *   Selects whether the application sends and expects multiplexed traffic.
+ *   Both sides of the link must agree.
+ *
+ * Parameters:
+ *   wiced_bool_t enable : WICED_TRUE to multiplex
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_enable(wiced_bool_t enable)
+{
+    spp_mux_enabled = enable;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_is_enabled
+ *******************************************************************************
+ * Summary:
+ *   Returns whether the application multiplexes its traffic
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if multiplexing is enabled
+ *
+ ******************************************************************************/
+wiced_bool_t spp_mux_is_enabled(void)
+{
+    return spp_mux_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_open_stream
+ *******************************************************************************
+ * Summary:
+ *   Opens (or reconfigures) a logical stream
+ *
+ * Parameters:
+ *   uint8_t stream_id : stream id, below SPP_MUX_MAX_STREAMS
+ *   uint8_t priority : lower values are served first
+ *   uint8_t weight : share of the link among streams of the same priority
+ *   spp_mux_rx_cback_t p_rx_cback : called for data received on the
+ *                                    stream, may be NULL
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stream was opened
+ *
+ ******************************************************************************/
+wiced_bool_t spp_mux_open_stream(uint8_t stream_id, uint8_t priority, uint8_t weight,
+                                 spp_mux_rx_cback_t p_rx_cback)
+{
+    if ((stream_id >= SPP_MUX_MAX_STREAMS) || (0 == weight))
+    {
+        return WICED_FALSE;
+    }
+    pthread_mutex_lock(&spp_mux_lock);
+    spp_mux_streams[stream_id].open = WICED_TRUE;
+    spp_mux_streams[stream_id].priority = priority;
+    spp_mux_streams[stream_id].weight = weight;
+    spp_mux_streams[stream_id].p_rx_cback = p_rx_cback;
+    pthread_mutex_unlock(&spp_mux_lock);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_send
+ *******************************************************************************
+ * Summary:
+ *   Queues a message on a stream of a session. The data is not copied; the
+ *   caller may reuse p_data once p_complete has been called.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t stream_id : stream to send on
+ *   const uint8_t *p_data : message
+ *   uint32_t len : message length
+ *   spp_send_complete_cback_t p_complete : called once the message was sent
+ *                                           or dropped, may be NULL
+ *   void *p_context : passed to p_complete
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the message was queued
+ *
+ ******************************************************************************/
+wiced_bool_t spp_mux_send(uint16_t handle, uint8_t stream_id, const uint8_t *p_data,
+                          uint32_t len, spp_send_complete_cback_t p_complete, void *p_context)
+{
+    spp_mux_session_t *p_session;
+    spp_mux_queue_t *p_queue;
+    spp_mux_msg_t *p_msg;
+    spp_mux_stream_stats_t *p_stats;
+    wiced_bool_t queued;
+
+    if ((stream_id >= SPP_MUX_MAX_STREAMS) || (NULL == p_data) || (0 == len))
+    {
+        return WICED_FALSE;
+    }
+
+    pthread_mutex_lock(&spp_mux_lock);
+    p_stats = &spp_mux_stats[stream_id];
+    p_session = spp_mux_find(handle);
+    p_queue = (NULL != p_session) ? &p_session->queues[stream_id] : NULL;
+    if ((NULL == p_queue) || !spp_mux_streams[stream_id].open ||
+        (p_queue->count == SPP_MUX_MAX_MESSAGES))
+    {
+        p_stats->send_failures++;
+        pthread_mutex_unlock(&spp_mux_lock);
+        return WICED_FALSE;
+    }
+
+    p_msg = &p_queue->msgs[(p_queue->head + p_queue->count) % SPP_MUX_MAX_MESSAGES];
+    p_msg->p_data = p_data;
+    p_msg->len = len;
+    p_msg->offset = 0;
+    p_msg->queued_us = spp_get_time_us();
+    p_msg->p_complete = p_complete;
+    p_msg->p_context = p_context;
+    p_queue->count++;
+    p_stats->queue_depth++;
+    p_stats->queue_depth_max = MAX(p_stats->queue_depth_max, p_stats->queue_depth);
+
+    queued = spp_mux_schedule_locked(p_session);
+    pthread_mutex_unlock(&spp_mux_lock);
+
+    if (queued)
+    {
+        spp_tx_kick(handle);
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Opens the stream queues of a new session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_connection_up(uint16_t handle)
+{
+    int i;
+
+    pthread_mutex_lock(&spp_mux_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 == spp_mux_sessions[i].handle) && !spp_mux_sessions[i].closing)
+        {
+            memset(&spp_mux_sessions[i], 0, sizeof(spp_mux_sessions[i]));
+            spp_mux_sessions[i].handle = handle;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&spp_mux_lock);
+
+    if (SPP_MAX_SESSIONS == i)
+    {
+        WICED_BT_TRACE("%s: no free session for handle %d\n", __FUNCTION__, handle);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_release_locked
+ *******************************************************************************
+ * Summary:
+ *   Drops the waiting messages of a session and frees the session. Must be
+ *   called with spp_mux_lock held and no chunk in flight, the caller runs the
+ *   returned completions with sent set to WICED_FALSE once it has released
+ *   the lock.
+ *
+ * Parameters:
+ *   spp_mux_session_t *p_session : session
+ *   spp_iovec_t *p_dropped : receives the completions of the dropped messages,
+ *                            SPP_MUX_MAX_STREAMS * SPP_MUX_MAX_MESSAGES entries
+ *
+ * Return:
+ *   int : number of completions written to p_dropped
+ *
+ ******************************************************************************/
+static int spp_mux_release_locked(spp_mux_session_t *p_session, spp_iovec_t *p_dropped)
+{
+    spp_mux_queue_t *p_queue;
+    spp_mux_msg_t *p_msg;
+    int count = 0;
+    int s;
+
+    for (s = 0; s < SPP_MUX_MAX_STREAMS; s++)
+    {
+        p_queue = &p_session->queues[s];
+        while (0 != p_queue->count)
+        {
+            p_msg = &p_queue->msgs[p_queue->head];
+            p_dropped[count].p_complete = p_msg->p_complete;
+            p_dropped[count].p_context = p_msg->p_context;
+            count++;
+            p_queue->head = (p_queue->head + 1) % SPP_MUX_MAX_MESSAGES;
+            p_queue->count--;
+            spp_mux_stats[s].queue_depth--;
+            spp_mux_stats[s].messages_dropped++;
+        }
+    }
+    memset(p_session, 0, sizeof(*p_session));
+    return count;
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Closes the stream queues of a session. Must be called after
+ *   spp_tx_connection_down(), which normally releases the chunks in flight.
+ *   Waiting messages are released to their owners with sent set to
+ *   WICED_FALSE. If the transmit queue was sending when the session went
+ *   down, it completes the chunks in flight later. The session is then only
+ *   marked closing, and the completion of its last chunk releases it, so no
+ *   owner gets its buffer back while a chunk may still be read from it.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_connection_down(uint16_t handle)
+{
+    spp_iovec_t dropped[SPP_MUX_MAX_STREAMS * SPP_MUX_MAX_MESSAGES];
+    spp_mux_session_t *p_session;
+    int count = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_mux_lock);
+    p_session = spp_mux_find(handle);
+    if (NULL != p_session)
+    {
+        if (0 == p_session->in_flight)
+        {
+            count = spp_mux_release_locked(p_session, dropped);
+        }
+        else
+        {
+            p_session->handle = 0;
+            p_session->closing = WICED_TRUE;
+            p_session->rx_len = 0;
+        }
+    }
+    pthread_mutex_unlock(&spp_mux_lock);
+
+    for (i = 0; i < count; i++)
+    {
+        if (NULL != dropped[i].p_complete)
+        {
+            dropped[i].p_complete(dropped[i].p_context, WICED_FALSE);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_rx_data
+ *******************************************************************************
+ * Summary:
+ *   Reassembles chunks from data received on a session and passes them to
+ *   their streams. Chunks may span or share received packets. Bytes which do
+ *   not start a valid header are skipped until the stream resynchronises.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_data : received data
+ *   uint32_t data_len : received data length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len)
+{
+    spp_mux_session_t *p_session;
+    uint32_t chunk_len;
+    uint32_t copy;
+
+    /* Receive state is only touched from the stack thread */
+    pthread_mutex_lock(&spp_mux_lock);
+    p_session = spp_mux_find(handle);
+    pthread_mutex_unlock(&spp_mux_lock);
+    if (NULL == p_session)
+    {
+        return;
+    }
+
+    while (0 != data_len)
+    {
+        if ((0 == p_session->rx_len) && (data_len >= SPP_MUX_HDR_LEN) &&
+            (SPP_MUX_MAGIC == p_data[0]))
+        {
+            /* Whole chunk in the packet, no need to copy it */
+            chunk_len = p_data[2] | (p_data[3] << 8);
+            if ((chunk_len <= SPP_MUX_MAX_CHUNK) && (data_len >= SPP_MUX_HDR_LEN + chunk_len))
+            {
+                spp_mux_deliver(handle, p_data, chunk_len);
+                p_data += SPP_MUX_HDR_LEN + chunk_len;
+                data_len -= SPP_MUX_HDR_LEN + chunk_len;
+                continue;
+            }
+        }
+
+        if (p_session->rx_len < SPP_MUX_HDR_LEN)
+        {
+            copy = MIN(SPP_MUX_HDR_LEN - p_session->rx_len, data_len);
+        }
+        else
+        {
+            chunk_len = p_session->rx_buf[2] | (p_session->rx_buf[3] << 8);
+            copy = MIN(SPP_MUX_HDR_LEN + chunk_len - p_session->rx_len, data_len);
+        }
+        memcpy(&p_session->rx_buf[p_session->rx_len], p_data, copy);
+        p_session->rx_len += copy;
+        p_data += copy;
+        data_len -= copy;
+
+        if ((p_session->rx_len >= 1) && (SPP_MUX_MAGIC != p_session->rx_buf[0]))
+        {
+            spp_mux_rx_errors++;
+            p_session->rx_len--;
+            memmove(p_session->rx_buf, &p_session->rx_buf[1], p_session->rx_len);
+            continue;
+        }
+        if (p_session->rx_len < SPP_MUX_HDR_LEN)
+        {
+            continue;
+        }
+        chunk_len = p_session->rx_buf[2] | (p_session->rx_buf[3] << 8);
+        if (chunk_len > SPP_MUX_MAX_CHUNK)
+        {
+            spp_mux_rx_errors++;
+            p_session->rx_len--;
+            memmove(p_session->rx_buf, &p_session->rx_buf[1], p_session->rx_len);
+            continue;
+        }
+        if (p_session->rx_len == SPP_MUX_HDR_LEN + chunk_len)
+        {
+            spp_mux_deliver(handle, p_session->rx_buf, chunk_len);
+            p_session->rx_len = 0;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the counters of a stream
+ *
+ * Parameters:
+ *   uint8_t stream_id : stream
+ *   spp_mux_stream_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_get_stats(uint8_t stream_id, spp_mux_stream_stats_t *p_stats)
+{
+    memset(p_stats, 0, sizeof(*p_stats));
+    if (stream_id < SPP_MUX_MAX_STREAMS)
+    {
+        pthread_mutex_lock(&spp_mux_lock);
+        *p_stats = spp_mux_stats[stream_id];
+        pthread_mutex_unlock(&spp_mux_lock);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_mux_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the counters, queue depth and send latency of every open stream
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_mux_print_stats(void)
+{
+    spp_mux_stream_stats_t stats;
+    double latency;
+    int s;
+
+    fprintf(stdout, "mux: %s, rx errors %u\n", spp_mux_enabled ? "on" : "off", spp_mux_rx_errors);
+    for (s = 0; s < SPP_MUX_MAX_STREAMS; s++)
+    {
+        if (!spp_mux_streams[s].open)
+        {
+            continue;
+        }
+        spp_mux_get_stats(s, &stats);
+        latency = (0 != stats.messages_sent) ? (double)stats.latency_total_us / stats.messages_sent : 0;
+        fprintf(stdout, "mux: stream %d prio %u weight %u, sent %llu msgs %llu bytes, dropped %llu, rx %llu bytes\n",
+                s, spp_mux_streams[s].priority, spp_mux_streams[s].weight,
+                (unsigned long long)stats.messages_sent, (unsigned long long)stats.bytes_sent,
+                (unsigned long long)stats.messages_dropped, (unsigned long long)stats.bytes_received);
+        fprintf(stdout, "mux: stream %d depth %u max %u, latency avg %.0f us max %u us, failures %u\n",
+                s, stats.queue_depth, stats.queue_depth_max, latency, stats.latency_max_us,
+                stats.send_failures);
+    }
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,417 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_pattern.c
+ *
+ * Description: Test pattern engine.
+ *
+ *              The sample data sender and the verify rx sink need the same
+ *              byte stream, addressed by its offset from the start of the
+ *              session. Every pattern is periodic: the incrementing pattern
+ *              repeats after 256 bytes, a fixed byte after one, the xorshift
+ *              stream after SPP_PATTERN_PRNG_PERIOD bytes and a replayed file
+ *              after its size. spp_pattern_configure() expands one period
+ *              into a table, repeated up to SPP_PATTERN_MIN_TABLE_SIZE bytes,
+ *              so that generating a chunk is one or two memcpy() calls and
+ *              verifying it one or two memcmp() calls. The C library
+ *              implements both with the widest vector instructions of the
+ *              host, no per-byte work is left on the send or receive path.
+ *
+ *              The table is built before the stack starts and only read
+ *              afterwards, so no lock is needed.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "wiced_bt_trace.h"
+#include "spp_pattern.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    spp_pattern_type_t type;
+    char spec[SPP_PATTERN_SPEC_MAX_LEN];
+    uint8_t *p_table;   /* whole periods of the stream */
+    uint32_t period;    /* bytes before the stream repeats */
+    uint32_t table_len; /* multiple of period */
+} spp_pattern_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_pattern_t spp_pattern;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Returns the pattern type of a spec, SPP_PATTERN_TYPES if it is not valid */
+static spp_pattern_type_t spp_pattern_parse_type(const char *p_spec)
+{
+    if (0 == strcmp(p_spec, "incr"))
+    {
+        return SPP_PATTERN_INCREMENT;
+    }
+    if ((0 == strncmp(p_spec, "fixed:", 6)) && ('\0' != p_spec[6]))
+    {
+        return SPP_PATTERN_FIXED;
+    }
+    if ((0 == strcmp(p_spec, "xorshift")) || ((0 == strncmp(p_spec, "xorshift:", 9)) && ('\0' != p_spec[9])))
+    {
+        return SPP_PATTERN_PRNG;
+    }
+    if ((0 == strncmp(p_spec, "file:", 5)) && ('\0' != p_spec[5]))
+    {
+        return SPP_PATTERN_FILE;
+    }
+    return SPP_PATTERN_TYPES;
+}
+
+/* Fills one period of the xorshift64 stream, eight bytes per step */
+static void spp_pattern_fill_prng(uint8_t *p_buf, uint32_t len, uint64_t seed)
+{
+    uint64_t x = seed;
+    uint32_t i;
+    int j;
+
+    for (i = 0; i < len; i += 8)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        for (j = 0; (j < 8) && (i + j < len); j++)
+        {
+            p_buf[i + j] = (uint8_t)(x >> (8 * j));
+        }
+    }
+}
+
+/* Reads a whole file, returns its size or 0 on failure */
+static uint32_t spp_pattern_read_file(const char *p_path, uint8_t **pp_data)
+{
+    struct stat st;
+    uint8_t *p_data;
+    ssize_t got;
+    uint32_t len = 0;
+    int fd;
+
+    fd = open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    if ((0 != fstat(fd, &st)) || (st.st_size <= 0) || (st.st_size > SPP_PATTERN_MAX_FILE_SIZE) ||
+        (NULL == (p_data = malloc(st.st_size))))
+    {
+        close(fd);
+        return 0;
+    }
+    while (len < st.st_size)
+    {
+        got = read(fd, p_data + len, st.st_size - len);
+        if (got <= 0)
+        {
+            break;
+        }
+        len += (uint32_t)got;
+    }
+    close(fd);
+    if (len != st.st_size)
+    {
+        free(p_data);
+        return 0;
+    }
+    *pp_data = p_data;
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_build
+ *******************************************************************************
+ * Summary:
+ *   Expands a spec into one period of its stream, repeated until the table
+ *   holds at least SPP_PATTERN_MIN_TABLE_SIZE bytes
+ *
+ * Parameters:
+ *   spp_pattern_t *p_pattern : filled with the table
+ *   const char *p_spec : spec string, see spp_pattern_configure()
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the spec is not valid or the file could
+ *                  not be read
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_pattern_build(spp_pattern_t *p_pattern, const char *p_spec)
+{
+    uint8_t *p_period = NULL;
+    unsigned long value = 0;
+    uint32_t copies;
+    uint32_t filled;
+    uint32_t i;
+    char *p_end;
+
+    memset(p_pattern, 0, sizeof(*p_pattern));
+    p_pattern->type = spp_pattern_parse_type(p_spec);
+    strncpy(p_pattern->spec, p_spec, sizeof(p_pattern->spec) - 1);
+
+    switch (p_pattern->type)
+    {
+    case SPP_PATTERN_INCREMENT:
+        p_pattern->period = 256;
+        break;
+    case SPP_PATTERN_FIXED:
+        value = strtoul(&p_spec[6], &p_end, 0);
+        if (('\0' != *p_end) || (value > 0xFF))
+        {
+            return WICED_FALSE;
+        }
+        p_pattern->period = 1;
+        break;
+    case SPP_PATTERN_PRNG:
+        value = (':' == p_spec[8]) ? strtoul(&p_spec[9], &p_end, 0) : 1;
+        /* An all zero state never leaves zero */
+        if (((':' == p_spec[8]) && ('\0' != *p_end)) || (0 == value))
+        {
+            return WICED_FALSE;
+        }
+        p_pattern->period = SPP_PATTERN_PRNG_PERIOD;
+        break;
+    case SPP_PATTERN_FILE:
+        p_pattern->period = spp_pattern_read_file(&p_spec[5], &p_period);
+        if (0 == p_pattern->period)
+        {
+            return WICED_FALSE;
+        }
+        break;
+    default:
+        return WICED_FALSE;
+    }
+
+    copies = (SPP_PATTERN_MIN_TABLE_SIZE + p_pattern->period - 1) / p_pattern->period;
+    p_pattern->table_len = copies * p_pattern->period;
+    p_pattern->p_table = malloc(p_pattern->table_len);
+    if (NULL == p_pattern->p_table)
+    {
+        free(p_period);
+        return WICED_FALSE;
+    }
+
+    switch (p_pattern->type)
+    {
+    case SPP_PATTERN_INCREMENT:
+        for (i = 0; i < p_pattern->period; i++)
+        {
+            p_pattern->p_table[i] = (uint8_t)i;
+        }
+        break;
+    case SPP_PATTERN_FIXED:
+        p_pattern->p_table[0] = (uint8_t)value;
+        break;
+    case SPP_PATTERN_PRNG:
+        spp_pattern_fill_prng(p_pattern->p_table, p_pattern->period, value);
+        break;
+    default:
+        memcpy(p_pattern->p_table, p_period, p_pattern->period);
+        free(p_period);
+        break;
+    }
+    /* Repeat the first period, doubling the filled part every copy */
+    for (filled = p_pattern->period; filled < p_pattern->table_len; filled += i)
+    {
+        i = MIN(filled, p_pattern->table_len - filled);
+        memcpy(&p_pattern->p_table[filled], p_pattern->p_table, i);
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_configure
+ *******************************************************************************
+ * Summary:
+ *   Selects the pattern of the sample data and of the verify rx sink. Must
+ *   be called before the stack is started.
+ *
+ * Parameters:
+ *   const char *p_spec : "incr", "fixed:<byte>", "xorshift[:<seed>]" or
+ *                        "file:<path>"
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the spec is not valid, the current
+ *                  pattern is kept
+ *
+ ******************************************************************************/
+wiced_bool_t spp_pattern_configure(const char *p_spec)
+{
+    spp_pattern_t pattern;
+
+    if ((NULL == p_spec) || (strlen(p_spec) >= SPP_PATTERN_SPEC_MAX_LEN) ||
+        !spp_pattern_build(&pattern, p_spec))
+    {
+        return WICED_FALSE;
+    }
+    free(spp_pattern.p_table);
+    spp_pattern = pattern;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_init
+ *******************************************************************************
+ * Summary:
+ *   Builds the default incrementing pattern unless one was configured
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_pattern_init(void)
+{
+    if (NULL == spp_pattern.p_table)
+    {
+        spp_pattern_build(&spp_pattern, "incr");
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_fill
+ *******************************************************************************
+ * Summary:
+ *   Copies part of the pattern stream into a buffer
+ *
+ * Parameters:
+ *   uint64_t offset : stream offset of the first byte
+ *   uint8_t *p_buf : receives the data
+ *   uint32_t len : bytes to copy
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_pattern_fill(uint64_t offset, uint8_t *p_buf, uint32_t len)
+{
+    uint32_t pos = (uint32_t)(offset % spp_pattern.table_len);
+    uint32_t chunk;
+
+    while (0 != len)
+    {
+        chunk = MIN(len, spp_pattern.table_len - pos);
+        memcpy(p_buf, &spp_pattern.p_table[pos], chunk);
+        p_buf += chunk;
+        len -= chunk;
+        pos = 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_verify
+ *******************************************************************************
+ * Summary:
+ *   Compares received data with the pattern stream
+ *
+ * Parameters:
+ *   uint64_t offset : stream offset of the first byte
+ *   const uint8_t *p_data : received data
+ *   uint32_t len : data length
+ *   uint32_t *p_first : set to the index of the first differing byte, left
+ *                       alone if all bytes match
+ *
+ * Return:
+ *   uint32_t : number of bytes which differ
+ *
+ ******************************************************************************/
+uint32_t spp_pattern_verify(uint64_t offset, const uint8_t *p_data, uint32_t len, uint32_t *p_first)
+{
+    uint32_t pos = (uint32_t)(offset % spp_pattern.table_len);
+    uint32_t done = 0;
+    uint32_t errors = 0;
+    uint32_t chunk;
+    uint32_t i;
+
+    while (done < len)
+    {
+        chunk = MIN(len - done, spp_pattern.table_len - pos);
+        if (0 != memcmp(&p_data[done], &spp_pattern.p_table[pos], chunk))
+        {
+            /* Only a corrupted chunk is walked byte by byte */
+            for (i = 0; i < chunk; i++)
+            {
+                if (p_data[done + i] != spp_pattern.p_table[pos + i])
+                {
+                    if (0 == errors)
+                    {
+                        *p_first = done + i;
+                    }
+                    errors++;
+                }
+            }
+        }
+        done += chunk;
+        pos = 0;
+    }
+    return errors;
+}
+
+/*******************************************************************************
+ * Function Name: spp_pattern_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the pattern in use
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_pattern_print_stats(void)
+{
+    fprintf(stdout, "pattern: \"%s\" period %u bytes, table %u bytes\n", spp_pattern.spec,
+            spp_pattern.period, spp_pattern.table_len);
+}
+
+/* END OF FILE [] */
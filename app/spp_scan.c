@@ -0,0 +1,453 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_scan.c
+ *
+ * Description: Page and inquiry scan scheduler.
+ *
+ *              After boot, after a disconnect and on request the device scans
+ *              with the high duty burst profile, so a peer which pages it
+ *              right then connects quickly. Once the burst expires, or a
+ *              peer connected, scanning steps down to the low duty profile,
+ *              which uses the stack's default scan parameters.
+ *
+ *              Discoverability is only needed to pair new peers: once a
+ *              bonded peer exists the device is only connectable, except
+ *              during a burst started on request, which acts as a pairing
+ *              window.
+ *              The supervisor of several controllers hides all but the
+ *              least loaded one, so new peers pair with that one.
+ *
+ *              For every profile the time from its start to the first ACL
+ *              connection is recorded.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_dev.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_scan.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    const char *p_name;
+    uint16_t page_interval;
+    uint16_t page_window;
+    uint16_t inquiry_interval;
+    uint16_t inquiry_window;
+} spp_scan_params_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const spp_scan_params_t spp_scan_params[SPP_SCAN_PROFILES] =
+{
+    {
+        "burst",
+        SPP_SCAN_BURST_PAGE_INTERVAL, SPP_SCAN_BURST_PAGE_WINDOW,
+        SPP_SCAN_BURST_INQUIRY_INTERVAL, SPP_SCAN_BURST_INQUIRY_WINDOW
+    },
+    {
+        "low duty",
+        WICED_BT_CFG_DEFAULT_PAGE_SCAN_INTERVAL, WICED_BT_CFG_DEFAULT_PAGE_SCAN_WINDOW,
+        WICED_BT_CFG_DEFAULT_INQUIRY_SCAN_INTERVAL, WICED_BT_CFG_DEFAULT_INQUIRY_SCAN_WINDOW
+    },
+};
+
+static spp_scan_profile_stats_t spp_scan_stats[SPP_SCAN_PROFILES];
+static spp_scan_profile_t spp_scan_profile = SPP_SCAN_PROFILE_LOW_DUTY;
+static uint64_t spp_scan_profile_start_us = 0;
+static wiced_bool_t spp_scan_connect_seen = WICED_FALSE;
+static wiced_bool_t spp_scan_bonded = WICED_FALSE;
+static wiced_bool_t spp_scan_pairing_window = WICED_FALSE;
+static wiced_bool_t spp_scan_hidden = WICED_FALSE;
+static uint32_t spp_scan_burst_ms = SPP_SCAN_DEFAULT_BURST_MS;
+static pthread_mutex_t spp_scan_lock = PTHREAD_MUTEX_INITIALIZER;
+static wiced_timer_t spp_scan_timer;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static void spp_scan_timeout(WICED_TIMER_PARAM_TYPE arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Makes a profile current, returns whether the device must be discoverable.
+ * Must be called with spp_scan_lock held.
+ */
+static wiced_bool_t spp_scan_select_locked(spp_scan_profile_t profile)
+{
+    spp_scan_profile = profile;
+    spp_scan_profile_start_us = spp_get_time_us();
+    spp_scan_connect_seen = WICED_FALSE;
+    spp_scan_stats[profile].activations++;
+    if (SPP_SCAN_PROFILE_BURST != profile)
+    {
+        spp_scan_pairing_window = WICED_FALSE;
+    }
+    return (!spp_scan_bonded || spp_scan_pairing_window) && !spp_scan_hidden;
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_apply
+ *******************************************************************************
+ * Summary:
+ *   Programs the page and inquiry scan parameters of a profile
+ *
+ * Parameters:
+ *   spp_scan_profile_t profile : profile to apply
+ *   wiced_bool_t discoverable : WICED_TRUE to answer inquiries
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_scan_apply(spp_scan_profile_t profile, wiced_bool_t discoverable)
+{
+    const spp_scan_params_t *p_params = &spp_scan_params[profile];
+
+    WICED_BT_TRACE("scan: %s profile, %sdiscoverable\n", p_params->p_name, discoverable ? "" : "not ");
+    wiced_bt_dev_set_connectability(BTM_CONNECTABLE, p_params->page_window,
+                                    p_params->page_interval);
+    wiced_bt_dev_set_discoverability(discoverable ? BTM_GENERAL_DISCOVERABLE : BTM_NON_DISCOVERABLE,
+                                     p_params->inquiry_window, p_params->inquiry_interval);
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_timeout
+ *******************************************************************************
+ * Summary:
+ *   End of a burst, steps down to the low duty profile
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_scan_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    wiced_bool_t discoverable;
+
+    pthread_mutex_lock(&spp_scan_lock);
+    discoverable = spp_scan_select_locked(SPP_SCAN_PROFILE_LOW_DUTY);
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    spp_scan_apply(SPP_SCAN_PROFILE_LOW_DUTY, discoverable);
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the scheduler and starts the boot burst
+ *
+ * Parameters:
+ *   wiced_bool_t bonded : WICED_TRUE if a bonded peer is stored
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_init(wiced_bool_t bonded)
+{
+    wiced_init_timer(&spp_scan_timer, spp_scan_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+
+    pthread_mutex_lock(&spp_scan_lock);
+    memset(spp_scan_stats, 0, sizeof(spp_scan_stats));
+    spp_scan_bonded = bonded;
+    spp_scan_pairing_window = WICED_FALSE;
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    spp_scan_start_burst(SPP_SCAN_BURST_BOOT);
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_configure_burst
+ *******************************************************************************
+ * Summary:
+ *   Sets how long bursts last. With 0 the device stays on the low duty
+ *   profile after boot and disconnects; bursts on request still use
+ *   SPP_SCAN_DEFAULT_BURST_MS.
+ *
+ * Parameters:
+ *   uint32_t duration_ms : burst duration in milliseconds
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_configure_burst(uint32_t duration_ms)
+{
+    pthread_mutex_lock(&spp_scan_lock);
+    spp_scan_burst_ms = duration_ms;
+    pthread_mutex_unlock(&spp_scan_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_set_bonded
+ *******************************************************************************
+ * Summary:
+ *   Updates whether a bonded peer exists, which turns discoverability off
+ *   (or back on) outside of pairing windows
+ *
+ * Parameters:
+ *   wiced_bool_t bonded : WICED_TRUE if a bonded peer is stored
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_set_bonded(wiced_bool_t bonded)
+{
+    spp_scan_profile_t profile;
+    wiced_bool_t discoverable;
+    wiced_bool_t changed;
+
+    pthread_mutex_lock(&spp_scan_lock);
+    changed = (bonded != spp_scan_bonded);
+    spp_scan_bonded = bonded;
+    profile = spp_scan_profile;
+    discoverable = (!bonded || spp_scan_pairing_window) && !spp_scan_hidden;
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    if (changed)
+    {
+        spp_scan_apply(profile, discoverable);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_set_hidden
+ *******************************************************************************
+ * Summary:
+ *   Keeps the device from answering inquiries, even in pairing windows, so
+ *   that new peers find another controller. Bonded peers still connect.
+ *
+ * Parameters:
+ *   wiced_bool_t hidden : WICED_TRUE to stop answering inquiries
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_set_hidden(wiced_bool_t hidden)
+{
+    spp_scan_profile_t profile;
+    wiced_bool_t discoverable;
+    wiced_bool_t changed;
+
+    pthread_mutex_lock(&spp_scan_lock);
+    changed = (hidden != spp_scan_hidden);
+    spp_scan_hidden = hidden;
+    profile = spp_scan_profile;
+    discoverable = (!spp_scan_bonded || spp_scan_pairing_window) && !hidden;
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    if (changed)
+    {
+        spp_scan_apply(profile, discoverable);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_start_burst
+ *******************************************************************************
+ * Summary:
+ *   Switches to the burst profile for the configured duration
+ *
+ * Parameters:
+ *   spp_scan_burst_reason_t reason : why the burst is started, a burst on
+ *                                    request also makes the device
+ *                                    discoverable
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_start_burst(spp_scan_burst_reason_t reason)
+{
+    spp_scan_profile_t profile = SPP_SCAN_PROFILE_BURST;
+    wiced_bool_t discoverable;
+    uint32_t duration_ms;
+
+    pthread_mutex_lock(&spp_scan_lock);
+    duration_ms = spp_scan_burst_ms;
+    if (SPP_SCAN_BURST_REQUEST == reason)
+    {
+        spp_scan_pairing_window = WICED_TRUE;
+        duration_ms = (0 != duration_ms) ? duration_ms : SPP_SCAN_DEFAULT_BURST_MS;
+    }
+    if (0 == duration_ms)
+    {
+        profile = SPP_SCAN_PROFILE_LOW_DUTY;
+    }
+    discoverable = spp_scan_select_locked(profile);
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    if (wiced_is_timer_in_use(&spp_scan_timer))
+    {
+        wiced_stop_timer(&spp_scan_timer);
+    }
+    spp_scan_apply(profile, discoverable);
+    if (SPP_SCAN_PROFILE_BURST == profile)
+    {
+        wiced_start_timer(&spp_scan_timer, duration_ms);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_acl_up
+ *******************************************************************************
+ * Summary:
+ *   Records the time to connect of the current profile and ends a burst,
+ *   a peer found us
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_acl_up(void)
+{
+    spp_scan_profile_stats_t *p_stats;
+    wiced_bool_t step_down;
+    wiced_bool_t discoverable = WICED_FALSE;
+    uint32_t connect_ms;
+
+    pthread_mutex_lock(&spp_scan_lock);
+    if (!spp_scan_connect_seen)
+    {
+        spp_scan_connect_seen = WICED_TRUE;
+        p_stats = &spp_scan_stats[spp_scan_profile];
+        connect_ms = (uint32_t)((spp_get_time_us() - spp_scan_profile_start_us) / 1000);
+        p_stats->connects++;
+        p_stats->connect_total_ms += connect_ms;
+        p_stats->connect_max_ms = MAX(p_stats->connect_max_ms, connect_ms);
+    }
+    step_down = (SPP_SCAN_PROFILE_BURST == spp_scan_profile);
+    if (step_down)
+    {
+        discoverable = spp_scan_select_locked(SPP_SCAN_PROFILE_LOW_DUTY);
+        /* The connection is not a new profile start */
+        spp_scan_connect_seen = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_scan_lock);
+
+    if (step_down)
+    {
+        if (wiced_is_timer_in_use(&spp_scan_timer))
+        {
+            wiced_stop_timer(&spp_scan_timer);
+        }
+        spp_scan_apply(SPP_SCAN_PROFILE_LOW_DUTY, discoverable);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the counters of a profile
+ *
+ * Parameters:
+ *   spp_scan_profile_t profile : profile
+ *   spp_scan_profile_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_get_stats(spp_scan_profile_t profile, spp_scan_profile_stats_t *p_stats)
+{
+    memset(p_stats, 0, sizeof(*p_stats));
+    if (profile < SPP_SCAN_PROFILES)
+    {
+        pthread_mutex_lock(&spp_scan_lock);
+        *p_stats = spp_scan_stats[profile];
+        pthread_mutex_unlock(&spp_scan_lock);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_scan_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the scan duty cycle and the time to connect of every profile
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_scan_print_stats(void)
+{
+    const spp_scan_params_t *p_params;
+    spp_scan_profile_stats_t stats;
+    double avg_ms;
+    int i;
+
+    fprintf(stdout, "scan: %s profile, bonded %d, hidden %d, burst %u ms\n",
+            spp_scan_params[spp_scan_profile].p_name, spp_scan_bonded, spp_scan_hidden, spp_scan_burst_ms);
+    for (i = 0; i < SPP_SCAN_PROFILES; i++)
+    {
+        p_params = &spp_scan_params[i];
+        spp_scan_get_stats(i, &stats);
+        avg_ms = (0 != stats.connects) ? (double)stats.connect_total_ms / stats.connects : 0;
+        fprintf(stdout, "scan: %-8s page duty %.1f%% inquiry duty %.1f%%, used %u times, "
+                "connects %u, time to connect avg %.0f ms max %u ms\n",
+                p_params->p_name, 100.0 * p_params->page_window / p_params->page_interval,
+                100.0 * p_params->inquiry_window / p_params->inquiry_interval,
+                stats.activations, stats.connects, avg_ms, stats.connect_max_ms);
+    }
+}
+
+/* END OF FILE [] */
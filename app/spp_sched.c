@@ -0,0 +1,676 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_sched.c
+ *
+ * Description: Thread placement, real-time scheduling and scheduling jitter
+ *              monitor.
+ *
+ *              Every thread of the application belongs to a role: the BT
+ *              stack and HCI threads of the porting layer ("stack"), the
+ *              menu thread ("menu") and the application worker threads
+ *              ("io"). A role can be given a scheduling policy, a priority
+ *              and a CPU set. The porting layer creates its threads itself,
+ *              so main() applies the stack role before starting it and the
+ *              threads inherit it; the menu role is applied afterwards.
+ *              Once a role is configured, the roles which are not get the
+ *              default policy and the CPU set of the process back.
+ *
+ *              The memory of the process can be locked, so that page faults
+ *              do not delay the real-time threads.
+ *
+ *              The jitter monitor wakes up every period in each role and
+ *              records how late it ran, like cyclictest. The stack role is
+ *              measured with a stack timer, so it also covers the timer
+ *              dispatching of the stack.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_sched.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define SPP_SCHED_DEFAULT_RT_PRIORITY           ( 10 )
+#define SPP_SCHED_MAX_CPUS_SPEC                 ( 64 )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    wiced_bool_t configured;
+    int policy;
+    int priority;
+    wiced_bool_t has_cpus;
+    cpu_set_t cpus;
+    char cpus_spec[SPP_SCHED_MAX_CPUS_SPEC];
+    uint32_t apply_failures;
+} spp_sched_config_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *const spp_sched_role_names[SPP_SCHED_ROLES] = { "stack", "menu", "io" };
+
+static spp_sched_config_t spp_sched_config[SPP_SCHED_ROLES];
+static wiced_bool_t spp_sched_any_configured = WICED_FALSE;
+static wiced_bool_t spp_sched_mlock = WICED_FALSE;
+static wiced_bool_t spp_sched_mlocked = WICED_FALSE;
+static wiced_bool_t spp_sched_default_saved = WICED_FALSE;
+static cpu_set_t spp_sched_default_cpus;
+static uint32_t spp_sched_period_us = 0;
+
+static spp_sched_stats_t spp_sched_stats[SPP_SCHED_ROLES];
+static wiced_timer_t spp_sched_timer;
+static uint64_t spp_sched_timer_due_us;
+static pthread_mutex_t spp_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static const char *spp_sched_policy_name(int policy)
+{
+    switch (policy)
+    {
+    case SCHED_FIFO:
+        return "fifo";
+    case SCHED_RR:
+        return "rr";
+    default:
+        return "other";
+    }
+}
+
+/* Parses a CPU list such as "0,2-3" */
+static wiced_bool_t spp_sched_parse_cpus(const char *p_list, cpu_set_t *p_cpus)
+{
+    unsigned long first;
+    unsigned long last;
+    unsigned long cpu;
+    char *p_end;
+
+    CPU_ZERO(p_cpus);
+    do
+    {
+        first = strtoul(p_list, &p_end, 10);
+        if (p_end == p_list)
+        {
+            return WICED_FALSE;
+        }
+        last = first;
+        if ('-' == *p_end)
+        {
+            p_list = p_end + 1;
+            last = strtoul(p_list, &p_end, 10);
+            if ((p_end == p_list) || (last < first))
+            {
+                return WICED_FALSE;
+            }
+        }
+        if (last >= CPU_SETSIZE)
+        {
+            return WICED_FALSE;
+        }
+        for (cpu = first; cpu <= last; cpu++)
+        {
+            CPU_SET(cpu, p_cpus);
+        }
+        p_list = p_end + 1;
+    } while (',' == *p_end);
+
+    return ('\0' == *p_end) ? WICED_TRUE : WICED_FALSE;
+}
+
+/* Delays above the last bucket are counted in it */
+static void spp_sched_record(spp_sched_role_t role, uint64_t delay_us)
+{
+    spp_sched_stats_t *p_stats = &spp_sched_stats[role];
+    uint32_t delay = (uint32_t)MIN(delay_us, (uint64_t)UINT32_MAX);
+    int bucket = 0;
+
+    while ((0 != (delay >> bucket)) && (bucket < SPP_SCHED_HIST_BUCKETS - 1))
+    {
+        bucket++;
+    }
+
+    pthread_mutex_lock(&spp_sched_lock);
+    p_stats->samples++;
+    p_stats->total_us += delay;
+    p_stats->max_us = MAX(p_stats->max_us, delay);
+    p_stats->hist[bucket]++;
+    pthread_mutex_unlock(&spp_sched_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_timeout
+ *******************************************************************************
+ * Summary:
+ *   Jitter monitor of the stack role: records how late the stack ran the
+ *   timer and restarts it
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg : unused
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_sched_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    uint64_t now_us = spp_get_time_us();
+    uint32_t period_ms = MAX(1, (spp_sched_period_us + 999) / 1000);
+
+    spp_sched_record(SPP_SCHED_ROLE_STACK,
+                     (now_us > spp_sched_timer_due_us) ? now_us - spp_sched_timer_due_us : 0);
+
+    /* The timer is relative, so it restarts from now */
+    spp_sched_timer_due_us = spp_get_time_us() + period_ms * 1000ULL;
+    wiced_start_timer(&spp_sched_timer, period_ms);
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_monitor
+ *******************************************************************************
+ * Summary:
+ *   Jitter monitor thread of the menu and io roles. It takes the placement of
+ *   its role, sleeps until the next period and records how late it woke up.
+ *   Periods missed entirely are skipped.
+ *
+ * Parameters:
+ *   void *p_arg : role, as an integer
+ *
+ * Return:
+ *   void * : never returns
+ *
+ ******************************************************************************/
+static void *spp_sched_monitor(void *p_arg)
+{
+    spp_sched_role_t role = (spp_sched_role_t)(uintptr_t)p_arg;
+    struct timespec next;
+    uint64_t next_us;
+    uint64_t now_us;
+
+    spp_sched_apply(role);
+
+    next_us = spp_get_time_us();
+    for (;;)
+    {
+        next_us += spp_sched_period_us;
+        next.tv_sec = (time_t)(next_us / 1000000ULL);
+        next.tv_nsec = (long)(next_us % 1000000ULL) * 1000;
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL))
+        {
+        }
+
+        now_us = spp_get_time_us();
+        spp_sched_record(role, (now_us > next_us) ? now_us - next_us : 0);
+        if (now_us >= next_us + spp_sched_period_us)
+        {
+            next_us = now_us;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_configure
+ *******************************************************************************
+ * Summary:
+ *   Configures the placement of a role from a specification
+ *   <role>[:other|fifo|rr[:<priority>]][@<cpus>], for example
+ *   "stack:fifo:40@1" or "io@2-3". fifo and rr need CAP_SYS_NICE or an
+ *   RLIMIT_RTPRIO allowance. Must be called before the threads start.
+ *
+ * Parameters:
+ *   const char *p_spec : placement specification
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the specification is not valid
+ *
+ ******************************************************************************/
+wiced_bool_t spp_sched_configure(const char *p_spec)
+{
+    spp_sched_config_t config;
+    const char *p_cpus = strchr(p_spec, '@');
+    size_t len = (NULL != p_cpus) ? (size_t)(p_cpus - p_spec) : strlen(p_spec);
+    char policy_spec[32];
+    char *p_policy;
+    char *p_priority;
+    char *p_end;
+    int role;
+
+    if (len >= sizeof(policy_spec))
+    {
+        return WICED_FALSE;
+    }
+    memcpy(policy_spec, p_spec, len);
+    policy_spec[len] = '\0';
+
+    memset(&config, 0, sizeof(config));
+    config.configured = WICED_TRUE;
+    config.policy = SCHED_OTHER;
+
+    p_policy = strchr(policy_spec, ':');
+    if (NULL != p_policy)
+    {
+        *p_policy++ = '\0';
+    }
+    for (role = 0; role < SPP_SCHED_ROLES; role++)
+    {
+        if (0 == strcmp(policy_spec, spp_sched_role_names[role]))
+        {
+            break;
+        }
+    }
+    if (SPP_SCHED_ROLES == role)
+    {
+        return WICED_FALSE;
+    }
+
+    if (NULL != p_policy)
+    {
+        p_priority = strchr(p_policy, ':');
+        if (NULL != p_priority)
+        {
+            *p_priority++ = '\0';
+        }
+        if (0 == strcmp(p_policy, "fifo"))
+        {
+            config.policy = SCHED_FIFO;
+        }
+        else if (0 == strcmp(p_policy, "rr"))
+        {
+            config.policy = SCHED_RR;
+        }
+        else if (0 != strcmp(p_policy, "other"))
+        {
+            return WICED_FALSE;
+        }
+
+        if (SCHED_OTHER != config.policy)
+        {
+            config.priority = SPP_SCHED_DEFAULT_RT_PRIORITY;
+            if (NULL != p_priority)
+            {
+                config.priority = (int)strtol(p_priority, &p_end, 10);
+                if ((p_end == p_priority) || ('\0' != *p_end))
+                {
+                    return WICED_FALSE;
+                }
+            }
+            if ((config.priority < sched_get_priority_min(config.policy)) ||
+                (config.priority > sched_get_priority_max(config.policy)))
+            {
+                return WICED_FALSE;
+            }
+        }
+        else if (NULL != p_priority)
+        {
+            return WICED_FALSE;
+        }
+    }
+
+    if (NULL != p_cpus)
+    {
+        if ((strlen(p_cpus + 1) >= sizeof(config.cpus_spec)) ||
+            !spp_sched_parse_cpus(p_cpus + 1, &config.cpus))
+        {
+            return WICED_FALSE;
+        }
+        strcpy(config.cpus_spec, p_cpus + 1);
+        config.has_cpus = WICED_TRUE;
+    }
+
+    spp_sched_config[role] = config;
+    spp_sched_any_configured = WICED_TRUE;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_configure_mlock
+ *******************************************************************************
+ * Summary:
+ *   Enables locking the current and future memory of the process
+ *
+ * Parameters:
+ *   wiced_bool_t enable : WICED_TRUE to lock the memory
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sched_configure_mlock(wiced_bool_t enable)
+{
+    spp_sched_mlock = enable;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_configure_jitter
+ *******************************************************************************
+ * Summary:
+ *   Enables the jitter monitor. The stack role is measured with a stack
+ *   timer, so its period is rounded up to milliseconds.
+ *
+ * Parameters:
+ *   uint32_t period_us : wake-up period, 0 disables the monitor
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the period is below SPP_SCHED_MIN_PERIOD_US
+ *
+ ******************************************************************************/
+wiced_bool_t spp_sched_configure_jitter(uint32_t period_us)
+{
+    if ((0 != period_us) && (period_us < SPP_SCHED_MIN_PERIOD_US))
+    {
+        return WICED_FALSE;
+    }
+    spp_sched_period_us = period_us;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_lock_memory
+ *******************************************************************************
+ * Summary:
+ *   Locks the memory of the process if configured. Called before the threads
+ *   start, so that their stacks are locked too.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sched_lock_memory(void)
+{
+    if (!spp_sched_mlock)
+    {
+        return;
+    }
+    if (0 != mlockall(MCL_CURRENT | MCL_FUTURE))
+    {
+        /* Usually RLIMIT_MEMLOCK, see ulimit -l */
+        fprintf(stdout, "sched: mlockall failed (%s), memory not locked\n", strerror(errno));
+        return;
+    }
+    spp_sched_mlocked = WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_apply
+ *******************************************************************************
+ * Summary:
+ *   Applies the placement of a role to the calling thread. Threads created
+ *   by it afterwards inherit the placement. A role which is not configured
+ *   gets the default policy and the CPU set of the process back, unless no
+ *   role is configured at all, in which case nothing is changed.
+ *
+ * Parameters:
+ *   spp_sched_role_t role : role of the calling thread
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the placement could not be applied
+ *
+ ******************************************************************************/
+wiced_bool_t spp_sched_apply(spp_sched_role_t role)
+{
+    spp_sched_config_t *p_config = &spp_sched_config[role];
+    struct sched_param param;
+    const cpu_set_t *p_cpus;
+    wiced_bool_t result = WICED_TRUE;
+    int err;
+
+    if (!spp_sched_any_configured)
+    {
+        return WICED_TRUE;
+    }
+
+    pthread_mutex_lock(&spp_sched_lock);
+    if (!spp_sched_default_saved)
+    {
+        /* The first call comes from main(), before any change */
+        if (0 != sched_getaffinity(0, sizeof(spp_sched_default_cpus), &spp_sched_default_cpus))
+        {
+            CPU_ZERO(&spp_sched_default_cpus);
+        }
+        spp_sched_default_saved = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_sched_lock);
+
+    p_cpus = p_config->has_cpus ? &p_config->cpus : &spp_sched_default_cpus;
+    if (0 != CPU_COUNT(p_cpus))
+    {
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), p_cpus);
+        if (0 != err)
+        {
+            WICED_BT_TRACE("%s: %s affinity failed %d\n", __FUNCTION__, spp_sched_role_names[role], err);
+            result = WICED_FALSE;
+        }
+    }
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = p_config->priority;
+    err = pthread_setschedparam(pthread_self(), p_config->configured ? p_config->policy : SCHED_OTHER,
+                                &param);
+    if (0 != err)
+    {
+        /* EPERM without CAP_SYS_NICE or RLIMIT_RTPRIO */
+        WICED_BT_TRACE("%s: %s policy %s failed %d\n", __FUNCTION__, spp_sched_role_names[role],
+                       spp_sched_policy_name(p_config->policy), err);
+        result = WICED_FALSE;
+    }
+
+    if (!result)
+    {
+        pthread_mutex_lock(&spp_sched_lock);
+        p_config->apply_failures++;
+        pthread_mutex_unlock(&spp_sched_lock);
+    }
+    return result;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_init
+ *******************************************************************************
+ * Summary:
+ *   Applies the stack role to the stack thread, which may have been created
+ *   with explicit attributes, and starts the jitter monitor if enabled.
+ *   Called from the stack thread once the stack is enabled.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sched_init(void)
+{
+    pthread_t thread;
+    int role;
+
+    spp_sched_apply(SPP_SCHED_ROLE_STACK);
+
+    wiced_init_timer(&spp_sched_timer, spp_sched_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+    if (0 == spp_sched_period_us)
+    {
+        return;
+    }
+    spp_sched_timer_due_us = spp_get_time_us() + MAX(1, (spp_sched_period_us + 999) / 1000) * 1000ULL;
+    wiced_start_timer(&spp_sched_timer, MAX(1, (spp_sched_period_us + 999) / 1000));
+
+    for (role = SPP_SCHED_ROLE_MENU; role < SPP_SCHED_ROLES; role++)
+    {
+        if (0 != pthread_create(&thread, NULL, spp_sched_monitor, (void *)(uintptr_t)role))
+        {
+            WICED_BT_TRACE("%s: %s monitor not started\n", __FUNCTION__, spp_sched_role_names[role]);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the jitter statistics of a role
+ *
+ * Parameters:
+ *   spp_sched_role_t role         : role
+ *   spp_sched_stats_t *p_stats    : filled with the statistics
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sched_get_stats(spp_sched_role_t role, spp_sched_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_sched_lock);
+    *p_stats = spp_sched_stats[role];
+    pthread_mutex_unlock(&spp_sched_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_sched_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the placement of every role and, if the jitter monitor runs, the
+ *   wake-up delay: mean, 99th percentile (upper bound of its histogram
+ *   bucket), maximum and the histogram
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sched_print_stats(void)
+{
+    spp_sched_stats_t stats;
+    spp_sched_config_t config;
+    uint64_t count;
+    uint32_t p99_us;
+    int role;
+    int i;
+
+    if (!spp_sched_any_configured && !spp_sched_mlock && (0 == spp_sched_period_us))
+    {
+        return;
+    }
+
+    fprintf(stdout, "sched: memory %s\n", spp_sched_mlocked ? "locked" :
+                                          spp_sched_mlock ? "lock failed" : "not locked");
+    for (role = 0; role < SPP_SCHED_ROLES; role++)
+    {
+        pthread_mutex_lock(&spp_sched_lock);
+        stats = spp_sched_stats[role];
+        config = spp_sched_config[role];
+        pthread_mutex_unlock(&spp_sched_lock);
+
+        fprintf(stdout, "sched: %s %s", spp_sched_role_names[role],
+                config.configured ? spp_sched_policy_name(config.policy) : "default");
+        if (SCHED_OTHER != config.policy)
+        {
+            fprintf(stdout, ":%d", config.priority);
+        }
+        fprintf(stdout, " cpus %s, %u apply failures", config.has_cpus ? config.cpus_spec : "all",
+                config.apply_failures);
+        if (0 == stats.samples)
+        {
+            fprintf(stdout, "\n");
+            continue;
+        }
+
+        count = 0;
+        p99_us = 0;
+        for (i = 0; i < SPP_SCHED_HIST_BUCKETS; i++)
+        {
+            count += stats.hist[i];
+            if (count * 100 >= stats.samples * 99)
+            {
+                p99_us = (0 == i) ? 0 : (1u << i) - 1;
+                break;
+            }
+        }
+        fprintf(stdout, ", %llu wake-ups late by %.1f us avg, p99 <= %u us, max %u us\n",
+                (unsigned long long)stats.samples, (double)stats.total_us / stats.samples,
+                p99_us, stats.max_us);
+
+        fprintf(stdout, "sched: %s delay histogram (us):", spp_sched_role_names[role]);
+        for (i = 0; i < SPP_SCHED_HIST_BUCKETS; i++)
+        {
+            if (0 == stats.hist[i])
+            {
+                continue;
+            }
+            if (0 == i)
+            {
+                fprintf(stdout, " 0:%u", stats.hist[i]);
+            }
+            else if (SPP_SCHED_HIST_BUCKETS - 1 == i)
+            {
+                fprintf(stdout, " %u+:%u", 1u << (i - 1), stats.hist[i]);
+            }
+            else
+            {
+                fprintf(stdout, " %u-%u:%u", 1u << (i - 1), (1u << i) - 1, stats.hist[i]);
+            }
+        }
+        fprintf(stdout, "\n");
+    }
+}
+
+/* END OF FILE [] */
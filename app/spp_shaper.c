@@ -0,0 +1,641 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_shaper.c
+ *
+ * Description: Token-bucket shapers of the SPP transmit path.
+ *
+ *              Every session has a guaranteed bucket (min_rate) and a
+ *              ceiling bucket (max_rate), and the whole link has one more
+ *              bucket shared by all sessions. Before a frame is handed to
+ *              the stack the transmit queue asks for admission, and only
+ *              once the stack has accepted the frame are the buckets
+ *              charged, so a frame refused for lack of credits costs no
+ *              tokens however often it is retried:
+ *              - a frame covered by the guaranteed bucket is always sent,
+ *                and still charged to the other two buckets
+ *              - any other frame needs tokens in both the ceiling bucket and
+ *                the link bucket
+ *              so a bulk sender can only use the link capacity left over
+ *              after the guaranteed rates of the other sessions.
+ *
+ *              A frame which is not admitted stays queued and the session is
+ *              put on a timer wheel, due when enough tokens will have
+ *              accumulated. One WICED timer drives the wheel for every
+ *              session, and only runs while a session is waiting.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_shaper.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Tokens are kept in byte-microseconds, so refills need no division */
+#define SPP_SHAPER_SCALE                        ( 1000000LL )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    uint32_t rate;       /* bytes per second, 0 if unlimited */
+    uint32_t burst;
+    int64_t tokens;      /* bytes x SPP_SHAPER_SCALE, may go into debt */
+    uint64_t last_us;
+} spp_shaper_bucket_t;
+
+typedef struct
+{
+    uint16_t handle;     /* 0 if the entry is free */
+    spp_shaper_bucket_t min_bucket;
+    spp_shaper_bucket_t max_bucket;
+    int wheel_slot;      /* -1 if not waiting */
+    uint32_t rounds;     /* full wheel turns left before it is due */
+    spp_shaper_session_stats_t stats;
+    uint64_t up_us;
+} spp_shaper_session_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_shaper_config_t spp_shaper_default;
+static spp_shaper_session_t spp_shaper_sessions[SPP_MAX_SESSIONS];
+static spp_shaper_bucket_t spp_shaper_link;
+static uint64_t spp_shaper_link_bytes;
+static uint32_t spp_shaper_link_deferrals;
+static uint32_t spp_shaper_wheel[SPP_SHAPER_WHEEL_SLOTS]; /* session bit masks */
+static uint32_t spp_shaper_wheel_pos;
+static uint32_t spp_shaper_waiting;
+static wiced_bool_t spp_shaper_active = WICED_FALSE;
+static wiced_timer_t spp_shaper_timer;
+static pthread_mutex_t spp_shaper_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATIONS
+ ******************************************************************************/
+static void spp_shaper_tick(WICED_TIMER_PARAM_TYPE arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_shaper_bucket_set(spp_shaper_bucket_t *p_bucket, uint32_t rate, uint32_t burst)
+{
+    p_bucket->rate = rate;
+    if (0 == burst)
+    {
+        burst = (uint32_t)((uint64_t)rate * SPP_SHAPER_DEFAULT_BURST_MS / 1000);
+    }
+    p_bucket->burst = MAX(burst, SPP_SHAPER_MIN_BURST);
+    /* Starts full, and keeps its level when only the rate changes */
+    if ((0 == p_bucket->last_us) || (p_bucket->tokens > (int64_t)p_bucket->burst * SPP_SHAPER_SCALE))
+    {
+        p_bucket->tokens = (int64_t)p_bucket->burst * SPP_SHAPER_SCALE;
+    }
+    p_bucket->last_us = spp_get_time_us();
+}
+
+static void spp_shaper_bucket_refill(spp_shaper_bucket_t *p_bucket, uint64_t now_us)
+{
+    if (0 != p_bucket->rate)
+    {
+        p_bucket->tokens += (int64_t)p_bucket->rate * (int64_t)(now_us - p_bucket->last_us);
+        p_bucket->tokens = MIN(p_bucket->tokens, (int64_t)p_bucket->burst * SPP_SHAPER_SCALE);
+    }
+    p_bucket->last_us = now_us;
+}
+
+/* Charges a bucket, the debt is bounded by one burst */
+static void spp_shaper_bucket_take(spp_shaper_bucket_t *p_bucket, uint32_t len)
+{
+    if (0 != p_bucket->rate)
+    {
+        p_bucket->tokens -= (int64_t)len * SPP_SHAPER_SCALE;
+        p_bucket->tokens = MAX(p_bucket->tokens, -(int64_t)p_bucket->burst * SPP_SHAPER_SCALE);
+    }
+}
+
+/* Microseconds until the bucket holds len bytes, 0 if it does or is unlimited */
+static uint64_t spp_shaper_bucket_wait_us(const spp_shaper_bucket_t *p_bucket, uint32_t len)
+{
+    int64_t missing = (int64_t)len * SPP_SHAPER_SCALE - p_bucket->tokens;
+
+    if ((0 == p_bucket->rate) || (missing <= 0))
+    {
+        return 0;
+    }
+    return (uint64_t)((missing + p_bucket->rate - 1) / p_bucket->rate);
+}
+
+/* Must be called with spp_shaper_lock held */
+static spp_shaper_session_t *spp_shaper_find(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != handle) && (spp_shaper_sessions[i].handle == handle))
+        {
+            return &spp_shaper_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Must be called with spp_shaper_lock held */
+static void spp_shaper_update_active(void)
+{
+    wiced_bool_t active = (0 != spp_shaper_link.rate) ? WICED_TRUE : WICED_FALSE;
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != spp_shaper_sessions[i].handle) &&
+            ((0 != spp_shaper_sessions[i].min_bucket.rate) ||
+             (0 != spp_shaper_sessions[i].max_bucket.rate)))
+        {
+            active = WICED_TRUE;
+        }
+    }
+    spp_shaper_active = active;
+}
+
+/* Must be called with spp_shaper_lock held, returns WICED_TRUE if the wheel
+ * timer has to be started
+ */
+static wiced_bool_t spp_shaper_wheel_insert(spp_shaper_session_t *p_session, uint64_t wait_us)
+{
+    uint32_t ticks = (uint32_t)((wait_us + SPP_SHAPER_TICK_MS * 1000 - 1) / (SPP_SHAPER_TICK_MS * 1000));
+    int index = (int)(p_session - spp_shaper_sessions);
+
+    if (p_session->wheel_slot >= 0)
+    {
+        /* Already waiting, its earlier wake-up re-evaluates the frame */
+        return WICED_FALSE;
+    }
+    ticks = MAX(ticks, 1);
+    p_session->wheel_slot = (int)((spp_shaper_wheel_pos + ticks) % SPP_SHAPER_WHEEL_SLOTS);
+    p_session->rounds = (ticks - 1) / SPP_SHAPER_WHEEL_SLOTS;
+    spp_shaper_wheel[p_session->wheel_slot] |= (1u << index);
+    return (0 == spp_shaper_waiting++) ? WICED_TRUE : WICED_FALSE;
+}
+
+/* Must be called with spp_shaper_lock held */
+static void spp_shaper_wheel_remove(spp_shaper_session_t *p_session)
+{
+    if (p_session->wheel_slot >= 0)
+    {
+        spp_shaper_wheel[p_session->wheel_slot] &= ~(1u << (p_session - spp_shaper_sessions));
+        p_session->wheel_slot = -1;
+        spp_shaper_waiting--;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_tick
+ *******************************************************************************
+ * Summary:
+ *   Advances the timer wheel by one slot and kicks the transmit queue of the
+ *   sessions which are due. Re-arms itself while sessions are waiting.
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_shaper_tick(WICED_TIMER_PARAM_TYPE arg)
+{
+    uint16_t due[SPP_MAX_SESSIONS];
+    spp_shaper_session_t *p_session;
+    uint32_t mask;
+    int count = 0;
+    int i;
+    wiced_bool_t rearm;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    spp_shaper_wheel_pos = (spp_shaper_wheel_pos + 1) % SPP_SHAPER_WHEEL_SLOTS;
+    mask = spp_shaper_wheel[spp_shaper_wheel_pos];
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if (0 == (mask & (1u << i)))
+        {
+            continue;
+        }
+        p_session = &spp_shaper_sessions[i];
+        if (0 != p_session->rounds)
+        {
+            p_session->rounds--;
+            continue;
+        }
+        spp_shaper_wheel_remove(p_session);
+        due[count++] = p_session->handle;
+    }
+    rearm = (0 != spp_shaper_waiting) ? WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_shaper_lock);
+
+    if (rearm)
+    {
+        wiced_start_timer(&spp_shaper_timer, SPP_SHAPER_TICK_MS);
+    }
+    for (i = 0; i < count; i++)
+    {
+        spp_tx_kick(due[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the shapers, no limit is applied until one is configured
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_init(void)
+{
+    wiced_init_timer(&spp_shaper_timer, spp_shaper_tick, 0, WICED_MILLI_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_configure_default
+ *******************************************************************************
+ * Summary:
+ *   Sets the shaping of sessions which connect from now on
+ *
+ * Parameters:
+ *   const spp_shaper_config_t *p_config : rates and burst
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_configure_default(const spp_shaper_config_t *p_config)
+{
+    pthread_mutex_lock(&spp_shaper_lock);
+    spp_shaper_default = *p_config;
+    pthread_mutex_unlock(&spp_shaper_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_configure_session
+ *******************************************************************************
+ * Summary:
+ *   Changes the shaping of a connected session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const spp_shaper_config_t *p_config : rates and burst
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session is not connected
+ *
+ ******************************************************************************/
+wiced_bool_t spp_shaper_configure_session(uint16_t handle, const spp_shaper_config_t *p_config)
+{
+    spp_shaper_session_t *p_session;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    p_session = spp_shaper_find(handle);
+    if (NULL != p_session)
+    {
+        spp_shaper_bucket_set(&p_session->min_bucket, p_config->min_rate, p_config->burst);
+        spp_shaper_bucket_set(&p_session->max_bucket, p_config->max_rate, p_config->burst);
+        spp_shaper_update_active();
+    }
+    pthread_mutex_unlock(&spp_shaper_lock);
+
+    /* A session waiting under the old limits may go at once */
+    spp_tx_kick(handle);
+    return (NULL != p_session) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_configure_link
+ *******************************************************************************
+ * Summary:
+ *   Sets the shaping of the whole link, shared by every session
+ *
+ * Parameters:
+ *   uint32_t rate : bytes per second, 0 for no limit
+ *   uint32_t burst : bucket depth in bytes
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_configure_link(uint32_t rate, uint32_t burst)
+{
+    uint16_t handles[SPP_MAX_SESSIONS];
+    int count;
+    int i;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    spp_shaper_bucket_set(&spp_shaper_link, rate, burst);
+    spp_shaper_update_active();
+    pthread_mutex_unlock(&spp_shaper_lock);
+
+    count = spp_tx_get_handles(handles, SPP_MAX_SESSIONS);
+    for (i = 0; i < count; i++)
+    {
+        spp_tx_kick(handles[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_connection_up / spp_shaper_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Opens the shapers of a new session with the default configuration, and
+ *   closes them when the session goes down
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_connection_up(uint16_t handle)
+{
+    spp_shaper_session_t *p_session;
+    int i;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        p_session = &spp_shaper_sessions[i];
+        if (0 == p_session->handle)
+        {
+            memset(p_session, 0, sizeof(*p_session));
+            p_session->handle = handle;
+            p_session->wheel_slot = -1;
+            p_session->up_us = spp_get_time_us();
+            p_session->stats.handle = handle;
+            spp_shaper_bucket_set(&p_session->min_bucket, spp_shaper_default.min_rate,
+                                  spp_shaper_default.burst);
+            spp_shaper_bucket_set(&p_session->max_bucket, spp_shaper_default.max_rate,
+                                  spp_shaper_default.burst);
+            break;
+        }
+    }
+    spp_shaper_update_active();
+    pthread_mutex_unlock(&spp_shaper_lock);
+}
+
+void spp_shaper_connection_down(uint16_t handle)
+{
+    spp_shaper_session_t *p_session;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    p_session = spp_shaper_find(handle);
+    if (NULL != p_session)
+    {
+        spp_shaper_wheel_remove(p_session);
+        p_session->handle = 0;
+    }
+    spp_shaper_update_active();
+    pthread_mutex_unlock(&spp_shaper_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_admit
+ *******************************************************************************
+ * Summary:
+ *   Asks whether a frame may be sent now. Nothing is charged here, the
+ *   caller calls spp_shaper_commit() once the frame was accepted. If the
+ *   frame may not go yet, the session is put on the timer wheel and its
+ *   transmit queue is kicked once enough tokens have accumulated.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t len : frame length
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the frame may be sent
+ *
+ ******************************************************************************/
+wiced_bool_t spp_shaper_admit(uint16_t handle, uint32_t len)
+{
+    spp_shaper_session_t *p_session;
+    uint64_t now_us;
+    uint64_t min_wait_us;
+    uint64_t max_wait_us;
+    uint64_t link_wait_us;
+    wiced_bool_t start_timer = WICED_FALSE;
+    wiced_bool_t admitted = WICED_TRUE;
+
+    if (!spp_shaper_active)
+    {
+        return WICED_TRUE;
+    }
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    p_session = spp_shaper_find(handle);
+    if (NULL == p_session)
+    {
+        pthread_mutex_unlock(&spp_shaper_lock);
+        return WICED_TRUE;
+    }
+    now_us = spp_get_time_us();
+    spp_shaper_bucket_refill(&p_session->min_bucket, now_us);
+    spp_shaper_bucket_refill(&p_session->max_bucket, now_us);
+    spp_shaper_bucket_refill(&spp_shaper_link, now_us);
+
+    min_wait_us = (0 != p_session->min_bucket.rate) ?
+                  spp_shaper_bucket_wait_us(&p_session->min_bucket, len) : UINT64_MAX;
+    max_wait_us = spp_shaper_bucket_wait_us(&p_session->max_bucket, len);
+    link_wait_us = spp_shaper_bucket_wait_us(&spp_shaper_link, len);
+
+    /* A frame covered by the guaranteed rate goes ahead of the link limit */
+    if ((0 != min_wait_us) && ((0 != max_wait_us) || (0 != link_wait_us)))
+    {
+        admitted = WICED_FALSE;
+        p_session->stats.deferrals++;
+        p_session->stats.deferred_bytes += len;
+        if (link_wait_us > max_wait_us)
+        {
+            spp_shaper_link_deferrals++;
+        }
+        start_timer = spp_shaper_wheel_insert(p_session, MIN(min_wait_us, MAX(max_wait_us, link_wait_us)));
+    }
+    pthread_mutex_unlock(&spp_shaper_lock);
+
+    if (start_timer)
+    {
+        wiced_start_timer(&spp_shaper_timer, SPP_SHAPER_TICK_MS);
+    }
+    return admitted;
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_commit
+ *******************************************************************************
+ * Summary:
+ *   Charges a frame which was admitted and accepted by the stack. A frame
+ *   the guaranteed bucket covers is charged to it as well as to the ceiling
+ *   and link buckets.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t len : frame length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_commit(uint16_t handle, uint32_t len)
+{
+    spp_shaper_session_t *p_session;
+    uint64_t now_us;
+
+    if (!spp_shaper_active)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    p_session = spp_shaper_find(handle);
+    if (NULL == p_session)
+    {
+        pthread_mutex_unlock(&spp_shaper_lock);
+        return;
+    }
+    now_us = spp_get_time_us();
+    spp_shaper_bucket_refill(&p_session->min_bucket, now_us);
+    spp_shaper_bucket_refill(&p_session->max_bucket, now_us);
+    spp_shaper_bucket_refill(&spp_shaper_link, now_us);
+
+    if ((0 != p_session->min_bucket.rate) && (0 == spp_shaper_bucket_wait_us(&p_session->min_bucket, len)))
+    {
+        spp_shaper_bucket_take(&p_session->min_bucket, len);
+        p_session->stats.committed_bytes += len;
+    }
+    spp_shaper_bucket_take(&p_session->max_bucket, len);
+    spp_shaper_bucket_take(&spp_shaper_link, len);
+    p_session->stats.bytes += len;
+    spp_shaper_link_bytes += len;
+    pthread_mutex_unlock(&spp_shaper_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_get_session_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the shaping counters of a session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   spp_shaper_session_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session is not connected
+ *
+ ******************************************************************************/
+wiced_bool_t spp_shaper_get_session_stats(uint16_t handle, spp_shaper_session_stats_t *p_stats)
+{
+    spp_shaper_session_t *p_session;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    p_session = spp_shaper_find(handle);
+    if (NULL != p_session)
+    {
+        *p_stats = p_session->stats;
+        p_stats->connected_us = spp_get_time_us() - p_session->up_us;
+    }
+    pthread_mutex_unlock(&spp_shaper_lock);
+    return (NULL != p_session) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_shaper_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the limits, the bytes admitted and deferred and the average rate
+ *   of the link and of every session
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_shaper_print_stats(void)
+{
+    spp_shaper_session_t *p_session;
+    uint64_t elapsed_us;
+    int i;
+
+    pthread_mutex_lock(&spp_shaper_lock);
+    fprintf(stdout, "shaper: link rate %u B/s burst %u, %llu bytes, %u deferrals on the link limit\n",
+            spp_shaper_link.rate, spp_shaper_link.burst, (unsigned long long)spp_shaper_link_bytes,
+            spp_shaper_link_deferrals);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        p_session = &spp_shaper_sessions[i];
+        if (0 == p_session->handle)
+        {
+            continue;
+        }
+        elapsed_us = spp_get_time_us() - p_session->up_us;
+        fprintf(stdout, "shaper: handle %d min %u max %u B/s, %llu bytes (%llu guaranteed), "
+                "%u deferrals (%llu bytes), avg %llu B/s\n",
+                p_session->handle, p_session->min_bucket.rate, p_session->max_bucket.rate,
+                (unsigned long long)p_session->stats.bytes,
+                (unsigned long long)p_session->stats.committed_bytes, p_session->stats.deferrals,
+                (unsigned long long)p_session->stats.deferred_bytes,
+                (unsigned long long)((0 != elapsed_us) ? p_session->stats.bytes * 1000000ULL / elapsed_us : 0));
+    }
+    pthread_mutex_unlock(&spp_shaper_lock);
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,820 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_sink.c
+ *
+ * Description: Pluggable sinks for the data received on SPP sessions.
+ *
+ *              Every session owns one sink, opened at connection time from
+ *              the configured spec string and replaceable at runtime:
+ *              - print    : prints every byte, the original behaviour
+ *              - discard  : only counts, for benchmarking
+ *              - checksum : running CRC-32 of the stream
+ *              - file     : appends to a file
+ *              - fd       : forwards to an inherited descriptor, a Unix
+ *                           socket or a TCP socket
+ *              - ring     : keeps the latest bytes in memory for the
+ *                           application to read
+ *              - uring    : appends to a file through io_uring, without
+ *                           ever waiting for the disk (spp_uring.c)
+ *              - verify   : compares the stream with the test pattern the
+ *                           peer sends (spp_pattern.c)
+ *
+ *              The receive buffer belongs to the SPP profile and is only
+ *              valid during the receive callback, so sinks borrow it for
+ *              the duration of the call: the file and fd sinks write straight
+ *              from it and only the ring sink copies the data.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_sink.h"
+#include "spp_uring.h"
+#include "spp_pattern.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    spp_sink_type_t type;
+    char spec[SPP_SINK_SPEC_MAX_LEN];
+    int fd;                  /* file and fd sinks */
+    uint32_t crc;            /* checksum sink */
+    spp_uring_t *p_uring;    /* uring sink */
+    uint8_t *p_ring;         /* ring sink */
+    uint32_t ring_size;
+    uint32_t ring_head;      /* oldest byte */
+    uint32_t ring_count;
+    uint64_t mismatches;     /* verify sink */
+    uint64_t first_mismatch; /* stream offset, valid if mismatches */
+    uint64_t bytes;
+    uint64_t first_us;       /* first and latest data received */
+    uint64_t last_us;
+} spp_sink_t;
+
+typedef struct
+{
+    uint16_t handle; /* 0 if the entry is free */
+    spp_sink_t sink;
+} spp_sink_session_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *spp_sink_names[SPP_SINK_TYPES] =
+{
+    "print", "discard", "checksum", "file", "fd", "ring", "uring", "verify"
+};
+
+static char spp_sink_spec[SPP_SINK_SPEC_MAX_LEN] = "print";
+static spp_sink_session_t spp_sink_sessions[SPP_MAX_SESSIONS];
+static spp_sink_stats_t spp_sink_stats[SPP_SINK_TYPES];
+static uint32_t spp_sink_crc_table[256];
+static pthread_mutex_t spp_sink_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/* Returns the sink type of a spec, SPP_SINK_TYPES if it is not valid */
+static spp_sink_type_t spp_sink_parse_type(const char *p_spec)
+{
+    if (0 == strcmp(p_spec, "print"))
+    {
+        return SPP_SINK_PRINT;
+    }
+    if (0 == strcmp(p_spec, "discard"))
+    {
+        return SPP_SINK_DISCARD;
+    }
+    if (0 == strcmp(p_spec, "checksum"))
+    {
+        return SPP_SINK_CHECKSUM;
+    }
+    if ((0 == strncmp(p_spec, "file:", 5)) && ('\0' != p_spec[5]))
+    {
+        return SPP_SINK_FILE;
+    }
+    if (((0 == strncmp(p_spec, "fd:", 3)) && ('\0' != p_spec[3])) ||
+        ((0 == strncmp(p_spec, "unix:", 5)) && ('\0' != p_spec[5])) ||
+        ((0 == strncmp(p_spec, "tcp:", 4)) && (NULL != strchr(&p_spec[4], ':'))))
+    {
+        return SPP_SINK_FD;
+    }
+    if ((0 == strcmp(p_spec, "ring")) || (0 == strncmp(p_spec, "ring:", 5)))
+    {
+        return SPP_SINK_RING;
+    }
+    if ((0 == strncmp(p_spec, "uring:", 6)) && ('\0' != p_spec[6]))
+    {
+        return SPP_SINK_URING;
+    }
+    if (0 == strcmp(p_spec, "verify"))
+    {
+        return SPP_SINK_VERIFY;
+    }
+    return SPP_SINK_TYPES;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_connect
+ *******************************************************************************
+ * Summary:
+ *   Opens the descriptor an fd sink forwards to
+ *
+ * Parameters:
+ *   const char *p_spec : "fd:<n>", "unix:<path>" or "tcp:<ipv4>:<port>"
+ *
+ * Return:
+ *   int : descriptor, -1 on failure
+ *
+ ******************************************************************************/
+static int spp_sink_connect(const char *p_spec)
+{
+    struct sockaddr_un un_addr;
+    struct sockaddr_in in_addr;
+    char host[INET_ADDRSTRLEN];
+    const char *p_port;
+    int fd;
+
+    /* A reader going away must show up as a write error, not kill us */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (0 == strncmp(p_spec, "fd:", 3))
+    {
+        /* Duplicated so closing the sink leaves the inherited one open */
+        return dup(atoi(&p_spec[3]));
+    }
+    if (0 == strncmp(p_spec, "unix:", 5))
+    {
+        memset(&un_addr, 0, sizeof(un_addr));
+        un_addr.sun_family = AF_UNIX;
+        strncpy(un_addr.sun_path, &p_spec[5], sizeof(un_addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((fd >= 0) && (0 != connect(fd, (struct sockaddr *)&un_addr, sizeof(un_addr))))
+        {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    p_port = strrchr(&p_spec[4], ':');
+    if ((NULL == p_port) || ((size_t)(p_port - &p_spec[4]) >= sizeof(host)))
+    {
+        return -1;
+    }
+    memcpy(host, &p_spec[4], p_port - &p_spec[4]);
+    host[p_port - &p_spec[4]] = '\0';
+    memset(&in_addr, 0, sizeof(in_addr));
+    in_addr.sin_family = AF_INET;
+    in_addr.sin_port = htons((uint16_t)atoi(p_port + 1));
+    if (1 != inet_pton(AF_INET, host, &in_addr.sin_addr))
+    {
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if ((fd >= 0) && (0 != connect(fd, (struct sockaddr *)&in_addr, sizeof(in_addr))))
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_open
+ *******************************************************************************
+ * Summary:
+ *   Opens a sink from its spec string
+ *
+ * Parameters:
+ *   spp_sink_t *p_sink : sink to open
+ *   const char *p_spec : spec string
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the sink was opened
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_sink_open(spp_sink_t *p_sink, const char *p_spec)
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t crc;
+
+    memset(p_sink, 0, sizeof(*p_sink));
+    p_sink->fd = -1;
+    p_sink->type = spp_sink_parse_type(p_spec);
+    strncpy(p_sink->spec, p_spec, sizeof(p_sink->spec) - 1);
+
+    switch (p_sink->type)
+    {
+    case SPP_SINK_CHECKSUM:
+        if (0 == spp_sink_crc_table[1])
+        {
+            for (i = 0; i < 256; i++)
+            {
+                crc = i;
+                for (j = 0; j < 8; j++)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+                }
+                spp_sink_crc_table[i] = crc;
+            }
+        }
+        p_sink->crc = 0xFFFFFFFF;
+        return WICED_TRUE;
+
+    case SPP_SINK_FILE:
+        p_sink->fd = open(&p_spec[5], O_WRONLY | O_CREAT | O_APPEND, 0644);
+        return (p_sink->fd >= 0) ? WICED_TRUE : WICED_FALSE;
+
+    case SPP_SINK_FD:
+        p_sink->fd = spp_sink_connect(p_spec);
+        return (p_sink->fd >= 0) ? WICED_TRUE : WICED_FALSE;
+
+    case SPP_SINK_RING:
+        p_sink->ring_size = (':' == p_spec[4]) ? (uint32_t)strtoul(&p_spec[5], NULL, 0)
+                                                : SPP_SINK_DEFAULT_RING_SIZE;
+        p_sink->p_ring = (0 != p_sink->ring_size) ? malloc(p_sink->ring_size) : NULL;
+        return (NULL != p_sink->p_ring) ? WICED_TRUE : WICED_FALSE;
+
+    case SPP_SINK_URING:
+        p_sink->p_uring = spp_uring_open(&p_spec[6]);
+        if (NULL != p_sink->p_uring)
+        {
+            return WICED_TRUE;
+        }
+        /* Kernels without io_uring still get the data, written in line */
+        fprintf(stdout, "io_uring not available, writing %s synchronously\n", &p_spec[6]);
+        p_sink->type = SPP_SINK_FILE;
+        p_sink->fd = open(&p_spec[6], O_WRONLY | O_CREAT | O_APPEND, 0644);
+        return (p_sink->fd >= 0) ? WICED_TRUE : WICED_FALSE;
+
+    case SPP_SINK_TYPES:
+        return WICED_FALSE;
+
+    default:
+        return WICED_TRUE;
+    }
+}
+
+static void spp_sink_close(spp_sink_t *p_sink)
+{
+    if (p_sink->fd >= 0)
+    {
+        close(p_sink->fd);
+    }
+    if (NULL != p_sink->p_uring)
+    {
+        spp_uring_close(p_sink->p_uring);
+    }
+    free(p_sink->p_ring);
+    memset(p_sink, 0, sizeof(*p_sink));
+    p_sink->fd = -1;
+}
+
+/* Writes all of p_data to a descriptor, returns the bytes not written */
+static uint32_t spp_sink_write_fd(int fd, const uint8_t *p_data, uint32_t len)
+{
+    ssize_t written;
+
+    while (0 != len)
+    {
+        written = write(fd, p_data, len);
+        if (written < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            break;
+        }
+        p_data += written;
+        len -= (uint32_t)written;
+    }
+    return len;
+}
+
+/* Must be called with spp_sink_lock held */
+static void spp_sink_ring_write(spp_sink_t *p_sink, const uint8_t *p_data, uint32_t len)
+{
+    uint32_t tail;
+    uint32_t chunk;
+
+    if (len >= p_sink->ring_size)
+    {
+        /* Only the latest ring_size bytes survive */
+        p_data += len - p_sink->ring_size;
+        len = p_sink->ring_size;
+        p_sink->ring_head = 0;
+        p_sink->ring_count = 0;
+    }
+    tail = (p_sink->ring_head + p_sink->ring_count) % p_sink->ring_size;
+    chunk = MIN(len, p_sink->ring_size - tail);
+    memcpy(&p_sink->p_ring[tail], p_data, chunk);
+    memcpy(p_sink->p_ring, p_data + chunk, len - chunk);
+    p_sink->ring_count += len;
+    if (p_sink->ring_count > p_sink->ring_size)
+    {
+        /* Oldest bytes were overwritten */
+        p_sink->ring_head = (p_sink->ring_head + p_sink->ring_count - p_sink->ring_size) %
+                            p_sink->ring_size;
+        p_sink->ring_count = p_sink->ring_size;
+    }
+}
+
+/* Reports the result of a verify sink */
+static void spp_sink_print_verify(uint16_t handle, const spp_sink_t *p_sink)
+{
+    if (0 == p_sink->mismatches)
+    {
+        fprintf(stdout, "rx sink: handle %d verified %llu bytes, no errors\n", handle,
+                (unsigned long long)p_sink->bytes);
+        return;
+    }
+    fprintf(stdout, "rx sink: handle %d verified %llu bytes, %llu differ, first at offset %llu\n", handle,
+            (unsigned long long)p_sink->bytes, (unsigned long long)p_sink->mismatches,
+            (unsigned long long)p_sink->first_mismatch);
+}
+
+/* Must be called with spp_sink_lock held */
+static spp_sink_session_t *spp_sink_find(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != handle) && (spp_sink_sessions[i].handle == handle))
+        {
+            return &spp_sink_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_configure
+ *******************************************************************************
+ * Summary:
+ *   Sets the sink opened for sessions which connect from now on
+ *
+ * Parameters:
+ *   const char *p_spec : "print", "discard", "checksum", "file:<path>",
+ *                        "fd:<n>", "unix:<path>", "tcp:<ipv4>:<port>",
+ *                        "ring[:<bytes>]", "uring:<path>" or "verify"
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the spec is not valid
+ *
+ ******************************************************************************/
+wiced_bool_t spp_sink_configure(const char *p_spec)
+{
+    if ((NULL == p_spec) || (strlen(p_spec) >= SPP_SINK_SPEC_MAX_LEN) ||
+        (SPP_SINK_TYPES == spp_sink_parse_type(p_spec)))
+    {
+        return WICED_FALSE;
+    }
+    pthread_mutex_lock(&spp_sink_lock);
+    strcpy(spp_sink_spec, p_spec);
+    pthread_mutex_unlock(&spp_sink_lock);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_select
+ *******************************************************************************
+ * Summary:
+ *   Replaces the sink of a session. The new sink is opened before the old
+ *   one is closed, so the session keeps its sink if the new one fails.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const char *p_spec : spec string, see spp_sink_configure()
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the new sink is in use
+ *
+ ******************************************************************************/
+wiced_bool_t spp_sink_select(uint16_t handle, const char *p_spec)
+{
+    spp_sink_session_t *p_session;
+    spp_sink_t sink;
+    wiced_bool_t ret = WICED_FALSE;
+
+    if ((NULL == p_spec) || !spp_sink_open(&sink, p_spec))
+    {
+        WICED_BT_TRACE("%s: cannot open sink %s\n", __FUNCTION__, (NULL != p_spec) ? p_spec : "");
+        if (NULL != p_spec)
+        {
+            spp_sink_close(&sink);
+        }
+        return WICED_FALSE;
+    }
+
+    pthread_mutex_lock(&spp_sink_lock);
+    p_session = spp_sink_find(handle);
+    if (NULL != p_session)
+    {
+        spp_sink_close(&p_session->sink);
+        p_session->sink = sink;
+        spp_sink_stats[sink.type].sessions++;
+        ret = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_sink_lock);
+
+    if (!ret)
+    {
+        spp_sink_close(&sink);
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Opens the configured sink for a new session. If it cannot be opened the
+ *   session falls back to the print sink.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sink_connection_up(uint16_t handle)
+{
+    char spec[SPP_SINK_SPEC_MAX_LEN];
+    int i;
+
+    pthread_mutex_lock(&spp_sink_lock);
+    strcpy(spec, spp_sink_spec);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if (0 == spp_sink_sessions[i].handle)
+        {
+            spp_sink_sessions[i].handle = handle;
+            spp_sink_open(&spp_sink_sessions[i].sink, "print");
+            break;
+        }
+    }
+    pthread_mutex_unlock(&spp_sink_lock);
+
+    if ((0 != strcmp(spec, "print")) && !spp_sink_select(handle, spec))
+    {
+        fprintf(stdout, "Cannot open rx sink %s, printing received data instead\n", spec);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Closes the sink of a session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sink_connection_down(uint16_t handle)
+{
+    spp_sink_session_t *p_session;
+
+    pthread_mutex_lock(&spp_sink_lock);
+    p_session = spp_sink_find(handle);
+    if (NULL != p_session)
+    {
+        if (SPP_SINK_CHECKSUM == p_session->sink.type)
+        {
+            fprintf(stdout, "rx sink: handle %d crc32 0x%08x over %llu bytes\n", handle,
+                    p_session->sink.crc ^ 0xFFFFFFFF, (unsigned long long)p_session->sink.bytes);
+        }
+        if (SPP_SINK_VERIFY == p_session->sink.type)
+        {
+            spp_sink_print_verify(handle, &p_session->sink);
+        }
+        spp_sink_close(&p_session->sink);
+        p_session->handle = 0;
+    }
+    pthread_mutex_unlock(&spp_sink_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_rx_data
+ *******************************************************************************
+ * Summary:
+ *   Hands data received on a session to its sink. p_data is only borrowed
+ *   for the duration of the call.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_data : received data
+ *   uint32_t data_len : received data length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sink_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len)
+{
+    spp_sink_session_t *p_session;
+    spp_sink_stats_t *p_stats;
+    spp_sink_t *p_sink;
+    uint64_t start_us = spp_get_time_us();
+    uint32_t mismatches;
+    uint32_t first = 0;
+    uint32_t crc;
+    uint32_t i;
+
+    pthread_mutex_lock(&spp_sink_lock);
+    p_session = spp_sink_find(handle);
+    if ((NULL == p_session) || (0 == data_len))
+    {
+        pthread_mutex_unlock(&spp_sink_lock);
+        return;
+    }
+    p_sink = &p_session->sink;
+    p_stats = &spp_sink_stats[p_sink->type];
+
+    switch (p_sink->type)
+    {
+    case SPP_SINK_PRINT:
+        fprintf(stdout, "%s handle:%d len:%d %02x-%02x, total rx %llu\n", __FUNCTION__, handle,
+                data_len, p_data[0], p_data[data_len - 1],
+                (unsigned long long)(p_sink->bytes + data_len));
+        fprintf(stdout, "data: ");
+        for (i = 0; i < data_len; i++)
+        {
+            fprintf(stdout, " %c ", p_data[i]);
+        }
+        fprintf(stdout, "\n");
+        break;
+
+    case SPP_SINK_CHECKSUM:
+        crc = p_sink->crc;
+        for (i = 0; i < data_len; i++)
+        {
+            crc = spp_sink_crc_table[(crc ^ p_data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        p_sink->crc = crc;
+        break;
+
+    case SPP_SINK_FILE:
+    case SPP_SINK_FD:
+        p_stats->errors += spp_sink_write_fd(p_sink->fd, p_data, data_len);
+        break;
+
+    case SPP_SINK_RING:
+        spp_sink_ring_write(p_sink, p_data, data_len);
+        break;
+
+    case SPP_SINK_URING:
+        p_stats->errors += spp_uring_write(p_sink->p_uring, p_data, data_len);
+        break;
+
+    case SPP_SINK_VERIFY:
+        /* The peer sends the stream from offset 0 on every new session */
+        mismatches = spp_pattern_verify(p_sink->bytes, p_data, data_len, &first);
+        if (0 != mismatches)
+        {
+            if (0 == p_sink->mismatches)
+            {
+                p_sink->first_mismatch = p_sink->bytes + first;
+            }
+            p_sink->mismatches += mismatches;
+            p_stats->errors += mismatches;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (0 == p_sink->bytes)
+    {
+        p_sink->first_us = start_us;
+    }
+    p_sink->last_us = start_us;
+    p_sink->bytes += data_len;
+    p_stats->bytes += data_len;
+    p_stats->writes++;
+    p_stats->busy_us += spp_get_time_us() - start_us;
+    pthread_mutex_unlock(&spp_sink_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_ring_read
+ *******************************************************************************
+ * Summary:
+ *   Removes the oldest bytes held by the ring sink of a session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_buf : receives the data
+ *   uint32_t len : size of p_buf
+ *
+ * Return:
+ *   uint32_t : bytes copied, 0 if the session has no ring sink
+ *
+ ******************************************************************************/
+uint32_t spp_sink_ring_read(uint16_t handle, uint8_t *p_buf, uint32_t len)
+{
+    spp_sink_session_t *p_session;
+    spp_sink_t *p_sink;
+    uint32_t chunk;
+
+    pthread_mutex_lock(&spp_sink_lock);
+    p_session = spp_sink_find(handle);
+    if ((NULL == p_session) || (SPP_SINK_RING != p_session->sink.type))
+    {
+        pthread_mutex_unlock(&spp_sink_lock);
+        return 0;
+    }
+    p_sink = &p_session->sink;
+    len = MIN(len, p_sink->ring_count);
+    chunk = MIN(len, p_sink->ring_size - p_sink->ring_head);
+    memcpy(p_buf, &p_sink->p_ring[p_sink->ring_head], chunk);
+    memcpy(p_buf + chunk, p_sink->p_ring, len - chunk);
+    p_sink->ring_head = (p_sink->ring_head + len) % p_sink->ring_size;
+    p_sink->ring_count -= len;
+    pthread_mutex_unlock(&spp_sink_lock);
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_checksum
+ *******************************************************************************
+ * Summary:
+ *   Returns the CRC-32 of the data received so far by a checksum sink
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   uint32_t : CRC-32, 0 if the session has no checksum sink
+ *
+ ******************************************************************************/
+uint32_t spp_sink_checksum(uint16_t handle)
+{
+    spp_sink_session_t *p_session;
+    uint32_t crc = 0;
+
+    pthread_mutex_lock(&spp_sink_lock);
+    p_session = spp_sink_find(handle);
+    if ((NULL != p_session) && (SPP_SINK_CHECKSUM == p_session->sink.type))
+    {
+        crc = p_session->sink.crc ^ 0xFFFFFFFF;
+    }
+    pthread_mutex_unlock(&spp_sink_lock);
+    return crc;
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the counters of a sink type
+ *
+ * Parameters:
+ *   spp_sink_type_t type : sink type
+ *   spp_sink_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sink_get_stats(spp_sink_type_t type, spp_sink_stats_t *p_stats)
+{
+    memset(p_stats, 0, sizeof(*p_stats));
+    if (type < SPP_SINK_TYPES)
+    {
+        pthread_mutex_lock(&spp_sink_lock);
+        *p_stats = spp_sink_stats[type];
+        pthread_mutex_unlock(&spp_sink_lock);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_sink_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the counters of every sink type in use and the receive rate of
+ *   every session. The in-sink rate is the rate the sink itself sustains,
+ *   the session rate is the one the link delivered.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_sink_print_stats(void)
+{
+    spp_sink_session_t *p_session;
+    spp_sink_stats_t stats;
+    uint64_t elapsed_us;
+    int i;
+
+    fprintf(stdout, "sink: new sessions use \"%s\"\n", spp_sink_spec);
+    for (i = 0; i < SPP_SINK_TYPES; i++)
+    {
+        spp_sink_get_stats(i, &stats);
+        if (0 == stats.sessions + stats.bytes)
+        {
+            continue;
+        }
+        fprintf(stdout, "sink: %-8s sessions %u, %llu bytes in %llu writes, errors %llu, in-sink %.1f MB/s\n",
+                spp_sink_names[i], stats.sessions, (unsigned long long)stats.bytes,
+                (unsigned long long)stats.writes, (unsigned long long)stats.errors,
+                (0 != stats.busy_us) ? (double)stats.bytes / stats.busy_us : 0.0);
+        if (SPP_SINK_URING == i)
+        {
+            spp_uring_print_stats();
+        }
+    }
+
+    pthread_mutex_lock(&spp_sink_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        p_session = &spp_sink_sessions[i];
+        if (0 == p_session->handle)
+        {
+            continue;
+        }
+        elapsed_us = p_session->sink.last_us - p_session->sink.first_us;
+        fprintf(stdout, "sink: handle %d \"%s\" %llu bytes, %.1f kB/s", p_session->handle,
+                p_session->sink.spec, (unsigned long long)p_session->sink.bytes,
+                (0 != elapsed_us) ? (double)p_session->sink.bytes * 1000.0 / elapsed_us : 0.0);
+        if (SPP_SINK_CHECKSUM == p_session->sink.type)
+        {
+            fprintf(stdout, ", crc32 0x%08x", p_session->sink.crc ^ 0xFFFFFFFF);
+        }
+        if (SPP_SINK_RING == p_session->sink.type)
+        {
+            fprintf(stdout, ", ring %u of %u bytes", p_session->sink.ring_count,
+                    p_session->sink.ring_size);
+        }
+        if (SPP_SINK_VERIFY == p_session->sink.type)
+        {
+            fprintf(stdout, ", %llu bytes differ", (unsigned long long)p_session->sink.mismatches);
+        }
+        fprintf(stdout, "\n");
+    }
+    pthread_mutex_unlock(&spp_sink_lock);
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,527 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_startup.c
+ *
+ * Description: Startup path of the application: skips the firmware patch
+ *              download when the controller already runs the same patch,
+ *              and reports how long each startup stage took.
+ *
+ *              The patch lives in controller RAM and survives a restart of
+ *              the application, but not a power cycle. After a download the
+ *              patch build reported by the controller is stored in a cache
+ *              file, together with a hash of the .hcd file. On the next
+ *              start, before the porting layer resets the controller, the
+ *              HCI UART is opened at the operational baud rate and the build
+ *              is read again. If both the build and the .hcd hash match, the
+ *              application asks the porting layer for no download and no
+ *              GPIO reset, so the controller keeps running its patch at the
+ *              operational baud rate.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_dev.h"
+#include "spp.h"
+#include "spp_startup.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define SPP_STARTUP_FNV_OFFSET                  ( 0x811C9DC5u )
+#define SPP_STARTUP_FNV_PRIME                   ( 0x01000193u )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    uint32_t patch_size;
+    uint32_t patch_hash;
+    uint8_t build_id[SPP_STARTUP_MAX_BUILD_ID];
+    uint8_t build_id_len;
+} spp_startup_identity_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static uint64_t spp_startup_us[SPP_STARTUP_STAGES];
+static const char *spp_startup_cache_path = NULL;
+static const char *spp_startup_log_path = NULL;
+static spp_startup_patch_t spp_startup_patch = SPP_STARTUP_PATCH_NONE;
+static spp_startup_identity_t spp_startup_identity;
+
+static const char *spp_startup_stage_names[SPP_STARTUP_STAGES] =
+{
+    "begin",
+    "probe",
+    "reset, autobaud and patch download",
+    "stack init",
+    "stack enable",
+    "application init",
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: spp_startup_mark
+ *******************************************************************************
+ * Summary:
+ *   Records the time a startup stage was reached. Reaching
+ *   SPP_STARTUP_READY prints the breakdown.
+ *
+ * Parameters:
+ *   spp_startup_stage_t stage : stage reached
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_startup_mark(spp_startup_stage_t stage)
+{
+    if ((stage >= SPP_STARTUP_STAGES) || (0 != spp_startup_us[stage]))
+    {
+        /* Only the first time counts, the stack may be enabled again */
+        return;
+    }
+    spp_startup_us[stage] = spp_get_time_us();
+    if (SPP_STARTUP_READY == stage)
+    {
+        spp_startup_print_stats();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_configure_cache / spp_startup_configure_log
+ *******************************************************************************
+ * Summary:
+ *   Sets the file which remembers the downloaded patch, which enables the
+ *   download skip, and the file the startup timings are appended to
+ *
+ * Parameters:
+ *   const char *p_path : file path, kept by reference
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_startup_configure_cache(const char *p_path)
+{
+    spp_startup_cache_path = p_path;
+}
+
+void spp_startup_configure_log(const char *p_path)
+{
+    spp_startup_log_path = p_path;
+}
+
+static wiced_bool_t spp_startup_hash_patch(const char *p_patch_file, spp_startup_identity_t *p_identity)
+{
+    uint8_t buffer[4096];
+    uint32_t hash = SPP_STARTUP_FNV_OFFSET;
+    uint32_t size = 0;
+    size_t got;
+    size_t i;
+    FILE *p_file = fopen(p_patch_file, "rb");
+
+    if (NULL == p_file)
+    {
+        return WICED_FALSE;
+    }
+    while (0 != (got = fread(buffer, 1, sizeof(buffer), p_file)))
+    {
+        for (i = 0; i < got; i++)
+        {
+            hash = (hash ^ buffer[i]) * SPP_STARTUP_FNV_PRIME;
+        }
+        size += (uint32_t)got;
+    }
+    fclose(p_file);
+    p_identity->patch_size = size;
+    p_identity->patch_hash = hash;
+    return WICED_TRUE;
+}
+
+static speed_t spp_startup_speed(uint32_t baudrate)
+{
+    switch (baudrate)
+    {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    case 3000000: return B3000000;
+    case 4000000: return B4000000;
+    default: return B0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_read_build
+ *******************************************************************************
+ * Summary:
+ *   Reads the patch build from the controller over the HCI UART, before the
+ *   porting layer opens it
+ *
+ * Parameters:
+ *   const char *p_hci_port : HCI UART device
+ *   uint32_t baudrate : operational baud rate
+ *   spp_startup_identity_t *p_identity : receives the build
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the controller answered
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_startup_read_build(const char *p_hci_port, uint32_t baudrate,
+                                           spp_startup_identity_t *p_identity)
+{
+    static const uint8_t command[] = { 0x01, SPP_STARTUP_READ_BUILD_OPCODE & 0xFF,
+                                       SPP_STARTUP_READ_BUILD_OPCODE >> 8, 0x00 };
+    uint8_t event[3 + 255];
+    uint32_t event_len = 0;
+    uint64_t deadline_us = spp_get_time_us() + SPP_STARTUP_PROBE_TIMEOUT_MS * 1000;
+    uint64_t now_us;
+    struct termios tio;
+    struct pollfd pfd;
+    wiced_bool_t answered = WICED_FALSE;
+    speed_t speed = spp_startup_speed(baudrate);
+    ssize_t got;
+    int fd;
+
+    if (B0 == speed)
+    {
+        WICED_BT_TRACE("%s: unsupported baud rate %u\n", __FUNCTION__, baudrate);
+        return WICED_FALSE;
+    }
+    fd = open(p_hci_port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        return WICED_FALSE;
+    }
+    if (0 == tcgetattr(fd, &tio))
+    {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CRTSCTS | CLOCAL | CREAD;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+
+    if (sizeof(command) == write(fd, command, sizeof(command)))
+    {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        while ((now_us = spp_get_time_us()) < deadline_us)
+        {
+            if (poll(&pfd, 1, (int)((deadline_us - now_us + 999) / 1000)) <= 0)
+            {
+                break;
+            }
+            got = read(fd, &event[event_len], sizeof(event) - event_len);
+            if (got <= 0)
+            {
+                break;
+            }
+            event_len += (uint32_t)got;
+            /* Anything before the H4 event indicator is line noise */
+            while ((0 != event_len) && (0x04 != event[0]))
+            {
+                memmove(event, &event[1], --event_len);
+            }
+            if ((event_len < 3) || (event_len < 3u + event[2]))
+            {
+                continue;
+            }
+            /* Command Complete: type, code, length, credits, opcode, status */
+            if ((0x0E == event[1]) && (event[2] >= 4) &&
+                ((SPP_STARTUP_READ_BUILD_OPCODE & 0xFF) == event[4]) &&
+                ((SPP_STARTUP_READ_BUILD_OPCODE >> 8) == event[5]) && (0 == event[6]))
+            {
+                p_identity->build_id_len = (uint8_t)MIN(event[2] - 4, SPP_STARTUP_MAX_BUILD_ID);
+                memcpy(p_identity->build_id, &event[7], p_identity->build_id_len);
+                answered = WICED_TRUE;
+                break;
+            }
+            /* Another event, drop it and keep waiting */
+            event_len -= 3u + event[2];
+            memmove(event, &event[3 + event[2]], event_len);
+        }
+    }
+    close(fd);
+    return answered;
+}
+
+static wiced_bool_t spp_startup_read_cache(spp_startup_identity_t *p_identity)
+{
+    char build_hex[2 * SPP_STARTUP_MAX_BUILD_ID + 1];
+    unsigned int byte;
+    size_t i;
+    FILE *p_file = fopen(spp_startup_cache_path, "r");
+    int fields;
+
+    if (NULL == p_file)
+    {
+        return WICED_FALSE;
+    }
+    memset(p_identity, 0, sizeof(*p_identity));
+    build_hex[0] = '\0';
+    fields = fscanf(p_file, "%u %x %64s", &p_identity->patch_size, &p_identity->patch_hash, build_hex);
+    fclose(p_file);
+    if (fields < 2)
+    {
+        return WICED_FALSE;
+    }
+    for (i = 0; (3 == fields) && (2 * i + 1 < strlen(build_hex)); i++)
+    {
+        sscanf(&build_hex[2 * i], "%2x", &byte);
+        p_identity->build_id[p_identity->build_id_len++] = (uint8_t)byte;
+    }
+    return WICED_TRUE;
+}
+
+static void spp_startup_write_cache(const spp_startup_identity_t *p_identity)
+{
+    FILE *p_file = fopen(spp_startup_cache_path, "w");
+    int i;
+
+    if (NULL == p_file)
+    {
+        WICED_BT_TRACE("%s: cannot write %s\n", __FUNCTION__, spp_startup_cache_path);
+        return;
+    }
+    fprintf(p_file, "%u %08x ", p_identity->patch_size, p_identity->patch_hash);
+    for (i = 0; i < p_identity->build_id_len; i++)
+    {
+        fprintf(p_file, "%02x", p_identity->build_id[i]);
+    }
+    fprintf(p_file, "\n");
+    fclose(p_file);
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_probe
+ *******************************************************************************
+ * Summary:
+ *   Decides whether the patch download can be skipped: the patch cache is
+ *   configured, the .hcd file is the one last downloaded, and the controller
+ *   answers at the operational baud rate with the build recorded after that
+ *   download.
+ *
+ * Parameters:
+ *   const char *p_hci_port : HCI UART device
+ *   uint32_t baudrate : operational baud rate
+ *   const char *p_patch_file : .hcd file, empty if none
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the download is to be skipped
+ *
+ ******************************************************************************/
+wiced_bool_t spp_startup_probe(const char *p_hci_port, uint32_t baudrate, const char *p_patch_file)
+{
+    spp_startup_identity_t cached;
+    spp_startup_identity_t running;
+    wiced_bool_t skip = WICED_FALSE;
+
+    memset(&spp_startup_identity, 0, sizeof(spp_startup_identity));
+    spp_startup_patch = SPP_STARTUP_PATCH_NONE;
+    if ((NULL == p_patch_file) || ('\0' == p_patch_file[0]))
+    {
+        spp_startup_mark(SPP_STARTUP_PROBED);
+        return WICED_FALSE;
+    }
+    spp_startup_patch = SPP_STARTUP_PATCH_DOWNLOADED;
+    if ((NULL == spp_startup_cache_path) ||
+        !spp_startup_hash_patch(p_patch_file, &spp_startup_identity))
+    {
+        spp_startup_mark(SPP_STARTUP_PROBED);
+        return WICED_FALSE;
+    }
+
+    if (spp_startup_read_cache(&cached) &&
+        (cached.patch_size == spp_startup_identity.patch_size) &&
+        (cached.patch_hash == spp_startup_identity.patch_hash))
+    {
+        memset(&running, 0, sizeof(running));
+        if (spp_startup_read_build(p_hci_port, baudrate, &running) &&
+            (running.build_id_len == cached.build_id_len) &&
+            (0 == memcmp(running.build_id, cached.build_id, cached.build_id_len)))
+        {
+            skip = WICED_TRUE;
+            spp_startup_patch = SPP_STARTUP_PATCH_SKIPPED;
+        }
+        fprintf(stdout, "Patch %s: controller %s\n", skip ? "download skipped" : "will be downloaded",
+                skip ? "already runs it" : "runs another build or did not answer");
+    }
+    spp_startup_mark(SPP_STARTUP_PROBED);
+    return skip;
+}
+
+static void spp_startup_build_read(wiced_bt_dev_vendor_specific_command_complete_params_t *p_params)
+{
+    if ((NULL == p_params) || (p_params->param_len < 1) || (0 != p_params->p_param_buf[0]))
+    {
+        WICED_BT_TRACE("%s: build not read, patch cache not updated\n", __FUNCTION__);
+        return;
+    }
+    spp_startup_identity.build_id_len = (uint8_t)MIN(p_params->param_len - 1, SPP_STARTUP_MAX_BUILD_ID);
+    memcpy(spp_startup_identity.build_id, &p_params->p_param_buf[1], spp_startup_identity.build_id_len);
+    spp_startup_write_cache(&spp_startup_identity);
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_stack_enabled
+ *******************************************************************************
+ * Summary:
+ *   Called on BTM_ENABLED_EVT. After a download, reads the patch build
+ *   through the stack and records it in the patch cache.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_startup_stack_enabled(void)
+{
+    spp_startup_mark(SPP_STARTUP_ENABLED);
+    if ((SPP_STARTUP_PATCH_DOWNLOADED == spp_startup_patch) && (NULL != spp_startup_cache_path) &&
+        (0 != spp_startup_identity.patch_size))
+    {
+        if (WICED_BT_PENDING != wiced_bt_dev_vendor_specific_command(SPP_STARTUP_READ_BUILD_OPCODE, 0, NULL,
+                                                                     spp_startup_build_read))
+        {
+            WICED_BT_TRACE("%s: build read not sent\n", __FUNCTION__);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_get_patch / spp_startup_get_stage_us
+ *******************************************************************************
+ * Summary:
+ *   Returns what happened to the patch, and the time spent reaching a stage
+ *   from the previous one
+ *
+ * Parameters:
+ *   spp_startup_stage_t stage : stage
+ *
+ * Return:
+ *   spp_startup_patch_t / uint32_t : microseconds, 0 if not reached
+ *
+ ******************************************************************************/
+spp_startup_patch_t spp_startup_get_patch(void)
+{
+    return spp_startup_patch;
+}
+
+uint32_t spp_startup_get_stage_us(spp_startup_stage_t stage)
+{
+    if ((stage <= SPP_STARTUP_BEGIN) || (stage >= SPP_STARTUP_STAGES) ||
+        (0 == spp_startup_us[stage]) || (0 == spp_startup_us[stage - 1]) ||
+        (spp_startup_us[stage] < spp_startup_us[stage - 1]))
+    {
+        return 0;
+    }
+    return (uint32_t)(spp_startup_us[stage] - spp_startup_us[stage - 1]);
+}
+
+/*******************************************************************************
+ * Function Name: spp_startup_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the time of each startup stage, and appends them as one JSON
+ *   line to the startup log if one is configured
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_startup_print_stats(void)
+{
+    static const char *patch_names[] = { "none", "downloaded", "skipped" };
+    FILE *p_log = NULL;
+    int stage;
+
+    if (0 == spp_startup_us[SPP_STARTUP_BEGIN])
+    {
+        return;
+    }
+    fprintf(stdout, "startup: patch %s\n", patch_names[spp_startup_patch]);
+    for (stage = SPP_STARTUP_PROBED; stage < SPP_STARTUP_STAGES; stage++)
+    {
+        fprintf(stdout, "startup: %-36s %8u us\n", spp_startup_stage_names[stage],
+                spp_startup_get_stage_us((spp_startup_stage_t)stage));
+    }
+    if (0 != spp_startup_us[SPP_STARTUP_READY])
+    {
+        fprintf(stdout, "startup: %-36s %8llu us\n", "total",
+                (unsigned long long)(spp_startup_us[SPP_STARTUP_READY] - spp_startup_us[SPP_STARTUP_BEGIN]));
+    }
+
+    if ((NULL == spp_startup_log_path) || (0 == spp_startup_us[SPP_STARTUP_READY]) ||
+        (NULL == (p_log = fopen(spp_startup_log_path, "a"))))
+    {
+        return;
+    }
+    fprintf(p_log, "{\"patch\": \"%s\", \"probe_us\": %u, \"transport_us\": %u, \"stack_init_us\": %u, "
+            "\"stack_enable_us\": %u, \"app_init_us\": %u, \"total_us\": %llu}\n",
+            patch_names[spp_startup_patch], spp_startup_get_stage_us(SPP_STARTUP_PROBED),
+            spp_startup_get_stage_us(SPP_STARTUP_TRANSPORT_UP), spp_startup_get_stage_us(SPP_STARTUP_STACK_INIT),
+            spp_startup_get_stage_us(SPP_STARTUP_ENABLED), spp_startup_get_stage_us(SPP_STARTUP_READY),
+            (unsigned long long)(spp_startup_us[SPP_STARTUP_READY] - spp_startup_us[SPP_STARTUP_BEGIN]));
+    fclose(p_log);
+    /* Appended once per run */
+    spp_startup_log_path = NULL;
+}
+
+/* END OF FILE [] */
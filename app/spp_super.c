@@ -0,0 +1,909 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_super.c
+ *
+ * Description: Supervisor of several controllers.
+ *
+ *              One process drives one controller, and one controller is
+ *              limited to a few links. With --supervise <config> the
+ *              process drives no controller itself. It starts one worker
+ *              process per line of the configuration file, each with its
+ *              own porting layer options (UART, REG_ON GPIO, BD address,
+ *              ...) and its own control socket, <socket>.<n> next to the
+ *              --daemon <socket> of the supervisor. The workers get the
+ *              --daemon-group and --daemon-files of the supervisor too.
+ *
+ *              Every SPP_SUPER_POLL_MS the supervisor reads the sessions and
+ *              statistics of each worker over its control socket. Only the
+ *              least loaded worker answers inquiries, so new peers pair with
+ *              it. The others stay connectable for their bonded peers.
+ *
+ *              A worker which exits is restarted after a backoff, the other
+ *              workers carry on. The supervisor socket answers LIST and
+ *              STATS (see spp_ctl.h) for all workers at once, one request
+ *              per connection. Data is sent through the worker sockets.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "spp.h"
+#include "spp_ctl.h"
+#include "spp_super.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Largest response read from a worker */
+#define SPP_SUPER_MAX_RESPONSE_LEN              ( 64 * 1024 )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SPP_SUPER_WORKER_STOPPED,
+    SPP_SUPER_WORKER_RUNNING,
+    SPP_SUPER_WORKER_WAITING,    /* exited, restarts at restart_us */
+} spp_super_state_t;
+
+typedef struct
+{
+    char *p_line;                /* configuration line, split into argv */
+    char *argv[SPP_SUPER_MAX_ARGS + 8];
+    char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    spp_super_state_t state;
+    pid_t pid;
+    uint64_t start_us;
+    uint64_t restart_us;
+    uint32_t backoff_ms;
+    uint32_t restarts;
+    int ctl_fd;                  /* connection to the worker's control socket */
+    int hidden;                  /* -1 until set */
+    int sessions;                /* -1 until read */
+    char *p_list_json;           /* last responses, NULL until read */
+    char *p_stats_json;
+} spp_super_worker_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *const spp_super_state_names[] = { "stopped", "running", "waiting" };
+
+static spp_super_worker_t spp_super_workers[SPP_SUPER_MAX_WORKERS];
+static int spp_super_worker_count = 0;
+static wiced_bool_t spp_super_enabled = WICED_FALSE;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_super_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t spp_super_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Sums the values of every occurrence of "key": in a JSON text */
+static uint64_t spp_super_json_sum(const char *p_json, const char *p_key)
+{
+    char pattern[64];
+    const char *p = p_json;
+    uint64_t sum = 0;
+    size_t len;
+
+    len = (size_t)snprintf(pattern, sizeof(pattern), "\"%s\":", p_key);
+    while ((NULL != p) && (NULL != (p = strstr(p, pattern))))
+    {
+        p += len;
+        sum += strtoull(p, NULL, 10);
+    }
+    return sum;
+}
+
+static void spp_super_worker_disconnect(spp_super_worker_t *p_worker)
+{
+    if (p_worker->ctl_fd >= 0)
+    {
+        close(p_worker->ctl_fd);
+        p_worker->ctl_fd = -1;
+    }
+    free(p_worker->p_list_json);
+    free(p_worker->p_stats_json);
+    p_worker->p_list_json = NULL;
+    p_worker->p_stats_json = NULL;
+    p_worker->hidden = -1;
+    p_worker->sessions = -1;
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_exchange
+ *******************************************************************************
+ * Summary:
+ *   Sends one request and reads its response on a blocking socket with
+ *   timeouts
+ *
+ * Parameters:
+ *   int fd : control socket
+ *   uint8_t op : request
+ *   const uint8_t *p_payload : request payload, may be NULL
+ *   uint32_t len : payload length
+ *   char **pp_response : set to the NUL terminated response payload, which
+ *                        the caller frees, may be NULL
+ *
+ * Return:
+ *   int : response status, -1 if the exchange failed
+ *
+ ******************************************************************************/
+static int spp_super_exchange(int fd, uint8_t op, const uint8_t *p_payload, uint32_t len, char **pp_response)
+{
+    uint8_t hdr[SPP_CTL_HDR_LEN];
+    char *p_response;
+    uint32_t got;
+    ssize_t n;
+
+    spp_super_put_u32(hdr, len);
+    hdr[4] = op;
+    memset(&hdr[5], 0, 3);
+    if ((SPP_CTL_HDR_LEN != send(fd, hdr, SPP_CTL_HDR_LEN, MSG_NOSIGNAL)) ||
+        ((0 != len) && ((ssize_t)len != send(fd, p_payload, len, MSG_NOSIGNAL))))
+    {
+        return -1;
+    }
+    for (got = 0; got < SPP_CTL_HDR_LEN; got += (uint32_t)n)
+    {
+        n = recv(fd, hdr + got, SPP_CTL_HDR_LEN - got, 0);
+        if (n <= 0)
+        {
+            return -1;
+        }
+    }
+    len = spp_super_get_u32(hdr);
+    if ((hdr[4] != op) || (len > SPP_SUPER_MAX_RESPONSE_LEN) || (NULL == (p_response = malloc(len + 1))))
+    {
+        return -1;
+    }
+    for (got = 0; got < len; got += (uint32_t)n)
+    {
+        n = recv(fd, p_response + got, len - got, 0);
+        if (n <= 0)
+        {
+            free(p_response);
+            return -1;
+        }
+    }
+    p_response[len] = '\0';
+    if (NULL != pp_response)
+    {
+        *pp_response = p_response;
+    }
+    else
+    {
+        free(p_response);
+    }
+    return hdr[5];
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_worker_poll
+ *******************************************************************************
+ * Summary:
+ *   Reads the sessions and statistics of a running worker, connecting to
+ *   its control socket first if needed
+ *
+ * Parameters:
+ *   spp_super_worker_t *p_worker : worker
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_worker_poll(spp_super_worker_t *p_worker)
+{
+    struct sockaddr_un addr;
+    struct timeval timeout;
+    char *p_list = NULL;
+    char *p_stats = NULL;
+    const char *p;
+    int sessions = 0;
+
+    if (p_worker->ctl_fd < 0)
+    {
+        p_worker->ctl_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (p_worker->ctl_fd < 0)
+        {
+            return;
+        }
+        timeout.tv_sec = SPP_SUPER_QUERY_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (SPP_SUPER_QUERY_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(p_worker->ctl_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(p_worker->ctl_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, p_worker->socket_path, sizeof(addr.sun_path));
+        if (0 != connect(p_worker->ctl_fd, (struct sockaddr *)&addr, sizeof(addr)))
+        {
+            /* Not serving yet, the stack is still starting */
+            close(p_worker->ctl_fd);
+            p_worker->ctl_fd = -1;
+            return;
+        }
+    }
+    if ((SPP_CTL_STATUS_OK != spp_super_exchange(p_worker->ctl_fd, SPP_CTL_OP_LIST, NULL, 0, &p_list)) ||
+        (SPP_CTL_STATUS_OK != spp_super_exchange(p_worker->ctl_fd, SPP_CTL_OP_STATS, NULL, 0, &p_stats)))
+    {
+        free(p_list);
+        spp_super_worker_disconnect(p_worker);
+        return;
+    }
+    for (p = p_list; NULL != (p = strstr(p, "\"handle\":")); p++)
+    {
+        sessions++;
+    }
+    free(p_worker->p_list_json);
+    free(p_worker->p_stats_json);
+    p_worker->p_list_json = p_list;
+    p_worker->p_stats_json = p_stats;
+    p_worker->sessions = sessions;
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_balance
+ *******************************************************************************
+ * Summary:
+ *   Lets only the worker with the fewest sessions answer inquiries
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_balance(void)
+{
+    spp_super_worker_t *p_worker;
+    uint8_t hidden;
+    int target = -1;
+    int i;
+
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        p_worker = &spp_super_workers[i];
+        if ((p_worker->sessions >= 0) &&
+            ((target < 0) || (p_worker->sessions < spp_super_workers[target].sessions)))
+        {
+            target = i;
+        }
+    }
+    for (i = 0; (target >= 0) && (i < spp_super_worker_count); i++)
+    {
+        p_worker = &spp_super_workers[i];
+        hidden = (i != target) ? 1 : 0;
+        if ((p_worker->sessions < 0) || (p_worker->hidden == hidden))
+        {
+            continue;
+        }
+        if (SPP_CTL_STATUS_OK != spp_super_exchange(p_worker->ctl_fd, SPP_CTL_OP_SET_HIDDEN, &hidden, 1, NULL))
+        {
+            spp_super_worker_disconnect(p_worker);
+            continue;
+        }
+        if (!hidden)
+        {
+            fprintf(stdout, "supervisor: new peers go to worker %d (%d sessions)\n", i, p_worker->sessions);
+        }
+        p_worker->hidden = hidden;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_worker_start
+ *******************************************************************************
+ * Summary:
+ *   Starts the worker process, this executable run headless with the
+ *   options of its configuration line
+ *
+ * Parameters:
+ *   spp_super_worker_t *p_worker : worker
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_worker_start(spp_super_worker_t *p_worker)
+{
+    sigset_t mask;
+    pid_t pid;
+    int fd;
+
+    pid = fork();
+    if (0 == pid)
+    {
+        /* Signals blocked for the supervisor's signalfd are not inherited */
+        sigemptyset(&mask);
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+        fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0)
+        {
+            dup2(fd, STDIN_FILENO);
+            close(fd);
+        }
+        execv("/proc/self/exe", p_worker->argv);
+        execvp(p_worker->argv[0], p_worker->argv);
+        _exit(127);
+    }
+    if (pid < 0)
+    {
+        fprintf(stderr, "supervisor: cannot start worker %d: %s\n",
+                (int)(p_worker - spp_super_workers), strerror(errno));
+        p_worker->state = SPP_SUPER_WORKER_WAITING;
+        p_worker->restart_us = spp_get_time_us() + (uint64_t)p_worker->backoff_ms * 1000;
+        return;
+    }
+    p_worker->pid = pid;
+    p_worker->state = SPP_SUPER_WORKER_RUNNING;
+    p_worker->start_us = spp_get_time_us();
+    fprintf(stdout, "supervisor: worker %d started, pid %d, socket %s\n",
+            (int)(p_worker - spp_super_workers), (int)pid, p_worker->socket_path);
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_reap
+ *******************************************************************************
+ * Summary:
+ *   Collects the workers which exited and schedules their restart
+ *
+ * Parameters:
+ *   wiced_bool_t restart : WICED_FALSE while shutting down
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_reap(wiced_bool_t restart)
+{
+    spp_super_worker_t *p_worker;
+    uint64_t now_us;
+    pid_t pid;
+    int status;
+    int i;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        for (i = 0; (i < spp_super_worker_count) && (spp_super_workers[i].pid != pid); i++)
+        {
+        }
+        if (i == spp_super_worker_count)
+        {
+            continue;
+        }
+        p_worker = &spp_super_workers[i];
+        now_us = spp_get_time_us();
+        p_worker->pid = 0;
+        spp_super_worker_disconnect(p_worker);
+        if (!restart)
+        {
+            p_worker->state = SPP_SUPER_WORKER_STOPPED;
+            continue;
+        }
+        if (now_us - p_worker->start_us >= (uint64_t)SPP_SUPER_STABLE_MS * 1000)
+        {
+            p_worker->backoff_ms = SPP_SUPER_RESTART_MIN_MS;
+        }
+        p_worker->state = SPP_SUPER_WORKER_WAITING;
+        p_worker->restart_us = now_us + (uint64_t)p_worker->backoff_ms * 1000;
+        if (WIFSIGNALED(status))
+        {
+            fprintf(stdout, "supervisor: worker %d killed by signal %d, restart in %u ms\n",
+                    i, WTERMSIG(status), p_worker->backoff_ms);
+        }
+        else
+        {
+            fprintf(stdout, "supervisor: worker %d exited with status %d, restart in %u ms\n",
+                    i, WEXITSTATUS(status), p_worker->backoff_ms);
+        }
+        p_worker->backoff_ms = MIN(p_worker->backoff_ms * 2, SPP_SUPER_RESTART_MAX_MS);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_status_json
+ *******************************************************************************
+ * Summary:
+ *   Writes the sessions (LIST) or the statistics (STATS) of all workers
+ *
+ * Parameters:
+ *   FILE *p_out : stream to write to
+ *   uint8_t op : SPP_CTL_OP_LIST or SPP_CTL_OP_STATS
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_status_json(FILE *p_out, uint8_t op)
+{
+    spp_super_worker_t *p_worker;
+    uint32_t running = 0;
+    uint32_t sessions = 0;
+    uint32_t restarts = 0;
+    uint64_t tx_bytes = 0;
+    uint64_t rx_bytes = 0;
+    int i;
+
+    fprintf(p_out, (SPP_CTL_OP_LIST == op) ? "[" : "{\"workers\":[");
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        p_worker = &spp_super_workers[i];
+        fprintf(p_out, "%s{\"worker\":%d,\"socket\":\"%s\",", (0 != i) ? "," : "", i, p_worker->socket_path);
+        if (SPP_CTL_OP_LIST == op)
+        {
+            fprintf(p_out, "\"sessions\":%s}", (NULL != p_worker->p_list_json) ? p_worker->p_list_json : "[]");
+            continue;
+        }
+        fprintf(p_out, "\"state\":\"%s\",\"pid\":%d,\"restarts\":%u,\"sessions\":%d,\"hidden\":%d,\"stats\":%s}",
+                spp_super_state_names[p_worker->state], (int)p_worker->pid, p_worker->restarts,
+                p_worker->sessions, p_worker->hidden,
+                (NULL != p_worker->p_stats_json) ? p_worker->p_stats_json : "null");
+        running += (SPP_SUPER_WORKER_RUNNING == p_worker->state) ? 1 : 0;
+        sessions += (p_worker->sessions > 0) ? (uint32_t)p_worker->sessions : 0;
+        restarts += p_worker->restarts;
+        if (NULL != p_worker->p_stats_json)
+        {
+            tx_bytes += spp_super_json_sum(p_worker->p_stats_json, "tx_bytes");
+            rx_bytes += spp_super_json_sum(p_worker->p_stats_json, "rx_bytes");
+        }
+    }
+    if (SPP_CTL_OP_LIST == op)
+    {
+        fprintf(p_out, "]");
+        return;
+    }
+    fprintf(p_out, "],\"totals\":{\"workers\":%d,\"running\":%u,\"sessions\":%u,\"restarts\":%u,"
+            "\"tx_bytes\":%llu,\"rx_bytes\":%llu}}",
+            spp_super_worker_count, running, sessions, restarts,
+            (unsigned long long)tx_bytes, (unsigned long long)rx_bytes);
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_serve
+ *******************************************************************************
+ * Summary:
+ *   Answers one request of a client of the supervisor socket
+ *
+ * Parameters:
+ *   int listen_fd : supervisor socket
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_serve(int listen_fd)
+{
+    struct timeval timeout = { 0, SPP_SUPER_QUERY_TIMEOUT_MS * 1000 };
+    uint8_t hdr[SPP_CTL_HDR_LEN];
+    char *p_json = NULL;
+    size_t json_len = 0;
+    uint8_t status = SPP_CTL_STATUS_OK;
+    FILE *p_out;
+    int fd;
+
+    fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+    if (!spp_ctl_peer_allowed(fd))
+    {
+        close(fd);
+        return;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (SPP_CTL_HDR_LEN != recv(fd, hdr, SPP_CTL_HDR_LEN, MSG_WAITALL))
+    {
+        close(fd);
+        return;
+    }
+    if ((0 != spp_super_get_u32(hdr)) ||
+        ((SPP_CTL_OP_LIST != hdr[4]) && (SPP_CTL_OP_STATS != hdr[4])))
+    {
+        /* Data goes through the worker sockets */
+        status = SPP_CTL_STATUS_BAD_REQUEST;
+    }
+    else if (NULL != (p_out = open_memstream(&p_json, &json_len)))
+    {
+        spp_super_status_json(p_out, hdr[4]);
+        fclose(p_out);
+    }
+    else
+    {
+        status = SPP_CTL_STATUS_NO_RESOURCES;
+    }
+    spp_super_put_u32(hdr, (uint32_t)json_len);
+    hdr[5] = status;
+    if ((SPP_CTL_HDR_LEN == send(fd, hdr, SPP_CTL_HDR_LEN, MSG_NOSIGNAL)) && (0 != json_len))
+    {
+        send(fd, p_json, json_len, MSG_NOSIGNAL);
+    }
+    free(p_json);
+    close(fd);
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_stop
+ *******************************************************************************
+ * Summary:
+ *   Stops the workers, killing those which do not exit in time
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_super_stop(void)
+{
+    uint64_t deadline_us = spp_get_time_us() + (uint64_t)SPP_SUPER_STOP_TIMEOUT_MS * 1000;
+    wiced_bool_t running;
+    int i;
+
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        if (SPP_SUPER_WORKER_RUNNING == spp_super_workers[i].state)
+        {
+            kill(spp_super_workers[i].pid, SIGTERM);
+        }
+        else
+        {
+            spp_super_workers[i].state = SPP_SUPER_WORKER_STOPPED;
+        }
+    }
+    do
+    {
+        spp_super_reap(WICED_FALSE);
+        running = WICED_FALSE;
+        for (i = 0; i < spp_super_worker_count; i++)
+        {
+            running |= (SPP_SUPER_WORKER_RUNNING == spp_super_workers[i].state);
+        }
+        if (running)
+        {
+            usleep(10000);
+        }
+    } while (running && (spp_get_time_us() < deadline_us));
+
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        if (SPP_SUPER_WORKER_RUNNING == spp_super_workers[i].state)
+        {
+            fprintf(stdout, "supervisor: worker %d did not stop, killed\n", i);
+            kill(spp_super_workers[i].pid, SIGKILL);
+            waitpid(spp_super_workers[i].pid, NULL, 0);
+            spp_super_workers[i].state = SPP_SUPER_WORKER_STOPPED;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_configure
+ *******************************************************************************
+ * Summary:
+ *   Reads the worker configuration file. Each line holds the options of one
+ *   worker, porting layer and application options separated by blanks, and
+ *   # starts a comment.
+ *
+ * Parameters:
+ *   const char *p_config : configuration file
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the file cannot be read or is invalid
+ *
+ ******************************************************************************/
+wiced_bool_t spp_super_configure(const char *p_config)
+{
+    spp_super_worker_t *p_worker;
+    wiced_bool_t valid = WICED_TRUE;
+    char *p_line = NULL;
+    size_t size = 0;
+    char *p_save;
+    char *p_arg;
+    FILE *p_file;
+    int argc;
+
+    p_file = fopen(p_config, "r");
+    if (NULL == p_file)
+    {
+        fprintf(stderr, "Cannot read %s: %s\n", p_config, strerror(errno));
+        return WICED_FALSE;
+    }
+    while (valid && (getline(&p_line, &size, p_file) >= 0))
+    {
+        if (NULL != strchr(p_line, '#'))
+        {
+            *strchr(p_line, '#') = '\0';
+        }
+        if (0 == p_line[strspn(p_line, " \t\r\n")])
+        {
+            continue;
+        }
+        if (spp_super_worker_count == SPP_SUPER_MAX_WORKERS)
+        {
+            fprintf(stderr, "More than %d workers in %s\n", SPP_SUPER_MAX_WORKERS, p_config);
+            valid = WICED_FALSE;
+            break;
+        }
+        p_worker = &spp_super_workers[spp_super_worker_count];
+        p_worker->p_line = strdup(p_line);
+        argc = 1;
+        for (p_arg = strtok_r(p_worker->p_line, " \t\r\n", &p_save); NULL != p_arg;
+             p_arg = strtok_r(NULL, " \t\r\n", &p_save))
+        {
+            if ((0 == strcmp(p_arg, "--daemon")) || (0 == strcmp(p_arg, "--supervise")))
+            {
+                fprintf(stderr, "%s is set by the supervisor, not in %s\n", p_arg, p_config);
+                valid = WICED_FALSE;
+                break;
+            }
+            if (SPP_SUPER_MAX_ARGS == argc)
+            {
+                fprintf(stderr, "More than %d options for a worker in %s\n", SPP_SUPER_MAX_ARGS - 1, p_config);
+                valid = WICED_FALSE;
+                break;
+            }
+            p_worker->argv[argc++] = p_arg;
+        }
+        /* argv[0] and the worker's control socket are filled in on start */
+        p_worker->argv[argc] = "--daemon";
+        p_worker->argv[argc + 1] = p_worker->socket_path;
+        p_worker->argv[argc + 2] = NULL;
+        p_worker->ctl_fd = -1;
+        p_worker->hidden = -1;
+        p_worker->sessions = -1;
+        p_worker->backoff_ms = SPP_SUPER_RESTART_MIN_MS;
+        spp_super_worker_count++;
+    }
+    free(p_line);
+    fclose(p_file);
+    if (valid && (0 == spp_super_worker_count))
+    {
+        fprintf(stderr, "No workers in %s\n", p_config);
+        valid = WICED_FALSE;
+    }
+    spp_super_enabled = valid;
+    return valid;
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_is_enabled
+ *******************************************************************************
+ * Summary:
+ *   Tells whether the process supervises workers instead of driving a
+ *   controller itself
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if --supervise was given
+ *
+ ******************************************************************************/
+wiced_bool_t spp_super_is_enabled(void)
+{
+    return spp_super_enabled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_super_run
+ *******************************************************************************
+ * Summary:
+ *   Starts the workers and supervises them until SIGINT or SIGTERM
+ *
+ * Parameters:
+ *   const char *p_argv0 : name the workers are started with
+ *
+ * Return:
+ *   int : 0 on a signal, -1 if the supervisor cannot run
+ *
+ ******************************************************************************/
+int spp_super_run(const char *p_argv0)
+{
+    const char *p_path = spp_ctl_get_path();
+    const char *p_group;
+    const char *p_file_dir;
+    struct pollfd fds[2];
+    struct signalfd_siginfo info;
+    spp_super_worker_t *p_worker;
+    uint64_t next_poll_us = 0;
+    uint64_t now_us;
+    int64_t wait_ms;
+    sigset_t mask;
+    wiced_bool_t running = WICED_TRUE;
+    int argc;
+    int i;
+
+    if (NULL == p_path)
+    {
+        fprintf(stderr, "--supervise needs --daemon <socket>\n");
+        return -1;
+    }
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        p_worker = &spp_super_workers[i];
+        if ((size_t)snprintf(p_worker->socket_path, sizeof(p_worker->socket_path), "%s.%d",
+                             p_path, i) >= sizeof(p_worker->socket_path))
+        {
+            fprintf(stderr, "Control socket path %s too long for the workers\n", p_path);
+            return -1;
+        }
+        p_worker->argv[0] = (char *)p_argv0;
+        for (argc = 0; NULL != p_worker->argv[argc]; argc++)
+        {
+        }
+        spp_ctl_get_access(&p_group, &p_file_dir);
+        if (NULL != p_group)
+        {
+            p_worker->argv[argc++] = "--daemon-group";
+            p_worker->argv[argc++] = (char *)p_group;
+        }
+        if (NULL != p_file_dir)
+        {
+            p_worker->argv[argc++] = "--daemon-files";
+            p_worker->argv[argc++] = (char *)p_file_dir;
+        }
+        p_worker->argv[argc] = NULL;
+    }
+
+    /* SIGINT and SIGTERM are blocked by --daemon already */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    fds[0].fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    fds[0].events = POLLIN;
+    fds[1].fd = spp_ctl_listen(p_path, SPP_SUPER_MAX_WORKERS);
+    fds[1].events = POLLIN;
+    if ((fds[0].fd < 0) || (fds[1].fd < 0))
+    {
+        fprintf(stderr, "Cannot serve control socket %s: %s\n", p_path, strerror(errno));
+        return -1;
+    }
+    fprintf(stdout, "supervisor: %d workers, control socket %s\n", spp_super_worker_count, p_path);
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        spp_super_worker_start(&spp_super_workers[i]);
+    }
+
+    while (running)
+    {
+        fflush(stdout);
+        now_us = spp_get_time_us();
+        wait_ms = (next_poll_us > now_us) ? (int64_t)((next_poll_us - now_us + 999) / 1000) : 0;
+        for (i = 0; i < spp_super_worker_count; i++)
+        {
+            p_worker = &spp_super_workers[i];
+            if (SPP_SUPER_WORKER_WAITING == p_worker->state)
+            {
+                wait_ms = MIN(wait_ms, (p_worker->restart_us > now_us) ?
+                              (int64_t)((p_worker->restart_us - now_us + 999) / 1000) : 0);
+            }
+        }
+        if ((poll(fds, 2, (int)wait_ms) < 0) && (EINTR != errno))
+        {
+            break;
+        }
+
+        while (sizeof(info) == read(fds[0].fd, &info, sizeof(info)))
+        {
+            if (SIGCHLD != info.ssi_signo)
+            {
+                running = WICED_FALSE;
+            }
+        }
+        spp_super_reap(running);
+        if (!running)
+        {
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            spp_super_serve(fds[1].fd);
+        }
+
+        now_us = spp_get_time_us();
+        for (i = 0; i < spp_super_worker_count; i++)
+        {
+            p_worker = &spp_super_workers[i];
+            if ((SPP_SUPER_WORKER_WAITING == p_worker->state) && (now_us >= p_worker->restart_us))
+            {
+                p_worker->restarts++;
+                spp_super_worker_start(p_worker);
+            }
+        }
+        if (now_us >= next_poll_us)
+        {
+            for (i = 0; i < spp_super_worker_count; i++)
+            {
+                if (SPP_SUPER_WORKER_RUNNING == spp_super_workers[i].state)
+                {
+                    spp_super_worker_poll(&spp_super_workers[i]);
+                }
+            }
+            spp_super_balance();
+            next_poll_us = spp_get_time_us() + (uint64_t)SPP_SUPER_POLL_MS * 1000;
+        }
+    }
+
+    fprintf(stdout, "supervisor: stopping workers\n");
+    spp_super_stop();
+    close(fds[1].fd);
+    unlink(p_path);
+    close(fds[0].fd);
+    for (i = 0; i < spp_super_worker_count; i++)
+    {
+        spp_super_worker_disconnect(&spp_super_workers[i]);
+        fprintf(stdout, "supervisor: worker %d restarted %u times\n", i, spp_super_workers[i].restarts);
+    }
+    return 0;
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,1209 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_tx.c
+ *
+ * Description: Per-session transmit queue implementing spp_send_iov().
+ *
+ *              Callers queue lists of buffer segments. The queue sends them
+ *              in frames of up to the session frame size: SPP_MAX_PAYLOAD
+ *              bytes on RFCOMM, the ATT payload on LE GATT and the channel
+ *              MTU on L2CAP:
+ *              - a segment of at least a frame, its tail included, or one
+ *                with nothing to merge with, is handed to the stack straight
+ *                from the caller's buffer
+ *              - runs of two or more smaller segments are packed into the
+ *                session frame buffer, taken from the stack heap. Packing
+ *                stops before a segment of at least a frame, so large writes
+ *                are never copied by the application.
+ *              The send functions of the stack copy every frame into stack
+ *              buffers and take no buffer from the caller. Packing therefore
+ *              only happens where it saves frames, i.e. for small writes.
+ *              A segment is released to its owner through its completion
+ *              callback once its last byte was accepted by the stack.
+ *
+ *              Segments may be queued from any thread. Only one thread pumps
+ *              a session at a time and the queue lock is never held while
+ *              calling into the stack.
+ *
+ *              RFCOMM is the default transport. Other transports register
+ *              their send path and the handle bit marking their sessions;
+ *              the counters kept per transport make the throughput and
+ *              latency of the transports directly comparable.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_spp.h"
+#include "wiced_memory.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_shaper.h"
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    spp_iovec_t iov;
+    uint32_t offset; /* bytes of this segment already sent */
+    wiced_bool_t whole; /* sent as a frame of its own, never packed or split */
+} spp_tx_seg_t;
+
+typedef struct
+{
+    uint16_t handle;                          /* 0 if the entry is free */
+    spp_transport_t transport;
+    uint32_t frame_size;                      /* largest frame the transport takes */
+    uint64_t up_us;                           /* time the session was opened */
+    uint8_t *p_frame;                         /* frame buffer from the stack heap */
+    spp_tx_seg_t segs[SPP_TX_MAX_SEGMENTS];   /* ring of queued segments */
+    uint16_t head;
+    uint16_t count;
+    uint32_t queued_bytes;
+    wiced_bool_t pumping;
+    uint64_t tx_bytes;                        /* payload bytes accepted by the transport */
+    uint64_t rx_bytes;                        /* payload bytes received */
+} spp_tx_session_t;
+
+typedef struct
+{
+    uint16_t handle_flag;                     /* 0 for the default transport */
+    uint32_t max_frame_size;                  /* size of the session frame buffers */
+    spp_tx_transport_ops_t ops;
+    spp_tx_transport_stats_t stats;
+} spp_tx_transport_entry_t;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static wiced_bool_t spp_tx_rfcomm_disconnect(uint16_t handle);
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static spp_tx_session_t spp_tx_sessions[SPP_MAX_SESSIONS];
+static spp_tx_stats_t spp_tx_stats;
+static pthread_mutex_t spp_tx_lock = PTHREAD_MUTEX_INITIALIZER;
+static wiced_timer_t spp_tx_retry_timer;
+static spp_tx_transport_entry_t spp_tx_transports[SPP_TRANSPORT_MAX] =
+{
+    [SPP_TRANSPORT_RFCOMM] = { 0, SPP_MAX_PAYLOAD,
+                               { wiced_bt_spp_can_send_more_data, wiced_bt_spp_send_session_data,
+                                 spp_tx_rfcomm_disconnect } },
+};
+static const char *spp_tx_transport_names[SPP_TRANSPORT_MAX] = { "rfcomm", "gatt", "l2cap" };
+
+static void spp_tx_retry_timeout(WICED_TIMER_PARAM_TYPE arg);
+static void spp_tx_pump(spp_tx_session_t *p_session);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static wiced_bool_t spp_tx_rfcomm_disconnect(uint16_t handle)
+{
+    return (WICED_BT_SUCCESS == wiced_bt_spp_disconnect(handle)) ? WICED_TRUE : WICED_FALSE;
+}
+
+/* Must be called with spp_tx_lock held */
+static spp_tx_session_t *spp_tx_find(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != handle) && (spp_tx_sessions[i].handle == handle))
+        {
+            return &spp_tx_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Returns the transport whose handle bit is set in handle */
+static spp_transport_t spp_tx_transport_of(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_TRANSPORT_MAX; i++)
+    {
+        if ((0 != spp_tx_transports[i].handle_flag) &&
+            (spp_tx_transports[i].handle_flag == (handle & spp_tx_transports[i].handle_flag)))
+        {
+            return (spp_transport_t)i;
+        }
+    }
+    return SPP_TRANSPORT_RFCOMM;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_release_sent
+ *******************************************************************************
+ * Summary:
+ *   Removes the fully sent segments from the head of the queue and moves
+ *   them to p_done so their completion callbacks can be called once the lock
+ *   is released. Must be called with spp_tx_lock held.
+ *
+ * Parameters:
+ *   spp_tx_session_t *p_session : session
+ *   spp_iovec_t *p_done : receives the released segments
+ *
+ * Return:
+ *   int : number of segments written to p_done
+ *
+ ******************************************************************************/
+static int spp_tx_release_sent(spp_tx_session_t *p_session, spp_iovec_t *p_done)
+{
+    spp_tx_seg_t *p_seg;
+    int done = 0;
+
+    while (0 != p_session->count)
+    {
+        p_seg = &p_session->segs[p_session->head];
+        if (p_seg->offset < p_seg->iov.len)
+        {
+            break;
+        }
+        p_done[done++] = p_seg->iov;
+        p_session->head = (p_session->head + 1) % SPP_TX_MAX_SEGMENTS;
+        p_session->count--;
+    }
+    spp_tx_stats.segments_completed += done;
+    return done;
+}
+
+static void spp_tx_complete(spp_iovec_t *p_done, int count, wiced_bool_t sent)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (NULL != p_done[i].p_complete)
+        {
+            p_done[i].p_complete(p_done[i].p_context, sent);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_close
+ *******************************************************************************
+ * Summary:
+ *   Empties a closed session and frees its entry. Segments already sent are
+ *   moved to p_sent, the others to p_dropped, so their completion callbacks
+ *   can be called once the lock is released. Must be called with spp_tx_lock
+ *   held and never while a pump is using the session.
+ *
+ * Parameters:
+ *   spp_tx_session_t *p_session : session
+ *   spp_iovec_t *p_sent : receives the sent segments
+ *   int *p_sent_count : number of segments written to p_sent
+ *   spp_iovec_t *p_dropped : receives the unsent segments
+ *   int *p_dropped_count : number of segments written to p_dropped
+ *
+ * Return:
+ *   uint8_t * : frame buffer of the session to be freed by the caller
+ *
+ ******************************************************************************/
+static uint8_t *spp_tx_close(spp_tx_session_t *p_session, spp_iovec_t *p_sent, int *p_sent_count,
+                             spp_iovec_t *p_dropped, int *p_dropped_count)
+{
+    uint8_t *p_frame = p_session->p_frame;
+    int count = 0;
+
+    *p_sent_count = spp_tx_release_sent(p_session, p_sent);
+    while (0 != p_session->count)
+    {
+        p_dropped[count++] = p_session->segs[p_session->head].iov;
+        p_session->head = (p_session->head + 1) % SPP_TX_MAX_SEGMENTS;
+        p_session->count--;
+    }
+    spp_tx_stats.segments_dropped += count;
+    *p_dropped_count = count;
+    memset(p_session, 0, sizeof(*p_session));
+    return p_frame;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_build_frame
+ *******************************************************************************
+ * Summary:
+ *   Selects the next frame to send from the head of the queue. Must be called
+ *   with spp_tx_lock held, the queue itself is not modified.
+ *
+ * Parameters:
+ *   spp_tx_session_t *p_session : session
+ *   uint8_t **pp_frame : set to the data to send
+ *   wiced_bool_t *p_packed : set if the data was packed into the frame buffer
+ *
+ * Return:
+ *   uint32_t : frame length, 0 if nothing is queued
+ *
+ ******************************************************************************/
+static uint32_t spp_tx_build_frame(spp_tx_session_t *p_session, uint8_t **pp_frame,
+                                   wiced_bool_t *p_packed)
+{
+    spp_tx_seg_t *p_seg = &p_session->segs[p_session->head];
+    spp_tx_seg_t *p_next;
+    uint32_t frame_len = 0;
+    uint32_t chunk;
+    uint16_t idx;
+    uint16_t i;
+
+    if (0 == p_session->count)
+    {
+        return 0;
+    }
+    if (p_seg->whole)
+    {
+        *pp_frame = (uint8_t *)p_seg->iov.p_data;
+        *p_packed = WICED_FALSE;
+        return p_seg->iov.len;
+    }
+    p_next = &p_session->segs[(p_session->head + 1) % SPP_TX_MAX_SEGMENTS];
+    if ((p_seg->iov.len >= p_session->frame_size) || (NULL == p_session->p_frame) ||
+        (1 == p_session->count) || p_next->whole || (p_next->iov.len >= p_session->frame_size))
+    {
+        /* Large segments, their tails included, and segments with nothing to
+         * merge with are sent from their buffer, packing would only add a copy
+         */
+        *pp_frame = (uint8_t *)p_seg->iov.p_data + p_seg->offset;
+        *p_packed = WICED_FALSE;
+        return MIN(p_session->frame_size, p_seg->iov.len - p_seg->offset);
+    }
+
+    for (i = 0; (i < p_session->count) && (frame_len < p_session->frame_size); i++)
+    {
+        idx = (p_session->head + i) % SPP_TX_MAX_SEGMENTS;
+        p_seg = &p_session->segs[idx];
+        if (p_seg->whole || (p_seg->iov.len >= p_session->frame_size))
+        {
+            /* Sent straight from its buffer in the next frame */
+            break;
+        }
+        chunk = MIN(p_session->frame_size - frame_len, p_seg->iov.len - p_seg->offset);
+        memcpy(&p_session->p_frame[frame_len], p_seg->iov.p_data + p_seg->offset, chunk);
+        frame_len += chunk;
+    }
+    *pp_frame = p_session->p_frame;
+    *p_packed = WICED_TRUE;
+    return frame_len;
+}
+
+/* Marks len bytes from the head of the queue as sent, spp_tx_lock held */
+static void spp_tx_advance(spp_tx_session_t *p_session, uint32_t len)
+{
+    spp_tx_seg_t *p_seg;
+    uint32_t chunk;
+    uint16_t i;
+
+    p_session->queued_bytes -= len;
+    for (i = 0; (i < p_session->count) && (0 != len); i++)
+    {
+        p_seg = &p_session->segs[(p_session->head + i) % SPP_TX_MAX_SEGMENTS];
+        chunk = MIN(len, p_seg->iov.len - p_seg->offset);
+        p_seg->offset += chunk;
+        len -= chunk;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_pump
+ *******************************************************************************
+ * Summary:
+ *   Sends queued data while the stack has credits. If another thread is
+ *   already pumping the session this returns at once, the running pump picks
+ *   up the new segments.
+ *
+ * Parameters:
+ *   spp_tx_session_t *p_session : session
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_tx_pump(spp_tx_session_t *p_session)
+{
+    spp_iovec_t done[SPP_TX_MAX_SEGMENTS];
+    spp_iovec_t dropped[SPP_TX_MAX_SEGMENTS];
+    spp_tx_transport_entry_t *p_transport;
+    uint8_t *p_frame = NULL;
+    uint8_t *p_session_frame = NULL;
+    wiced_bool_t packed = WICED_FALSE;
+    uint16_t handle;
+    uint32_t len;
+    int done_count;
+    int dropped_count = 0;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    if (p_session->pumping || (0 == p_session->handle))
+    {
+        pthread_mutex_unlock(&spp_tx_lock);
+        return;
+    }
+    p_session->pumping = WICED_TRUE;
+    handle = p_session->handle;
+    p_transport = &spp_tx_transports[p_session->transport];
+
+    for (;;)
+    {
+        done_count = spp_tx_release_sent(p_session, done);
+        len = spp_tx_build_frame(p_session, &p_frame, &packed);
+        pthread_mutex_unlock(&spp_tx_lock);
+
+        spp_tx_complete(done, done_count, WICED_TRUE);
+        if (0 == len)
+        {
+            pthread_mutex_lock(&spp_tx_lock);
+            if ((p_session->handle == handle) && (0 != p_session->count))
+            {
+                /* Segments were queued after the frame was built */
+                continue;
+            }
+            break;
+        }
+        if (!spp_shaper_admit(handle, len))
+        {
+            /* Over its rate, the shaper kicks the session when it may go */
+            pthread_mutex_lock(&spp_tx_lock);
+            break;
+        }
+        if (!p_transport->ops.p_can_send(handle) ||
+            (WICED_TRUE != p_transport->ops.p_send(handle, p_frame, len)))
+        {
+            pthread_mutex_lock(&spp_tx_lock);
+            spp_tx_stats.credit_stalls++;
+            p_transport->stats.stalls++;
+            pthread_mutex_unlock(&spp_tx_lock);
+            if (!wiced_is_timer_in_use(&spp_tx_retry_timer))
+            {
+                wiced_start_timer(&spp_tx_retry_timer, SPP_TX_RETRY_TIMEOUT);
+            }
+            pthread_mutex_lock(&spp_tx_lock);
+            break;
+        }
+        spp_shaper_commit(handle, len);
+
+        pthread_mutex_lock(&spp_tx_lock);
+        if (p_session->handle != handle)
+        {
+            /* Disconnected while sending, the queue was already flushed */
+            break;
+        }
+        spp_tx_advance(p_session, len);
+        p_session->tx_bytes += len;
+        spp_tx_stats.frames_sent++;
+        spp_tx_stats.bytes_sent += len;
+        p_transport->stats.tx_frames++;
+        p_transport->stats.tx_bytes += len;
+        if (packed)
+        {
+            spp_tx_stats.bytes_packed += len;
+        }
+        else
+        {
+            spp_tx_stats.bytes_direct += len;
+        }
+    }
+
+    /* Loop exits with spp_tx_lock held */
+    done_count = 0;
+    if (p_session->handle == handle)
+    {
+        p_session->pumping = WICED_FALSE;
+    }
+    else
+    {
+        /* The session was closed while pumping. Its segments and frame buffer
+         * were left to us, the owners may still be read from until here.
+         */
+        p_session_frame = spp_tx_close(p_session, done, &done_count, dropped, &dropped_count);
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    if (NULL != p_session_frame)
+    {
+        wiced_bt_free_buffer(p_session_frame);
+    }
+    spp_tx_complete(done, done_count, WICED_TRUE);
+    spp_tx_complete(dropped, dropped_count, WICED_FALSE);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_retry_timeout
+ *******************************************************************************
+ * Summary:
+ *   Retries every session which still has queued data
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_tx_retry_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    spp_tx_session_t *retry[SPP_MAX_SESSIONS];
+    int retry_count = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != spp_tx_sessions[i].handle) && (0 != spp_tx_sessions[i].count))
+        {
+            retry[retry_count++] = &spp_tx_sessions[i];
+        }
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    /* spp_tx_pump() takes the lock itself and skips slots closed meanwhile */
+    for (i = 0; i < retry_count; i++)
+    {
+        spp_tx_pump(retry[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the transmit queues
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_init(void)
+{
+    memset(spp_tx_sessions, 0, sizeof(spp_tx_sessions));
+    wiced_init_timer(&spp_tx_retry_timer, spp_tx_retry_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+    spp_shaper_init();
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_register_transport
+ *******************************************************************************
+ * Summary:
+ *   Registers the send path of a transport other than RFCOMM. Sessions whose
+ *   handle has all bits of handle_flag set are sent through it.
+ *
+ * Parameters:
+ *   spp_transport_t transport : transport
+ *   uint16_t handle_flag : handle bits marking the sessions of the transport
+ *   uint32_t max_frame_size : largest frame the transport takes
+ *   const spp_tx_transport_ops_t *p_ops : send path
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_register_transport(spp_transport_t transport, uint16_t handle_flag,
+                               uint32_t max_frame_size, const spp_tx_transport_ops_t *p_ops)
+{
+    if ((SPP_TRANSPORT_RFCOMM == transport) || (transport >= SPP_TRANSPORT_MAX) ||
+        (0 == handle_flag) || (0 == max_frame_size) || (NULL == p_ops))
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_tx_lock);
+    spp_tx_transports[transport].handle_flag = handle_flag;
+    spp_tx_transports[transport].max_frame_size = max_frame_size;
+    spp_tx_transports[transport].ops = *p_ops;
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_transport
+ *******************************************************************************
+ * Summary:
+ *   Returns the transport a session runs over
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   spp_transport_t : transport of the session
+ *
+ ******************************************************************************/
+spp_transport_t spp_tx_get_transport(uint16_t handle)
+{
+    spp_transport_t transport;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    transport = spp_tx_transport_of(handle);
+    pthread_mutex_unlock(&spp_tx_lock);
+    return transport;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Opens the transmit queue of a new session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_connection_up(uint16_t handle)
+{
+    spp_transport_t transport = spp_tx_get_transport(handle);
+    uint32_t frame_size = spp_tx_transports[transport].max_frame_size;
+    uint8_t *p_frame = (uint8_t *)wiced_bt_get_buffer(frame_size);
+    int i;
+
+    if (NULL == p_frame)
+    {
+        /* Still usable, small segments are then sent one by one */
+        WICED_BT_TRACE("%s: no frame buffer for handle %d\n", __FUNCTION__, handle);
+    }
+
+    pthread_mutex_lock(&spp_tx_lock);
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 == spp_tx_sessions[i].handle) && !spp_tx_sessions[i].pumping)
+        {
+            memset(&spp_tx_sessions[i], 0, sizeof(spp_tx_sessions[i]));
+            spp_tx_sessions[i].handle = handle;
+            spp_tx_sessions[i].transport = transport;
+            spp_tx_sessions[i].frame_size = frame_size;
+            spp_tx_sessions[i].up_us = spp_get_time_us();
+            spp_tx_sessions[i].p_frame = p_frame;
+            spp_tx_transports[spp_tx_sessions[i].transport].stats.sessions++;
+            p_frame = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    if (NULL != p_frame)
+    {
+        WICED_BT_TRACE("%s: no free session for handle %d\n", __FUNCTION__, handle);
+        wiced_bt_free_buffer(p_frame);
+    }
+    spp_shaper_connection_up(handle);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Closes the transmit queue of a session. Queued segments are released to
+ *   their owners with sent set to WICED_FALSE. If a pump is sending on
+ *   another thread, the session is only marked closed: the pump releases the
+ *   segments and the frame buffer once it is no longer reading from them.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_connection_down(uint16_t handle)
+{
+    spp_iovec_t sent[SPP_TX_MAX_SEGMENTS];
+    spp_iovec_t dropped[SPP_TX_MAX_SEGMENTS];
+    spp_tx_session_t *p_session;
+    uint8_t *p_frame = NULL;
+    int sent_count = 0;
+    int count = 0;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        spp_tx_transports[p_session->transport].stats.connected_us += spp_get_time_us() - p_session->up_us;
+        if (p_session->pumping)
+        {
+            /* Closed, but the entry stays taken until the pump notices */
+            p_session->handle = 0;
+        }
+        else
+        {
+            p_frame = spp_tx_close(p_session, sent, &sent_count, dropped, &count);
+        }
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    if (NULL != p_frame)
+    {
+        wiced_bt_free_buffer(p_frame);
+    }
+    spp_tx_complete(sent, sent_count, WICED_TRUE);
+    spp_tx_complete(dropped, count, WICED_FALSE);
+    spp_shaper_connection_down(handle);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_enqueue
+ *******************************************************************************
+ * Summary:
+ *   Queues a list of buffer segments on a session without sending them.
+ *   Callers which must keep their own lock while queueing, to preserve
+ *   ordering, use this and call spp_tx_kick() once the lock is released.
+ *   The segments are either all queued or, if the queue has no room for all
+ *   of them, none is.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const spp_iovec_t *p_iov : segments to send
+ *   int iov_count : number of segments
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the segments were queued
+ *
+ ******************************************************************************/
+wiced_bool_t spp_tx_enqueue(uint16_t handle, const spp_iovec_t *p_iov, int iov_count)
+{
+    spp_tx_session_t *p_session;
+    spp_tx_seg_t *p_seg;
+    int i;
+
+    if ((NULL == p_iov) || (iov_count <= 0))
+    {
+        return WICED_FALSE;
+    }
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if ((NULL == p_session) || (p_session->count + iov_count > SPP_TX_MAX_SEGMENTS))
+    {
+        pthread_mutex_unlock(&spp_tx_lock);
+        return WICED_FALSE;
+    }
+    for (i = 0; i < iov_count; i++)
+    {
+        p_seg = &p_session->segs[(p_session->head + p_session->count) % SPP_TX_MAX_SEGMENTS];
+        p_seg->iov = p_iov[i];
+        p_seg->offset = 0;
+        p_seg->whole = WICED_FALSE;
+        p_session->queued_bytes += p_iov[i].len;
+        p_session->count++;
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_enqueue_frame
+ *******************************************************************************
+ * Summary:
+ *   Queues a buffer which is sent as one frame of its own: it is neither
+ *   packed together with other segments nor split, so a receiver sees it as
+ *   one data indication. Like spp_tx_enqueue() this does not send, call
+ *   spp_tx_kick() afterwards.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const spp_iovec_t *p_iov : frame to send
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the frame was queued, WICED_FALSE if the
+ *                  queue is full or the frame is larger than the session
+ *                  frame size
+ *
+ ******************************************************************************/
+wiced_bool_t spp_tx_enqueue_frame(uint16_t handle, const spp_iovec_t *p_iov)
+{
+    spp_tx_session_t *p_session;
+    spp_tx_seg_t *p_seg;
+
+    if ((NULL == p_iov) || (0 == p_iov->len))
+    {
+        return WICED_FALSE;
+    }
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if ((NULL == p_session) || (p_session->count >= SPP_TX_MAX_SEGMENTS) ||
+        (p_iov->len > p_session->frame_size))
+    {
+        pthread_mutex_unlock(&spp_tx_lock);
+        return WICED_FALSE;
+    }
+    p_seg = &p_session->segs[(p_session->head + p_session->count) % SPP_TX_MAX_SEGMENTS];
+    p_seg->iov = *p_iov;
+    p_seg->offset = 0;
+    p_seg->whole = WICED_TRUE;
+    p_session->queued_bytes += p_iov->len;
+    p_session->count++;
+    pthread_mutex_unlock(&spp_tx_lock);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_kick
+ *******************************************************************************
+ * Summary:
+ *   Sends whatever is queued on a session, as far as credits allow
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_kick(uint16_t handle)
+{
+    spp_tx_session_t *p_session;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    if (NULL != p_session)
+    {
+        spp_tx_pump(p_session);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_set_frame_size
+ *******************************************************************************
+ * Summary:
+ *   Sets the largest frame sent on a session, e.g. after the ATT MTU of a
+ *   GATT session changed. Capped to the frame size of the transport.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t frame_size : frame size in bytes
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_set_frame_size(uint16_t handle, uint32_t frame_size)
+{
+    spp_tx_session_t *p_session;
+
+    if (0 == frame_size)
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        p_session->frame_size = MIN(frame_size, spp_tx_transports[p_session->transport].max_frame_size);
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_frame_size
+ *******************************************************************************
+ * Summary:
+ *   Returns the largest frame currently sent on a session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   uint32_t : frame size in bytes, 0 if the session is not open
+ *
+ ******************************************************************************/
+uint32_t spp_tx_get_frame_size(uint16_t handle)
+{
+    spp_tx_session_t *p_session;
+    uint32_t frame_size = 0;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        frame_size = p_session->frame_size;
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+    return frame_size;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_note_rx
+ *******************************************************************************
+ * Summary:
+ *   Counts bytes received on a session against the session and its transport
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t len : bytes received
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_note_rx(uint16_t handle, uint32_t len)
+{
+    spp_tx_session_t *p_session;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        p_session->rx_bytes += len;
+    }
+    spp_tx_transports[spp_tx_transport_of(handle)].stats.rx_bytes += len;
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_note_rtt
+ *******************************************************************************
+ * Summary:
+ *   Counts a round trip measured on a session against its transport.
+ *   spp_tx_lock is never held while calling out, so this may be called with
+ *   other locks held.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t rtt_us : round trip time
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_note_rtt(uint16_t handle, uint32_t rtt_us)
+{
+    spp_tx_transport_stats_t *p_stats;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_stats = &spp_tx_transports[spp_tx_transport_of(handle)].stats;
+    p_stats->rtt_min_us = (0 == p_stats->rtt_samples) ? rtt_us : MIN(p_stats->rtt_min_us, rtt_us);
+    p_stats->rtt_max_us = MAX(p_stats->rtt_max_us, rtt_us);
+    p_stats->rtt_total_us += rtt_us;
+    p_stats->rtt_samples++;
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_send_iov
+ *******************************************************************************
+ * Summary:
+ *   Queues a list of buffer segments for sending on a session. The segments
+ *   are sent in order as one byte stream; they are either all queued or, if
+ *   the queue has no room for all of them, none is.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   const spp_iovec_t *p_iov : segments to send
+ *   int iov_count : number of segments
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the segments were queued
+ *
+ ******************************************************************************/
+wiced_bool_t spp_send_iov(uint16_t handle, const spp_iovec_t *p_iov, int iov_count)
+{
+    if (!spp_tx_enqueue(handle, p_iov, iov_count))
+    {
+        return WICED_FALSE;
+    }
+    spp_tx_kick(handle);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_queued_bytes
+ *******************************************************************************
+ * Summary:
+ *   Returns the number of bytes queued and not yet sent on a session
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   uint32_t : queued bytes
+ *
+ ******************************************************************************/
+uint32_t spp_tx_queued_bytes(uint16_t handle)
+{
+    spp_tx_session_t *p_session;
+    uint32_t queued = 0;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        queued = p_session->queued_bytes;
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+    return queued;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_session_bytes
+ *******************************************************************************
+ * Summary:
+ *   Returns the payload bytes sent and received on a session since it opened
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint64_t *p_tx_bytes : receives the bytes sent
+ *   uint64_t *p_rx_bytes : receives the bytes received
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session is not open
+ *
+ ******************************************************************************/
+wiced_bool_t spp_tx_get_session_bytes(uint16_t handle, uint64_t *p_tx_bytes, uint64_t *p_rx_bytes)
+{
+    spp_tx_session_t *p_session;
+    wiced_bool_t found = WICED_FALSE;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    p_session = spp_tx_find(handle);
+    if (NULL != p_session)
+    {
+        *p_tx_bytes = p_session->tx_bytes;
+        *p_rx_bytes = p_session->rx_bytes;
+        found = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+    return found;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_handles
+ *******************************************************************************
+ * Summary:
+ *   Returns the handles of the connected sessions
+ *
+ * Parameters:
+ *   uint16_t *p_handles : receives the handles
+ *   int max_handles : size of p_handles
+ *
+ * Return:
+ *   int : number of handles written
+ *
+ ******************************************************************************/
+int spp_tx_get_handles(uint16_t *p_handles, int max_handles)
+{
+    int count = 0;
+    int i;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    for (i = 0; (i < SPP_MAX_SESSIONS) && (count < max_handles); i++)
+    {
+        if (0 != spp_tx_sessions[i].handle)
+        {
+            p_handles[count++] = spp_tx_sessions[i].handle;
+        }
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+    return count;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_transport_name
+ *******************************************************************************
+ * Summary:
+ *   Returns the name of a transport as printed in the statistics
+ *
+ * Parameters:
+ *   spp_transport_t transport : transport
+ *
+ * Return:
+ *   const char * : name
+ *
+ ******************************************************************************/
+const char *spp_tx_get_transport_name(spp_transport_t transport)
+{
+    return (transport < SPP_TRANSPORT_MAX) ? spp_tx_transport_names[transport] : "unknown";
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_disconnect
+ *******************************************************************************
+ * Summary:
+ *   Starts closing a session through its transport. The session goes down
+ *   once the stack reports the disconnection.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session is not connected or the
+ *                  transport refused
+ *
+ ******************************************************************************/
+wiced_bool_t spp_tx_disconnect(uint16_t handle)
+{
+    wiced_bool_t (*p_disconnect)(uint16_t handle) = NULL;
+
+    pthread_mutex_lock(&spp_tx_lock);
+    if (NULL != spp_tx_find(handle))
+    {
+        p_disconnect = spp_tx_transports[spp_tx_transport_of(handle)].ops.p_disconnect;
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+
+    return (NULL != p_disconnect) ? p_disconnect(handle) : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the transmit counters
+ *
+ * Parameters:
+ *   spp_tx_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_get_stats(spp_tx_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_tx_lock);
+    *p_stats = spp_tx_stats;
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_get_transport_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the counters of a transport, the connected time
+ *   includes the sessions still open
+ *
+ * Parameters:
+ *   spp_transport_t transport : transport
+ *   spp_tx_transport_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_get_transport_stats(spp_transport_t transport, spp_tx_transport_stats_t *p_stats)
+{
+    uint64_t now_us = spp_get_time_us();
+    int i;
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    if (transport >= SPP_TRANSPORT_MAX)
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_tx_lock);
+    *p_stats = spp_tx_transports[transport].stats;
+    for (i = 0; i < SPP_MAX_SESSIONS; i++)
+    {
+        if ((0 != spp_tx_sessions[i].handle) && (spp_tx_sessions[i].transport == transport))
+        {
+            p_stats->connected_us += now_us - spp_tx_sessions[i].up_us;
+        }
+    }
+    pthread_mutex_unlock(&spp_tx_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_tx_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the transmit counters
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_tx_print_stats(void)
+{
+    spp_tx_transport_stats_t transport_stats;
+    spp_tx_stats_t stats;
+    double seconds;
+    int i;
+
+    spp_tx_get_stats(&stats);
+    fprintf(stdout, "tx: frames %llu bytes %llu (packed %llu, direct %llu) credit stalls %u\n",
+            (unsigned long long)stats.frames_sent, (unsigned long long)stats.bytes_sent,
+            (unsigned long long)stats.bytes_packed, (unsigned long long)stats.bytes_direct,
+            stats.credit_stalls);
+    fprintf(stdout, "tx: segments completed %llu dropped %llu\n",
+            (unsigned long long)stats.segments_completed,
+            (unsigned long long)stats.segments_dropped);
+
+    for (i = 0; i < SPP_TRANSPORT_MAX; i++)
+    {
+        spp_tx_get_transport_stats((spp_transport_t)i, &transport_stats);
+        if (0 == transport_stats.sessions)
+        {
+            continue;
+        }
+        seconds = (double)transport_stats.connected_us / 1000000.0;
+        fprintf(stdout, "tx %s: sessions %u connected %.1f s, sent %llu bytes in %llu frames "
+                "(avg %llu) stalls %u, received %llu bytes\n",
+                spp_tx_transport_names[i], transport_stats.sessions, seconds,
+                (unsigned long long)transport_stats.tx_bytes,
+                (unsigned long long)transport_stats.tx_frames,
+                (unsigned long long)((0 != transport_stats.tx_frames)
+                                     ? transport_stats.tx_bytes / transport_stats.tx_frames : 0),
+                transport_stats.stalls, (unsigned long long)transport_stats.rx_bytes);
+        if (seconds > 0.0)
+        {
+            fprintf(stdout, "tx %s: mean rate sent %.1f KB/s received %.1f KB/s\n",
+                    spp_tx_transport_names[i], (double)transport_stats.tx_bytes / 1024.0 / seconds,
+                    (double)transport_stats.rx_bytes / 1024.0 / seconds);
+        }
+        if (0 != transport_stats.rtt_samples)
+        {
+            fprintf(stdout, "tx %s: rtt min %u avg %llu max %u us over %u probes\n",
+                    spp_tx_transport_names[i], transport_stats.rtt_min_us,
+                    (unsigned long long)(transport_stats.rtt_total_us / transport_stats.rtt_samples),
+                    transport_stats.rtt_max_us, transport_stats.rtt_samples);
+        }
+    }
+}
+
+/* END OF FILE [] */
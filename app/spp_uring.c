@@ -0,0 +1,712 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_uring.c
+ *
+ * Description: io_uring backed file receiver.
+ *
+ *              Received data is copied into a pool of buffers registered
+ *              with the kernel. Full buffers are queued as fixed-buffer
+ *              writes, and the receive path enters the kernel once per
+ *              SPP_URING_BATCH buffers. A reaper thread per file collects
+ *              the completions, returns the buffers to the pool, flushes
+ *              partly filled buffers and submits an fsync on the configured
+ *              cadence. The receive path (the BT stack thread) never waits
+ *              for the disk. If the disk falls so far behind that every
+ *              buffer is busy, the data is dropped and counted as overrun.
+ *
+ *              The raw system calls are used, so no library is needed.
+ *              Requires Linux 5.4 or later.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "wiced_bt_trace.h"
+#include "spp.h"
+#include "spp_uring.h"
+#include "spp_sched.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+/* Room for every buffer, the fsync and the tick timeout */
+#define SPP_URING_ENTRIES                       ( 64 )
+
+/* user_data of the requests which are not buffer writes */
+#define SPP_URING_TAG_FSYNC                     ( 0x100 )
+#define SPP_URING_TAG_TIMEOUT                   ( 0x101 )
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+struct spp_uring
+{
+    int file_fd;
+    int ring_fd;
+    uint64_t offset;            /* file offset of the next write */
+    wiced_bool_t fixed;         /* buffers registered with the kernel */
+
+    /* Submission and completion rings, shared with the kernel */
+    void *p_sq_map;
+    size_t sq_map_len;
+    void *p_cq_map;
+    size_t cq_map_len;
+    struct io_uring_sqe *p_sqes;
+    uint32_t *p_sq_tail;
+    uint32_t *p_sq_head;
+    uint32_t sq_mask;
+    uint32_t *p_sq_array;
+    uint32_t *p_cq_head;
+    uint32_t *p_cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *p_cqes;
+    uint32_t unsubmitted;       /* requests queued but not yet submitted */
+
+    /* Buffer pool */
+    uint8_t *p_pool;
+    struct iovec iov[SPP_URING_BUF_COUNT];
+    uint32_t write_len[SPP_URING_BUF_COUNT];
+    int free_list[SPP_URING_BUF_COUNT];
+    int free_count;
+    int fill_idx;               /* buffer being filled, -1 if none */
+    uint32_t fill_len;
+    uint64_t fill_start_us;
+
+    uint32_t in_flight;         /* writes submitted and not completed */
+    wiced_bool_t fsync_pending;
+    wiced_bool_t timeout_pending;
+    wiced_bool_t dirty;         /* written since the last fsync */
+    wiced_bool_t closing;
+    uint64_t fsync_start_us;
+    uint64_t last_fsync_us;
+    struct __kernel_timespec tick;
+    pthread_t reaper;
+};
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static uint32_t spp_uring_fsync_ms = SPP_URING_DEFAULT_FSYNC_MS;
+static spp_uring_stats_t spp_uring_stats;
+static uint64_t spp_uring_first_submit_us;
+static uint64_t spp_uring_depth_sum;     /* in-flight writes summed at each submit */
+static pthread_mutex_t spp_uring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static int spp_uring_enter(int ring_fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_setup
+ *******************************************************************************
+ * Summary:
+ *   Creates the io_uring instance of a file and maps its rings
+ *
+ * Parameters:
+ *   spp_uring_t *p_uring : file receiver
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if io_uring is not available
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_uring_setup(spp_uring_t *p_uring)
+{
+    struct io_uring_params params;
+    uint8_t *p_sq;
+    uint8_t *p_cq;
+
+    memset(&params, 0, sizeof(params));
+    p_uring->ring_fd = (int)syscall(__NR_io_uring_setup, SPP_URING_ENTRIES, &params);
+    if (p_uring->ring_fd < 0)
+    {
+        return WICED_FALSE;
+    }
+
+    p_uring->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    p_uring->cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        p_uring->sq_map_len = MAX(p_uring->sq_map_len, p_uring->cq_map_len);
+    }
+    p_uring->p_sq_map = mmap(NULL, p_uring->sq_map_len, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, p_uring->ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == p_uring->p_sq_map)
+    {
+        p_uring->p_sq_map = NULL;
+        return WICED_FALSE;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        p_uring->p_cq_map = p_uring->p_sq_map;
+    }
+    else
+    {
+        p_uring->p_cq_map = mmap(NULL, p_uring->cq_map_len, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, p_uring->ring_fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == p_uring->p_cq_map)
+        {
+            p_uring->p_cq_map = NULL;
+            return WICED_FALSE;
+        }
+    }
+    p_uring->p_sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           p_uring->ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == p_uring->p_sqes)
+    {
+        p_uring->p_sqes = NULL;
+        return WICED_FALSE;
+    }
+
+    p_sq = p_uring->p_sq_map;
+    p_uring->p_sq_head = (uint32_t *)(p_sq + params.sq_off.head);
+    p_uring->p_sq_tail = (uint32_t *)(p_sq + params.sq_off.tail);
+    p_uring->sq_mask = *(uint32_t *)(p_sq + params.sq_off.ring_mask);
+    p_uring->p_sq_array = (uint32_t *)(p_sq + params.sq_off.array);
+    p_cq = p_uring->p_cq_map;
+    p_uring->p_cq_head = (uint32_t *)(p_cq + params.cq_off.head);
+    p_uring->p_cq_tail = (uint32_t *)(p_cq + params.cq_off.tail);
+    p_uring->cq_mask = *(uint32_t *)(p_cq + params.cq_off.ring_mask);
+    p_uring->p_cqes = (struct io_uring_cqe *)(p_cq + params.cq_off.cqes);
+
+    /* Fixed buffers save the kernel pinning the pages on every write. Without
+     * them (e.g. RLIMIT_MEMLOCK too low) plain vectored writes are used.
+     */
+    p_uring->fixed = (0 == syscall(__NR_io_uring_register, p_uring->ring_fd,
+                                   IORING_REGISTER_BUFFERS, p_uring->iov, SPP_URING_BUF_COUNT))
+                         ? WICED_TRUE : WICED_FALSE;
+    return WICED_TRUE;
+}
+
+/* Must be called with spp_uring_lock held. The ring never fills up, it has
+ * room for every request a file can have outstanding.
+ */
+static struct io_uring_sqe *spp_uring_get_sqe(spp_uring_t *p_uring)
+{
+    uint32_t tail = *p_uring->p_sq_tail;
+    uint32_t index = tail & p_uring->sq_mask;
+    struct io_uring_sqe *p_sqe = &p_uring->p_sqes[index];
+
+    memset(p_sqe, 0, sizeof(*p_sqe));
+    p_uring->p_sq_array[index] = index;
+    /* The entry is published by the release store of the tail */
+    __atomic_store_n(p_uring->p_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    p_uring->unsubmitted++;
+    return p_sqe;
+}
+
+/* Must be called with spp_uring_lock held */
+static void spp_uring_queue_fill(spp_uring_t *p_uring)
+{
+    struct io_uring_sqe *p_sqe;
+    int idx = p_uring->fill_idx;
+
+    if ((idx < 0) || (0 == p_uring->fill_len))
+    {
+        return;
+    }
+
+    p_sqe = spp_uring_get_sqe(p_uring);
+    p_sqe->fd = p_uring->file_fd;
+    p_sqe->off = p_uring->offset;
+    p_sqe->user_data = (uint64_t)idx;
+    if (p_uring->fixed)
+    {
+        p_sqe->opcode = IORING_OP_WRITE_FIXED;
+        p_sqe->addr = (uint64_t)(uintptr_t)p_uring->iov[idx].iov_base;
+        p_sqe->len = p_uring->fill_len;
+        p_sqe->buf_index = (uint16_t)idx;
+    }
+    else
+    {
+        p_uring->iov[idx].iov_len = p_uring->fill_len;
+        p_sqe->opcode = IORING_OP_WRITEV;
+        p_sqe->addr = (uint64_t)(uintptr_t)&p_uring->iov[idx];
+        p_sqe->len = 1;
+    }
+
+    p_uring->write_len[idx] = p_uring->fill_len;
+    p_uring->offset += p_uring->fill_len;
+    p_uring->fill_idx = -1;
+    p_uring->fill_len = 0;
+    p_uring->in_flight++;
+    p_uring->dirty = WICED_TRUE;
+
+    spp_uring_stats.depth++;
+    spp_uring_stats.max_depth = MAX(spp_uring_stats.max_depth, spp_uring_stats.depth);
+    spp_uring_depth_sum += p_uring->in_flight;
+    if (0 == spp_uring_first_submit_us)
+    {
+        spp_uring_first_submit_us = spp_get_time_us();
+    }
+}
+
+/* Must be called with spp_uring_lock held, returns the requests to submit */
+static uint32_t spp_uring_take_unsubmitted(spp_uring_t *p_uring)
+{
+    uint32_t count = p_uring->unsubmitted;
+
+    p_uring->unsubmitted = 0;
+    if (0 != count)
+    {
+        spp_uring_stats.enters++;
+        spp_uring_stats.sqes += count;
+    }
+    return count;
+}
+
+/* Must be called with spp_uring_lock held */
+static void spp_uring_reap(spp_uring_t *p_uring)
+{
+    uint32_t head = *p_uring->p_cq_head;
+    uint32_t tail = __atomic_load_n(p_uring->p_cq_tail, __ATOMIC_ACQUIRE);
+    struct io_uring_cqe *p_cqe;
+    uint64_t now_us = spp_get_time_us();
+    uint64_t elapsed_us;
+    int idx;
+
+    for (; head != tail; head++)
+    {
+        p_cqe = &p_uring->p_cqes[head & p_uring->cq_mask];
+        if (SPP_URING_TAG_TIMEOUT == p_cqe->user_data)
+        {
+            p_uring->timeout_pending = WICED_FALSE;
+        }
+        else if (SPP_URING_TAG_FSYNC == p_cqe->user_data)
+        {
+            p_uring->fsync_pending = WICED_FALSE;
+            elapsed_us = now_us - p_uring->fsync_start_us;
+            spp_uring_stats.fsync_max_us = MAX(spp_uring_stats.fsync_max_us, elapsed_us);
+            spp_uring_stats.fsyncs++;
+            if (p_cqe->res < 0)
+            {
+                WICED_BT_TRACE("%s: fsync failed %d\n", __FUNCTION__, -p_cqe->res);
+            }
+        }
+        else
+        {
+            idx = (int)p_cqe->user_data;
+            if (p_cqe->res > 0)
+            {
+                spp_uring_stats.bytes_written += (uint32_t)p_cqe->res;
+            }
+            /* Regular files only write short when out of space */
+            if ((uint32_t)MAX(p_cqe->res, 0) < p_uring->write_len[idx])
+            {
+                spp_uring_stats.error_bytes += p_uring->write_len[idx] - (uint32_t)MAX(p_cqe->res, 0);
+            }
+            spp_uring_stats.writes++;
+            spp_uring_stats.depth--;
+            spp_uring_stats.write_us = now_us - spp_uring_first_submit_us;
+            p_uring->in_flight--;
+            p_uring->free_list[p_uring->free_count++] = idx;
+        }
+    }
+    __atomic_store_n(p_uring->p_cq_head, head, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_reaper
+ *******************************************************************************
+ * Summary:
+ *   Thread which collects the completions of a file, flushes partly filled
+ *   buffers and unsubmitted batches, and submits the periodic fsync. It wakes
+ *   up on every completion, and at least every SPP_URING_FLUSH_MS through a
+ *   timeout request. Once the file is closed it drains the outstanding
+ *   writes, syncs the file and frees it.
+ *
+ * Parameters:
+ *   void *p_arg : file receiver
+ *
+ * Return:
+ *   void * : NULL
+ *
+ ******************************************************************************/
+static void *spp_uring_reaper(void *p_arg)
+{
+    spp_uring_t *p_uring = p_arg;
+    struct io_uring_sqe *p_sqe;
+    uint64_t now_us;
+    uint32_t to_submit;
+    wiced_bool_t fsync_due;
+
+    spp_sched_apply(SPP_SCHED_ROLE_IO);
+
+    pthread_mutex_lock(&spp_uring_lock);
+    for (;;)
+    {
+        now_us = spp_get_time_us();
+        if (p_uring->closing ||
+            (now_us - p_uring->fill_start_us >= SPP_URING_FLUSH_MS * 1000ULL))
+        {
+            spp_uring_queue_fill(p_uring);
+        }
+
+        fsync_due = (0 != spp_uring_fsync_ms) &&
+                    (now_us - p_uring->last_fsync_us >= spp_uring_fsync_ms * 1000ULL);
+        if (p_uring->closing)
+        {
+            /* The final sync waits for the last writes */
+            fsync_due = (0 != spp_uring_fsync_ms) && (0 == p_uring->in_flight);
+        }
+        if (fsync_due && p_uring->dirty && !p_uring->fsync_pending)
+        {
+            /* Drained so it covers every write queued before it */
+            p_sqe = spp_uring_get_sqe(p_uring);
+            p_sqe->opcode = IORING_OP_FSYNC;
+            p_sqe->fd = p_uring->file_fd;
+            p_sqe->flags = IOSQE_IO_DRAIN;
+            p_sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            p_sqe->user_data = SPP_URING_TAG_FSYNC;
+            p_uring->fsync_pending = WICED_TRUE;
+            p_uring->dirty = WICED_FALSE;
+            p_uring->fsync_start_us = now_us;
+            p_uring->last_fsync_us = now_us;
+        }
+
+        if (p_uring->closing && (0 == p_uring->in_flight) && !p_uring->fsync_pending &&
+            ((0 == spp_uring_fsync_ms) || !p_uring->dirty))
+        {
+            break;
+        }
+
+        if (!p_uring->timeout_pending)
+        {
+            p_sqe = spp_uring_get_sqe(p_uring);
+            p_sqe->opcode = IORING_OP_TIMEOUT;
+            p_sqe->addr = (uint64_t)(uintptr_t)&p_uring->tick;
+            p_sqe->len = 1;
+            p_sqe->user_data = SPP_URING_TAG_TIMEOUT;
+            p_uring->timeout_pending = WICED_TRUE;
+        }
+
+        to_submit = spp_uring_take_unsubmitted(p_uring);
+        pthread_mutex_unlock(&spp_uring_lock);
+
+        if ((spp_uring_enter(p_uring->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS) < 0) &&
+            (EINTR != errno))
+        {
+            WICED_BT_TRACE("%s: io_uring_enter failed %d\n", __FUNCTION__, errno);
+        }
+
+        pthread_mutex_lock(&spp_uring_lock);
+        spp_uring_reap(p_uring);
+    }
+    pthread_mutex_unlock(&spp_uring_lock);
+
+    /* Closing the ring also cancels the pending timeout */
+    munmap(p_uring->p_sqes, SPP_URING_ENTRIES * sizeof(struct io_uring_sqe));
+    if (p_uring->p_cq_map != p_uring->p_sq_map)
+    {
+        munmap(p_uring->p_cq_map, p_uring->cq_map_len);
+    }
+    munmap(p_uring->p_sq_map, p_uring->sq_map_len);
+    close(p_uring->ring_fd);
+    close(p_uring->file_fd);
+    free(p_uring->p_pool);
+    free(p_uring);
+    return NULL;
+}
+
+static void spp_uring_free(spp_uring_t *p_uring)
+{
+    if (NULL != p_uring->p_sqes)
+    {
+        munmap(p_uring->p_sqes, SPP_URING_ENTRIES * sizeof(struct io_uring_sqe));
+    }
+    if ((NULL != p_uring->p_cq_map) && (p_uring->p_cq_map != p_uring->p_sq_map))
+    {
+        munmap(p_uring->p_cq_map, p_uring->cq_map_len);
+    }
+    if (NULL != p_uring->p_sq_map)
+    {
+        munmap(p_uring->p_sq_map, p_uring->sq_map_len);
+    }
+    if (p_uring->ring_fd >= 0)
+    {
+        close(p_uring->ring_fd);
+    }
+    if (p_uring->file_fd >= 0)
+    {
+        close(p_uring->file_fd);
+    }
+    free(p_uring->p_pool);
+    free(p_uring);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_configure_fsync
+ *******************************************************************************
+ * Summary:
+ *   Sets how often files written through io_uring are synced to disk
+ *
+ * Parameters:
+ *   uint32_t fsync_ms : fsync period, 0 never syncs
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_uring_configure_fsync(uint32_t fsync_ms)
+{
+    pthread_mutex_lock(&spp_uring_lock);
+    spp_uring_fsync_ms = fsync_ms;
+    pthread_mutex_unlock(&spp_uring_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_open
+ *******************************************************************************
+ * Summary:
+ *   Opens a file for appending through io_uring and starts its reaper thread
+ *
+ * Parameters:
+ *   const char *p_path : file to append to, created if needed
+ *
+ * Return:
+ *   spp_uring_t * : file receiver, NULL if the file cannot be opened or the
+ *                   kernel does not support io_uring
+ *
+ ******************************************************************************/
+spp_uring_t *spp_uring_open(const char *p_path)
+{
+    spp_uring_t *p_uring = calloc(1, sizeof(*p_uring));
+    int i;
+
+    if (NULL == p_uring)
+    {
+        return NULL;
+    }
+    p_uring->ring_fd = -1;
+    p_uring->fill_idx = -1;
+    p_uring->tick.tv_nsec = SPP_URING_FLUSH_MS * 1000000LL;
+    p_uring->file_fd = open(p_path, O_WRONLY | O_CREAT, 0644);
+    if ((p_uring->file_fd < 0) ||
+        (0 != posix_memalign((void **)&p_uring->p_pool, 4096,
+                             SPP_URING_BUF_SIZE * SPP_URING_BUF_COUNT)))
+    {
+        spp_uring_free(p_uring);
+        return NULL;
+    }
+    /* Appends, like the synchronous file sink */
+    p_uring->offset = (uint64_t)lseek(p_uring->file_fd, 0, SEEK_END);
+
+    for (i = 0; i < SPP_URING_BUF_COUNT; i++)
+    {
+        p_uring->iov[i].iov_base = &p_uring->p_pool[i * SPP_URING_BUF_SIZE];
+        p_uring->iov[i].iov_len = SPP_URING_BUF_SIZE;
+        p_uring->free_list[i] = SPP_URING_BUF_COUNT - 1 - i;
+    }
+    p_uring->free_count = SPP_URING_BUF_COUNT;
+
+    if (!spp_uring_setup(p_uring))
+    {
+        WICED_BT_TRACE("%s: io_uring not available %d\n", __FUNCTION__, errno);
+        spp_uring_free(p_uring);
+        return NULL;
+    }
+    p_uring->last_fsync_us = spp_get_time_us();
+
+    if (0 != pthread_create(&p_uring->reaper, NULL, spp_uring_reaper, p_uring))
+    {
+        spp_uring_free(p_uring);
+        return NULL;
+    }
+    pthread_detach(p_uring->reaper);
+
+    pthread_mutex_lock(&spp_uring_lock);
+    spp_uring_stats.files++;
+    pthread_mutex_unlock(&spp_uring_lock);
+    return p_uring;
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_write
+ *******************************************************************************
+ * Summary:
+ *   Queues received data for writing. Never waits for the disk: the data is
+ *   copied into the buffer being filled and a full buffer is queued, with a
+ *   system call only once per SPP_URING_BATCH buffers.
+ *
+ * Parameters:
+ *   spp_uring_t *p_uring : file receiver
+ *   const uint8_t *p_data : received data
+ *   uint32_t len : received data length
+ *
+ * Return:
+ *   uint32_t : bytes dropped because every buffer was waiting for the disk
+ *
+ ******************************************************************************/
+uint32_t spp_uring_write(spp_uring_t *p_uring, const uint8_t *p_data, uint32_t len)
+{
+    uint32_t to_submit = 0;
+    uint32_t chunk;
+
+    pthread_mutex_lock(&spp_uring_lock);
+    while (0 != len)
+    {
+        if (p_uring->fill_idx < 0)
+        {
+            if (0 == p_uring->free_count)
+            {
+                spp_uring_stats.overrun_bytes += len;
+                break;
+            }
+            p_uring->fill_idx = p_uring->free_list[--p_uring->free_count];
+            p_uring->fill_len = 0;
+            p_uring->fill_start_us = spp_get_time_us();
+        }
+        chunk = MIN(len, SPP_URING_BUF_SIZE - p_uring->fill_len);
+        memcpy((uint8_t *)p_uring->iov[p_uring->fill_idx].iov_base + p_uring->fill_len,
+               p_data, chunk);
+        p_uring->fill_len += chunk;
+        spp_uring_stats.bytes_queued += chunk;
+        p_data += chunk;
+        len -= chunk;
+        if (SPP_URING_BUF_SIZE == p_uring->fill_len)
+        {
+            spp_uring_queue_fill(p_uring);
+        }
+    }
+    /* Smaller batches are submitted by the reaper on its next tick */
+    if (p_uring->unsubmitted >= SPP_URING_BATCH)
+    {
+        to_submit = spp_uring_take_unsubmitted(p_uring);
+    }
+    pthread_mutex_unlock(&spp_uring_lock);
+
+    if (0 != to_submit)
+    {
+        spp_uring_enter(p_uring->ring_fd, to_submit, 0, 0);
+    }
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_close
+ *******************************************************************************
+ * Summary:
+ *   Closes a file. Returns at once, the reaper thread writes the remaining
+ *   data, syncs and frees the file.
+ *
+ * Parameters:
+ *   spp_uring_t *p_uring : file receiver
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_uring_close(spp_uring_t *p_uring)
+{
+    pthread_mutex_lock(&spp_uring_lock);
+    p_uring->closing = WICED_TRUE;
+    pthread_mutex_unlock(&spp_uring_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the io_uring receiver counters
+ *
+ * Parameters:
+ *   spp_uring_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_uring_get_stats(spp_uring_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_uring_lock);
+    *p_stats = spp_uring_stats;
+    pthread_mutex_unlock(&spp_uring_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_uring_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the sustained write rate, the submit queue depth and the fsync
+ *   counters of the io_uring receiver
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_uring_print_stats(void)
+{
+    spp_uring_stats_t stats;
+    double avg_depth;
+
+    pthread_mutex_lock(&spp_uring_lock);
+    stats = spp_uring_stats;
+    avg_depth = (0 != stats.writes + stats.depth) ?
+                (double)spp_uring_depth_sum / (stats.writes + stats.depth) : 0.0;
+    pthread_mutex_unlock(&spp_uring_lock);
+
+    fprintf(stdout, "uring: files %u, queued %llu bytes, written %llu bytes in %llu writes, %.1f kB/s sustained\n",
+            stats.files, (unsigned long long)stats.bytes_queued,
+            (unsigned long long)stats.bytes_written, (unsigned long long)stats.writes,
+            (0 != stats.write_us) ? (double)stats.bytes_written * 1000.0 / stats.write_us : 0.0);
+    fprintf(stdout, "uring: depth %u now, %.1f avg, %u max, %llu requests in %llu enters\n",
+            stats.depth, avg_depth, stats.max_depth, (unsigned long long)stats.sqes,
+            (unsigned long long)stats.enters);
+    fprintf(stdout, "uring: fsyncs %llu (max %llu us), overrun %llu bytes, write errors %llu bytes\n",
+            (unsigned long long)stats.fsyncs, (unsigned long long)stats.fsync_max_us,
+            (unsigned long long)stats.overrun_bytes, (unsigned long long)stats.error_bytes);
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,1398 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_xfer.c
+ *
+ * Description: Resumable bulk transfer layer for SPP. Every transfer carries
+ *              a transfer ID, the receiver acknowledges progress at fixed
+ *              checkpoints and remembers it per peer BD address. When the
+ *              same peer reconnects, the sender restarts the transfer from the
+ *              last confirmed offset instead of byte zero, and the receiver
+ *              drops any overlap.
+ *
+ *              Both ends must run this layer. Transfer frames start with a
+ *              two byte magic so they can share the session with plain data.
+ *              Frames go through the spp_tx queue as frames of their own
+ *              (spp_tx_enqueue_frame), so they are shaped and counted like any
+ *              other traffic while RFCOMM still preserves their boundaries.
+ *
+ *              The menu, the stack thread, the timers and the delta sync
+ *              workers all call in here, so the state is kept under one
+ *              module lock. The fill and receive callbacks and the spp_tx
+ *              calls that send run outside it. A transfer that waits on the
+ *              peer for SPP_XFER_ABANDON_TIMEOUT seconds is abandoned, and
+ *              spp_xfer_cancel() ends one at once.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+
+/*******************************************************************************
+ *      INCLUDES
+ *******************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_spp.h"
+#include "wiced_memory.h"
+#include "wiced_timer.h"
+#include "spp.h"
+#include "spp_tx.h"
+#include "spp_xfer.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define SPP_XFER_RETRY_TIMEOUT     (100) /* msec */
+#define SPP_XFER_MAX_RETRY         (30)
+#define SPP_XFER_MAX_QUEUED        (4)   /* DATA frames waiting in the spp_tx queue */
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SPP_XFER_MSG_START = 1, /* sender -> receiver, payload: total length */
+    SPP_XFER_MSG_DATA,      /* sender -> receiver, payload: content */
+    SPP_XFER_MSG_ACK,       /* receiver -> sender, offset: confirmed bytes */
+} spp_xfer_msg_t;
+
+typedef enum
+{
+    SPP_XFER_STATE_IDLE,
+    SPP_XFER_STATE_WAIT_START_ACK, /* START sent, waiting for resume offset */
+    SPP_XFER_STATE_SENDING,
+    SPP_XFER_STATE_WAIT_FINAL_ACK, /* everything sent, waiting for last ACK */
+    SPP_XFER_STATE_SUSPENDED,      /* link lost or stalled, checkpoint kept */
+} spp_xfer_state_t;
+
+/* Sending side, one active transfer */
+typedef struct
+{
+    spp_xfer_state_t state;
+    uint16_t handle;
+    wiced_bt_device_address_t peer_bda;
+    uint32_t xfer_id;
+    uint32_t total_len;
+    uint32_t send_offset;   /* next byte to hand to the stack */
+    uint32_t acked_offset;  /* last checkpoint confirmed by the peer */
+    uint32_t high_offset;   /* furthest byte ever sent */
+    wiced_bool_t start_pending;
+    uint32_t retry_count;
+    uint64_t wait_since_ms; /* when the transfer started waiting for the peer */
+    wiced_bool_t pumping;   /* a thread is queueing DATA frames */
+    wiced_bool_t pump_again;
+    spp_xfer_fill_cback_t p_fill;
+} spp_xfer_tx_t;
+
+/* Receiving side, progress remembered per peer across disconnects */
+typedef struct
+{
+    wiced_bool_t in_use;
+    wiced_bt_device_address_t peer_bda;
+    uint32_t xfer_id;
+    uint32_t total_len;
+    uint32_t rx_offset;     /* contiguous bytes delivered */
+    uint32_t acked_offset;  /* last offset confirmed to the sender */
+    wiced_bool_t ack_pending;
+    uint32_t last_used;
+} spp_xfer_rx_t;
+
+/* Connected handle to peer address mapping */
+typedef struct
+{
+    uint16_t handle;
+    wiced_bt_device_address_t bda;
+} spp_xfer_link_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+/* Guards everything below. Never held across the fill and receive callbacks
+ * or spp_tx calls that send, their completions come back into this module.
+ */
+static pthread_mutex_t spp_xfer_lock = PTHREAD_MUTEX_INITIALIZER;
+static spp_xfer_tx_t spp_xfer_tx;
+static spp_xfer_rx_t spp_xfer_rx[SPP_XFER_MAX_PEERS];
+static spp_xfer_link_t spp_xfer_links[SPP_XFER_MAX_PEERS];
+static spp_xfer_stats_t spp_xfer_stats;
+static spp_xfer_rx_cback_t spp_xfer_rx_cback = NULL;
+static wiced_timer_t spp_xfer_timer;
+static wiced_timer_t spp_xfer_abandon_timer;
+static wiced_bool_t spp_xfer_retry_pending = WICED_FALSE;
+static uint32_t spp_xfer_use_counter = 0;
+static uint32_t spp_xfer_queued = 0;
+
+/*******************************************************************************
+ *       FUNCTION PROTOTYPES
+ ******************************************************************************/
+static void spp_xfer_timeout(WICED_TIMER_PARAM_TYPE arg);
+static void spp_xfer_abandon_timeout(WICED_TIMER_PARAM_TYPE arg);
+static void spp_xfer_pump(void);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+static void spp_xfer_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t spp_xfer_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t spp_xfer_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_build_hdr
+ *******************************************************************************
+ * Summary:
+ *   Writes the transfer frame header into p_frame
+ *
+ * Parameters:
+ *   uint8_t *p_frame : frame buffer, at least SPP_XFER_HDR_LEN bytes
+ *   spp_xfer_msg_t type : message type
+ *   uint32_t xfer_id : transfer ID
+ *   uint32_t offset : transfer offset the message refers to
+ *   uint16_t len : payload length following the header
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_build_hdr(uint8_t *p_frame, spp_xfer_msg_t type, uint32_t xfer_id,
+                               uint32_t offset, uint16_t len)
+{
+    p_frame[0] = SPP_XFER_MAGIC_0;
+    p_frame[1] = SPP_XFER_MAGIC_1;
+    p_frame[2] = (uint8_t)type;
+    spp_xfer_put_u32(&p_frame[3], xfer_id);
+    spp_xfer_put_u32(&p_frame[7], offset);
+    p_frame[11] = (uint8_t)len;
+    p_frame[12] = (uint8_t)(len >> 8);
+}
+
+/* Peer address of a connected handle, spp_xfer_lock held */
+static uint8_t *spp_xfer_link_bda(uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if ((0 != handle) && (handle == spp_xfer_links[i].handle))
+        {
+            return spp_xfer_links[i].bda;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_rx_find
+ *******************************************************************************
+ * Summary:
+ *   Looks up the receive progress kept for a peer. When create is set and the
+ *   peer is unknown, the least recently used entry is recycled. Called with
+ *   spp_xfer_lock held.
+ *
+ * Parameters:
+ *   uint8_t *bda : peer BD address
+ *   wiced_bool_t create : allocate an entry if none exists
+ *
+ * Return:
+ *   spp_xfer_rx_t * : receive entry, NULL if not found
+ *
+ ******************************************************************************/
+static spp_xfer_rx_t *spp_xfer_rx_find(uint8_t *bda, wiced_bool_t create)
+{
+    spp_xfer_rx_t *p_lru = &spp_xfer_rx[0];
+    int i;
+
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if (spp_xfer_rx[i].in_use &&
+            (0 == memcmp(spp_xfer_rx[i].peer_bda, bda, sizeof(wiced_bt_device_address_t))))
+        {
+            spp_xfer_rx[i].last_used = ++spp_xfer_use_counter;
+            return &spp_xfer_rx[i];
+        }
+        if (p_lru->in_use &&
+            (!spp_xfer_rx[i].in_use || (spp_xfer_rx[i].last_used < p_lru->last_used)))
+        {
+            p_lru = &spp_xfer_rx[i];
+        }
+    }
+    if (!create)
+    {
+        return NULL;
+    }
+    memset(p_lru, 0, sizeof(*p_lru));
+    p_lru->in_use = WICED_TRUE;
+    memcpy(p_lru->peer_bda, bda, sizeof(wiced_bt_device_address_t));
+    p_lru->last_used = ++spp_xfer_use_counter;
+    return p_lru;
+}
+
+/* Whether the transfer waits on the peer and may be abandoned, spp_xfer_lock held */
+static wiced_bool_t spp_xfer_is_waiting(void)
+{
+    return ((SPP_XFER_STATE_WAIT_START_ACK == spp_xfer_tx.state) ||
+            (SPP_XFER_STATE_WAIT_FINAL_ACK == spp_xfer_tx.state) ||
+            (SPP_XFER_STATE_SUSPENDED == spp_xfer_tx.state)) ? WICED_TRUE : WICED_FALSE;
+}
+
+/* Changes the transfer state, spp_xfer_lock held */
+static void spp_xfer_set_state(spp_xfer_state_t state)
+{
+    spp_xfer_tx.state = state;
+    if (spp_xfer_is_waiting())
+    {
+        spp_xfer_tx.wait_since_ms = spp_xfer_now_ms();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_arm_timers
+ *******************************************************************************
+ * Summary:
+ *   Starts the retry timer if something could not be queued, and the abandon
+ *   timer while the transfer waits on the peer. Called without spp_xfer_lock,
+ *   like the timers of the other modules they are never started under it.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_arm_timers(void)
+{
+    wiced_bool_t retry;
+    wiced_bool_t waiting;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    retry = spp_xfer_retry_pending;
+    waiting = spp_xfer_is_waiting();
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (retry && !wiced_is_timer_in_use(&spp_xfer_timer))
+    {
+        wiced_start_timer(&spp_xfer_timer, SPP_XFER_RETRY_TIMEOUT);
+    }
+    if (waiting && !wiced_is_timer_in_use(&spp_xfer_abandon_timer))
+    {
+        wiced_start_timer(&spp_xfer_abandon_timer, SPP_XFER_ABANDON_TIMEOUT);
+    }
+}
+
+/* Completion of a frame queued on spp_tx, the frame buffer is ours again */
+static void spp_xfer_ctrl_complete(void *p_context, wiced_bool_t sent)
+{
+    wiced_bt_free_buffer(p_context);
+}
+
+static void spp_xfer_data_complete(void *p_context, wiced_bool_t sent)
+{
+    wiced_bt_free_buffer(p_context);
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (0 != spp_xfer_queued)
+    {
+        spp_xfer_queued--;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+    if (sent)
+    {
+        spp_xfer_pump();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_queue_frame
+ *******************************************************************************
+ * Summary:
+ *   Queues a frame built in a stack buffer on the session. The buffer is
+ *   freed from p_complete once spp_tx is done with it, or here if it could not
+ *   be queued.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_frame : frame from wiced_bt_get_buffer()
+ *   uint32_t len : frame length
+ *   spp_send_complete_cback_t p_complete : frees the buffer
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the frame was queued
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_queue_frame(uint16_t handle, uint8_t *p_frame, uint32_t len,
+                                         spp_send_complete_cback_t p_complete)
+{
+    spp_iovec_t iov;
+
+    iov.p_data = p_frame;
+    iov.len = len;
+    iov.p_complete = p_complete;
+    iov.p_context = p_frame;
+    if (!spp_tx_enqueue_frame(handle, &iov))
+    {
+        wiced_bt_free_buffer(p_frame);
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_send_ctrl
+ *******************************************************************************
+ * Summary:
+ *   Sends a header-only control message or a START message. Called without
+ *   spp_xfer_lock.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   spp_xfer_msg_t type : SPP_XFER_MSG_START or SPP_XFER_MSG_ACK
+ *   uint32_t xfer_id : transfer ID
+ *   uint32_t offset : offset the message refers to
+ *   uint32_t total_len : total transfer length, START only
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the message was queued
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_send_ctrl(uint16_t handle, spp_xfer_msg_t type, uint32_t xfer_id,
+                                       uint32_t offset, uint32_t total_len)
+{
+    uint8_t *p_msg = (uint8_t *)wiced_bt_get_buffer(SPP_XFER_HDR_LEN + sizeof(uint32_t));
+    uint16_t len = (SPP_XFER_MSG_START == type) ? sizeof(uint32_t) : 0;
+
+    if (NULL == p_msg)
+    {
+        return WICED_FALSE;
+    }
+    spp_xfer_build_hdr(p_msg, type, xfer_id, offset, len);
+    spp_xfer_put_u32(&p_msg[SPP_XFER_HDR_LEN], total_len);
+    if (!spp_xfer_queue_frame(handle, p_msg, SPP_XFER_HDR_LEN + len, spp_xfer_ctrl_complete))
+    {
+        return WICED_FALSE;
+    }
+    spp_tx_kick(handle);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_stall
+ *******************************************************************************
+ * Summary:
+ *   Called with spp_xfer_lock held when data could not be queued. Retries a
+ *   limited number of times, then suspends the transfer. Unlike the
+ *   sample-data path the confirmed checkpoint is kept, so spp_xfer_resume()
+ *   continues from it.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_stall(void)
+{
+    if (spp_xfer_tx.retry_count >= SPP_XFER_MAX_RETRY)
+    {
+        WICED_BT_TRACE("xfer 0x%08x stalled at %d, suspended at checkpoint %d\n",
+                       spp_xfer_tx.xfer_id, spp_xfer_tx.send_offset, spp_xfer_tx.acked_offset);
+        spp_xfer_set_state(SPP_XFER_STATE_SUSPENDED);
+        spp_xfer_tx.send_offset = spp_xfer_tx.acked_offset;
+        spp_xfer_tx.retry_count = 0;
+        return;
+    }
+    spp_xfer_tx.retry_count++;
+    spp_xfer_retry_pending = WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_send_start
+ *******************************************************************************
+ * Summary:
+ *   Announces the transfer (new or resumed) to the receiver, which answers
+ *   with the offset it already holds. The caller has set the state to
+ *   SPP_XFER_STATE_WAIT_START_ACK and released spp_xfer_lock.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_send_start(void)
+{
+    spp_xfer_tx_t *p_tx = &spp_xfer_tx;
+    wiced_bool_t sent;
+    uint16_t handle;
+    uint32_t xfer_id;
+    uint32_t offset;
+    uint32_t total_len;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if ((SPP_XFER_STATE_WAIT_START_ACK != p_tx->state) || (0 == p_tx->handle))
+    {
+        pthread_mutex_unlock(&spp_xfer_lock);
+        return;
+    }
+    handle = p_tx->handle;
+    xfer_id = p_tx->xfer_id;
+    offset = p_tx->acked_offset;
+    total_len = p_tx->total_len;
+    p_tx->start_pending = WICED_FALSE;
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    sent = spp_xfer_send_ctrl(handle, SPP_XFER_MSG_START, xfer_id, offset, total_len);
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (!sent && (SPP_XFER_STATE_WAIT_START_ACK == p_tx->state) && (xfer_id == p_tx->xfer_id))
+    {
+        p_tx->start_pending = WICED_TRUE;
+        spp_xfer_stall();
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+    spp_xfer_arm_timers();
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_pump
+ *******************************************************************************
+ * Summary:
+ *   Queues transfer data while the sender is within SPP_XFER_WINDOW bytes of
+ *   the last checkpoint, at most SPP_XFER_MAX_QUEUED frames at a time. Each
+ *   frame fills the session frame size; spp_tx waits for credits and the
+ *   completion of a frame calls this again. One thread pumps at a time, so
+ *   frames are queued in offset order; a call made meanwhile makes that
+ *   thread look again before it stops.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_pump(void)
+{
+    spp_xfer_tx_t *p_tx = &spp_xfer_tx;
+    spp_xfer_fill_cback_t p_fill;
+    wiced_bool_t filled;
+    wiced_bool_t queued_ok = WICED_FALSE;
+    uint8_t *p_frame;
+    uint16_t handle;
+    uint32_t xfer_id;
+    uint32_t frame_size;
+    uint32_t offset;
+    uint32_t len;
+    int queued = 0;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (p_tx->pumping)
+    {
+        p_tx->pump_again = WICED_TRUE;
+        pthread_mutex_unlock(&spp_xfer_lock);
+        return;
+    }
+    if (SPP_XFER_STATE_SENDING != p_tx->state)
+    {
+        pthread_mutex_unlock(&spp_xfer_lock);
+        return;
+    }
+    p_tx->pumping = WICED_TRUE;
+
+    do
+    {
+        p_tx->pump_again = WICED_FALSE;
+        handle = p_tx->handle;
+        xfer_id = p_tx->xfer_id;
+        p_fill = p_tx->p_fill;
+        pthread_mutex_unlock(&spp_xfer_lock);
+        frame_size = MIN(spp_tx_get_frame_size(handle), SPP_MAX_PAYLOAD);
+        pthread_mutex_lock(&spp_xfer_lock);
+
+        while ((SPP_XFER_STATE_SENDING == p_tx->state) && (xfer_id == p_tx->xfer_id) &&
+               (handle == p_tx->handle) && (p_tx->send_offset < p_tx->total_len))
+        {
+            if ((p_tx->send_offset - p_tx->acked_offset >= SPP_XFER_WINDOW) ||
+                (spp_xfer_queued >= SPP_XFER_MAX_QUEUED))
+            {
+                /* Wait for the next checkpoint or a queued frame to go out */
+                break;
+            }
+            p_frame = (frame_size > SPP_XFER_HDR_LEN) ? (uint8_t *)wiced_bt_get_buffer(frame_size) : NULL;
+            if (NULL == p_frame)
+            {
+                spp_xfer_stall();
+                break;
+            }
+            offset = p_tx->send_offset;
+            len = MIN(frame_size - SPP_XFER_HDR_LEN, p_tx->total_len - offset);
+            pthread_mutex_unlock(&spp_xfer_lock);
+
+            filled = p_fill(offset, &p_frame[SPP_XFER_HDR_LEN], len);
+            if (filled)
+            {
+                spp_xfer_build_hdr(p_frame, SPP_XFER_MSG_DATA, xfer_id, offset, len);
+                queued_ok = spp_xfer_queue_frame(handle, p_frame, SPP_XFER_HDR_LEN + len,
+                                                 spp_xfer_data_complete);
+            }
+            else
+            {
+                wiced_bt_free_buffer(p_frame);
+            }
+
+            pthread_mutex_lock(&spp_xfer_lock);
+            if (!filled)
+            {
+                if ((xfer_id == p_tx->xfer_id) && (SPP_XFER_STATE_IDLE != p_tx->state))
+                {
+                    WICED_BT_TRACE("xfer 0x%08x source failed at %d\n", xfer_id, offset);
+                    spp_xfer_set_state(SPP_XFER_STATE_IDLE);
+                }
+                break;
+            }
+            if (!queued_ok)
+            {
+                if ((xfer_id == p_tx->xfer_id) && (SPP_XFER_STATE_SENDING == p_tx->state))
+                {
+                    spp_xfer_stall();
+                }
+                break;
+            }
+            spp_xfer_queued++;
+            queued++;
+            if ((xfer_id != p_tx->xfer_id) || (SPP_XFER_STATE_SENDING != p_tx->state) ||
+                (offset != p_tx->send_offset))
+            {
+                /* Suspended or cancelled while the frame was filled. It goes
+                 * out anyway, the receiver drops what it already holds.
+                 */
+                continue;
+            }
+            if (offset < p_tx->high_offset)
+            {
+                spp_xfer_stats.bytes_resent += MIN(len, p_tx->high_offset - offset);
+            }
+            spp_xfer_stats.bytes_sent += len;
+            p_tx->send_offset += len;
+            p_tx->high_offset = MAX(p_tx->high_offset, p_tx->send_offset);
+            p_tx->retry_count = 0;
+        }
+        if ((SPP_XFER_STATE_SENDING == p_tx->state) && (p_tx->send_offset == p_tx->total_len))
+        {
+            spp_xfer_set_state(SPP_XFER_STATE_WAIT_FINAL_ACK);
+        }
+        /* Only kicked once the state is consistent, completions re-enter here */
+        if (0 != queued)
+        {
+            pthread_mutex_unlock(&spp_xfer_lock);
+            spp_tx_kick(handle);
+            pthread_mutex_lock(&spp_xfer_lock);
+            queued = 0;
+        }
+    } while (p_tx->pump_again && (SPP_XFER_STATE_SENDING == p_tx->state));
+
+    p_tx->pumping = WICED_FALSE;
+    pthread_mutex_unlock(&spp_xfer_lock);
+    spp_xfer_arm_timers();
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_send_ack
+ *******************************************************************************
+ * Summary:
+ *   Confirms the receive progress of p_rx to the sender. If the ACK cannot be
+ *   queued it is retried from the transfer timer. Called without
+ *   spp_xfer_lock.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   spp_xfer_rx_t *p_rx : receive entry
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_send_ack(uint16_t handle, spp_xfer_rx_t *p_rx)
+{
+    uint32_t xfer_id;
+    uint32_t offset;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    xfer_id = p_rx->xfer_id;
+    offset = p_rx->rx_offset;
+    p_rx->acked_offset = offset;
+    p_rx->ack_pending = WICED_FALSE;
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (spp_xfer_send_ctrl(handle, SPP_XFER_MSG_ACK, xfer_id, offset, 0))
+    {
+        return;
+    }
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (p_rx->in_use && (xfer_id == p_rx->xfer_id))
+    {
+        p_rx->ack_pending = WICED_TRUE;
+        spp_xfer_retry_pending = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+    spp_xfer_arm_timers();
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_handle_data
+ *******************************************************************************
+ * Summary:
+ *   Receiver side handling of a DATA frame, called with spp_xfer_lock held.
+ *   Bytes below the delivered offset are duplicates from a resumed transfer
+ *   and are dropped. A frame beyond the delivered offset cannot be placed, it
+ *   is dropped and the current offset is confirmed again. The new bytes are
+ *   reported back for delivery once the lock is released.
+ *
+ * Parameters:
+ *   spp_xfer_rx_t *p_rx : receive entry
+ *   uint32_t offset : offset of the frame
+ *   uint32_t len : payload length of the frame
+ *   uint32_t *p_skip : receives the number of duplicate bytes to skip
+ *   uint32_t *p_deliver : receives the number of new bytes to deliver
+ *   uint32_t *p_deliver_offset : receives the offset of the new bytes
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if an ACK is due
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_handle_data(spp_xfer_rx_t *p_rx, uint32_t offset, uint32_t len,
+                                         uint32_t *p_skip, uint32_t *p_deliver,
+                                         uint32_t *p_deliver_offset)
+{
+    uint32_t skip;
+
+    *p_deliver = 0;
+    if (offset > p_rx->rx_offset)
+    {
+        return WICED_TRUE;
+    }
+    skip = MIN(len, p_rx->rx_offset - offset);
+    spp_xfer_stats.bytes_duplicate += skip;
+    if (skip == len)
+    {
+        return WICED_FALSE;
+    }
+    len -= skip;
+    if (len > p_rx->total_len - p_rx->rx_offset)
+    {
+        len = p_rx->total_len - p_rx->rx_offset;
+    }
+    *p_skip = skip;
+    *p_deliver = len;
+    *p_deliver_offset = p_rx->rx_offset;
+    p_rx->rx_offset += len;
+    spp_xfer_stats.bytes_received += len;
+
+    return ((p_rx->rx_offset - p_rx->acked_offset >= SPP_XFER_ACK_INTERVAL) ||
+            (p_rx->rx_offset == p_rx->total_len)) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_handle_ack
+ *******************************************************************************
+ * Summary:
+ *   Sender side handling of an ACK, called with spp_xfer_lock held. The first
+ *   ACK after START carries the offset the receiver already holds, the
+ *   transfer continues from there.
+ *
+ * Parameters:
+ *   uint32_t offset : offset confirmed by the receiver
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if more data can be pumped
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_handle_ack(uint32_t offset)
+{
+    spp_xfer_tx_t *p_tx = &spp_xfer_tx;
+
+    if (offset > p_tx->total_len)
+    {
+        return WICED_FALSE;
+    }
+    if (SPP_XFER_STATE_WAIT_START_ACK == p_tx->state)
+    {
+        if (0 != offset)
+        {
+            spp_xfer_stats.xfers_resumed++;
+            spp_xfer_stats.bytes_resume_saved += offset;
+            WICED_BT_TRACE("xfer 0x%08x resuming at %d of %d\n", p_tx->xfer_id, offset, p_tx->total_len);
+        }
+        p_tx->acked_offset = offset;
+        p_tx->send_offset = offset;
+        spp_xfer_set_state(SPP_XFER_STATE_SENDING);
+    }
+    else if ((SPP_XFER_STATE_SENDING == p_tx->state) || (SPP_XFER_STATE_WAIT_FINAL_ACK == p_tx->state))
+    {
+        if (offset < p_tx->acked_offset)
+        {
+            return WICED_FALSE;
+        }
+        p_tx->acked_offset = offset;
+        /* Progress, the peer is still there */
+        p_tx->wait_since_ms = spp_xfer_now_ms();
+    }
+    else
+    {
+        return WICED_FALSE;
+    }
+
+    if (p_tx->acked_offset == p_tx->total_len)
+    {
+        fprintf(stdout, "xfer 0x%08x complete, %u bytes\n", p_tx->xfer_id, p_tx->total_len);
+        spp_xfer_stats.xfers_completed++;
+        spp_xfer_set_state(SPP_XFER_STATE_IDLE);
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the transfer layer
+ *
+ * Parameters:
+ *   spp_xfer_rx_cback_t p_rx_cback : called with received transfer content
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_init(spp_xfer_rx_cback_t p_rx_cback)
+{
+    pthread_mutex_lock(&spp_xfer_lock);
+    memset(&spp_xfer_tx, 0, sizeof(spp_xfer_tx));
+    memset(spp_xfer_rx, 0, sizeof(spp_xfer_rx));
+    memset(spp_xfer_links, 0, sizeof(spp_xfer_links));
+    spp_xfer_queued = 0;
+    spp_xfer_retry_pending = WICED_FALSE;
+    spp_xfer_rx_cback = p_rx_cback;
+    pthread_mutex_unlock(&spp_xfer_lock);
+    wiced_init_timer(&spp_xfer_timer, spp_xfer_timeout, 0, WICED_MILLI_SECONDS_TIMER);
+    wiced_init_timer(&spp_xfer_abandon_timer, spp_xfer_abandon_timeout, 0, WICED_SECONDS_TIMER);
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_start
+ *******************************************************************************
+ * Summary:
+ *   Starts a new resumable transfer to the peer connected on handle. The
+ *   check for a running transfer and the start are one step, so concurrent
+ *   callers cannot both start.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint32_t total_len : number of bytes to transfer
+ *   spp_xfer_fill_cback_t p_fill : produces the transfer content
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if a transfer is already in progress
+ *
+ ******************************************************************************/
+wiced_bool_t spp_xfer_start(uint16_t handle, uint32_t total_len, spp_xfer_fill_cback_t p_fill)
+{
+    struct timespec ts;
+    uint8_t *bda;
+    uint32_t xfer_id;
+
+    if ((NULL == p_fill) || (0 == total_len))
+    {
+        return WICED_FALSE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    bda = spp_xfer_link_bda(handle);
+    if ((SPP_XFER_STATE_IDLE != spp_xfer_tx.state) || (NULL == bda))
+    {
+        pthread_mutex_unlock(&spp_xfer_lock);
+        return WICED_FALSE;
+    }
+    memset(&spp_xfer_tx, 0, sizeof(spp_xfer_tx));
+    spp_xfer_tx.handle = handle;
+    memcpy(spp_xfer_tx.peer_bda, bda, sizeof(wiced_bt_device_address_t));
+    spp_xfer_tx.xfer_id = (uint32_t)ts.tv_nsec ^ ((uint32_t)ts.tv_sec << 12) ^ spp_xfer_stats.xfers_started;
+    spp_xfer_tx.total_len = total_len;
+    spp_xfer_tx.p_fill = p_fill;
+    spp_xfer_set_state(SPP_XFER_STATE_WAIT_START_ACK);
+    spp_xfer_stats.xfers_started++;
+    xfer_id = spp_xfer_tx.xfer_id;
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    WICED_BT_TRACE("xfer 0x%08x start, %d bytes\n", xfer_id, total_len);
+    spp_xfer_send_start();
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_is_idle
+ *******************************************************************************
+ * Summary:
+ *   Tells whether a new transfer can be started. Only a hint, spp_xfer_start()
+ *   checks again.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if no transfer is running or suspended
+ *
+ ******************************************************************************/
+wiced_bool_t spp_xfer_is_idle(void)
+{
+    wiced_bool_t idle;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    idle = (SPP_XFER_STATE_IDLE == spp_xfer_tx.state) ? WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_xfer_lock);
+    return idle;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_resume
+ *******************************************************************************
+ * Summary:
+ *   Resumes a suspended transfer from its last checkpoint if the peer is
+ *   connected
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_resume(void)
+{
+    wiced_bool_t resume = WICED_FALSE;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if ((SPP_XFER_STATE_SUSPENDED == spp_xfer_tx.state) && (0 != spp_xfer_tx.handle))
+    {
+        spp_xfer_set_state(SPP_XFER_STATE_WAIT_START_ACK);
+        resume = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (resume)
+    {
+        spp_xfer_send_start();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_cancel
+ *******************************************************************************
+ * Summary:
+ *   Abandons the transfer in progress, running or suspended, so a new one can
+ *   be started. Frames already queued still go out.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if there was no transfer
+ *
+ ******************************************************************************/
+wiced_bool_t spp_xfer_cancel(void)
+{
+    wiced_bool_t cancelled = WICED_FALSE;
+    uint32_t xfer_id = 0;
+    uint32_t acked = 0;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (SPP_XFER_STATE_IDLE != spp_xfer_tx.state)
+    {
+        xfer_id = spp_xfer_tx.xfer_id;
+        acked = spp_xfer_tx.acked_offset;
+        spp_xfer_set_state(SPP_XFER_STATE_IDLE);
+        spp_xfer_stats.xfers_cancelled++;
+        cancelled = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (cancelled)
+    {
+        fprintf(stdout, "xfer 0x%08x cancelled at checkpoint %u\n", xfer_id, acked);
+    }
+    return cancelled;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_connection_up
+ *******************************************************************************
+ * Summary:
+ *   Records the peer of a new session. A transfer suspended for the same peer
+ *   is resumed.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *bda : connected device's BD address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_connection_up(uint16_t handle, uint8_t *bda)
+{
+    wiced_bool_t resume = WICED_FALSE;
+    int i;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if (0 == spp_xfer_links[i].handle)
+        {
+            spp_xfer_links[i].handle = handle;
+            memcpy(spp_xfer_links[i].bda, bda, sizeof(wiced_bt_device_address_t));
+            break;
+        }
+    }
+
+    if ((SPP_XFER_STATE_SUSPENDED == spp_xfer_tx.state) &&
+        (0 == memcmp(spp_xfer_tx.peer_bda, bda, sizeof(wiced_bt_device_address_t))))
+    {
+        spp_xfer_tx.handle = handle;
+        spp_xfer_set_state(SPP_XFER_STATE_WAIT_START_ACK);
+        resume = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (resume)
+    {
+        spp_xfer_send_start();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_has_retry_work
+ *******************************************************************************
+ * Summary:
+ *   Tells whether the transfer timer still has something to retry on a
+ *   connected session: an ACK which could not be queued or a transfer which
+ *   is waiting to queue its START or its data. Called with spp_xfer_lock
+ *   held.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the timer must keep running
+ *
+ ******************************************************************************/
+static wiced_bool_t spp_xfer_has_retry_work(void)
+{
+    int i, j;
+
+    if ((0 != spp_xfer_tx.handle) &&
+        (((SPP_XFER_STATE_WAIT_START_ACK == spp_xfer_tx.state) && spp_xfer_tx.start_pending) ||
+         (SPP_XFER_STATE_SENDING == spp_xfer_tx.state)))
+    {
+        return WICED_TRUE;
+    }
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if (!spp_xfer_rx[i].in_use || !spp_xfer_rx[i].ack_pending)
+        {
+            continue;
+        }
+        for (j = 0; j < SPP_XFER_MAX_PEERS; j++)
+        {
+            if ((0 != spp_xfer_links[j].handle) &&
+                (0 == memcmp(spp_xfer_links[j].bda, spp_xfer_rx[i].peer_bda,
+                             sizeof(wiced_bt_device_address_t))))
+            {
+                return WICED_TRUE;
+            }
+        }
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_connection_down
+ *******************************************************************************
+ * Summary:
+ *   Suspends a transfer running on the session. The confirmed checkpoint and
+ *   the receive progress are kept for when the peer comes back. The retry
+ *   timer is shared by all sessions and only stopped once none of them has
+ *   anything left to retry.
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_connection_down(uint16_t handle)
+{
+    wiced_bool_t stop_retry;
+    int i;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if (handle == spp_xfer_links[i].handle)
+        {
+            spp_xfer_links[i].handle = 0;
+        }
+    }
+
+    if ((SPP_XFER_STATE_IDLE != spp_xfer_tx.state) && (handle == spp_xfer_tx.handle))
+    {
+        WICED_BT_TRACE("xfer 0x%08x suspended, checkpoint %d of %d\n",
+                       spp_xfer_tx.xfer_id, spp_xfer_tx.acked_offset, spp_xfer_tx.total_len);
+        spp_xfer_set_state(SPP_XFER_STATE_SUSPENDED);
+        spp_xfer_tx.send_offset = spp_xfer_tx.acked_offset;
+        spp_xfer_tx.handle = 0;
+        spp_xfer_tx.retry_count = 0;
+        spp_xfer_tx.start_pending = WICED_FALSE;
+    }
+    stop_retry = !spp_xfer_has_retry_work();
+    if (stop_retry)
+    {
+        spp_xfer_retry_pending = WICED_FALSE;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (stop_retry && wiced_is_timer_in_use(&spp_xfer_timer))
+    {
+        wiced_stop_timer(&spp_xfer_timer);
+    }
+    spp_xfer_arm_timers();
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_rx_data
+ *******************************************************************************
+ * Summary:
+ *   Processes data received on a session if it is a transfer frame
+ *
+ * Parameters:
+ *   uint16_t handle : spp handle
+ *   uint8_t *p_data : received data
+ *   uint32_t data_len : received data length
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the data was a transfer frame and consumed
+ *
+ ******************************************************************************/
+wiced_bool_t spp_xfer_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len)
+{
+    spp_xfer_rx_t *p_rx = NULL;
+    uint8_t *bda;
+    wiced_bool_t ack = WICED_FALSE;
+    wiced_bool_t pump = WICED_FALSE;
+    uint32_t xfer_id;
+    uint32_t offset;
+    uint32_t total_len = 0;
+    uint32_t skip = 0;
+    uint32_t deliver = 0;
+    uint32_t deliver_offset = 0;
+    uint16_t len;
+    uint8_t type;
+
+    if ((data_len < SPP_XFER_HDR_LEN) || (SPP_XFER_MAGIC_0 != p_data[0]) ||
+        (SPP_XFER_MAGIC_1 != p_data[1]))
+    {
+        return WICED_FALSE;
+    }
+    type = p_data[2];
+    xfer_id = spp_xfer_get_u32(&p_data[3]);
+    offset = spp_xfer_get_u32(&p_data[7]);
+    len = (uint16_t)(p_data[11] | (p_data[12] << 8));
+    if (SPP_XFER_HDR_LEN + len != data_len)
+    {
+        return WICED_FALSE;
+    }
+    if ((SPP_XFER_MSG_START != type) && (SPP_XFER_MSG_DATA != type) && (SPP_XFER_MSG_ACK != type))
+    {
+        return WICED_FALSE;
+    }
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    bda = spp_xfer_link_bda(handle);
+    switch (type)
+    {
+    case SPP_XFER_MSG_START:
+        if ((sizeof(uint32_t) != len) || (NULL == bda))
+        {
+            break;
+        }
+        p_rx = spp_xfer_rx_find(bda, WICED_TRUE);
+        if (p_rx->xfer_id != xfer_id)
+        {
+            /* New transfer, anything kept for an older one is stale */
+            p_rx->xfer_id = xfer_id;
+            p_rx->total_len = spp_xfer_get_u32(&p_data[SPP_XFER_HDR_LEN]);
+            p_rx->rx_offset = 0;
+        }
+        p_rx->acked_offset = p_rx->rx_offset;
+        WICED_BT_TRACE("xfer 0x%08x from peer, %d of %d bytes held\n", xfer_id, p_rx->rx_offset,
+                       p_rx->total_len);
+        ack = WICED_TRUE;
+        break;
+
+    case SPP_XFER_MSG_DATA:
+        if (NULL == bda)
+        {
+            break;
+        }
+        p_rx = spp_xfer_rx_find(bda, WICED_FALSE);
+        if ((NULL != p_rx) && (p_rx->xfer_id == xfer_id))
+        {
+            ack = spp_xfer_handle_data(p_rx, offset, len, &skip, &deliver, &deliver_offset);
+            total_len = p_rx->total_len;
+        }
+        break;
+
+    default:
+        if ((handle == spp_xfer_tx.handle) && (xfer_id == spp_xfer_tx.xfer_id))
+        {
+            pump = spp_xfer_handle_ack(offset);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    /* Frames arrive on the stack thread only, so deliveries stay in order */
+    if ((0 != deliver) && (NULL != spp_xfer_rx_cback))
+    {
+        spp_xfer_rx_cback(handle, xfer_id, deliver_offset, &p_data[SPP_XFER_HDR_LEN + skip], deliver,
+                          total_len);
+    }
+    if (ack)
+    {
+        spp_xfer_send_ack(handle, p_rx);
+    }
+    if (pump)
+    {
+        spp_xfer_pump();
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_timeout
+ *******************************************************************************
+ * Summary:
+ *   Retries whatever could not be sent because the stack had no credits
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    spp_xfer_rx_t *p_acks[SPP_XFER_MAX_PEERS];
+    uint16_t handles[SPP_XFER_MAX_PEERS];
+    wiced_bool_t start;
+    int count = 0;
+    int i, j;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    spp_xfer_retry_pending = WICED_FALSE;
+    for (i = 0; i < SPP_XFER_MAX_PEERS; i++)
+    {
+        if (!spp_xfer_rx[i].in_use || !spp_xfer_rx[i].ack_pending)
+        {
+            continue;
+        }
+        for (j = 0; j < SPP_XFER_MAX_PEERS; j++)
+        {
+            if ((0 != spp_xfer_links[j].handle) &&
+                (0 == memcmp(spp_xfer_links[j].bda, spp_xfer_rx[i].peer_bda,
+                             sizeof(wiced_bt_device_address_t))))
+            {
+                p_acks[count] = &spp_xfer_rx[i];
+                handles[count] = spp_xfer_links[j].handle;
+                count++;
+                break;
+            }
+        }
+    }
+    start = ((SPP_XFER_STATE_WAIT_START_ACK == spp_xfer_tx.state) && spp_xfer_tx.start_pending) ?
+            WICED_TRUE : WICED_FALSE;
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    for (i = 0; i < count; i++)
+    {
+        spp_xfer_send_ack(handles[i], p_acks[i]);
+    }
+    if (start)
+    {
+        spp_xfer_send_start();
+    }
+    else
+    {
+        spp_xfer_pump();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_abandon_timeout
+ *******************************************************************************
+ * Summary:
+ *   Abandons a transfer that has waited on the peer for
+ *   SPP_XFER_ABANDON_TIMEOUT seconds: for the answer to its START, for the
+ *   final ACK, or suspended for a peer that did not come back. Otherwise the
+ *   timer is started again for the time left.
+ *
+ * Parameters:
+ *   WICED_TIMER_PARAM_TYPE arg
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void spp_xfer_abandon_timeout(WICED_TIMER_PARAM_TYPE arg)
+{
+    wiced_bool_t abandoned = WICED_FALSE;
+    uint64_t waited_ms;
+    uint32_t left = 0;
+    uint32_t xfer_id = 0;
+    uint32_t acked = 0;
+
+    pthread_mutex_lock(&spp_xfer_lock);
+    if (spp_xfer_is_waiting())
+    {
+        waited_ms = spp_xfer_now_ms() - spp_xfer_tx.wait_since_ms;
+        if (waited_ms >= (uint64_t)SPP_XFER_ABANDON_TIMEOUT * 1000)
+        {
+            xfer_id = spp_xfer_tx.xfer_id;
+            acked = spp_xfer_tx.acked_offset;
+            spp_xfer_set_state(SPP_XFER_STATE_IDLE);
+            spp_xfer_stats.xfers_abandoned++;
+            abandoned = WICED_TRUE;
+        }
+        else
+        {
+            left = SPP_XFER_ABANDON_TIMEOUT - (uint32_t)(waited_ms / 1000);
+        }
+    }
+    pthread_mutex_unlock(&spp_xfer_lock);
+
+    if (abandoned)
+    {
+        fprintf(stdout, "xfer 0x%08x abandoned at checkpoint %u, no answer from the peer\n",
+                xfer_id, acked);
+    }
+    else if (0 != left)
+    {
+        wiced_start_timer(&spp_xfer_abandon_timer, left);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns a snapshot of the transfer counters
+ *
+ * Parameters:
+ *   spp_xfer_stats_t *p_stats : filled with the counters
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_get_stats(spp_xfer_stats_t *p_stats)
+{
+    pthread_mutex_lock(&spp_xfer_lock);
+    *p_stats = spp_xfer_stats;
+    pthread_mutex_unlock(&spp_xfer_lock);
+}
+
+/*******************************************************************************
+ * Function Name: spp_xfer_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the transfer counters
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void spp_xfer_print_stats(void)
+{
+    spp_xfer_stats_t stats;
+
+    spp_xfer_get_stats(&stats);
+    fprintf(stdout, "xfer: started %u completed %u resumed %u cancelled %u abandoned %u\n",
+            stats.xfers_started, stats.xfers_completed, stats.xfers_resumed,
+            stats.xfers_cancelled, stats.xfers_abandoned);
+    fprintf(stdout, "xfer tx: sent %llu bytes, resent %llu, saved by resume %llu\n",
+            (unsigned long long)stats.bytes_sent,
+            (unsigned long long)stats.bytes_resent,
+            (unsigned long long)stats.bytes_resume_saved);
+    fprintf(stdout, "xfer rx: received %llu bytes, duplicates dropped %llu\n",
+            (unsigned long long)stats.bytes_received,
+            (unsigned long long)stats.bytes_duplicate);
+}
+
+/* END OF FILE [] */
@@ -118,7 +118,7 @@ const wiced_bt_cfg_ble_advert_settings_t ble_advert_cfg = {
 
 const wiced_bt_cfg_ble_t ble_cfg = {
     .ble_max_simultaneous_links = 2,   /**< Max number for simultaneous connections for a layer, profile, protocol */
-    .ble_max_rx_pdu_size = 80,         /**< Max pdu size of the connections (size of data to be received/transmitted) */
+    .ble_max_rx_pdu_size = 517,        /**< Max pdu size of the connections (size of data to be received/transmitted) */
     .rpa_refresh_timeout = WICED_BT_CFG_DEFAULT_RANDOM_ADDRESS_NEVER_CHANGE,          /**< Interval of  random address refreshing - secs  @note BLE Privacy is disabled if the value is 0. */
     .host_addr_resolution_db_size = 5, /**< addr resolution db size */
 
@@ -147,11 +147,11 @@ const wiced_bt_cfg_gatt_t gatt_cfg =
 const wiced_bt_cfg_l2cap_application_t l2cap_application =                                                                             /* Application managed l2cap protocol configuration */
 {
     /* BR EDR l2cap configuration */
-    .max_app_l2cap_psms = 0,           /**< Maximum number of application-managed BR/EDR PSMs */
+    .max_app_l2cap_psms = 1,           /**< Maximum number of application-managed BR/EDR PSMs */
     .max_app_l2cap_channels = 12,      /**< Maximum number of application-managed BR/EDR channels  */
 
     .max_app_l2cap_br_edr_ertm_chnls = 2,               /**< Maximum ERTM channels  */
-    .max_app_l2cap_br_edr_ertm_tx_win = 1,              /**< Maximum TX Window      */
+    .max_app_l2cap_br_edr_ertm_tx_win = 32,             /**< Maximum TX Window      */
 
     .max_app_l2cap_le_fixed_channels = 0,  /**< Maximum RX MTU allowed */
 };
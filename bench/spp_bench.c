@@ -0,0 +1,505 @@
+/*******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *******************************************************************************/
+/******************************************************************************
+ * File Name: spp_bench.c
+ *
+ * Description: Microbenchmarks for the SPP application hot paths. The
+ *              application source is compiled into this translation unit
+ *              so its static handlers can be driven directly, while the BT
+ *              stack and SPP profile are replaced by spp_bench_stubs.c.
+ *
+ *              Results are written as JSON, one object per benchmark case.
+ *
+ * Usage: spp_bench [-o <json_file>] [-r <repetitions>]
+ *
+ * Related Document: See README.md
+ *
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "spp_bench_stubs.h"
+
+/* Application under test, statics included */
+#include "../app/spp.c"
+
+/*******************************************************************************
+ *                               MACROS
+ *******************************************************************************/
+#define BENCH_DEFAULT_REPETITIONS (5)
+#define BENCH_MAX_REPETITIONS     (101)
+#define BENCH_NSEC_PER_SEC        (1000000000ULL)
+/* Bulk payload of the RFCOMM / L2CAP comparison */
+#define BENCH_BULK_LEN            (32768)
+/* Session of the L2CAP bulk channel */
+#define BENCH_L2CAP_HANDLE        (SPP_L2CAP_HANDLE_FLAG | 1)
+#define BENCH_L2CAP_CID           (0x0040)
+
+/*******************************************************************************
+ *                               STRUCTURES AND ENUMERATIONS
+ *******************************************************************************/
+typedef void (*bench_fn_t)(uint32_t param);
+
+typedef struct
+{
+    const char *name;        /* benchmark case name */
+    const char *label;       /* readable form of param */
+    bench_fn_t fn;           /* one call of the code under test */
+    uint32_t param;          /* case parameter, e.g. packet size */
+    uint32_t iterations;     /* calls per repetition */
+    uint32_t bytes_per_call; /* payload bytes moved per call, 0 if n/a */
+} bench_case_t;
+
+/******************************************************************************
+ *                               GLOBAL VARIABLES
+ ******************************************************************************/
+/* Normally provided by main.c */
+uint8_t spp_bd_address[LOCAL_BDA_LEN] = {0x11, 0x12, 0x13, 0x21, 0x22, 0x23};
+
+static uint8_t bench_rx_packet[SPP_MAX_PAYLOAD];
+static uint8_t bench_iov_header[8];
+static uint8_t bench_iov_payload[8000];
+static uint8_t bench_mux_packet[4 * SPP_MAX_PAYLOAD];
+static uint8_t bench_bulk_payload[BENCH_BULK_LEN];
+static uint8_t bench_pattern_buf[SPP_MAX_PAYLOAD];
+static int bench_devnull_fd = -1;
+static int bench_stdout_fd = -1;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+static void bench_rx_data(uint32_t len);
+static void bench_send_sample_data(uint32_t unused);
+static void bench_write_eir(uint32_t unused);
+static void bench_management_event(uint32_t event);
+static void bench_send_iov(uint32_t payload_len);
+static void bench_coalesce_write(uint32_t len);
+static void bench_mux_send(uint32_t stream_id);
+static void bench_mux_rx_data(uint32_t chunk_len);
+static void bench_sink_rx_data(uint32_t type);
+static void bench_bcast_send(uint32_t len);
+static void bench_rfcomm_frames(uint32_t frame_size);
+static void bench_l2cap_frames(uint32_t frame_size);
+static void bench_pattern_fill(uint32_t len);
+static void bench_pattern_verify(uint32_t len);
+
+/******************************************************************************
+ *                               BENCHMARK CASES
+ ******************************************************************************/
+static const bench_case_t bench_cases[] =
+{
+    { "spp_rx_data_callback", "1 byte", bench_rx_data, 1, 20000, 1 },
+    { "spp_rx_data_callback", "16 bytes", bench_rx_data, 16, 20000, 16 },
+    { "spp_rx_data_callback", "128 bytes", bench_rx_data, 128, 5000, 128 },
+    { "spp_rx_data_callback", "SPP_MAX_PAYLOAD", bench_rx_data, SPP_MAX_PAYLOAD, 1000, SPP_MAX_PAYLOAD },
+    { "spp_send_sample_data", "SPP_TOTAL_DATA_TO_SEND", bench_send_sample_data, 0, 2000, SPP_TOTAL_DATA_TO_SEND },
+    { "spp_send_iov", "8 + 100 bytes", bench_send_iov, 100, 100000, 108 },
+    { "spp_send_iov", "8 + SPP_MAX_PAYLOAD", bench_send_iov, SPP_MAX_PAYLOAD, 50000, 8 + SPP_MAX_PAYLOAD },
+    { "spp_send_iov", "8 + 8000 bytes", bench_send_iov, 8000, 20000, 8008 },
+    { "spp_send_iov", "rfcomm 32 KB, 330 byte frames", bench_rfcomm_frames, 330, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "rfcomm 32 KB, 672 byte frames", bench_rfcomm_frames, 672, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "rfcomm 32 KB, 1007 byte frames", bench_rfcomm_frames, 1007, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "l2cap 32 KB, 672 byte frames", bench_l2cap_frames, 672, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "l2cap 32 KB, 1007 byte frames", bench_l2cap_frames, 1007, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "l2cap 32 KB, 4096 byte frames", bench_l2cap_frames, 4096, 2000, BENCH_BULK_LEN },
+    { "spp_send_iov", "l2cap 32 KB, 8192 byte frames", bench_l2cap_frames, 8192, 2000, BENCH_BULK_LEN },
+    { "spp_coalesce_write", "32 bytes", bench_coalesce_write, 32, 200000, 32 },
+    { "spp_mux_send", "control 32 bytes", bench_mux_send, SPP_MUX_STREAM_CONTROL, 100000, 32 },
+    { "spp_mux_send", "bulk 8000 bytes", bench_mux_send, SPP_MUX_STREAM_BULK, 20000, 8000 },
+    { "spp_bcast_send", "8000 bytes", bench_bcast_send, 8000, 20000, 8000 },
+    { "spp_mux_rx_data", "4 x 100 byte chunks", bench_mux_rx_data, 100, 50000, 400 },
+    { "spp_write_eir", "", bench_write_eir, 0, 20000, 0 },
+    { "spp_management_callback", "BTM_USER_CONFIRMATION_REQUEST_EVT", bench_management_event,
+      BTM_USER_CONFIRMATION_REQUEST_EVT, 200000, 0 },
+    { "spp_management_callback", "BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT", bench_management_event,
+      BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT, 200000, 0 },
+    { "spp_management_callback", "BTM_ENCRYPTION_STATUS_EVT", bench_management_event,
+      BTM_ENCRYPTION_STATUS_EVT, 200000, 0 },
+    { "spp_management_callback", "BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT", bench_management_event,
+      BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT, 200000, 0 },
+    { "spp_management_callback", "default", bench_management_event,
+      BTM_BLE_SCAN_STATE_CHANGED_EVT, 200000, 0 },
+    { "spp_sink_rx_data", "discard SPP_MAX_PAYLOAD", bench_sink_rx_data, SPP_SINK_DISCARD, 200000, SPP_MAX_PAYLOAD },
+    { "spp_sink_rx_data", "checksum SPP_MAX_PAYLOAD", bench_sink_rx_data, SPP_SINK_CHECKSUM, 20000, SPP_MAX_PAYLOAD },
+    { "spp_sink_rx_data", "ring SPP_MAX_PAYLOAD", bench_sink_rx_data, SPP_SINK_RING, 100000, SPP_MAX_PAYLOAD },
+    { "spp_pattern_fill", "xorshift SPP_MAX_PAYLOAD", bench_pattern_fill, SPP_MAX_PAYLOAD, 200000, SPP_MAX_PAYLOAD },
+    { "spp_pattern_verify", "xorshift SPP_MAX_PAYLOAD", bench_pattern_verify, SPP_MAX_PAYLOAD, 200000, SPP_MAX_PAYLOAD },
+};
+
+/******************************************************************************
+ *                               FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Function Name: bench_now_ns()
+ *******************************************************************************
+ * Summary:
+ *   Reads the monotonic clock
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   uint64_t : current time in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * BENCH_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/******************************************************************************
+ * Function Name: bench_mute_app() / bench_unmute_app()
+ *******************************************************************************
+ * Summary:
+ *   The application prints from its hot paths. Its output still has to be
+ *   formatted, so it is sent to /dev/null instead of being compiled out,
+ *   which keeps the measured cost representative.
+ *
+ ******************************************************************************/
+static void bench_mute_app(void)
+{
+    fflush(stdout);
+    dup2(bench_devnull_fd, STDOUT_FILENO);
+}
+
+static void bench_unmute_app(void)
+{
+    fflush(stdout);
+    dup2(bench_stdout_fd, STDOUT_FILENO);
+}
+
+static void bench_rx_data(uint32_t len)
+{
+    spp_reg.p_rx_data_callback(spp_handle, bench_rx_packet, len);
+}
+
+static void bench_send_sample_data(uint32_t unused)
+{
+    spp_send_sample_data();
+}
+
+static void bench_send_iov(uint32_t payload_len)
+{
+    spp_iovec_t iov[2] =
+    {
+        { bench_iov_header, sizeof(bench_iov_header), NULL, NULL },
+        { bench_iov_payload, payload_len, NULL, NULL },
+    };
+
+    spp_send_iov(spp_handle, iov, 2);
+}
+
+/* The same bulk payload cut into frames of a given size, RFCOMM first and
+ * then the L2CAP bulk channel. The frame size is restored for the other cases.
+ */
+static void bench_rfcomm_frames(uint32_t frame_size)
+{
+    spp_iovec_t iov = { bench_bulk_payload, BENCH_BULK_LEN, NULL, NULL };
+
+    spp_tx_set_frame_size(spp_handle, frame_size);
+    spp_send_iov(spp_handle, &iov, 1);
+    spp_tx_set_frame_size(spp_handle, SPP_MAX_PAYLOAD);
+}
+
+static void bench_l2cap_frames(uint32_t frame_size)
+{
+    spp_iovec_t iov = { bench_bulk_payload, BENCH_BULK_LEN, NULL, NULL };
+
+    spp_tx_set_frame_size(BENCH_L2CAP_HANDLE, frame_size);
+    spp_send_iov(BENCH_L2CAP_HANDLE, &iov, 1);
+}
+
+static void bench_coalesce_write(uint32_t len)
+{
+    spp_coalesce_write(spp_handle, bench_rx_packet, len);
+}
+
+static void bench_mux_send(uint32_t stream_id)
+{
+    spp_mux_send(spp_handle, (uint8_t)stream_id, bench_iov_payload,
+                 (SPP_MUX_STREAM_CONTROL == stream_id) ? 32 : 8000, NULL, NULL);
+}
+
+static void bench_mux_rx_data(uint32_t chunk_len)
+{
+    uint8_t *p = bench_mux_packet;
+    int i;
+
+    /* Built once, chunks then arrive back to back in one packet */
+    if (SPP_MUX_MAGIC != bench_mux_packet[0])
+    {
+        for (i = 0; i < 4; i++)
+        {
+            p[0] = SPP_MUX_MAGIC;
+            p[1] = SPP_MUX_STREAM_BULK;
+            p[2] = (uint8_t)(chunk_len & 0xFF);
+            p[3] = (uint8_t)(chunk_len >> 8);
+            memset(&p[SPP_MUX_HDR_LEN], 0x20 + i, chunk_len);
+            p += SPP_MUX_HDR_LEN + chunk_len;
+        }
+    }
+    spp_mux_rx_data(spp_handle, bench_mux_packet, 4 * (SPP_MUX_HDR_LEN + chunk_len));
+}
+
+static void bench_bcast_send(uint32_t len)
+{
+    spp_bcast_send(bench_iov_payload, len, NULL, NULL);
+}
+
+static void bench_sink_rx_data(uint32_t type)
+{
+    static const char *specs[SPP_SINK_TYPES] = { "print", "discard", "checksum", NULL, NULL, "ring" };
+    static uint32_t selected = SPP_SINK_PRINT;
+
+    /* The sink is switched by the warm up call, outside the timed loop */
+    if (selected != type)
+    {
+        spp_sink_select(spp_handle, specs[type]);
+        selected = type;
+    }
+    spp_sink_rx_data(spp_handle, bench_rx_packet, SPP_MAX_PAYLOAD);
+}
+
+/* Walks the stream so every call starts at another table position */
+static void bench_pattern_fill(uint32_t len)
+{
+    static uint64_t offset = 0;
+
+    spp_pattern_fill(offset, bench_pattern_buf, len);
+    offset += len;
+}
+
+/* Checks data which matches, the common case of a healthy link */
+static void bench_pattern_verify(uint32_t len)
+{
+    uint32_t first;
+
+    if (0 != spp_pattern_verify(0, bench_pattern_buf, len, &first))
+    {
+        spp_pattern_fill(0, bench_pattern_buf, len);
+    }
+}
+
+static void bench_write_eir(uint32_t unused)
+{
+    spp_write_eir();
+}
+
+static void bench_management_event(uint32_t event)
+{
+    wiced_bt_management_evt_data_t event_data;
+
+    memset(&event_data, 0, sizeof(event_data));
+    spp_management_callback((wiced_bt_management_evt_t)event, &event_data);
+}
+
+static int bench_compare_u64(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/******************************************************************************
+ * Function Name: bench_run_case()
+ *******************************************************************************
+ * Summary:
+ *   Runs one benchmark case and prints its result as a JSON object
+ *
+ * Parameters:
+ *   const bench_case_t *p_case : case to run
+ *   int repetitions            : number of timed repetitions
+ *   FILE *p_out                : JSON output stream
+ *   int first                  : non-zero for the first case in the list
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void bench_run_case(const bench_case_t *p_case, int repetitions, FILE *p_out, int first)
+{
+    uint64_t samples[BENCH_MAX_REPETITIONS];
+    uint64_t start;
+    uint32_t i;
+    int rep;
+    double median_ns;
+    double min_ns;
+    double mb_per_sec = 0;
+
+    bench_stub_reset();
+    bench_mute_app();
+    /* Warm up caches and branch predictors */
+    for (i = 0; i < p_case->iterations / 10 + 1; i++)
+    {
+        p_case->fn(p_case->param);
+    }
+    for (rep = 0; rep < repetitions; rep++)
+    {
+        start = bench_now_ns();
+        for (i = 0; i < p_case->iterations; i++)
+        {
+            p_case->fn(p_case->param);
+        }
+        samples[rep] = bench_now_ns() - start;
+        /* Hand back a partly filled coalescing frame before freeing buffers */
+        spp_coalesce_flush(spp_handle);
+        bench_stub_release_buffers();
+    }
+    bench_unmute_app();
+
+    qsort(samples, repetitions, sizeof(samples[0]), bench_compare_u64);
+    median_ns = (double)samples[repetitions / 2] / p_case->iterations;
+    min_ns = (double)samples[0] / p_case->iterations;
+    if (0 != p_case->bytes_per_call)
+    {
+        mb_per_sec = (p_case->bytes_per_call / median_ns) * 1e9 / 1e6;
+    }
+
+    fprintf(p_out, "%s    {\"name\": \"%s\", \"label\": \"%s\", \"param\": %u, \"iterations\": %u, "
+            "\"repetitions\": %d, \"ns_per_call_median\": %.1f, \"ns_per_call_min\": %.1f, "
+            "\"mb_per_sec\": %.2f",
+            first ? "" : ",\n", p_case->name, p_case->label, p_case->param, p_case->iterations,
+            repetitions, median_ns, min_ns, mb_per_sec);
+    if (0 != bench_stub_air_packets)
+    {
+        /* Share of the modelled baseband payload carrying application data */
+        fprintf(p_out, ", \"air_efficiency\": %.3f",
+                (double)bench_stub_tx_bytes / (bench_stub_air_packets * (double)BENCH_STUB_ACL_PAYLOAD));
+    }
+    fprintf(p_out, "}");
+}
+
+/******************************************************************************
+ * Function Name: main()
+ *******************************************************************************
+ * Summary:
+ *   Benchmark entry function
+ *
+ * Parameters:
+ *   int argc            : argument count
+ *   char *argv[]        : list of arguments
+ *
+ * Return:
+ *   EXIT_SUCCESS or EXIT_FAILURE
+ *
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    const char *out_path = NULL;
+    int repetitions = BENCH_DEFAULT_REPETITIONS;
+    FILE *p_out;
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-o <json_file>] [-r <repetitions>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((repetitions < 1) || (repetitions > BENCH_MAX_REPETITIONS))
+    {
+        fprintf(stderr, "repetitions must be 1..%d\n", BENCH_MAX_REPETITIONS);
+        return EXIT_FAILURE;
+    }
+
+    bench_devnull_fd = open("/dev/null", O_WRONLY);
+    bench_stdout_fd = dup(STDOUT_FILENO);
+    if ((bench_devnull_fd < 0) || (bench_stdout_fd < 0))
+    {
+        perror("spp_bench");
+        return EXIT_FAILURE;
+    }
+
+    /* Bring the application up the same way the porting layer does */
+    bench_mute_app();
+    spp_l2cap_configure(SPP_L2CAP_MAX_MTU, SPP_L2CAP_MODE_ERTM);
+    spp_pattern_configure("xorshift:1");
+    spp_application_start();
+    {
+        wiced_bt_management_evt_data_t event_data;
+
+        memset(&event_data, 0, sizeof(event_data));
+        event_data.enabled.status = WICED_BT_SUCCESS;
+        bench_stub_management_cb(BTM_ENABLED_EVT, &event_data);
+    }
+    /* An L2CAP bulk channel next to the RFCOMM session the other cases use */
+    bench_stub_l2cap_info->connected_cback(NULL, spp_bd_address, BENCH_L2CAP_CID, SPP_L2CAP_MAX_MTU);
+    spp_connection_up_callback(1, spp_bd_address);
+    spp_coalesce_configure(WICED_TRUE, SPP_COALESCE_DEFAULT_DEADLINE_US);
+    bench_stub_pin_buffers();
+    bench_unmute_app();
+
+    for (i = 0; i < sizeof(bench_rx_packet); i++)
+    {
+        bench_rx_packet[i] = 0x20 + (i % 0x5F);
+    }
+
+    /* Results never share a stdio stream with the muted application output */
+    p_out = (NULL != out_path) ? fopen(out_path, "w") : fdopen(dup(bench_stdout_fd), "w");
+    if (NULL == p_out)
+    {
+        perror(out_path);
+        return EXIT_FAILURE;
+    }
+    fprintf(p_out, "{\n  \"benchmark\": \"spp_bench\",\n  \"results\": [\n");
+    for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++)
+    {
+        bench_run_case(&bench_cases[i], repetitions, p_out, 0 == i);
+        fflush(p_out);
+    }
+    fprintf(p_out, "\n  ]\n}\n");
+    fclose(p_out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,614 @@
+/*******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *******************************************************************************/
+/******************************************************************************
+ * File Name: spp_bench_stubs.c
+ *
+ * Description: Stubbed BT stack, SPP profile and porting layer APIs used by
+ *              the SPP benchmark target.
+ *
+ * Related Document: See README.md
+ *
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include "wiced_bt_trace.h"
+#include "wiced_bt_dev.h"
+#include "wiced_bt_stack.h"
+#include "wiced_memory.h"
+#include "wiced_hal_nvram.h"
+#include "wiced_bt_sdp.h"
+#include "wiced_bt_spp.h"
+#include "wiced_bt_ble.h"
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_l2c.h"
+#include "wiced_timer.h"
+#include "spp_bench_stubs.h"
+
+/*******************************************************************************
+ *                               MACROS
+ *******************************************************************************/
+#define BENCH_STUB_MAX_TIMERS (32)
+/* L2CAP basic header */
+#define BENCH_STUB_L2CAP_HDR   (4)
+
+/*******************************************************************************
+ *                               STRUCTURES AND ENUMERATIONS
+ *******************************************************************************/
+/* Header placed in front of every buffer returned by wiced_bt_get_buffer */
+typedef union bench_buf_hdr
+{
+    struct
+    {
+        union bench_buf_hdr *p_next;
+        union bench_buf_hdr *p_prev;
+        wiced_bool_t pinned;
+    } link;
+    long double align;
+} bench_buf_hdr_t;
+
+/******************************************************************************
+ *                               GLOBAL VARIABLES
+ ******************************************************************************/
+wiced_bt_management_cback_t *bench_stub_management_cb = NULL;
+wiced_bt_connection_status_change_cback_t *bench_stub_connection_status_cb = NULL;
+wiced_bool_t bench_stub_can_send = WICED_TRUE;
+wiced_bool_t bench_stub_use_credits = WICED_FALSE;
+uint32_t bench_stub_credits[BENCH_STUB_MAX_HANDLES];
+uint64_t bench_stub_handle_tx_bytes[BENCH_STUB_MAX_HANDLES];
+uint64_t bench_stub_tx_calls = 0;
+uint64_t bench_stub_tx_bytes = 0;
+uint64_t bench_stub_air_packets = 0;
+wiced_bt_l2cap_appl_information_t *bench_stub_l2cap_info = NULL;
+wiced_bt_gatt_cback_t *bench_stub_gatt_cb = NULL;
+uint32_t bench_stub_buffers_outstanding = 0;
+
+static bench_buf_hdr_t *bench_buf_list = NULL;
+static wiced_timer_t *bench_timers_in_use[BENCH_STUB_MAX_TIMERS];
+static uint8_t bench_nvram_data[512];
+static uint16_t bench_nvram_len = 0;
+
+/******************************************************************************
+ *                               FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Function Name: bench_stub_reset()
+ *******************************************************************************
+ * Summary:
+ *   Clears the counters kept by the stubs
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void bench_stub_reset(void)
+{
+    bench_stub_can_send = WICED_TRUE;
+    bench_stub_use_credits = WICED_FALSE;
+    memset(bench_stub_credits, 0, sizeof(bench_stub_credits));
+    memset(bench_stub_handle_tx_bytes, 0, sizeof(bench_stub_handle_tx_bytes));
+    bench_stub_tx_calls = 0;
+    bench_stub_tx_bytes = 0;
+    bench_stub_air_packets = 0;
+}
+
+/******************************************************************************
+ * Function Name: bench_stub_release_buffers()
+ *******************************************************************************
+ * Summary:
+ *   Frees every buffer still held by the application, so benchmarks of code
+ *   paths which never free their buffers stay bounded in memory
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void bench_stub_release_buffers(void)
+{
+    bench_buf_hdr_t *p_hdr = bench_buf_list;
+    bench_buf_hdr_t *p_next;
+
+    while (NULL != p_hdr)
+    {
+        p_next = p_hdr->link.p_next;
+        if (!p_hdr->link.pinned)
+        {
+            wiced_bt_free_buffer(p_hdr + 1);
+        }
+        p_hdr = p_next;
+    }
+}
+
+/******************************************************************************
+ * Function Name: bench_stub_pin_buffers()
+ *******************************************************************************
+ * Summary:
+ *   Marks every buffer currently held by the application as long lived, so
+ *   bench_stub_release_buffers() leaves it alone (e.g. per-session TX frames)
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void bench_stub_pin_buffers(void)
+{
+    bench_buf_hdr_t *p_hdr;
+
+    for (p_hdr = bench_buf_list; NULL != p_hdr; p_hdr = p_hdr->link.p_next)
+    {
+        p_hdr->link.pinned = WICED_TRUE;
+    }
+}
+
+/******************************************************************************
+ * Function Name: bench_stub_timers_running()
+ *******************************************************************************
+ * Summary:
+ *   Counts the timers started and not stopped yet. The stub timers never
+ *   fire, so a timer the application forgets to stop stays counted.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   uint32_t : number of running timers
+ *
+ ******************************************************************************/
+uint32_t bench_stub_timers_running(void)
+{
+    uint32_t count = 0;
+    int i;
+
+    for (i = 0; i < BENCH_STUB_MAX_TIMERS; i++)
+    {
+        count += (NULL != bench_timers_in_use[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+/* Trace output of the porting layer */
+int wiced_printf(char *buffer, int len, ...)
+{
+    va_list args;
+    const char *fmt;
+    int ret;
+
+    va_start(args, len);
+    fmt = va_arg(args, const char *);
+    ret = vfprintf(stdout, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+void wiced_trace_array(const uint8_t *p_array, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        fprintf(stdout, "%02x ", p_array[i]);
+    }
+    fprintf(stdout, "\n");
+}
+
+/* Stack */
+wiced_result_t wiced_bt_stack_init(wiced_bt_management_cback_t *p_bt_management_cback,
+                                   const wiced_bt_cfg_settings_t *p_bt_cfg_settings)
+{
+    bench_stub_management_cb = p_bt_management_cback;
+    return WICED_BT_SUCCESS;
+}
+
+wiced_bt_heap_t *wiced_bt_create_heap(const char *name, void *p_area, int size,
+                                      wiced_bt_lock_t *p_lock, wiced_bool_t b_make_default)
+{
+    static uint64_t heap_token;
+
+    return (wiced_bt_heap_t *)&heap_token;
+}
+
+void *wiced_bt_get_buffer(uint32_t size)
+{
+    bench_buf_hdr_t *p_hdr = malloc(sizeof(bench_buf_hdr_t) + size);
+
+    if (NULL == p_hdr)
+    {
+        return NULL;
+    }
+    p_hdr->link.p_prev = NULL;
+    p_hdr->link.pinned = WICED_FALSE;
+    p_hdr->link.p_next = bench_buf_list;
+    if (NULL != bench_buf_list)
+    {
+        bench_buf_list->link.p_prev = p_hdr;
+    }
+    bench_buf_list = p_hdr;
+    bench_stub_buffers_outstanding++;
+    return p_hdr + 1;
+}
+
+void wiced_bt_free_buffer(void *p_buf)
+{
+    bench_buf_hdr_t *p_hdr;
+
+    if (NULL == p_buf)
+    {
+        return;
+    }
+    p_hdr = (bench_buf_hdr_t *)p_buf - 1;
+    if (NULL != p_hdr->link.p_prev)
+    {
+        p_hdr->link.p_prev->link.p_next = p_hdr->link.p_next;
+    }
+    else
+    {
+        bench_buf_list = p_hdr->link.p_next;
+    }
+    if (NULL != p_hdr->link.p_next)
+    {
+        p_hdr->link.p_next->link.p_prev = p_hdr->link.p_prev;
+    }
+    bench_stub_buffers_outstanding--;
+    free(p_hdr);
+}
+
+/* Device manager */
+wiced_result_t wiced_bt_set_local_bdaddr(wiced_bt_device_address_t bd_addr,
+                                         wiced_bt_ble_address_type_t addr_type)
+{
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_dev_read_local_addr(wiced_bt_device_address_t bd_addr)
+{
+    memset(bd_addr, 0, sizeof(wiced_bt_device_address_t));
+}
+
+void wiced_bt_dev_pin_code_reply(wiced_bt_device_address_t bd_addr, wiced_result_t res,
+                                 uint8_t pin_len, uint8_t *p_pin)
+{
+}
+
+void wiced_bt_dev_confirm_req_reply(wiced_result_t res, wiced_bt_device_address_t bd_addr)
+{
+}
+
+wiced_result_t wiced_bt_dev_register_connection_status_change(
+    wiced_bt_connection_status_change_cback_t *p_cback)
+{
+    bench_stub_connection_status_cb = p_cback;
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_write_eir(uint8_t *p_buff, uint16_t len)
+{
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_set_pairable_mode(uint8_t allow_pairing, uint8_t connect_only_paired)
+{
+}
+
+wiced_result_t wiced_bt_dev_set_discoverability(uint8_t inq_mode, uint16_t window,
+                                                uint16_t interval)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_set_connectability(uint8_t page_mode, uint16_t window,
+                                               uint16_t interval)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_set_link_policy(wiced_bt_device_address_t remote_bda, uint16_t *settings)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_switch_role(wiced_bt_device_address_t remote_bd_addr, uint8_t new_role,
+                                        wiced_bt_dev_cmpl_cback_t *p_cb)
+{
+    return WICED_BT_PENDING;
+}
+
+wiced_result_t wiced_bt_dev_get_role(wiced_bt_device_address_t remote_bd_addr, uint8_t *p_role,
+                                     wiced_bt_transport_t transport)
+{
+    *p_role = HCI_ROLE_CENTRAL;
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_vendor_specific_command(uint16_t opcode, uint8_t param_len,
+                                                   uint8_t *p_param_buf,
+                                                   wiced_bt_dev_vendor_specific_command_complete_cback_t *p_cback)
+{
+    return WICED_BT_PENDING;
+}
+
+wiced_bool_t wiced_bt_sdp_db_init(uint8_t *p_sdp_db, uint16_t size)
+{
+    return WICED_TRUE;
+}
+
+/* NVRAM, a single record is enough for this application */
+uint16_t wiced_hal_write_nvram(uint16_t vs_id, uint16_t data_length, uint8_t *p_data,
+                               wiced_result_t *p_status)
+{
+    bench_nvram_len = MIN(data_length, sizeof(bench_nvram_data));
+    memcpy(bench_nvram_data, p_data, bench_nvram_len);
+    *p_status = WICED_BT_SUCCESS;
+    return bench_nvram_len;
+}
+
+uint16_t wiced_hal_read_nvram(uint16_t vs_id, uint16_t data_length, uint8_t *p_data,
+                              wiced_result_t *p_status)
+{
+    uint16_t len = MIN(data_length, bench_nvram_len);
+
+    memcpy(p_data, bench_nvram_data, len);
+    *p_status = (0 != len) ? WICED_BT_SUCCESS : WICED_BT_ERROR;
+    return len;
+}
+
+/* Timers never fire, the benchmark drives every code path directly */
+wiced_result_t wiced_init_timer(wiced_timer_t *p_timer, wiced_timer_callback_t TimerCb,
+                                WICED_TIMER_PARAM_TYPE cBackparam, wiced_timer_type_t type)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_start_timer(wiced_timer_t *p_timer, uint32_t timeout)
+{
+    int i;
+
+    for (i = 0; i < BENCH_STUB_MAX_TIMERS; i++)
+    {
+        if ((bench_timers_in_use[i] == p_timer) || (NULL == bench_timers_in_use[i]))
+        {
+            bench_timers_in_use[i] = p_timer;
+            return WICED_BT_SUCCESS;
+        }
+    }
+    return WICED_BT_NO_RESOURCES;
+}
+
+wiced_result_t wiced_stop_timer(wiced_timer_t *p_timer)
+{
+    int i;
+
+    for (i = 0; i < BENCH_STUB_MAX_TIMERS; i++)
+    {
+        if (bench_timers_in_use[i] == p_timer)
+        {
+            bench_timers_in_use[i] = NULL;
+        }
+    }
+    return WICED_BT_SUCCESS;
+}
+
+wiced_bool_t wiced_is_timer_in_use(wiced_timer_t *p_timer)
+{
+    int i;
+
+    for (i = 0; i < BENCH_STUB_MAX_TIMERS; i++)
+    {
+        if (bench_timers_in_use[i] == p_timer)
+        {
+            return WICED_TRUE;
+        }
+    }
+    return WICED_FALSE;
+}
+
+/* SPP profile */
+wiced_result_t wiced_bt_spp_startup(wiced_bt_spp_reg_t *p_reg)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_spp_connect(BD_ADDR bd_addr)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_spp_disconnect(uint16_t handle)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_bool_t wiced_bt_spp_can_send_more_data(uint16_t handle)
+{
+    if (bench_stub_use_credits && ((handle >= BENCH_STUB_MAX_HANDLES) || (0 == bench_stub_credits[handle])))
+    {
+        return WICED_FALSE;
+    }
+    return bench_stub_can_send;
+}
+
+wiced_bool_t wiced_bt_spp_send_session_data(uint16_t handle, uint8_t *p_data, uint32_t length)
+{
+    /* RFCOMM address, control, length (two bytes above 127), credit and
+     * FCS fields, in one L2CAP basic frame
+     */
+    uint32_t frame_len = BENCH_STUB_L2CAP_HDR + length + 5 + ((length > 127) ? 1 : 0);
+
+    if (bench_stub_use_credits)
+    {
+        if ((handle >= BENCH_STUB_MAX_HANDLES) || (0 == bench_stub_credits[handle]))
+        {
+            return WICED_FALSE;
+        }
+        bench_stub_credits[handle]--;
+    }
+    if (handle < BENCH_STUB_MAX_HANDLES)
+    {
+        bench_stub_handle_tx_bytes[handle] += length;
+    }
+    bench_stub_tx_calls++;
+    bench_stub_tx_bytes += length;
+    bench_stub_air_packets += (frame_len + BENCH_STUB_ACL_PAYLOAD - 1) / BENCH_STUB_ACL_PAYLOAD;
+    return WICED_TRUE;
+}
+
+/* LE, the benchmark does not enable the GATT serial service */
+wiced_result_t wiced_bt_ble_set_raw_advertisement_data(uint8_t num_elem, wiced_bt_ble_advert_elem_t *p_data)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_raw_scan_response_data(uint8_t num_elem, wiced_bt_ble_advert_elem_t *p_data)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_start_advertisements(wiced_bt_ble_advert_mode_t advert_mode,
+                                             wiced_bt_ble_address_type_t directed_advertisement_bdaddr_type,
+                                             wiced_bt_device_address_ptr_t directed_advertisement_bdaddr_ptr)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_phy(wiced_bt_ble_phy_preferences_t *phy_preferences)
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_data_packet_length(wiced_bt_device_address_t remote_bda, uint16_t tx_pdu_length)
+{
+    return WICED_BT_SUCCESS;
+}
+
+/* BR/EDR L2CAP, only the bulk channel registration and its send path */
+uint16_t wiced_bt_l2cap_register(uint16_t psm, wiced_bt_l2cap_appl_information_t *p_cb_info, void *context)
+{
+    bench_stub_l2cap_info = p_cb_info;
+    return psm;
+}
+
+uint16_t wiced_bt_l2cap_connect_req(uint16_t psm, wiced_bt_device_address_t p_bd_addr,
+                                    wiced_bt_l2cap_ertm_information_t *p_ertm_info)
+{
+    return 0;
+}
+
+wiced_bool_t wiced_bt_l2cap_disconnect_req(uint16_t cid)
+{
+    return WICED_TRUE;
+}
+
+wiced_bool_t wiced_bt_l2cap_disconnect_rsp(uint16_t cid)
+{
+    return WICED_TRUE;
+}
+
+uint8_t wiced_bt_l2cap_data_write(uint16_t cid, uint8_t *p_data, uint16_t len, uint16_t flags)
+{
+    uint16_t mps = bench_stub_l2cap_info->fcr.mps;
+    uint32_t segments = (len + mps - 1) / mps;
+
+    /* Every I-frame of at most mps bytes takes one packet of its own */
+    bench_stub_tx_calls++;
+    bench_stub_tx_bytes += len;
+    bench_stub_air_packets += segments;
+    return L2CAP_DW_SUCCESS;
+}
+
+wiced_bool_t wiced_bt_l2cap_update_ble_conn_params(wiced_bt_device_address_t rem_bdRa, uint16_t min_int,
+                                                   uint16_t max_int, uint16_t latency, uint16_t timeout)
+{
+    return WICED_TRUE;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_register(wiced_bt_gatt_cback_t *p_gatt_cback)
+{
+    bench_stub_gatt_cb = p_gatt_cback;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_db_init(const uint8_t *p_gatt_db, uint16_t gatt_db_size,
+                                             wiced_bt_db_hash_t hash)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_mtu_rsp(uint16_t conn_id, uint16_t remote_mtu,
+                                                         uint16_t local_mtu)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_read_handle_rsp(uint16_t conn_id, wiced_bt_gatt_opcode_t opcode,
+                                                                 uint16_t len, uint8_t *p_attr, void *p_app_ctx)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_error_rsp(uint16_t conn_id, wiced_bt_gatt_opcode_t opcode,
+                                                           uint16_t handle, wiced_bt_gatt_status_t status)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_write_rsp(uint16_t conn_id, wiced_bt_gatt_opcode_t opcode,
+                                                           uint16_t handle)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t attr_handle,
+                                                              uint16_t attr_len, uint8_t *p_attr_val,
+                                                              void *p_app_ctx)
+{
+    return WICED_BT_GATT_ERROR;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_disconnect(uint16_t conn_id)
+{
+    return WICED_BT_GATT_SUCCESS;
+}
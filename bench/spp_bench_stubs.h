@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *******************************************************************************/
+/******************************************************************************
+ * File Name: spp_bench_stubs.h
+ *
+ * Description: Stubbed BT stack, SPP profile and porting layer APIs used by
+ *              the SPP benchmark target. The stubs never touch a controller,
+ *              they only record what the application asked for.
+ *
+ * Related Document: See README.md
+ *
+ *******************************************************************************/
+
+#ifndef __SPP_BENCH_STUBS_H__
+#define __SPP_BENCH_STUBS_H__
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_dev.h"
+#include "wiced_bt_l2c.h"
+#include "wiced_bt_gatt.h"
+
+/*******************************************************************************
+ *                           MACROS
+ *******************************************************************************/
+/* Payload of a 3-DH5 packet */
+#define BENCH_STUB_ACL_PAYLOAD (1021)
+/* RFCOMM handles below this get their own credits and byte counter */
+#define BENCH_STUB_MAX_HANDLES (16)
+
+/*******************************************************************************
+ *                           VARIABLE DEFINITIONS
+ *******************************************************************************/
+/* Management callback registered through wiced_bt_stack_init() */
+extern wiced_bt_management_cback_t *bench_stub_management_cb;
+
+/* Callback registered through wiced_bt_dev_register_connection_status_change() */
+extern wiced_bt_connection_status_change_cback_t *bench_stub_connection_status_cb;
+
+/* Value returned by wiced_bt_spp_can_send_more_data() */
+extern wiced_bool_t bench_stub_can_send;
+
+/* If set, wiced_bt_spp_send_session_data() takes one credit of the handle
+ * per frame and wiced_bt_spp_can_send_more_data() fails once none are left
+ */
+extern wiced_bool_t bench_stub_use_credits;
+extern uint32_t bench_stub_credits[BENCH_STUB_MAX_HANDLES];
+
+/* Bytes sent on each RFCOMM handle */
+extern uint64_t bench_stub_handle_tx_bytes[BENCH_STUB_MAX_HANDLES];
+
+/* Counters updated by wiced_bt_spp_send_session_data() and
+ * wiced_bt_l2cap_data_write()
+ */
+extern uint64_t bench_stub_tx_calls;
+extern uint64_t bench_stub_tx_bytes;
+
+/* 3-DH5 baseband packets the sent bytes would take, with RFCOMM or L2CAP
+ * framing added. Only a model, the stubs never reach a controller.
+ */
+extern uint64_t bench_stub_air_packets;
+
+/* Application registered through wiced_bt_l2cap_register() */
+extern wiced_bt_l2cap_appl_information_t *bench_stub_l2cap_info;
+
+/* Callback registered through wiced_bt_gatt_register() */
+extern wiced_bt_gatt_cback_t *bench_stub_gatt_cb;
+
+/* Buffers handed out by wiced_bt_get_buffer() and not freed yet */
+extern uint32_t bench_stub_buffers_outstanding;
+
+/*******************************************************************************
+ *                           FUNCTION PROTOTYPES
+ *******************************************************************************/
+void bench_stub_reset(void);
+void bench_stub_release_buffers(void);
+void bench_stub_pin_buffers(void);
+uint32_t bench_stub_timers_running(void);
+
+#endif /* __SPP_BENCH_STUBS_H__ */
@@ -0,0 +1,605 @@
+/*******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *******************************************************************************/
+/******************************************************************************
+ * File Name: spp_churn.c
+ *
+ * Description: Connection churn harness. Like spp_perf, the application
+ *              (spp.c and main.c, statics included) is compiled into this
+ *              translation unit and the BT stack is replaced by
+ *              spp_bench_stubs.c. Each cycle connects a peer, moves data
+ *              both ways and disconnects again, through the callbacks the
+ *              stack would call:
+ *              - rfcomm : ACL up, SPP session up, data, session and ACL down
+ *              - l2cap  : bulk channel connected, data, disconnected
+ *              - gatt   : LE link connected, data, disconnected
+ *              Peers rotate over a small set of addresses, so per-peer
+ *              tables fill up during the warm-up and stay flat afterwards.
+ *
+ *              After every cycle the harness samples the stack buffers held
+ *              by the application, the running timers, the open file
+ *              descriptors and the heap in use. Once the warm-up is over,
+ *              none of them may grow, except the heap by a small allowance
+ *              for the allocator. The exit code is non-zero if one did. The
+ *              connection setup time (from the first callback until the
+ *              session is up) and the cycle rate are reported as well.
+ *
+ * Usage: spp_churn [-c <cycles>] [-w <warmup_cycles>] [-p <peers>]
+ *                  [-t rfcomm|l2cap|gatt|mix] [-i <report_interval>]
+ *                  [-g <heap_allowance_bytes>] [-o <json_file>]
+ *                  [-- <application options>]
+ *
+ *        Application options after -- are applied as well, e.g.
+ *        -- --rx-sink uring:/tmp/churn.bin to check the sink lifecycle.
+ *
+ * Related Document: See README.md
+ *
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <malloc.h>
+#include "spp_bench_stubs.h"
+
+/* Application under test, statics included */
+#include "../app/spp.c"
+#define main spp_app_main
+#include "../app/main.c"
+#undef main
+
+/*******************************************************************************
+ *                               MACROS
+ *******************************************************************************/
+#define CHURN_DEFAULT_CYCLES      (5000)
+#define CHURN_DEFAULT_WARMUP      (200)
+#define CHURN_DEFAULT_PEERS       (8)
+#define CHURN_DEFAULT_HEAP_ALLOW  (4096)
+#define CHURN_MAX_PEERS           (64)
+#define CHURN_MAX_CYCLES          (1000000)
+#define CHURN_MAX_OPTIONS         (16)
+#define CHURN_NSEC_PER_SEC        (1000000000ULL)
+/* Frames received per cycle, the sample data is sent once */
+#define CHURN_RX_FRAMES           (8)
+#define CHURN_L2CAP_CID           (0x0041)
+#define CHURN_L2CAP_MTU           (1024)
+#define CHURN_GATT_CONN_ID        (0x0010)
+#define CHURN_ACL_HANDLE          (0x0080)
+#define CHURN_RFCOMM_HANDLE       (1)
+/* Worker threads, e.g. the uring reapers, release their files up to one
+ * 100 ms tick after the session is gone: sampled every 10 ms until steady
+ * for 250 ms, for up to 5 s
+ */
+#define CHURN_SETTLE_POLL_US      (10000)
+#define CHURN_SETTLE_STEADY_POLLS (25)
+#define CHURN_SETTLE_POLLS        (500)
+
+/*******************************************************************************
+ *                               STRUCTURES AND ENUMERATIONS
+ *******************************************************************************/
+typedef enum
+{
+    CHURN_RFCOMM,
+    CHURN_L2CAP,
+    CHURN_GATT,
+    CHURN_TRANSPORTS,
+    CHURN_MIX = CHURN_TRANSPORTS
+} churn_transport_t;
+
+typedef enum
+{
+    CHURN_RES_BUFFERS,
+    CHURN_RES_TIMERS,
+    CHURN_RES_FDS,
+    CHURN_RES_HEAP,
+    CHURN_RESOURCES
+} churn_resource_t;
+
+typedef struct
+{
+    int64_t base;    /* after the warm-up */
+    int64_t peak;
+    int64_t final;
+    int64_t allowance;
+} churn_usage_t;
+
+/******************************************************************************
+ *                               GLOBAL VARIABLES
+ ******************************************************************************/
+static const char *const churn_transport_names[CHURN_TRANSPORTS + 1] = { "rfcomm", "l2cap", "gatt", "mix" };
+static const char *const churn_resource_names[CHURN_RESOURCES] = { "buffers", "timers", "fds", "heap_bytes" };
+
+static uint64_t *churn_setup_ns;
+static uint8_t churn_frame[SPP_MAX_PAYLOAD];
+static int churn_devnull_fd = -1;
+static int churn_stdout_fd = -1;
+
+/* Not used, main.c hands these to the porting layer */
+int arg_parser_get_args(int argc, char *argv[], char *hci_port, uint8_t *bd_addr, uint32_t *baud,
+                        int *spy_inst, char *peer_ip, uint8_t *is_socket, char *patch,
+                        uint32_t *patch_baud, cybt_controller_autobaud_config_t *autobaud)
+{
+    return PARSE_ERROR;
+}
+
+void cy_platform_bluetooth_init(char *patch_file, char *uart_name, uint32_t baud_rate_for_fw_download,
+                                uint32_t baud_rate_for_feature, cybt_controller_autobaud_config_t *autobaud)
+{
+}
+
+/******************************************************************************
+ *                               FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static uint64_t churn_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * CHURN_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* Application output goes to /dev/null while the cycles run */
+static void churn_mute_app(void)
+{
+    fflush(stdout);
+    dup2(churn_devnull_fd, STDOUT_FILENO);
+}
+
+static void churn_unmute_app(void)
+{
+    fflush(stdout);
+    dup2(churn_stdout_fd, STDOUT_FILENO);
+}
+
+static int churn_compare_u64(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Open descriptors, the one used to list them not counted */
+static int64_t churn_count_fds(void)
+{
+    DIR *p_dir = opendir("/proc/self/fd");
+    struct dirent *p_entry;
+    int64_t count = 0;
+
+    if (NULL == p_dir)
+    {
+        return -1;
+    }
+    while (NULL != (p_entry = readdir(p_dir)))
+    {
+        count += ('.' != p_entry->d_name[0]) ? 1 : 0;
+    }
+    closedir(p_dir);
+    return count - 1;
+}
+
+static void churn_sample(int64_t *p_values)
+{
+    struct mallinfo2 info = mallinfo2();
+
+    p_values[CHURN_RES_BUFFERS] = bench_stub_buffers_outstanding;
+    p_values[CHURN_RES_TIMERS] = bench_stub_timers_running();
+    p_values[CHURN_RES_FDS] = churn_count_fds();
+    p_values[CHURN_RES_HEAP] = (int64_t)info.uordblks;
+}
+
+/* Samples until the values stay the same for a while, used for the base and
+ * final values
+ */
+static void churn_sample_settled(int64_t *p_values)
+{
+    int64_t previous[CHURN_RESOURCES];
+    int steady = 0;
+    int i;
+
+    churn_sample(p_values);
+    for (i = 0; (i < CHURN_SETTLE_POLLS) && (steady < CHURN_SETTLE_STEADY_POLLS); i++)
+    {
+        memcpy(previous, p_values, sizeof(previous));
+        usleep(CHURN_SETTLE_POLL_US);
+        churn_sample(p_values);
+        steady = (0 == memcmp(previous, p_values, sizeof(previous))) ? steady + 1 : 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: churn_connect
+ *******************************************************************************
+ * Summary:
+ *   Brings a session up on a transport the way the stack reports it
+ *
+ * Parameters:
+ *   churn_transport_t transport : transport of the session
+ *   uint8_t *bda                : peer address
+ *
+ * Return:
+ *   uint16_t : session handle, 0 if the session did not come up
+ *
+ ******************************************************************************/
+static uint16_t churn_connect(churn_transport_t transport, uint8_t *bda)
+{
+    wiced_bt_gatt_event_data_t gatt_event;
+
+    spp_handle = 0;
+    switch (transport)
+    {
+    case CHURN_RFCOMM:
+        bench_stub_connection_status_cb(bda, NULL, WICED_TRUE, CHURN_ACL_HANDLE, BT_TRANSPORT_BR_EDR, 0);
+        spp_connection_up_callback(CHURN_RFCOMM_HANDLE, bda);
+        break;
+    case CHURN_L2CAP:
+        bench_stub_l2cap_info->connected_cback(NULL, bda, CHURN_L2CAP_CID, CHURN_L2CAP_MTU);
+        break;
+    default:
+        memset(&gatt_event, 0, sizeof(gatt_event));
+        gatt_event.connection_status.bd_addr = bda;
+        gatt_event.connection_status.conn_id = CHURN_GATT_CONN_ID;
+        gatt_event.connection_status.connected = WICED_TRUE;
+        gatt_event.connection_status.transport = BT_TRANSPORT_LE;
+        bench_stub_gatt_cb(GATT_CONNECTION_STATUS_EVT, &gatt_event);
+        break;
+    }
+    return spp_handle;
+}
+
+static void churn_disconnect(churn_transport_t transport, uint8_t *bda, uint16_t handle)
+{
+    wiced_bt_gatt_event_data_t gatt_event;
+
+    switch (transport)
+    {
+    case CHURN_RFCOMM:
+        spp_connection_down_callback(handle);
+        /* 0x13: remote user terminated connection */
+        bench_stub_connection_status_cb(bda, NULL, WICED_FALSE, CHURN_ACL_HANDLE, BT_TRANSPORT_BR_EDR, 0x13);
+        break;
+    case CHURN_L2CAP:
+        bench_stub_l2cap_info->disconnect_indication_cback(NULL, CHURN_L2CAP_CID, WICED_FALSE);
+        break;
+    default:
+        memset(&gatt_event, 0, sizeof(gatt_event));
+        gatt_event.connection_status.bd_addr = bda;
+        gatt_event.connection_status.conn_id = CHURN_GATT_CONN_ID;
+        gatt_event.connection_status.connected = WICED_FALSE;
+        gatt_event.connection_status.transport = BT_TRANSPORT_LE;
+        bench_stub_gatt_cb(GATT_CONNECTION_STATUS_EVT, &gatt_event);
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: churn_transfer
+ *******************************************************************************
+ * Summary:
+ *   Receives a few frames on the session and sends the option 2 sample data.
+ *   L2CAP data arrives through the channel callback. GATT writes end in the
+ *   same receive callback, which is called directly. The stub refuses GATT
+ *   notifications, so those sessions disconnect with data still queued.
+ *
+ * Parameters:
+ *   churn_transport_t transport : transport of the session
+ *   uint16_t handle             : session handle
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void churn_transfer(churn_transport_t transport, uint16_t handle)
+{
+    int i;
+
+    for (i = 0; i < CHURN_RX_FRAMES; i++)
+    {
+        if (CHURN_L2CAP == transport)
+        {
+            bench_stub_l2cap_info->data_indication_cback(NULL, CHURN_L2CAP_CID, churn_frame,
+                                                         sizeof(churn_frame));
+        }
+        else
+        {
+            spp_rx_data_callback(handle, churn_frame, sizeof(churn_frame));
+        }
+    }
+    spp_send_sample_data();
+}
+
+/*******************************************************************************
+ * Function Name: churn_start_app
+ *******************************************************************************
+ * Summary:
+ *   Applies the application options, enables the transports under test and
+ *   starts the application
+ *
+ * Parameters:
+ *   churn_transport_t transport : transport under test, or CHURN_MIX
+ *   int argc                    : application option count
+ *   char *argv[]                : application options
+ *
+ * Return:
+ *   int : 0, or -1 if the options were rejected
+ *
+ ******************************************************************************/
+static int churn_start_app(churn_transport_t transport, int argc, char *argv[])
+{
+    char *app_argv[CHURN_MAX_OPTIONS + 2];
+    wiced_bt_management_evt_data_t event_data;
+    int i;
+
+    if (argc > CHURN_MAX_OPTIONS)
+    {
+        return -1;
+    }
+    app_argv[0] = "spp_churn";
+    for (i = 0; i < argc; i++)
+    {
+        app_argv[i + 1] = argv[i];
+    }
+    app_argv[argc + 1] = NULL;
+    if (1 != app_parse_args(argc + 1, app_argv))
+    {
+        return -1;
+    }
+    if ((CHURN_L2CAP == transport) || (CHURN_MIX == transport))
+    {
+        spp_l2cap_configure(CHURN_L2CAP_MTU, SPP_L2CAP_MODE_ERTM);
+    }
+    if ((CHURN_GATT == transport) || (CHURN_MIX == transport))
+    {
+        spp_gatt_configure(WICED_TRUE);
+    }
+
+    spp_application_start();
+    memset(&event_data, 0, sizeof(event_data));
+    event_data.enabled.status = WICED_BT_SUCCESS;
+    bench_stub_management_cb(BTM_ENABLED_EVT, &event_data);
+    return 0;
+}
+
+static void churn_write_json(FILE *p_out, churn_transport_t transport, uint32_t cycles, uint32_t warmup,
+                             uint32_t startup_buffers, double cycles_per_sec,
+                             const uint64_t *p_setup_ns, const churn_usage_t *p_usage)
+{
+    int r;
+
+    fprintf(p_out, "{\n  \"suite\": \"spp_churn\",\n  \"transport\": \"%s\",\n  \"cycles\": %u,\n"
+            "  \"warmup_cycles\": %u,\n  \"startup_buffers\": %u,\n  \"cycles_per_sec\": %.1f,\n"
+            "  \"setup_ns\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu},\n  \"resources\": [\n",
+            churn_transport_names[transport], cycles, warmup, startup_buffers, cycles_per_sec,
+            (unsigned long long)p_setup_ns[0], (unsigned long long)p_setup_ns[1],
+            (unsigned long long)p_setup_ns[2]);
+    for (r = 0; r < CHURN_RESOURCES; r++)
+    {
+        fprintf(p_out, "%s    {\"name\": \"%s\", \"base\": %lld, \"peak\": %lld, \"final\": %lld, "
+                "\"growth\": %lld, \"allowance\": %lld}", (0 == r) ? "" : ",\n", churn_resource_names[r],
+                (long long)p_usage[r].base, (long long)p_usage[r].peak, (long long)p_usage[r].final,
+                (long long)(p_usage[r].final - p_usage[r].base), (long long)p_usage[r].allowance);
+    }
+    fprintf(p_out, "\n  ]\n}\n");
+}
+
+/******************************************************************************
+ * Function Name: main()
+ *******************************************************************************
+ * Summary:
+ *   Churn harness entry function
+ *
+ * Parameters:
+ *   int argc            : argument count
+ *   char *argv[]        : list of arguments
+ *
+ * Return:
+ *   EXIT_SUCCESS, or EXIT_FAILURE if a resource grew or a session failed
+ *
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint8_t bda[BD_ADDR_LEN] = { 0x11, 0x12, 0x13, 0x21, 0x23, 0x00 };
+    churn_usage_t usage[CHURN_RESOURCES];
+    int64_t values[CHURN_RESOURCES];
+    churn_transport_t transport = CHURN_MIX;
+    churn_transport_t cycle_transport;
+    const char *p_out_path = NULL;
+    uint32_t cycles = CHURN_DEFAULT_CYCLES;
+    uint32_t warmup = CHURN_DEFAULT_WARMUP;
+    uint32_t peers = CHURN_DEFAULT_PEERS;
+    uint32_t interval = 0;
+    uint32_t startup_buffers;
+    int64_t heap_allowance = CHURN_DEFAULT_HEAP_ALLOW;
+    uint64_t setup_ns[3];
+    uint64_t start;
+    uint64_t total_ns;
+    uint16_t handle;
+    uint32_t cycle;
+    uint32_t failed = 0;
+    int result = EXIT_SUCCESS;
+    FILE *p_out;
+    int opt;
+    int r;
+
+    while ((opt = getopt(argc, argv, "c:w:p:t:i:g:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            cycles = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            warmup = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            peers = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            for (r = 0; r <= CHURN_TRANSPORTS; r++)
+            {
+                if (0 == strcmp(optarg, churn_transport_names[r]))
+                {
+                    break;
+                }
+            }
+            transport = (churn_transport_t)r;
+            break;
+        case 'i':
+            interval = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            heap_allowance = strtoll(optarg, NULL, 0);
+            break;
+        case 'o':
+            p_out_path = optarg;
+            break;
+        default:
+            cycles = 0;
+            break;
+        }
+    }
+    if ((cycles < 1) || (cycles > CHURN_MAX_CYCLES) || (warmup >= cycles) || (peers < 1) ||
+        (peers > CHURN_MAX_PEERS) || (transport > CHURN_MIX) || (heap_allowance < 0))
+    {
+        fprintf(stderr, "Usage: %s [-c <cycles>] [-w <warmup_cycles>] [-p <peers>] "
+                "[-t rfcomm|l2cap|gatt|mix] [-i <report_interval>] [-g <heap_allowance_bytes>] "
+                "[-o <json_file>] [-- <application options>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    churn_setup_ns = malloc(cycles * sizeof(churn_setup_ns[0]));
+    churn_devnull_fd = open("/dev/null", O_WRONLY);
+    churn_stdout_fd = dup(STDOUT_FILENO);
+    if ((NULL == churn_setup_ns) || (churn_devnull_fd < 0) || (churn_stdout_fd < 0))
+    {
+        perror("spp_churn");
+        return EXIT_FAILURE;
+    }
+    memset(churn_frame, 0x5A, sizeof(churn_frame));
+
+    churn_mute_app();
+    if (0 != churn_start_app(transport, argc - optind, &argv[optind]))
+    {
+        churn_unmute_app();
+        fprintf(stderr, "spp_churn: options rejected by the application\n");
+        return EXIT_FAILURE;
+    }
+    startup_buffers = bench_stub_buffers_outstanding;
+
+    start = churn_now_ns();
+    for (cycle = 0; cycle < cycles; cycle++)
+    {
+        cycle_transport = (CHURN_MIX == transport) ? (churn_transport_t)(cycle % CHURN_TRANSPORTS) : transport;
+        bda[BD_ADDR_LEN - 1] = (uint8_t)(cycle % peers);
+
+        churn_setup_ns[cycle] = churn_now_ns();
+        handle = churn_connect(cycle_transport, bda);
+        churn_setup_ns[cycle] = churn_now_ns() - churn_setup_ns[cycle];
+        if (0 == handle)
+        {
+            failed++;
+            continue;
+        }
+        churn_transfer(cycle_transport, handle);
+        churn_disconnect(cycle_transport, bda, handle);
+
+        if (cycle + 1 == warmup)
+        {
+            churn_sample_settled(values);
+            for (r = 0; r < CHURN_RESOURCES; r++)
+            {
+                usage[r].base = values[r];
+                usage[r].peak = values[r];
+            }
+        }
+        churn_sample(values);
+        for (r = 0; r < CHURN_RESOURCES; r++)
+        {
+            usage[r].peak = MAX(usage[r].peak, values[r]);
+        }
+        if ((0 != interval) && (0 == (cycle + 1) % interval))
+        {
+            churn_unmute_app();
+            fprintf(stdout, "cycle %u: buffers %lld, timers %lld, fds %lld, heap %lld bytes\n",
+                    cycle + 1, (long long)values[CHURN_RES_BUFFERS], (long long)values[CHURN_RES_TIMERS],
+                    (long long)values[CHURN_RES_FDS], (long long)values[CHURN_RES_HEAP]);
+            churn_mute_app();
+        }
+    }
+    total_ns = churn_now_ns() - start;
+    churn_sample_settled(values);
+    churn_unmute_app();
+
+    for (r = 0; r < CHURN_RESOURCES; r++)
+    {
+        usage[r].final = values[r];
+        usage[r].allowance = (CHURN_RES_HEAP == r) ? heap_allowance : 0;
+        if (usage[r].final - usage[r].base > usage[r].allowance)
+        {
+            fprintf(stderr, "spp_churn: %s grew from %lld to %lld over %u cycles\n", churn_resource_names[r],
+                    (long long)usage[r].base, (long long)usage[r].final, cycles - warmup);
+            result = EXIT_FAILURE;
+        }
+    }
+    if (0 != failed)
+    {
+        fprintf(stderr, "spp_churn: %u sessions did not come up\n", failed);
+        result = EXIT_FAILURE;
+    }
+
+    qsort(churn_setup_ns, cycles, sizeof(churn_setup_ns[0]), churn_compare_u64);
+    setup_ns[0] = churn_setup_ns[cycles / 2];
+    setup_ns[1] = churn_setup_ns[MIN((uint64_t)cycles * 99 / 100, cycles - 1)];
+    setup_ns[2] = churn_setup_ns[cycles - 1];
+
+    p_out = (NULL != p_out_path) ? fopen(p_out_path, "w") : fdopen(dup(churn_stdout_fd), "w");
+    if (NULL == p_out)
+    {
+        perror(p_out_path);
+        return EXIT_FAILURE;
+    }
+    churn_write_json(p_out, transport, cycles, warmup, startup_buffers,
+                     (double)cycles * CHURN_NSEC_PER_SEC / total_ns, setup_ns, usage);
+    fclose(p_out);
+    free(churn_setup_ns);
+    return result;
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,907 @@
+/*******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *******************************************************************************/
+/******************************************************************************
+ * File Name: spp_perf.c
+ *
+ * Description: End-to-end performance regression suite. Like spp_bench,
+ *              the application (spp.c and main.c, statics included) is
+ *              compiled into this translation unit and the BT stack, SPP
+ *              profile and controller are replaced by spp_bench_stubs.c.
+ *              Each scenario configures the application through its own
+ *              command line options and drives it through the callbacks
+ *              the stack would call:
+ *              - bulk_tx       : option 2 sample data, sent as fast as the
+ *                                stack takes it
+ *              - bulk_rx       : full frames into the verify rx sink
+ *              - latency       : 32 byte messages reflected by --echo, from
+ *                                the receive callback to the reply handed to
+ *                                the stack
+ *              - fairness      : four sessions with a backlog sharing equal
+ *                                RFCOMM credit grants
+ *              - connect_cycle : sessions connecting and disconnecting next
+ *                                to an open one
+ *
+ *              Every scenario is run once to warm up and then for a number
+ *              of repetitions. Each metric is summarised by its median over
+ *              the repetitions and a 95% confidence interval of the median
+ *              taken from the order statistics. A metric regresses when its
+ *              median is worse than the baseline median by more than the
+ *              tolerance and its interval lies entirely on the worse side of
+ *              the interval stored with the baseline. The first condition
+ *              sets how large a slowdown matters, the second keeps noise
+ *              from failing the suite. Metrics ending in _ns are better when
+ *              lower, all others when higher.
+ *
+ *              A fixed copy and hash loop is timed next to every repetition
+ *              and its median is stored with the baseline. Before comparing,
+ *              the baseline is scaled by the ratio of this run's calibration
+ *              time to the stored one, so a slower or busier host does not
+ *              show up as a regression.
+ *
+ * Usage: spp_perf -s <scenario> [-r <repetitions>] [-o <json_file>]
+ *                 [-b <baseline_json>] [-t <tolerance_pct>] [-w]
+ *
+ *        -b compares with a baseline written earlier with -w. The exit code
+ *        is non-zero if a metric regressed or a scenario check failed.
+ *
+ * Related Document: See README.md
+ *
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "spp_bench_stubs.h"
+
+/* Application under test, statics included */
+#include "../app/spp.c"
+#define main spp_app_main
+#include "../app/main.c"
+#undef main
+
+/*******************************************************************************
+ *                               MACROS
+ *******************************************************************************/
+#define PERF_DEFAULT_REPETITIONS  (31)
+#define PERF_MAX_REPETITIONS      (101)
+#define PERF_DEFAULT_TOLERANCE    (25.0)
+#define PERF_MAX_METRICS          (4)
+#define PERF_MAX_OPTIONS          (8)
+#define PERF_NSEC_PER_SEC         (1000000000ULL)
+/* Timed calls per repetition */
+#define PERF_BULK_TX_CALLS        (200)
+#define PERF_BULK_RX_FRAMES       (2000)
+#define PERF_LATENCY_MESSAGES     (10000)
+#define PERF_LATENCY_LEN          (32)
+#define PERF_CONNECT_CYCLES       (1000)
+/* Fairness: backlog of every session and credits granted per round */
+#define PERF_FAIR_SESSIONS        (4)
+#define PERF_FAIR_BACKLOG         (256 * 1024)
+#define PERF_FAIR_CREDITS         (4)
+#define PERF_MAX_SAMPLES          (PERF_LATENCY_MESSAGES)
+/* Calibration: passes over a buffer, each a copy and a hash of it */
+#define PERF_CALIBRATION_LEN      (256 * 1024)
+#define PERF_CALIBRATION_PASSES   (4)
+
+/*******************************************************************************
+ *                               STRUCTURES AND ENUMERATIONS
+ *******************************************************************************/
+/* Runs one repetition, stores one value per metric, returns 0 on success */
+typedef int (*perf_run_fn_t)(double *p_values);
+
+typedef struct
+{
+    const char *name;
+    const char *options[PERF_MAX_OPTIONS]; /* application options, NULL terminated */
+    int sessions;                          /* RFCOMM sessions opened, handles 1..n */
+    perf_run_fn_t run;
+    const char *metrics[PERF_MAX_METRICS]; /* NULL terminated */
+} perf_scenario_t;
+
+typedef struct
+{
+    double median;
+    double ci_low;
+    double ci_high;
+    double min;
+    double max;
+} perf_summary_t;
+
+/******************************************************************************
+ *                               GLOBAL VARIABLES
+ ******************************************************************************/
+static uint64_t perf_samples[PERF_MAX_SAMPLES];
+static uint8_t perf_frame[SPP_MAX_PAYLOAD];
+static uint8_t perf_backlog[PERF_FAIR_BACKLOG];
+static uint64_t perf_rx_offset = 0;
+static int perf_devnull_fd = -1;
+static int perf_stdout_fd = -1;
+static uint8_t perf_calibration_buf[2][PERF_CALIBRATION_LEN];
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+static int perf_bulk_tx(double *p_values);
+static int perf_bulk_rx(double *p_values);
+static int perf_latency(double *p_values);
+static int perf_fairness(double *p_values);
+static int perf_connect_cycle(double *p_values);
+
+/******************************************************************************
+ *                               SCENARIOS
+ ******************************************************************************/
+static const perf_scenario_t perf_scenarios[] =
+{
+    { "bulk_tx", { "--rx-sink", "discard", "--pattern", "xorshift", NULL }, 1, perf_bulk_tx,
+      { "mb_per_sec", "p50_ns", "p99_ns", NULL } },
+    { "bulk_rx", { "--rx-sink", "verify", "--pattern", "xorshift", NULL }, 1, perf_bulk_rx,
+      { "mb_per_sec", "p50_ns", "p99_ns", NULL } },
+    { "latency", { "--echo", NULL }, 1, perf_latency,
+      { "p50_ns", "p90_ns", "p99_ns", NULL } },
+    { "fairness", { "--rx-sink", "discard", NULL }, PERF_FAIR_SESSIONS, perf_fairness,
+      { "mb_per_sec", "jain_index", NULL } },
+    { "connect_cycle", { "--rx-sink", "checksum", NULL }, 1, perf_connect_cycle,
+      { "cycles_per_sec", "p50_ns", "p99_ns", NULL } },
+};
+
+/* Not used, main.c hands these to the porting layer */
+int arg_parser_get_args(int argc, char *argv[], char *hci_port, uint8_t *bd_addr, uint32_t *baud,
+                        int *spy_inst, char *peer_ip, uint8_t *is_socket, char *patch,
+                        uint32_t *patch_baud, cybt_controller_autobaud_config_t *autobaud)
+{
+    return PARSE_ERROR;
+}
+
+void cy_platform_bluetooth_init(char *patch_file, char *uart_name, uint32_t baud_rate_for_fw_download,
+                                uint32_t baud_rate_for_feature, cybt_controller_autobaud_config_t *autobaud)
+{
+}
+
+/******************************************************************************
+ *                               FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static uint64_t perf_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * PERF_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* Application output goes to /dev/null while a scenario runs */
+static void perf_mute_app(void)
+{
+    fflush(stdout);
+    dup2(perf_devnull_fd, STDOUT_FILENO);
+}
+
+static void perf_unmute_app(void)
+{
+    fflush(stdout);
+    dup2(perf_stdout_fd, STDOUT_FILENO);
+}
+
+static int perf_compare_u64(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static int perf_compare_double(const void *p_a, const void *p_b)
+{
+    double a = *(const double *)p_a;
+    double b = *(const double *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Sorts the first count samples and returns the given percentile */
+static double perf_percentile(uint32_t count, int percent)
+{
+    uint32_t idx;
+
+    qsort(perf_samples, count, sizeof(perf_samples[0]), perf_compare_u64);
+    idx = (uint32_t)(((uint64_t)count * percent) / 100);
+    return (double)perf_samples[MIN(idx, count - 1)];
+}
+
+/* Sum of the first count samples */
+static uint64_t perf_total(uint32_t count)
+{
+    uint64_t total = 0;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        total += perf_samples[i];
+    }
+    return total;
+}
+
+/*******************************************************************************
+ * Function Name: perf_bulk_tx
+ *******************************************************************************
+ * Summary:
+ *   Sends the option 2 sample data on session 1, the stack taking every
+ *   frame at once
+ *
+ * Parameters:
+ *   double *p_values : mb_per_sec, p50_ns and p99_ns of one call
+ *
+ * Return:
+ *   int : 0, or -1 if data was not sent
+ *
+ ******************************************************************************/
+static int perf_bulk_tx(double *p_values)
+{
+    uint64_t tx_bytes = bench_stub_tx_bytes;
+    uint64_t start;
+    uint32_t i;
+
+    for (i = 0; i < PERF_BULK_TX_CALLS; i++)
+    {
+        start = perf_now_ns();
+        spp_send_sample_data();
+        perf_samples[i] = perf_now_ns() - start;
+    }
+    if (bench_stub_tx_bytes - tx_bytes != (uint64_t)PERF_BULK_TX_CALLS * SPP_TOTAL_DATA_TO_SEND)
+    {
+        fprintf(stderr, "bulk_tx: %llu bytes sent, expected %llu\n",
+                (unsigned long long)(bench_stub_tx_bytes - tx_bytes),
+                (unsigned long long)PERF_BULK_TX_CALLS * SPP_TOTAL_DATA_TO_SEND);
+        return -1;
+    }
+    p_values[0] = (double)PERF_BULK_TX_CALLS * SPP_TOTAL_DATA_TO_SEND * 1e3 / perf_total(PERF_BULK_TX_CALLS);
+    p_values[1] = perf_percentile(PERF_BULK_TX_CALLS, 50);
+    p_values[2] = perf_percentile(PERF_BULK_TX_CALLS, 99);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_bulk_rx
+ *******************************************************************************
+ * Summary:
+ *   Delivers full frames of the test pattern to session 1, checked by the
+ *   verify rx sink. Only the receive callback is timed.
+ *
+ * Parameters:
+ *   double *p_values : mb_per_sec, p50_ns and p99_ns of one frame
+ *
+ * Return:
+ *   int : 0, or -1 if the sink found corrupted data
+ *
+ ******************************************************************************/
+static int perf_bulk_rx(double *p_values)
+{
+    spp_sink_stats_t stats;
+    uint64_t start;
+    uint32_t i;
+
+    for (i = 0; i < PERF_BULK_RX_FRAMES; i++)
+    {
+        spp_pattern_fill(perf_rx_offset, perf_frame, SPP_MAX_PAYLOAD);
+        perf_rx_offset += SPP_MAX_PAYLOAD;
+        start = perf_now_ns();
+        spp_rx_data_callback(1, perf_frame, SPP_MAX_PAYLOAD);
+        perf_samples[i] = perf_now_ns() - start;
+    }
+    spp_sink_get_stats(SPP_SINK_VERIFY, &stats);
+    if ((0 != stats.errors) || (stats.bytes != perf_rx_offset))
+    {
+        fprintf(stderr, "bulk_rx: %llu of %llu bytes verified, %llu differ\n",
+                (unsigned long long)stats.bytes, (unsigned long long)perf_rx_offset,
+                (unsigned long long)stats.errors);
+        return -1;
+    }
+    p_values[0] = (double)PERF_BULK_RX_FRAMES * SPP_MAX_PAYLOAD * 1e3 / perf_total(PERF_BULK_RX_FRAMES);
+    p_values[1] = perf_percentile(PERF_BULK_RX_FRAMES, 50);
+    p_values[2] = perf_percentile(PERF_BULK_RX_FRAMES, 99);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_latency
+ *******************************************************************************
+ * Summary:
+ *   Times small messages from the receive callback to the reflected copy
+ *   handed to the stack
+ *
+ * Parameters:
+ *   double *p_values : p50_ns, p90_ns and p99_ns of one message
+ *
+ * Return:
+ *   int : 0, or -1 if a message was not reflected
+ *
+ ******************************************************************************/
+static int perf_latency(double *p_values)
+{
+    uint64_t tx_calls = bench_stub_tx_calls;
+    uint64_t start;
+    uint32_t i;
+
+    memset(perf_frame, 0x5A, PERF_LATENCY_LEN);
+    for (i = 0; i < PERF_LATENCY_MESSAGES; i++)
+    {
+        start = perf_now_ns();
+        spp_rx_data_callback(1, perf_frame, PERF_LATENCY_LEN);
+        perf_samples[i] = perf_now_ns() - start;
+    }
+    if (bench_stub_tx_calls - tx_calls != PERF_LATENCY_MESSAGES)
+    {
+        fprintf(stderr, "latency: %llu of %d messages reflected\n",
+                (unsigned long long)(bench_stub_tx_calls - tx_calls), PERF_LATENCY_MESSAGES);
+        return -1;
+    }
+    p_values[0] = perf_percentile(PERF_LATENCY_MESSAGES, 50);
+    p_values[1] = perf_percentile(PERF_LATENCY_MESSAGES, 90);
+    p_values[2] = perf_percentile(PERF_LATENCY_MESSAGES, 99);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_fairness
+ *******************************************************************************
+ * Summary:
+ *   Queues the same backlog on every session and grants each the same
+ *   credits per round until all are drained. Fairness is Jain's index of
+ *   the bytes each session sent until the first one ran dry.
+ *
+ * Parameters:
+ *   double *p_values : mb_per_sec over the whole run and jain_index
+ *
+ * Return:
+ *   int : 0, or -1 if a backlog was not sent
+ *
+ ******************************************************************************/
+static int perf_fairness(double *p_values)
+{
+    spp_iovec_t iov = { perf_backlog, PERF_FAIR_BACKLOG, NULL, NULL };
+    uint64_t sent[PERF_FAIR_SESSIONS + 1];
+    wiced_bool_t snapshot = WICED_FALSE;
+    uint32_t pending;
+    uint64_t start;
+    double sum = 0;
+    double sum_sq = 0;
+    uint16_t h;
+
+    memset(bench_stub_handle_tx_bytes, 0, sizeof(bench_stub_handle_tx_bytes));
+    memset(bench_stub_credits, 0, sizeof(bench_stub_credits));
+    bench_stub_use_credits = WICED_TRUE;
+    for (h = 1; h <= PERF_FAIR_SESSIONS; h++)
+    {
+        spp_send_iov(h, &iov, 1);
+    }
+
+    start = perf_now_ns();
+    do
+    {
+        pending = 0;
+        for (h = 1; h <= PERF_FAIR_SESSIONS; h++)
+        {
+            bench_stub_credits[h] += PERF_FAIR_CREDITS;
+            spp_tx_kick(h);
+            pending += (0 != spp_tx_queued_bytes(h)) ? 1 : 0;
+        }
+        if (!snapshot && (pending < PERF_FAIR_SESSIONS))
+        {
+            memcpy(sent, bench_stub_handle_tx_bytes, sizeof(sent));
+            snapshot = WICED_TRUE;
+        }
+    } while (0 != pending);
+    start = perf_now_ns() - start;
+    bench_stub_use_credits = WICED_FALSE;
+
+    for (h = 1; h <= PERF_FAIR_SESSIONS; h++)
+    {
+        if (PERF_FAIR_BACKLOG != bench_stub_handle_tx_bytes[h])
+        {
+            fprintf(stderr, "fairness: handle %d sent %llu of %d bytes\n", h,
+                    (unsigned long long)bench_stub_handle_tx_bytes[h], PERF_FAIR_BACKLOG);
+            return -1;
+        }
+        sum += (double)sent[h];
+        sum_sq += (double)sent[h] * sent[h];
+    }
+    p_values[0] = (double)PERF_FAIR_SESSIONS * PERF_FAIR_BACKLOG * 1e3 / start;
+    p_values[1] = (sum * sum) / (PERF_FAIR_SESSIONS * sum_sq);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_connect_cycle
+ *******************************************************************************
+ * Summary:
+ *   Connects and disconnects session 2 while session 1 stays up. Fails if
+ *   the cycles leave buffers behind.
+ *
+ * Parameters:
+ *   double *p_values : cycles_per_sec, p50_ns and p99_ns of one cycle
+ *
+ * Return:
+ *   int : 0, or -1 if buffers leaked
+ *
+ ******************************************************************************/
+static int perf_connect_cycle(double *p_values)
+{
+    uint8_t bda[BD_ADDR_LEN] = { 0x11, 0x12, 0x13, 0x21, 0x22, 0x02 };
+    uint32_t buffers = bench_stub_buffers_outstanding;
+    uint64_t start;
+    uint32_t i;
+
+    for (i = 0; i < PERF_CONNECT_CYCLES; i++)
+    {
+        start = perf_now_ns();
+        spp_connection_up_callback(2, bda);
+        spp_connection_down_callback(2);
+        perf_samples[i] = perf_now_ns() - start;
+    }
+    if (bench_stub_buffers_outstanding != buffers)
+    {
+        fprintf(stderr, "connect_cycle: %d buffers leaked in %d cycles\n",
+                (int)(bench_stub_buffers_outstanding - buffers), PERF_CONNECT_CYCLES);
+        return -1;
+    }
+    p_values[0] = (double)PERF_CONNECT_CYCLES * 1e9 / perf_total(PERF_CONNECT_CYCLES);
+    p_values[1] = perf_percentile(PERF_CONNECT_CYCLES, 50);
+    p_values[2] = perf_percentile(PERF_CONNECT_CYCLES, 99);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_summarise
+ *******************************************************************************
+ * Summary:
+ *   Median of the repetitions and a distribution-free 95% confidence
+ *   interval of it, bounded by the order statistics n/2 -/+ 0.98 sqrt(n)
+ *
+ * Parameters:
+ *   double *p_values : one value per repetition, sorted in place
+ *   int count : number of repetitions
+ *   perf_summary_t *p_summary : filled with the summary
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void perf_summarise(double *p_values, int count, perf_summary_t *p_summary)
+{
+    double half_width = 0.98 * sqrt((double)count);
+    int low;
+    int high;
+
+    qsort(p_values, count, sizeof(p_values[0]), perf_compare_double);
+    low = (int)floor(count / 2.0 - half_width);
+    high = (int)ceil(count / 2.0 + half_width) - 1;
+    p_summary->median = (count & 1) ? p_values[count / 2]
+                                    : (p_values[count / 2 - 1] + p_values[count / 2]) / 2;
+    p_summary->ci_low = p_values[MAX(low, 0)];
+    p_summary->ci_high = p_values[MIN(high, count - 1)];
+    p_summary->min = p_values[0];
+    p_summary->max = p_values[count - 1];
+}
+
+/*******************************************************************************
+ * Function Name: perf_calibrate
+ *******************************************************************************
+ * Summary:
+ *   Times a fixed amount of copying and hashing which does not depend on the
+ *   application, as a measure of how fast this host runs right now
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   double : ns taken
+ *
+ ******************************************************************************/
+static double perf_calibrate(void)
+{
+    uint64_t start = perf_now_ns();
+    uint32_t hash = 2166136261u;
+    uint8_t *p_buf;
+    int pass;
+    int i;
+
+    for (pass = 0; pass < PERF_CALIBRATION_PASSES; pass++)
+    {
+        p_buf = perf_calibration_buf[pass & 1];
+        memcpy(p_buf, perf_calibration_buf[(pass + 1) & 1], PERF_CALIBRATION_LEN);
+        for (i = 0; i < PERF_CALIBRATION_LEN; i++)
+        {
+            hash = (hash ^ p_buf[i]) * 16777619u;
+        }
+        /* Stored, so the hash cannot be optimised away */
+        p_buf[hash % PERF_CALIBRATION_LEN] = (uint8_t)hash;
+    }
+    return (double)(perf_now_ns() - start);
+}
+
+/* Reads one field of a metric object, returns 0 if found */
+static int perf_read_field(const char *p_object, const char *p_field, double *p_value)
+{
+    char key[32];
+    const char *p_end = strchr(p_object, '}');
+    const char *p;
+
+    snprintf(key, sizeof(key), "\"%s\":", p_field);
+    p = strstr(p_object, key);
+    if ((NULL == p) || ((NULL != p_end) && (p > p_end)) || (1 != sscanf(p + strlen(key), "%lf", p_value)))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* Reads the summary of a metric from a baseline file, returns 0 if found. A
+ * baseline without an interval gets the median as both of its ends.
+ */
+static int perf_read_baseline(const char *p_text, const char *p_metric, perf_summary_t *p_baseline)
+{
+    char key[64];
+    const char *p;
+
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", p_metric);
+    p = strstr(p_text, key);
+    if ((NULL == p) || (0 != perf_read_field(p, "median", &p_baseline->median)))
+    {
+        return -1;
+    }
+    if ((0 != perf_read_field(p, "ci_low", &p_baseline->ci_low)) ||
+        (0 != perf_read_field(p, "ci_high", &p_baseline->ci_high)))
+    {
+        p_baseline->ci_low = p_baseline->median;
+        p_baseline->ci_high = p_baseline->median;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: perf_compare
+ *******************************************************************************
+ * Summary:
+ *   Compares every metric with a baseline and prints the verdicts. The
+ *   baseline is first scaled by how much slower this run's calibration loop
+ *   was than the one stored with it; a baseline without calibration is
+ *   compared as it is. A metric regresses when its median is past the
+ *   tolerance and its interval does not overlap the baseline interval.
+ *
+ * Parameters:
+ *   const perf_scenario_t *p_scenario : scenario run
+ *   const perf_summary_t *p_summaries : one summary per metric
+ *   double calibration_ns : median calibration time of this run
+ *   const char *p_path : baseline file
+ *   double tolerance : allowed slowdown in percent
+ *
+ * Return:
+ *   int : number of regressed metrics, -1 if the baseline cannot be read
+ *
+ ******************************************************************************/
+static int perf_compare(const perf_scenario_t *p_scenario, const perf_summary_t *p_summaries,
+                        double calibration_ns, const char *p_path, double tolerance)
+{
+    char text[4096];
+    const perf_summary_t *p_sum;
+    const char *p_metric;
+    const char *p_verdict;
+    perf_summary_t baseline;
+    double baseline_calibration_ns;
+    double scale = 1.0;
+    double factor;
+    double limit;
+    size_t len;
+    FILE *p_file;
+    int lower_is_better;
+    int regressions = 0;
+    int m;
+
+    p_file = fopen(p_path, "r");
+    if (NULL == p_file)
+    {
+        perror(p_path);
+        return -1;
+    }
+    len = fread(text, 1, sizeof(text) - 1, p_file);
+    text[len] = '\0';
+    fclose(p_file);
+
+    p_metric = strstr(text, "\"calibration_ns\":");
+    if ((NULL != p_metric) &&
+        (1 == sscanf(p_metric + strlen("\"calibration_ns\":"), "%lf", &baseline_calibration_ns)) &&
+        (baseline_calibration_ns > 0))
+    {
+        scale = calibration_ns / baseline_calibration_ns;
+    }
+    fprintf(stdout, "perf: %s calibration %.0f ns, baseline scaled x%.2f\n", p_scenario->name,
+            calibration_ns, scale);
+
+    for (m = 0; NULL != p_scenario->metrics[m]; m++)
+    {
+        p_metric = p_scenario->metrics[m];
+        p_sum = &p_summaries[m];
+        if (0 != perf_read_baseline(text, p_metric, &baseline))
+        {
+            fprintf(stdout, "perf: %s %s %.1f, no baseline\n", p_scenario->name, p_metric, p_sum->median);
+            continue;
+        }
+        lower_is_better = (len = strlen(p_metric)) > 3 && (0 == strcmp(&p_metric[len - 3], "_ns"));
+        /* Only timings and rates follow the speed of the host, ratios do not */
+        factor = lower_is_better ? scale : (NULL != strstr(p_metric, "per_sec")) ? 1.0 / scale : 1.0;
+        baseline.median *= factor;
+        baseline.ci_low *= factor;
+        baseline.ci_high *= factor;
+        if (lower_is_better)
+        {
+            limit = baseline.median * (1.0 + tolerance / 100.0);
+            p_verdict = ((p_sum->median > limit) && (p_sum->ci_low > baseline.ci_high)) ? "REGRESSION" : "ok";
+        }
+        else
+        {
+            limit = baseline.median * (1.0 - tolerance / 100.0);
+            p_verdict = ((p_sum->median < limit) && (p_sum->ci_high < baseline.ci_low)) ? "REGRESSION" : "ok";
+        }
+        regressions += ('R' == p_verdict[0]) ? 1 : 0;
+        fprintf(stdout, "perf: %s %s %.1f [%.1f, %.1f] baseline %.1f [%.1f, %.1f] limit %.1f: %s\n",
+                p_scenario->name, p_metric, p_sum->median, p_sum->ci_low, p_sum->ci_high, baseline.median,
+                baseline.ci_low, baseline.ci_high, limit, p_verdict);
+    }
+    return regressions;
+}
+
+/* Writes the summaries as JSON, also the format of a baseline */
+static void perf_write_json(FILE *p_out, const perf_scenario_t *p_scenario, const perf_summary_t *p_summaries,
+                            int repetitions, double calibration_ns)
+{
+    int m;
+
+    fprintf(p_out, "{\n  \"suite\": \"spp_perf\",\n  \"scenario\": \"%s\",\n  \"repetitions\": %d,\n"
+            "  \"calibration_ns\": %.0f,\n  \"metrics\": [\n", p_scenario->name, repetitions, calibration_ns);
+    for (m = 0; NULL != p_scenario->metrics[m]; m++)
+    {
+        fprintf(p_out, "%s    {\"name\": \"%s\", \"median\": %.3f, \"ci_low\": %.3f, \"ci_high\": %.3f, "
+                "\"min\": %.3f, \"max\": %.3f}", (0 == m) ? "" : ",\n", p_scenario->metrics[m],
+                p_summaries[m].median, p_summaries[m].ci_low, p_summaries[m].ci_high,
+                p_summaries[m].min, p_summaries[m].max);
+    }
+    fprintf(p_out, "\n  ]\n}\n");
+}
+
+/*******************************************************************************
+ * Function Name: perf_start_app
+ *******************************************************************************
+ * Summary:
+ *   Applies the scenario options through the application option parser,
+ *   starts the application and opens the scenario sessions
+ *
+ * Parameters:
+ *   const perf_scenario_t *p_scenario : scenario to prepare
+ *
+ * Return:
+ *   int : 0, or -1 if the options were rejected
+ *
+ ******************************************************************************/
+static int perf_start_app(const perf_scenario_t *p_scenario)
+{
+    char *argv[PERF_MAX_OPTIONS + 2];
+    uint8_t bda[BD_ADDR_LEN] = { 0x11, 0x12, 0x13, 0x21, 0x22, 0x00 };
+    wiced_bt_management_evt_data_t event_data;
+    int argc = 0;
+    int i;
+
+    argv[argc++] = "spp_perf";
+    for (i = 0; NULL != p_scenario->options[i]; i++)
+    {
+        argv[argc++] = (char *)p_scenario->options[i];
+    }
+    argv[argc] = NULL;
+    if (1 != app_parse_args(argc, argv))
+    {
+        return -1;
+    }
+
+    spp_application_start();
+    memset(&event_data, 0, sizeof(event_data));
+    event_data.enabled.status = WICED_BT_SUCCESS;
+    bench_stub_management_cb(BTM_ENABLED_EVT, &event_data);
+    for (i = 1; i <= p_scenario->sessions; i++)
+    {
+        bda[BD_ADDR_LEN - 1] = (uint8_t)i;
+        spp_connection_up_callback((uint16_t)i, bda);
+    }
+    spp_handle = 1;
+    bench_stub_pin_buffers();
+    bench_stub_reset();
+    return 0;
+}
+
+/******************************************************************************
+ * Function Name: main()
+ *******************************************************************************
+ * Summary:
+ *   Performance suite entry function
+ *
+ * Parameters:
+ *   int argc            : argument count
+ *   char *argv[]        : list of arguments
+ *
+ * Return:
+ *   EXIT_SUCCESS, or EXIT_FAILURE on a regression or failed check
+ *
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    static double values[PERF_MAX_METRICS][PERF_MAX_REPETITIONS];
+    static double calibration[PERF_MAX_REPETITIONS];
+    perf_summary_t summaries[PERF_MAX_METRICS];
+    perf_summary_t calibration_summary;
+    const perf_scenario_t *p_scenario = NULL;
+    const char *p_name = NULL;
+    const char *p_out_path = NULL;
+    const char *p_baseline = NULL;
+    double tolerance = PERF_DEFAULT_TOLERANCE;
+    double rep_values[PERF_MAX_METRICS];
+    int repetitions = PERF_DEFAULT_REPETITIONS;
+    int write_baseline = 0;
+    int result = 0;
+    FILE *p_out;
+    size_t i;
+    int rep;
+    int m;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:o:b:t:w")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            p_name = optarg;
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'o':
+            p_out_path = optarg;
+            break;
+        case 'b':
+            p_baseline = optarg;
+            break;
+        case 't':
+            tolerance = atof(optarg);
+            break;
+        case 'w':
+            write_baseline = 1;
+            break;
+        default:
+            p_name = NULL;
+            optind = argc;
+            break;
+        }
+    }
+    for (i = 0; (NULL != p_name) && (i < sizeof(perf_scenarios) / sizeof(perf_scenarios[0])); i++)
+    {
+        if (0 == strcmp(p_name, perf_scenarios[i].name))
+        {
+            p_scenario = &perf_scenarios[i];
+        }
+    }
+    if ((NULL == p_scenario) || (repetitions < 1) || (repetitions > PERF_MAX_REPETITIONS) ||
+        (tolerance < 0) || (write_baseline && (NULL == p_baseline)))
+    {
+        fprintf(stderr, "Usage: %s -s <scenario> [-r <repetitions>] [-o <json_file>] "
+                "[-b <baseline_json>] [-t <tolerance_pct>] [-w]\nScenarios:", argv[0]);
+        for (i = 0; i < sizeof(perf_scenarios) / sizeof(perf_scenarios[0]); i++)
+        {
+            fprintf(stderr, " %s", perf_scenarios[i].name);
+        }
+        fprintf(stderr, "\n");
+        return EXIT_FAILURE;
+    }
+
+    perf_devnull_fd = open("/dev/null", O_WRONLY);
+    perf_stdout_fd = dup(STDOUT_FILENO);
+    if ((perf_devnull_fd < 0) || (perf_stdout_fd < 0))
+    {
+        perror("spp_perf");
+        return EXIT_FAILURE;
+    }
+
+    perf_mute_app();
+    if (0 != perf_start_app(p_scenario))
+    {
+        perf_unmute_app();
+        fprintf(stderr, "%s: options rejected by the application\n", p_scenario->name);
+        return EXIT_FAILURE;
+    }
+    /* The first repetition only warms up caches and branch predictors */
+    for (rep = -1; (rep < repetitions) && (0 == result); rep++)
+    {
+        result = p_scenario->run(rep_values);
+        for (m = 0; (rep >= 0) && (NULL != p_scenario->metrics[m]); m++)
+        {
+            values[m][rep] = rep_values[m];
+        }
+        if (rep >= 0)
+        {
+            calibration[rep] = perf_calibrate();
+        }
+        bench_stub_release_buffers();
+    }
+    perf_unmute_app();
+    if (0 != result)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (m = 0; NULL != p_scenario->metrics[m]; m++)
+    {
+        perf_summarise(values[m], repetitions, &summaries[m]);
+    }
+    perf_summarise(calibration, repetitions, &calibration_summary);
+    p_out = (NULL != p_out_path) ? fopen(p_out_path, "w") : fdopen(dup(perf_stdout_fd), "w");
+    if (NULL == p_out)
+    {
+        perror(p_out_path);
+        return EXIT_FAILURE;
+    }
+    perf_write_json(p_out, p_scenario, summaries, repetitions, calibration_summary.median);
+    fclose(p_out);
+
+    if (write_baseline)
+    {
+        p_out = fopen(p_baseline, "w");
+        if (NULL == p_out)
+        {
+            perror(p_baseline);
+            return EXIT_FAILURE;
+        }
+        perf_write_json(p_out, p_scenario, summaries, repetitions, calibration_summary.median);
+        fclose(p_out);
+    }
+    else if ((NULL != p_baseline) &&
+             (0 != perf_compare(p_scenario, summaries, calibration_summary.median, p_baseline, tolerance)))
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* END OF FILE [] */
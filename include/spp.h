@@ -55,6 +55,25 @@
 #define SPP_RFCOMM_SCN                          ( 2 )
 #define SPP_MAX_PAYLOAD                         ( 1007 )
 #define LOCAL_BDA_LEN                           ( 6 )
+#define SPP_MAX_SESSIONS                        ( 4 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Called once every byte of a segment was handed to the stack (sent is
+ * WICED_TRUE) or the segment was dropped on disconnect (sent is WICED_FALSE).
+ * Only then may the caller reuse or free the segment buffer.
+ */
+typedef void (*spp_send_complete_cback_t)(void *p_context, wiced_bool_t sent);
+
+/* One buffer segment of a scatter-gather send */
+typedef struct
+{
+    const uint8_t *p_data;
+    uint32_t len;
+    spp_send_complete_cback_t p_complete; /* may be NULL */
+    void *p_context;
+} spp_iovec_t;
 
 /******************************************************************************
  *          VARIABLE DEFINITIONS
@@ -70,4 +89,14 @@ void spp_application_start( );
 
 void spp_send_sample_data( void );
 
+void spp_send_resumable_data( uint32_t total_len );
+
+void spp_print_stats( void );
+
+wiced_bool_t spp_send_control_data( uint8_t *p_data, uint32_t len );
+
+wiced_bool_t spp_send_iov( uint16_t handle, const spp_iovec_t *p_iov, int iov_count );
+
+uint64_t spp_get_time_us( void );
+
 #endif /* __APP_SPP_H__ */
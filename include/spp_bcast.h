@@ -0,0 +1,83 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_bcast.h
+ *
+ * Description: This is the include file for the reference-counted broadcast
+ *              of one buffer to every connected SPP session.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_BCAST_H__
+#define __APP_SPP_BCAST_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Called once every session has sent the buffer or dropped it on disconnect.
+ * Only then may the caller reuse or free the buffer.
+ */
+typedef void (*spp_bcast_release_cback_t)(void *p_context, uint32_t delivered, uint32_t dropped);
+
+typedef struct
+{
+    uint32_t broadcasts;
+    uint32_t active;            /* broadcasts not yet released */
+    uint32_t deliveries;        /* sessions which sent a broadcast in full */
+    uint32_t drops;             /* sessions which did not */
+    uint64_t held_bytes;        /* broadcast bytes held now, one copy each */
+    uint64_t held_peak_bytes;
+    uint64_t naive_bytes;       /* bytes one copy per session would hold now */
+    uint64_t naive_peak_bytes;
+} spp_bcast_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+int spp_bcast_send(const uint8_t *p_data, uint32_t len, spp_bcast_release_cback_t p_release,
+                   void *p_context);
+
+int spp_bcast_send_copy(const uint8_t *p_data, uint32_t len);
+
+void spp_bcast_get_stats(spp_bcast_stats_t *p_stats);
+
+void spp_bcast_print_stats(void);
+
+#endif /* __APP_SPP_BCAST_H__ */
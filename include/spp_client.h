@@ -0,0 +1,97 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_client.h
+ *
+ * Description: This is the include file for the SPP client (initiator) role.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_CLIENT_H__
+#define __APP_SPP_CLIENT_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Reconnect delay after a failed attempt, doubled up to the maximum */
+#define SPP_CLIENT_RETRY_MIN_MS                 ( 1000 )
+#define SPP_CLIENT_RETRY_MAX_MS                 ( 30000 )
+/* Peers whose service discovery result is remembered */
+#define SPP_CLIENT_MAX_CACHED_PEERS             ( 8 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    uint32_t attempts;          /* wiced_bt_spp_connect() calls */
+    uint32_t connects;
+    uint32_t failures;          /* connection failed callbacks */
+    uint32_t not_found;         /* service not found callbacks */
+    uint32_t skipped;           /* attempts skipped, peer known to have no SPP */
+    uint64_t first_connect_us;  /* latency of the first connection to the peer */
+    uint64_t reconnect_sum_us;  /* latency of the later ones */
+    uint64_t reconnect_max_us;
+} spp_client_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_client_configure_peer(const char *p_bd_addr);
+
+wiced_bool_t spp_client_is_enabled(void);
+
+void spp_client_init(void);
+
+void spp_client_connect(wiced_bool_t force);
+
+void spp_client_connection_up(uint16_t handle, uint8_t *bda);
+
+void spp_client_connection_down(uint16_t handle);
+
+void spp_client_connection_failed(void);
+
+void spp_client_service_not_found(void);
+
+void spp_client_get_stats(spp_client_stats_t *p_stats);
+
+void spp_client_print_stats(void);
+
+#endif /* __APP_SPP_CLIENT_H__ */
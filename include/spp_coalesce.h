@@ -0,0 +1,91 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_coalesce.h
+ *
+ * Description: This is the include file for the optional small-write
+ *              coalescing stage in front of the SPP transmit queue.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_COALESCE_H__
+#define __APP_SPP_COALESCE_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Deadline used when coalescing is enabled without an explicit value */
+#define SPP_COALESCE_DEFAULT_DEADLINE_US        ( 5000 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    uint64_t writes;           /* spp_coalesce_write() calls */
+    uint64_t bytes;            /* bytes flushed to the transmit queue */
+    uint64_t frames;           /* frames flushed to the transmit queue */
+    uint64_t capacity;         /* sum over frames of the session frame size */
+    uint64_t flush_full;       /* frames flushed because they were full */
+    uint64_t flush_deadline;   /* frames flushed by the deadline */
+    uint64_t flush_explicit;   /* frames flushed by spp_coalesce_flush() */
+    uint64_t delay_total_us;   /* sum over frames of the oldest byte's wait */
+    uint32_t delay_max_us;     /* longest wait of any byte */
+    uint32_t write_failures;   /* writes refused, queue full or no session */
+} spp_coalesce_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_coalesce_init(void);
+
+void spp_coalesce_configure(wiced_bool_t enable, uint32_t deadline_us);
+
+wiced_bool_t spp_coalesce_write(uint16_t handle, const uint8_t *p_data, uint32_t len);
+
+void spp_coalesce_flush(uint16_t handle);
+
+void spp_coalesce_connection_down(uint16_t handle);
+
+void spp_coalesce_get_stats(spp_coalesce_stats_t *p_stats);
+
+void spp_coalesce_print_stats(void);
+
+#endif /* __APP_SPP_COALESCE_H__ */
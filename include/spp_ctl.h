@@ -0,0 +1,128 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_ctl.h
+ *
+ * Description: This is the include file for the control socket of the
+ *              headless (daemon) mode of the application.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_CTL_H__
+#define __APP_SPP_CTL_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Every request and response starts with this header, all fields little
+ * endian, followed by len bytes of payload
+ */
+#define SPP_CTL_HDR_LEN                         ( 8 )  /* len:4 op:1 status:1 handle:2 */
+
+/* Requests, the response echoes op and handle. Handle 0 is the session the
+ * menu works on. SEND and SEND_FILE are answered once the data left the
+ * transmit queue (OK) or was dropped on disconnect (DROPPED), every other
+ * request at once. SEND_FILE fails with FILE_ERROR if the file shrinks while
+ * it is sent.
+ */
+#define SPP_CTL_OP_SEND                         ( 0x01 ) /* payload: data */
+#define SPP_CTL_OP_SEND_FILE                    ( 0x02 ) /* payload: path in --daemon-files */
+#define SPP_CTL_OP_LIST                         ( 0x03 ) /* response: JSON array of sessions */
+#define SPP_CTL_OP_DISCONNECT                   ( 0x04 )
+#define SPP_CTL_OP_STATS                        ( 0x05 ) /* response: JSON object */
+#define SPP_CTL_OP_SET_HIDDEN                   ( 0x06 ) /* payload: 1 byte, 1 stops answering inquiries */
+
+/* Response status */
+#define SPP_CTL_STATUS_OK                       ( 0 )
+#define SPP_CTL_STATUS_BAD_REQUEST              ( 1 )
+#define SPP_CTL_STATUS_NO_SESSION               ( 2 )
+#define SPP_CTL_STATUS_NO_RESOURCES             ( 3 )
+#define SPP_CTL_STATUS_FILE_ERROR               ( 4 )
+#define SPP_CTL_STATUS_DROPPED                  ( 5 )
+#define SPP_CTL_STATUS_FORBIDDEN                ( 6 )  /* file outside --daemon-files */
+
+/* Largest send request and largest other request, and control clients
+ * served at once
+ */
+#define SPP_CTL_MAX_SEND_LEN                    ( 4 * 1024 * 1024 )
+#define SPP_CTL_MAX_ARG_LEN                     ( 4096 )
+#define SPP_CTL_MAX_CLIENTS                     ( 16 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    uint32_t clients;            /* connections accepted */
+    uint32_t rejected;           /* connections refused, all slots in use */
+    uint32_t denied;             /* connections refused, client not allowed */
+    uint64_t requests;
+    uint64_t bad_requests;
+    uint64_t bytes_queued;       /* data handed to the transmit queue */
+    uint64_t bytes_sent;         /* of which sent */
+    uint32_t queue_waits;        /* sends held until the queue had room */
+} spp_ctl_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_ctl_configure(const char *p_path);
+
+wiced_bool_t spp_ctl_configure_group(const char *p_group);
+
+wiced_bool_t spp_ctl_configure_file_dir(const char *p_dir);
+
+void spp_ctl_get_access(const char **pp_group, const char **pp_file_dir);
+
+wiced_bool_t spp_ctl_is_enabled(void);
+
+const char *spp_ctl_get_path(void);
+
+int spp_ctl_listen(const char *p_path, int backlog);
+
+wiced_bool_t spp_ctl_peer_allowed(int fd);
+
+int spp_ctl_run(void);
+
+void spp_ctl_get_stats(spp_ctl_stats_t *p_stats);
+
+void spp_ctl_print_stats(void);
+
+#endif /* __APP_SPP_CTL_H__ */
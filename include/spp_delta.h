@@ -0,0 +1,113 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_delta.h
+ *
+ * Description: This is the include file for the block delta sync layer used
+ *              on top of the resumable bulk transfers.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_DELTA_H__
+#define __APP_SPP_DELTA_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Every delta stream starts with the magic and the stream type */
+#define SPP_DELTA_MAGIC                         "SPDL"
+#define SPP_DELTA_MAGIC_LEN                     ( 4 )
+
+/* Object names are plain file names in the receive directory */
+#define SPP_DELTA_MAX_NAME                      ( 64 )
+
+/* Largest image, and the block size range. The sender picks about the
+ * square root of the image size, so the signatures stay small.
+ */
+#define SPP_DELTA_MAX_LEN                       ( 256 * 1024 * 1024 )
+#define SPP_DELTA_MIN_BLOCK                     ( 512 )
+#define SPP_DELTA_MAX_BLOCK                     ( 64 * 1024 )
+
+/* A stream is started again every SPP_DELTA_RETRY_MS while another transfer
+ * holds the transfer layer, for up to SPP_DELTA_MAX_RETRY times
+ */
+#define SPP_DELTA_RETRY_MS                      ( 100 )
+#define SPP_DELTA_MAX_RETRY                     ( 300 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    /* Sending side */
+    uint32_t pushes;              /* pushes started */
+    uint32_t pushes_completed;    /* rebuilt and verified by the receiver */
+    uint32_t pushes_failed;
+    uint64_t bytes_image;         /* size of the images pushed */
+    uint64_t bytes_sent;          /* request and delta streams sent */
+    uint64_t bytes_literal;       /* changed data sent as is */
+    uint64_t bytes_matched;       /* data the receiver copied from its copy */
+    uint64_t bytes_signatures;    /* signatures received */
+    uint32_t last_image_len;      /* last completed push */
+    uint32_t last_sent_len;
+
+    /* Receiving side */
+    uint32_t rebuilt;             /* images rebuilt and verified */
+    uint32_t verify_failures;
+    uint64_t bytes_rebuilt;
+} spp_delta_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_delta_init(void);
+
+wiced_bool_t spp_delta_configure_dir(const char *p_dir);
+
+wiced_bool_t spp_delta_send(uint16_t handle, const char *p_path);
+
+wiced_bool_t spp_delta_rx_xfer(uint16_t handle, uint32_t xfer_id, uint32_t offset,
+                               uint8_t *p_data, uint32_t len, uint32_t total_len);
+
+void spp_delta_get_stats(spp_delta_stats_t *p_stats);
+
+void spp_delta_print_stats(void);
+
+#endif /* __APP_SPP_DELTA_H__ */
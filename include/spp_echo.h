@@ -0,0 +1,111 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_echo.h
+ *
+ * Description: This is the include file for the echo / ping-pong mode used
+ *              to measure the application level round-trip time of the link.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_ECHO_H__
+#define __APP_SPP_ECHO_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Probe header: magic (2 bytes), sequence number (LE32), send time in
+ * microseconds (LE64). The rest of the probe is padding.
+ */
+#define SPP_ECHO_MAGIC_0                        ( 0xEC )
+#define SPP_ECHO_MAGIC_1                        ( 0x50 )
+#define SPP_ECHO_HDR_LEN                        ( 14 )
+#define SPP_ECHO_DEFAULT_SIZE                   ( 64 )
+#define SPP_ECHO_DEFAULT_INTERVAL_MS            ( 100 )
+/* RTT samples kept for the percentiles */
+#define SPP_ECHO_MAX_SAMPLES                    ( 4096 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    uint32_t probes_sent;
+    uint32_t replies;
+    uint32_t lost;           /* probes without a reply when the run ended */
+    uint32_t reordered;      /* replies older than one already received */
+    uint32_t invalid_bytes;  /* bytes skipped while looking for a probe */
+    uint32_t send_failures;  /* probes the transmit queue did not accept */
+    uint32_t rtt_min_us;
+    uint32_t rtt_p50_us;
+    uint32_t rtt_p99_us;
+    uint32_t rtt_max_us;
+    uint32_t jitter_us;      /* RFC 3550 estimator over consecutive RTTs */
+    uint64_t echoed_bytes;   /* reflector */
+    uint32_t echo_drops;     /* reflector frames the transmit queue did not accept */
+} spp_echo_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_echo_init(void);
+
+void spp_echo_configure_reflector(wiced_bool_t enable);
+
+wiced_bool_t spp_echo_configure_probe(uint32_t size, uint32_t interval_ms, uint32_t count,
+                                      wiced_bool_t auto_start);
+
+void spp_echo_connection_up(uint16_t handle);
+
+void spp_echo_connection_down(uint16_t handle);
+
+wiced_bool_t spp_echo_start(uint16_t handle);
+
+void spp_echo_stop(void);
+
+wiced_bool_t spp_echo_is_probing(void);
+
+wiced_bool_t spp_echo_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len);
+
+void spp_echo_get_stats(spp_echo_stats_t *p_stats);
+
+void spp_echo_print_stats(void);
+
+#endif /* __APP_SPP_ECHO_H__ */
@@ -0,0 +1,118 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_gatt.h
+ *
+ * Description: This is the include file for the LE GATT serial service
+ *              which carries SPP sessions over Bluetooth LE.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_GATT_H__
+#define __APP_SPP_GATT_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "wiced_bt_spp.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Set in the handle of every LE session, RFCOMM handles never have it */
+#define SPP_GATT_HANDLE_FLAG                    ( 0x8000 )
+#define SPP_GATT_IS_SESSION(handle)             ( 0 != ((handle) & SPP_GATT_HANDLE_FLAG) )
+/* Matches ble_max_simultaneous_links of the stack configuration */
+#define SPP_GATT_MAX_LINKS                      ( 2 )
+/* Largest ATT MTU offered, matches ble_max_rx_pdu_size */
+#define SPP_GATT_MAX_MTU                        ( 517 )
+#define SPP_GATT_DEFAULT_MTU                    ( 23 )
+#define SPP_GATT_ATT_HEADER                     ( 3 )
+/* Notifications handed to the stack and not yet transmitted, per link */
+#define SPP_GATT_MAX_IN_FLIGHT                  ( 8 )
+/* LL payload requested with the data length extension */
+#define SPP_GATT_DATA_LENGTH                    ( 251 )
+/* Connection interval in 1.25 ms units, supervision timeout in 10 ms units */
+#define SPP_GATT_CONN_INTERVAL_MIN              ( 6 )
+#define SPP_GATT_CONN_INTERVAL_MAX              ( 12 )
+#define SPP_GATT_CONN_LATENCY                   ( 0 )
+#define SPP_GATT_SUPERVISION_TIMEOUT            ( 500 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Session callbacks, the same ones given to wiced_bt_spp_startup() */
+typedef struct
+{
+    wiced_bt_spp_connection_up_callback_t p_connection_up_callback;
+    wiced_bt_spp_connection_down_callback_t p_connection_down_callback;
+    wiced_bt_spp_rx_data_callback_t p_rx_data_callback;
+} spp_gatt_reg_t;
+
+typedef struct
+{
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t rejected;          /* links refused, no free session */
+    uint32_t mtu_exchanges;
+    uint32_t phy_2m;            /* PHY updates ending on 2M in both directions */
+    uint32_t data_length_updates;
+    uint64_t notifications;     /* notifications accepted by the stack */
+    uint64_t notify_bytes;
+    uint64_t writes;            /* writes and write commands to the RX value */
+    uint64_t write_bytes;
+    uint32_t congestions;       /* times the stack reported congestion */
+    uint32_t no_buffers;        /* notifications not sent, heap exhausted */
+} spp_gatt_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_gatt_configure(wiced_bool_t enable);
+
+wiced_bool_t spp_gatt_is_enabled(void);
+
+void spp_gatt_init(const spp_gatt_reg_t *p_reg);
+
+void spp_gatt_phy_update(uint8_t *bda, uint8_t tx_phy, uint8_t rx_phy);
+
+void spp_gatt_data_length_update(uint8_t *bda, uint16_t tx_octets, uint16_t rx_octets);
+
+void spp_gatt_get_stats(spp_gatt_stats_t *p_stats);
+
+void spp_gatt_print_stats(void);
+
+#endif /* __APP_SPP_GATT_H__ */
@@ -0,0 +1,121 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_l2cap.h
+ *
+ * Description: This is the include file for the L2CAP bulk channel which
+ *              carries SPP sessions without RFCOMM framing.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_L2CAP_H__
+#define __APP_SPP_L2CAP_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "wiced_bt_spp.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Dynamic PSM of the bulk channel, both ends must use the same */
+#define SPP_L2CAP_PSM                           ( 0x1001 )
+/* Set in the handle of every L2CAP session */
+#define SPP_L2CAP_HANDLE_FLAG                   ( 0x4000 )
+#define SPP_L2CAP_IS_SESSION(handle)            ( 0 != ((handle) & SPP_L2CAP_HANDLE_FLAG) )
+/* Matches max_app_l2cap_br_edr_ertm_chnls of the stack configuration */
+#define SPP_L2CAP_MAX_CHANNELS                  ( 2 )
+#define SPP_L2CAP_MIN_MTU                       ( 48 )
+#define SPP_L2CAP_DEFAULT_MTU                   ( 4096 )
+/* Bounded by the session frame buffers taken from the stack heap */
+#define SPP_L2CAP_MAX_MTU                       ( 8192 )
+/* Matches max_app_l2cap_br_edr_ertm_tx_win, 63 at most without the
+ * extended window option
+ */
+#define SPP_L2CAP_TX_WINDOW                     ( 32 )
+#define SPP_L2CAP_MAX_TRANSMIT                  ( 10 )
+#define SPP_L2CAP_RETRANS_TIMEOUT               ( 2000 )  /* msec */
+#define SPP_L2CAP_MONITOR_TIMEOUT               ( 12000 ) /* msec */
+/* I-frame payload. A segment with the basic header, control field, SDU
+ * length and FCS then fills one 3-DH5 packet (1021 bytes).
+ */
+#define SPP_L2CAP_MPS                           ( 1011 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef enum
+{
+    SPP_L2CAP_MODE_ERTM,        /* retransmissions and acknowledgements */
+    SPP_L2CAP_MODE_STREAM,      /* no retransmission, lost frames are dropped */
+} spp_l2cap_mode_t;
+
+/* Session callbacks, the same ones given to wiced_bt_spp_startup() */
+typedef struct
+{
+    wiced_bt_spp_connection_up_callback_t p_connection_up_callback;
+    wiced_bt_spp_connection_down_callback_t p_connection_down_callback;
+    wiced_bt_spp_rx_data_callback_t p_rx_data_callback;
+} spp_l2cap_reg_t;
+
+typedef struct
+{
+    uint32_t connect_requests;  /* channels opened by this side */
+    uint32_t connect_failures;  /* requests refused at once by the stack */
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t rejected;          /* channels closed, no free session */
+    uint32_t congestions;       /* times the channel reported congestion */
+    uint32_t write_failures;    /* SDUs the stack refused */
+} spp_l2cap_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_l2cap_configure(uint32_t mtu, spp_l2cap_mode_t mode);
+
+wiced_bool_t spp_l2cap_is_enabled(void);
+
+void spp_l2cap_init(const spp_l2cap_reg_t *p_reg);
+
+wiced_bool_t spp_l2cap_connect(uint8_t *bda);
+
+void spp_l2cap_get_stats(spp_l2cap_stats_t *p_stats);
+
+void spp_l2cap_print_stats(void);
+
+#endif /* __APP_SPP_L2CAP_H__ */
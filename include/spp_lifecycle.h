@@ -0,0 +1,114 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_lifecycle.h
+ *
+ * Description: This is the include file for the connection lifecycle tracer,
+ *              which times every stage from ACL connection to SPP session.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_LIFECYCLE_H__
+#define __APP_SPP_LIFECYCLE_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "wiced_bt_dev.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Peers traced at the same time */
+#define SPP_LIFECYCLE_MAX_PEERS                 ( 8 )
+
+/* Histogram buckets: < 1 ms, < 2 ms, < 4 ms, ... the last one is open ended */
+#define SPP_LIFECYCLE_HIST_BUCKETS              ( 14 )
+
+/* A stage taking longer than this is reported as slow */
+#define SPP_LIFECYCLE_SLOW_STAGE_MS             ( 300 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef enum
+{
+    SPP_LIFECYCLE_ACL_UP,          /* ACL link connected */
+    SPP_LIFECYCLE_LINK_KEY_REQ,    /* stack asked for a stored link key */
+    SPP_LIFECYCLE_IO_CAP_REQ,      /* pairing started */
+    SPP_LIFECYCLE_USER_CONFIRM,    /* numeric comparison confirmed */
+    SPP_LIFECYCLE_PAIRING_DONE,    /* pairing complete */
+    SPP_LIFECYCLE_ENCRYPTED,       /* link encrypted */
+    SPP_LIFECYCLE_SPP_UP,          /* SPP session usable */
+    SPP_LIFECYCLE_STAGES
+} spp_lifecycle_stage_t;
+
+typedef struct
+{
+    uint32_t count;                                /* times the stage was reached */
+    uint64_t total_us;                             /* sum of time since previous stage */
+    uint32_t max_us;
+    uint32_t slow;                                 /* times above the slow threshold */
+    uint32_t hist[SPP_LIFECYCLE_HIST_BUCKETS];     /* log2 ms buckets */
+} spp_lifecycle_stage_stats_t;
+
+typedef struct
+{
+    spp_lifecycle_stage_stats_t stages[SPP_LIFECYCLE_STAGES];
+    spp_lifecycle_stage_stats_t total;   /* ACL up to SPP up */
+    uint32_t reconnects;                 /* sessions set up with a stored key */
+    uint32_t full_pairings;              /* sessions which had to pair */
+    uint32_t key_misses;                 /* link key requests without a stored key */
+    uint32_t repairs_after_key_miss;     /* full pairings caused by a key miss */
+    uint32_t failures;                   /* pairing or encryption failures */
+    uint32_t aborted;                    /* ACL dropped before the SPP session */
+} spp_lifecycle_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_lifecycle_init(void);
+
+void spp_lifecycle_event(const wiced_bt_device_address_t bda, spp_lifecycle_stage_t stage,
+                         wiced_bool_t success);
+
+void spp_lifecycle_acl_down(const wiced_bt_device_address_t bda);
+
+void spp_lifecycle_get_stats(spp_lifecycle_stats_t *p_stats);
+
+void spp_lifecycle_print_stats(void);
+
+#endif /* __APP_SPP_LIFECYCLE_H__ */
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_link.h
+ *
+ * Description: This is the include file for the link profiles of BR/EDR
+ *              links: role, link policy settings and the RFCOMM frame size
+ *              of each session, with the throughput each connection reached.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_LINK_H__
+#define __APP_SPP_LINK_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Peers with their own profile, given as <profile>@<bd_addr> */
+#define SPP_LINK_MAX_PEER_PROFILES              ( 8 )
+
+/* Sessions listed with the statistics, the oldest is dropped */
+#define SPP_LINK_HISTORY                        ( 16 )
+
+/* L2CAP and RFCOMM headers of a frame on the ACL link */
+#define SPP_LINK_FRAME_OVERHEAD                 ( 10 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct
+{
+    uint32_t links;               /* ACL links brought up */
+    uint32_t role_switches;       /* role switches requested */
+    uint32_t role_switch_failures;
+    uint32_t policy_failures;     /* link policy not accepted */
+    uint32_t sessions;            /* sessions recorded */
+    uint32_t frames_resized;      /* sessions sized for their packet type */
+} spp_link_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_link_configure(const char *p_spec);
+
+void spp_link_acl_up(const wiced_bt_device_address_t bda, const uint8_t *p_features);
+
+void spp_link_acl_down(const wiced_bt_device_address_t bda);
+
+void spp_link_connection_up(uint16_t handle, const uint8_t *bda);
+
+void spp_link_connection_down(uint16_t handle);
+
+void spp_link_get_stats(spp_link_stats_t *p_stats);
+
+void spp_link_print_stats(void);
+
+#endif /* __APP_SPP_LINK_H__ */
@@ -0,0 +1,125 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_mux.h
+ *
+ * Description: This is the include file for the logical stream multiplexer
+ *              which carries several prioritised streams over one SPP
+ *              session.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_MUX_H__
+#define __APP_SPP_MUX_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "spp.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+#define SPP_MUX_MAX_STREAMS                     ( 8 )
+/* Messages which can wait per stream and session */
+#define SPP_MUX_MAX_MESSAGES                    ( 32 )
+
+/* Every chunk on the link is preceded by a header:
+ * magic (1) | stream id (1) | payload length (2, little endian)
+ */
+#define SPP_MUX_MAGIC                           ( 0x4D )
+#define SPP_MUX_HDR_LEN                         ( 4 )
+#define SPP_MUX_MAX_CHUNK                       ( SPP_MAX_PAYLOAD - SPP_MUX_HDR_LEN )
+
+/* Chunks handed to the transmit queue and not yet sent. Keeping this small
+ * bounds how long a high priority message waits behind bulk data.
+ */
+#define SPP_MUX_MAX_IN_FLIGHT                   ( 2 )
+
+/* Bytes a stream of weight 1 may send per deficit round robin round */
+#define SPP_MUX_QUANTUM                         ( SPP_MUX_MAX_CHUNK )
+
+/* Streams used by the application, a lower priority value is served first */
+#define SPP_MUX_STREAM_CONTROL                  ( 0 )
+#define SPP_MUX_STREAM_BULK                     ( 1 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Called for every chunk received on a stream */
+typedef void (*spp_mux_rx_cback_t)(uint16_t handle, uint8_t stream_id, uint8_t *p_data,
+                                   uint32_t len);
+
+typedef struct
+{
+    uint64_t messages_sent;    /* messages completely accepted by the stack */
+    uint64_t messages_dropped; /* messages released on disconnect */
+    uint64_t bytes_sent;       /* payload bytes accepted by the stack */
+    uint64_t chunks_sent;      /* chunks accepted by the stack */
+    uint64_t bytes_received;   /* payload bytes received */
+    uint64_t latency_total_us; /* sum of send to completion time of messages */
+    uint32_t latency_max_us;   /* longest send to completion time */
+    uint32_t queue_depth;      /* messages waiting now */
+    uint32_t queue_depth_max;  /* most messages ever waiting */
+    uint32_t send_failures;    /* messages refused, queue full or no session */
+} spp_mux_stream_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_mux_init(void);
+
+void spp_mux_enable(wiced_bool_t enable);
+
+wiced_bool_t spp_mux_is_enabled(void);
+
+wiced_bool_t spp_mux_open_stream(uint8_t stream_id, uint8_t priority, uint8_t weight,
+                                 spp_mux_rx_cback_t p_rx_cback);
+
+wiced_bool_t spp_mux_send(uint16_t handle, uint8_t stream_id, const uint8_t *p_data,
+                          uint32_t len, spp_send_complete_cback_t p_complete, void *p_context);
+
+void spp_mux_connection_up(uint16_t handle);
+
+void spp_mux_connection_down(uint16_t handle);
+
+void spp_mux_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len);
+
+void spp_mux_get_stats(uint8_t stream_id, spp_mux_stream_stats_t *p_stats);
+
+void spp_mux_print_stats(void);
+
+#endif /* __APP_SPP_MUX_H__ */
@@ -0,0 +1,88 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_pattern.h
+ *
+ * Description: This is the include file for the test pattern engine which
+ *              generates the sample data and verifies it on reception.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_PATTERN_H__
+#define __APP_SPP_PATTERN_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+#define SPP_PATTERN_SPEC_MAX_LEN                ( 128 )
+/* Bytes of the xorshift stream before it repeats */
+#define SPP_PATTERN_PRNG_PERIOD                 ( 1024 * 1024 )
+/* Largest file replayed by a file:<path> pattern */
+#define SPP_PATTERN_MAX_FILE_SIZE               ( 16 * 1024 * 1024 )
+/* Short periods are repeated up to this size so that copies stay long */
+#define SPP_PATTERN_MIN_TABLE_SIZE              ( 16 * 1024 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Pattern types, selected by the prefix of the spec string */
+typedef enum
+{
+    SPP_PATTERN_INCREMENT, /* "incr": byte n is n modulo 256 (default) */
+    SPP_PATTERN_FIXED,     /* "fixed:<byte>": the same byte throughout */
+    SPP_PATTERN_PRNG,      /* "xorshift[:<seed>]": xorshift64 stream */
+    SPP_PATTERN_FILE,      /* "file:<path>": the file contents, repeated */
+    SPP_PATTERN_TYPES
+} spp_pattern_type_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_pattern_configure(const char *p_spec);
+
+void spp_pattern_init(void);
+
+void spp_pattern_fill(uint64_t offset, uint8_t *p_buf, uint32_t len);
+
+uint32_t spp_pattern_verify(uint64_t offset, const uint8_t *p_data, uint32_t len, uint32_t *p_first);
+
+void spp_pattern_print_stats(void);
+
+#endif /* __APP_SPP_PATTERN_H__ */
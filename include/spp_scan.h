@@ -0,0 +1,109 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_scan.h
+ *
+ * Description: This is the include file for the page and inquiry scan
+ *              scheduler, which switches between a high duty burst profile
+ *              and a low duty profile.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_SCAN_H__
+#define __APP_SPP_SCAN_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "wiced_bt_dev.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Burst profile, scan intervals and windows in 0.625 ms slots */
+#define SPP_SCAN_BURST_PAGE_INTERVAL            ( 0x0080 ) /* 80 ms */
+#define SPP_SCAN_BURST_PAGE_WINDOW              ( 0x0040 ) /* 40 ms */
+#define SPP_SCAN_BURST_INQUIRY_INTERVAL         ( 0x0200 ) /* 320 ms */
+#define SPP_SCAN_BURST_INQUIRY_WINDOW           ( 0x0048 ) /* 45 ms */
+
+/* How long a burst lasts before stepping down to the low duty profile */
+#define SPP_SCAN_DEFAULT_BURST_MS               ( 30000 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef enum
+{
+    SPP_SCAN_PROFILE_BURST,    /* high duty, right after boot, disconnect or request */
+    SPP_SCAN_PROFILE_LOW_DUTY, /* the stack's default scan parameters */
+    SPP_SCAN_PROFILES
+} spp_scan_profile_t;
+
+typedef enum
+{
+    SPP_SCAN_BURST_BOOT,
+    SPP_SCAN_BURST_DISCONNECT,
+    SPP_SCAN_BURST_REQUEST, /* also opens discoverability for new peers */
+} spp_scan_burst_reason_t;
+
+typedef struct
+{
+    uint32_t activations;       /* times the profile was applied */
+    uint32_t connects;          /* ACL connections while the profile was active */
+    uint64_t connect_total_ms;  /* sum of profile start to ACL connection */
+    uint32_t connect_max_ms;
+} spp_scan_profile_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_scan_init(wiced_bool_t bonded);
+
+void spp_scan_configure_burst(uint32_t duration_ms);
+
+void spp_scan_set_bonded(wiced_bool_t bonded);
+
+void spp_scan_set_hidden(wiced_bool_t hidden);
+
+void spp_scan_start_burst(spp_scan_burst_reason_t reason);
+
+void spp_scan_acl_up(void);
+
+void spp_scan_get_stats(spp_scan_profile_t profile, spp_scan_profile_stats_t *p_stats);
+
+void spp_scan_print_stats(void);
+
+#endif /* __APP_SPP_SCAN_H__ */
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_sched.h
+ *
+ * Description: This is the include file for the thread placement, real-time
+ *              scheduling and scheduling jitter monitor of the application.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_SCHED_H__
+#define __APP_SPP_SCHED_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Delay histogram buckets: 0 us, then [2^(i-1), 2^i) us, the last one open */
+#define SPP_SCHED_HIST_BUCKETS                  ( 18 )
+#define SPP_SCHED_DEFAULT_PERIOD_US             ( 1000 )
+#define SPP_SCHED_MIN_PERIOD_US                 ( 100 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef enum
+{
+    SPP_SCHED_ROLE_STACK, /* "stack": BT stack and HCI threads of the porting layer */
+    SPP_SCHED_ROLE_MENU,  /* "menu": main thread reading the menu, or serving --daemon */
+    SPP_SCHED_ROLE_IO,    /* "io": application worker threads, e.g. the uring reaper */
+    SPP_SCHED_ROLES
+} spp_sched_role_t;
+
+typedef struct
+{
+    uint64_t samples;
+    uint64_t total_us;  /* sum of the delays */
+    uint32_t max_us;
+    uint32_t hist[SPP_SCHED_HIST_BUCKETS];
+} spp_sched_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_sched_configure(const char *p_spec);
+
+void spp_sched_configure_mlock(wiced_bool_t enable);
+
+wiced_bool_t spp_sched_configure_jitter(uint32_t period_us);
+
+void spp_sched_lock_memory(void);
+
+wiced_bool_t spp_sched_apply(spp_sched_role_t role);
+
+void spp_sched_init(void);
+
+void spp_sched_get_stats(spp_sched_role_t role, spp_sched_stats_t *p_stats);
+
+void spp_sched_print_stats(void);
+
+#endif /* __APP_SPP_SCHED_H__ */
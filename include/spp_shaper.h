@@ -0,0 +1,111 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_shaper.h
+ *
+ * Description: This is the include file for the token-bucket shapers of the
+ *              SPP transmit path.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_SHAPER_H__
+#define __APP_SPP_SHAPER_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "spp.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Timer wheel shared by every deferred session */
+#define SPP_SHAPER_TICK_MS                      ( 5 )
+#define SPP_SHAPER_WHEEL_SLOTS                  ( 64 )
+/* Buckets hold at least two full frames, so that tokens earned while a
+ * session waits for the next tick are not lost. A burst of 0 is the amount
+ * earned in SPP_SHAPER_DEFAULT_BURST_MS.
+ */
+#define SPP_SHAPER_MIN_BURST                    ( 2 * SPP_MAX_PAYLOAD )
+#define SPP_SHAPER_DEFAULT_BURST_MS             ( 20 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Rates are in bytes per second, 0 means no limit (max_rate) or no
+ * guarantee (min_rate)
+ */
+typedef struct
+{
+    uint32_t min_rate;  /* guaranteed rate, sent even when the link bucket is empty */
+    uint32_t max_rate;  /* ceiling of the session */
+    uint32_t burst;     /* bucket depth in bytes, 0 for the default */
+} spp_shaper_config_t;
+
+typedef struct
+{
+    uint16_t handle;
+    uint64_t bytes;           /* bytes admitted */
+    uint64_t committed_bytes; /* bytes admitted under the guaranteed rate */
+    uint64_t deferred_bytes;  /* bytes of frames which had to wait */
+    uint32_t deferrals;       /* times the session had to wait */
+    uint64_t connected_us;    /* time since the session came up */
+} spp_shaper_session_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_shaper_init(void);
+
+void spp_shaper_configure_default(const spp_shaper_config_t *p_config);
+
+wiced_bool_t spp_shaper_configure_session(uint16_t handle, const spp_shaper_config_t *p_config);
+
+void spp_shaper_configure_link(uint32_t rate, uint32_t burst);
+
+void spp_shaper_connection_up(uint16_t handle);
+
+void spp_shaper_connection_down(uint16_t handle);
+
+wiced_bool_t spp_shaper_admit(uint16_t handle, uint32_t len);
+
+void spp_shaper_commit(uint16_t handle, uint32_t len);
+
+wiced_bool_t spp_shaper_get_session_stats(uint16_t handle, spp_shaper_session_stats_t *p_stats);
+
+void spp_shaper_print_stats(void);
+
+#endif /* __APP_SPP_SHAPER_H__ */
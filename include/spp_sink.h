@@ -0,0 +1,106 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_sink.h
+ *
+ * Description: This is the include file for the pluggable sinks which
+ *              consume the data received on SPP sessions.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_SINK_H__
+#define __APP_SPP_SINK_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+#define SPP_SINK_SPEC_MAX_LEN                   ( 128 )
+/* Size of the ring sink when the spec gives none */
+#define SPP_SINK_DEFAULT_RING_SIZE              ( 64 * 1024 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Sink types, selected by the prefix of the spec string */
+typedef enum
+{
+    SPP_SINK_PRINT,    /* "print": print every byte (default) */
+    SPP_SINK_DISCARD,  /* "discard": count only */
+    SPP_SINK_CHECKSUM, /* "checksum": running CRC-32 of the stream */
+    SPP_SINK_FILE,     /* "file:<path>": append to a file */
+    SPP_SINK_FD,       /* "fd:<n>", "unix:<path>", "tcp:<ipv4>:<port>": forward */
+    SPP_SINK_RING,     /* "ring[:<bytes>]": keep the latest bytes in memory */
+    SPP_SINK_URING,    /* "uring:<path>": append to a file through io_uring */
+    SPP_SINK_VERIFY,   /* "verify": compare with the configured test pattern */
+    SPP_SINK_TYPES
+} spp_sink_type_t;
+
+typedef struct
+{
+    uint64_t bytes;     /* bytes consumed */
+    uint64_t writes;    /* rx callbacks consumed */
+    uint64_t errors;    /* bytes which could not be written, or differ
+                           from the pattern */
+    uint64_t busy_us;   /* time spent inside the sink */
+    uint32_t sessions;  /* sessions which used the sink */
+} spp_sink_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_sink_configure(const char *p_spec);
+
+void spp_sink_connection_up(uint16_t handle);
+
+void spp_sink_connection_down(uint16_t handle);
+
+wiced_bool_t spp_sink_select(uint16_t handle, const char *p_spec);
+
+void spp_sink_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len);
+
+uint32_t spp_sink_ring_read(uint16_t handle, uint8_t *p_buf, uint32_t len);
+
+uint32_t spp_sink_checksum(uint16_t handle);
+
+void spp_sink_get_stats(spp_sink_type_t type, spp_sink_stats_t *p_stats);
+
+void spp_sink_print_stats(void);
+
+#endif /* __APP_SPP_SINK_H__ */
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_startup.h
+ *
+ * Description: This is the include file for the startup path: the patch
+ *              download skip and the startup timing breakdown.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_STARTUP_H__
+#define __APP_SPP_STARTUP_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Vendor command returning the chip, target and patch build of the firmware */
+#define SPP_STARTUP_READ_BUILD_OPCODE           ( 0xFC79 )
+/* How long the probe waits for the controller to answer */
+#define SPP_STARTUP_PROBE_TIMEOUT_MS            ( 200 )
+#define SPP_STARTUP_MAX_BUILD_ID                ( 32 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef enum
+{
+    SPP_STARTUP_BEGIN,        /* main() entered */
+    SPP_STARTUP_PROBED,       /* running patch probed */
+    SPP_STARTUP_TRANSPORT_UP, /* GPIO reset, autobaud and patch download done */
+    SPP_STARTUP_STACK_INIT,   /* wiced_bt_stack_init() returned */
+    SPP_STARTUP_ENABLED,      /* BTM_ENABLED_EVT */
+    SPP_STARTUP_READY,        /* application initialized */
+    SPP_STARTUP_STAGES
+} spp_startup_stage_t;
+
+typedef enum
+{
+    SPP_STARTUP_PATCH_NONE,       /* no patch file given */
+    SPP_STARTUP_PATCH_DOWNLOADED,
+    SPP_STARTUP_PATCH_SKIPPED,    /* the controller already runs it */
+} spp_startup_patch_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_startup_mark(spp_startup_stage_t stage);
+
+void spp_startup_configure_cache(const char *p_path);
+
+void spp_startup_configure_log(const char *p_path);
+
+wiced_bool_t spp_startup_probe(const char *p_hci_port, uint32_t baudrate, const char *p_patch_file);
+
+void spp_startup_stack_enabled(void);
+
+spp_startup_patch_t spp_startup_get_patch(void);
+
+uint32_t spp_startup_get_stage_us(spp_startup_stage_t stage);
+
+void spp_startup_print_stats(void);
+
+#endif /* __APP_SPP_STARTUP_H__ */
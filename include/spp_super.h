@@ -0,0 +1,79 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_super.h
+ *
+ * Description: This is the include file for the supervisor which runs one
+ *              worker process per controller.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_SUPER_H__
+#define __APP_SPP_SUPER_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Workers (controllers) and arguments per worker */
+#define SPP_SUPER_MAX_WORKERS                   ( 8 )
+#define SPP_SUPER_MAX_ARGS                      ( 64 )
+
+/* How often the workers are polled for their load and statistics */
+#define SPP_SUPER_POLL_MS                       ( 1000 )
+#define SPP_SUPER_QUERY_TIMEOUT_MS              ( 500 )
+
+/* Restart backoff of a crashed worker, reset once it ran for a while */
+#define SPP_SUPER_RESTART_MIN_MS                ( 1000 )
+#define SPP_SUPER_RESTART_MAX_MS                ( 30000 )
+#define SPP_SUPER_STABLE_MS                     ( 60000 )
+
+/* Time the workers get to exit on shutdown before they are killed */
+#define SPP_SUPER_STOP_TIMEOUT_MS               ( 5000 )
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+wiced_bool_t spp_super_configure(const char *p_config);
+
+wiced_bool_t spp_super_is_enabled(void);
+
+int spp_super_run(const char *p_argv0);
+
+#endif /* __APP_SPP_SUPER_H__ */
@@ -0,0 +1,151 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_tx.h
+ *
+ * Description: This is the include file for the per-session SPP transmit
+ *              queue behind spp_send_iov().
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_TX_H__
+#define __APP_SPP_TX_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "spp.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Segments which can be queued per session */
+#define SPP_TX_MAX_SEGMENTS                     ( 64 )
+#define SPP_TX_RETRY_TIMEOUT                    ( 20 ) /* msec */
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Transports a session can run over, told apart by the session handle */
+typedef enum
+{
+    SPP_TRANSPORT_RFCOMM,
+    SPP_TRANSPORT_GATT,
+    SPP_TRANSPORT_L2CAP,
+    SPP_TRANSPORT_MAX
+} spp_transport_t;
+
+/* Send path of a transport. p_send must copy the data, or keep it until sent,
+ * before returning WICED_TRUE. p_disconnect starts closing a session, which
+ * then goes down through the usual connection down callback.
+ */
+typedef struct
+{
+    wiced_bool_t (*p_can_send)(uint16_t handle);
+    wiced_bool_t (*p_send)(uint16_t handle, uint8_t *p_data, uint32_t len);
+    wiced_bool_t (*p_disconnect)(uint16_t handle);
+} spp_tx_transport_ops_t;
+
+typedef struct
+{
+    uint32_t sessions;           /* sessions opened */
+    uint64_t connected_us;       /* time sessions were open, summed */
+    uint64_t tx_frames;          /* frames accepted by the transport */
+    uint64_t tx_bytes;           /* payload bytes accepted by the transport */
+    uint64_t rx_bytes;           /* payload bytes received */
+    uint32_t stalls;             /* times the transport could not take a frame */
+    uint32_t rtt_samples;        /* round trips measured by the echo probes */
+    uint64_t rtt_total_us;
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+} spp_tx_transport_stats_t;
+
+typedef struct
+{
+    uint64_t frames_sent;        /* frames accepted by the stack */
+    uint64_t bytes_sent;         /* payload bytes accepted by the stack */
+    uint64_t bytes_packed;       /* bytes packed into a frame buffer */
+    uint64_t bytes_direct;       /* bytes handed to the stack from caller buffers */
+    uint64_t segments_completed; /* segments released to their owner */
+    uint64_t segments_dropped;   /* segments released on disconnect */
+    uint32_t credit_stalls;      /* times the stack had no credits */
+} spp_tx_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_tx_init(void);
+
+void spp_tx_register_transport(spp_transport_t transport, uint16_t handle_flag,
+                               uint32_t max_frame_size, const spp_tx_transport_ops_t *p_ops);
+
+spp_transport_t spp_tx_get_transport(uint16_t handle);
+
+const char *spp_tx_get_transport_name(spp_transport_t transport);
+
+void spp_tx_connection_up(uint16_t handle);
+
+void spp_tx_connection_down(uint16_t handle);
+
+wiced_bool_t spp_tx_enqueue(uint16_t handle, const spp_iovec_t *p_iov, int iov_count);
+
+wiced_bool_t spp_tx_enqueue_frame(uint16_t handle, const spp_iovec_t *p_iov);
+
+void spp_tx_kick(uint16_t handle);
+
+void spp_tx_set_frame_size(uint16_t handle, uint32_t frame_size);
+
+uint32_t spp_tx_get_frame_size(uint16_t handle);
+
+void spp_tx_note_rx(uint16_t handle, uint32_t len);
+
+void spp_tx_note_rtt(uint16_t handle, uint32_t rtt_us);
+
+uint32_t spp_tx_queued_bytes(uint16_t handle);
+
+wiced_bool_t spp_tx_get_session_bytes(uint16_t handle, uint64_t *p_tx_bytes, uint64_t *p_rx_bytes);
+
+int spp_tx_get_handles(uint16_t *p_handles, int max_handles);
+
+wiced_bool_t spp_tx_disconnect(uint16_t handle);
+
+void spp_tx_get_stats(spp_tx_stats_t *p_stats);
+
+void spp_tx_get_transport_stats(spp_transport_t transport, spp_tx_transport_stats_t *p_stats);
+
+void spp_tx_print_stats(void);
+
+#endif /* __APP_SPP_TX_H__ */
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_uring.h
+ *
+ * Description: This is the include file for the io_uring backed file
+ *              receiver used by the "uring:" rx sink.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_URING_H__
+#define __APP_SPP_URING_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Received data is gathered into registered buffers of this size */
+#define SPP_URING_BUF_SIZE                      ( 64 * 1024 )
+/* Buffers per file, i.e. how much data a disk stall can absorb */
+#define SPP_URING_BUF_COUNT                     ( 32 )
+/* Full buffers queued before the receive path enters the kernel */
+#define SPP_URING_BATCH                         ( 4 )
+/* Longest time data waits in a partly filled buffer or an unsubmitted batch */
+#define SPP_URING_FLUSH_MS                      ( 100 )
+#define SPP_URING_DEFAULT_FSYNC_MS              ( 1000 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+typedef struct spp_uring spp_uring_t;
+
+typedef struct
+{
+    uint32_t files;         /* files opened */
+    uint32_t depth;         /* writes in flight now */
+    uint32_t max_depth;     /* most writes in flight at once */
+    uint64_t bytes_queued;  /* bytes accepted from the receive path */
+    uint64_t bytes_written; /* bytes the kernel reported written */
+    uint64_t overrun_bytes; /* bytes dropped because every buffer was busy */
+    uint64_t error_bytes;   /* bytes of failed or short writes */
+    uint64_t writes;        /* write requests completed */
+    uint64_t enters;        /* io_uring_enter() calls that submitted requests */
+    uint64_t sqes;          /* requests submitted */
+    uint64_t fsyncs;        /* fsync requests completed */
+    uint64_t fsync_max_us;  /* slowest fsync */
+    uint64_t write_us;      /* time from first submit to latest completion */
+} spp_uring_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_uring_configure_fsync(uint32_t fsync_ms);
+
+spp_uring_t *spp_uring_open(const char *p_path);
+
+uint32_t spp_uring_write(spp_uring_t *p_uring, const uint8_t *p_data, uint32_t len);
+
+void spp_uring_close(spp_uring_t *p_uring);
+
+void spp_uring_get_stats(spp_uring_stats_t *p_stats);
+
+void spp_uring_print_stats(void);
+
+#endif /* __APP_SPP_URING_H__ */
@@ -0,0 +1,115 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_xfer.h
+ *
+ * Description: This is the include file for the resumable bulk transfer
+ *              layer used on top of the SPP session.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+#ifndef __APP_SPP_XFER_H__
+#define __APP_SPP_XFER_H__
+
+/******************************************************************************
+ *          INCLUDES
+ *****************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Transfer frame header: magic(2) type(1) transfer id(4) offset(4) length(2) */
+#define SPP_XFER_HDR_LEN                        ( 13 )
+#define SPP_XFER_MAGIC_0                        ( 0xA5 )
+#define SPP_XFER_MAGIC_1                        ( 0x5C )
+
+/* Receiver confirms progress every SPP_XFER_ACK_INTERVAL bytes */
+#define SPP_XFER_ACK_INTERVAL                   ( 8 * 1024 )
+/* Sender never runs more than SPP_XFER_WINDOW bytes ahead of the last ACK */
+#define SPP_XFER_WINDOW                         ( 4 * SPP_XFER_ACK_INTERVAL )
+/* Number of peers for which receive progress is remembered */
+#define SPP_XFER_MAX_PEERS                      ( 4 )
+/* A transfer waiting this long on its peer is abandoned, in seconds */
+#define SPP_XFER_ABANDON_TIMEOUT                ( 120 )
+
+/******************************************************************************
+ *          STRUCTURES AND ENUMERATIONS
+ *****************************************************************************/
+/* Fills p_buf with len bytes of transfer content starting at offset */
+typedef wiced_bool_t (*spp_xfer_fill_cback_t)(uint32_t offset, uint8_t *p_buf, uint32_t len);
+
+/* Receives in-order, deduplicated transfer content */
+typedef void (*spp_xfer_rx_cback_t)(uint16_t handle, uint32_t xfer_id, uint32_t offset,
+                                    uint8_t *p_data, uint32_t len, uint32_t total_len);
+
+typedef struct
+{
+    uint32_t xfers_started;       /* transfers started by this side */
+    uint32_t xfers_completed;     /* transfers acknowledged to the last byte */
+    uint32_t xfers_resumed;       /* transfers resumed after reconnect/stall */
+    uint32_t xfers_cancelled;     /* transfers cancelled with spp_xfer_cancel() */
+    uint32_t xfers_abandoned;     /* transfers given up on a silent peer */
+    uint64_t bytes_sent;          /* payload bytes handed to the stack */
+    uint64_t bytes_resume_saved;  /* bytes not resent thanks to checkpoints */
+    uint64_t bytes_resent;        /* bytes sent again past the checkpoint */
+    uint64_t bytes_received;      /* new payload bytes delivered */
+    uint64_t bytes_duplicate;     /* overlapping payload bytes dropped */
+} spp_xfer_stats_t;
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+void spp_xfer_init(spp_xfer_rx_cback_t p_rx_cback);
+
+wiced_bool_t spp_xfer_start(uint16_t handle, uint32_t total_len, spp_xfer_fill_cback_t p_fill);
+
+wiced_bool_t spp_xfer_is_idle(void);
+
+void spp_xfer_resume(void);
+
+wiced_bool_t spp_xfer_cancel(void);
+
+void spp_xfer_connection_up(uint16_t handle, uint8_t *bda);
+
+void spp_xfer_connection_down(uint16_t handle);
+
+wiced_bool_t spp_xfer_rx_data(uint16_t handle, uint8_t *p_data, uint32_t data_len);
+
+void spp_xfer_get_stats(spp_xfer_stats_t *p_stats);
+
+void spp_xfer_print_stats(void);
+
+#endif /* __APP_SPP_XFER_H__ */
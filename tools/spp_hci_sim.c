@@ -0,0 +1,1770 @@
+/******************************************************************************
+ * (c) 2020, Cypress Semiconductor Corporation. All rights reserved.
+ *******************************************************************************
+ * This software, including source code, documentation and related materials
+ * ("Software"), is owned by Cypress Semiconductor Corporation or one of its
+ * subsidiaries ("Cypress") and is protected by and subject to worldwide patent
+ * protection (United States and foreign), United States copyright laws and
+ * international treaty provisions. Therefore, you may use this Software only
+ * as provided in the license agreement accompanying the software package from
+ * which you obtained this Software ("EULA").
+ *
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software source
+ * code solely for use in connection with Cypress's integrated circuit products.
+ * Any reproduction, modification, translation, compilation, or representation
+ * of this Software except as specified above is prohibited without the express
+ * written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer of such
+ * system or application assumes all risk of such use and in doing so agrees to
+ * indemnify Cypress against all liability.
+ *****************************************************************************/
+/******************************************************************************
+ * File Name: spp_hci_sim.c
+ *
+ * Description: Simulated HCI controller for end-to-end runs of the SPP
+ *              application without a CYW5557x.
+ *
+ *              The simulator opens a pseudo-terminal and speaks H4 on it.
+ *              The application is started with -c pointing at the PTY and
+ *              runs unmodified, including the porting layer UART code and
+ *              the patch download.
+ *              - HCI commands issued at init and during patch download are
+ *                answered with canned Command Complete / Command Status
+ *                events
+ *              - once the application enables page scan, a scripted SPP
+ *                peer pages it: ACL link, Just Works pairing, L2CAP channel
+ *                on the RFCOMM PSM, RFCOMM multiplexer and DLC to the SPP
+ *                server channel, then credit based data at a given rate
+ *              Data sent by the application is counted, and reflected back
+ *              with -e. Every second the payload rate in each direction and
+ *              the bytes on the wire, including H4, HCI ACL, L2CAP and
+ *              RFCOMM framing, are printed.
+ *
+ * Usage: spp_hci_sim [-l <link>] [-a <peer_bd_addr>] [-s <scn>]
+ *                    [-r <bytes/s>] [-f <frame_size>] [-n <bytes>]
+ *                    [-t <seconds>] [-d <ms>] [-e] [-v]
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+ *                           INCLUDES
+ *******************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ *                               MACROS
+ *******************************************************************************/
+/* H4 packet types */
+#define SIM_H4_CMD                  ( 0x01 )
+#define SIM_H4_ACL                  ( 0x02 )
+#define SIM_H4_SCO                  ( 0x03 )
+#define SIM_H4_EVT                  ( 0x04 )
+
+/* HCI events */
+#define SIM_EVT_INQUIRY_COMPLETE        ( 0x01 )
+#define SIM_EVT_CONN_COMPLETE           ( 0x03 )
+#define SIM_EVT_CONN_REQUEST            ( 0x04 )
+#define SIM_EVT_DISCONN_COMPLETE        ( 0x05 )
+#define SIM_EVT_AUTH_COMPLETE           ( 0x06 )
+#define SIM_EVT_REMOTE_NAME             ( 0x07 )
+#define SIM_EVT_ENCRYPTION_CHANGE       ( 0x08 )
+#define SIM_EVT_REMOTE_FEATURES         ( 0x0B )
+#define SIM_EVT_REMOTE_VERSION          ( 0x0C )
+#define SIM_EVT_CMD_COMPLETE            ( 0x0E )
+#define SIM_EVT_CMD_STATUS              ( 0x0F )
+#define SIM_EVT_ROLE_CHANGE             ( 0x12 )
+#define SIM_EVT_NUM_COMPLETED_PACKETS   ( 0x13 )
+#define SIM_EVT_MODE_CHANGE             ( 0x14 )
+#define SIM_EVT_LINK_KEY_REQUEST        ( 0x17 )
+#define SIM_EVT_LINK_KEY_NOTIFICATION   ( 0x18 )
+#define SIM_EVT_PACKET_TYPE_CHANGED     ( 0x1D )
+#define SIM_EVT_REMOTE_EXT_FEATURES     ( 0x23 )
+#define SIM_EVT_IO_CAP_REQUEST          ( 0x31 )
+#define SIM_EVT_IO_CAP_RESPONSE         ( 0x32 )
+#define SIM_EVT_USER_CONFIRM_REQUEST    ( 0x33 )
+#define SIM_EVT_SIMPLE_PAIRING_COMPLETE ( 0x36 )
+
+/* HCI commands which need more than a bare status */
+#define SIM_OP_INQUIRY                  ( 0x0401 )
+#define SIM_OP_CREATE_CONN              ( 0x0405 )
+#define SIM_OP_DISCONNECT               ( 0x0406 )
+#define SIM_OP_ACCEPT_CONN              ( 0x0409 )
+#define SIM_OP_REJECT_CONN              ( 0x040A )
+#define SIM_OP_LINK_KEY_REPLY           ( 0x040B )
+#define SIM_OP_LINK_KEY_NEG_REPLY       ( 0x040C )
+#define SIM_OP_CHANGE_PACKET_TYPE       ( 0x040F )
+#define SIM_OP_AUTH_REQUESTED           ( 0x0411 )
+#define SIM_OP_SET_ENCRYPTION           ( 0x0413 )
+#define SIM_OP_REMOTE_NAME              ( 0x0419 )
+#define SIM_OP_REMOTE_FEATURES          ( 0x041B )
+#define SIM_OP_REMOTE_EXT_FEATURES      ( 0x041C )
+#define SIM_OP_REMOTE_VERSION           ( 0x041D )
+#define SIM_OP_IO_CAP_REPLY             ( 0x042B )
+#define SIM_OP_USER_CONFIRM_REPLY       ( 0x042C )
+#define SIM_OP_USER_CONFIRM_NEG_REPLY   ( 0x042D )
+#define SIM_OP_SNIFF_MODE               ( 0x0803 )
+#define SIM_OP_EXIT_SNIFF_MODE          ( 0x0804 )
+#define SIM_OP_SWITCH_ROLE              ( 0x080B )
+#define SIM_OP_WRITE_LINK_POLICY        ( 0x080D )
+#define SIM_OP_RESET                    ( 0x0C03 )
+#define SIM_OP_WRITE_SCAN_ENABLE        ( 0x0C1A )
+#define SIM_OP_HOST_BUFFER_SIZE         ( 0x0C33 )
+#define SIM_OP_READ_LOCAL_VERSION       ( 0x1001 )
+#define SIM_OP_READ_LOCAL_COMMANDS      ( 0x1002 )
+#define SIM_OP_READ_LOCAL_FEATURES      ( 0x1003 )
+#define SIM_OP_READ_LOCAL_EXT_FEATURES  ( 0x1004 )
+#define SIM_OP_READ_BUFFER_SIZE         ( 0x1005 )
+#define SIM_OP_READ_BD_ADDR             ( 0x1009 )
+#define SIM_OP_READ_ENC_KEY_SIZE        ( 0x1408 )
+#define SIM_OP_WRITE_RAM                ( 0xFC4C )
+#define SIM_OP_LAUNCH_RAM               ( 0xFC4E )
+#define SIM_OP_READ_BUILD               ( 0xFC79 )
+#define SIM_OP_LE_READ_BUFFER_SIZE      ( 0x2002 )
+#define SIM_OP_LE_READ_FEATURES         ( 0x2003 )
+#define SIM_OP_LE_READ_ADV_TX_POWER     ( 0x2007 )
+#define SIM_OP_LE_READ_WHITE_LIST_SIZE  ( 0x200F )
+#define SIM_OP_LE_READ_SUPPORTED_STATES ( 0x201C )
+#define SIM_OP_LE_READ_DEFAULT_DATA_LEN ( 0x2023 )
+#define SIM_OP_LE_READ_RESOLV_LIST_SIZE ( 0x202A )
+#define SIM_OP_LE_READ_MAX_DATA_LEN     ( 0x202F )
+#define SIM_OP_LE_READ_MAX_ADV_DATA_LEN ( 0x203A )
+#define SIM_OP_LE_READ_NUM_ADV_SETS     ( 0x203B )
+
+/* Controller properties reported to the stack */
+#define SIM_ACL_BUFFER_SIZE         ( 1021 )
+#define SIM_ACL_BUFFER_COUNT        ( 8 )
+#define SIM_LE_BUFFER_SIZE          ( 251 )
+#define SIM_LE_BUFFER_COUNT         ( 8 )
+#define SIM_CONN_HANDLE             ( 0x0040 )
+
+/* L2CAP */
+#define SIM_L2CAP_SIGNAL_CID        ( 0x0001 )
+#define SIM_L2CAP_LOCAL_CID         ( 0x0040 )
+#define SIM_L2CAP_MTU               ( 1021 )
+#define SIM_PSM_RFCOMM              ( 0x0003 )
+
+/* RFCOMM frame types, P/F bit included where it is always set */
+#define SIM_RFCOMM_SABM             ( 0x3F )
+#define SIM_RFCOMM_UA               ( 0x73 )
+#define SIM_RFCOMM_DM               ( 0x1F )
+#define SIM_RFCOMM_DISC             ( 0x53 )
+#define SIM_RFCOMM_UIH              ( 0xEF )
+#define SIM_RFCOMM_PF               ( 0x10 )
+#define SIM_RFCOMM_MUX_PN           ( 0x20 )
+#define SIM_RFCOMM_MUX_MSC          ( 0x38 )
+#define SIM_RFCOMM_MUX_RPN          ( 0x24 )
+#define SIM_RFCOMM_MUX_RLS          ( 0x14 )
+#define SIM_RFCOMM_MUX_NSC          ( 0x04 )
+#define SIM_RFCOMM_CREDITS          ( 7 )
+#define SIM_RFCOMM_DEFAULT_FRAME    ( 1011 )
+
+/* Largest H4 packet: ACL header and a full 16 bit payload */
+#define SIM_MAX_PACKET              ( 5 + 65535 )
+/* Stop generating peer data while this much is waiting for the PTY */
+#define SIM_OUT_HIGH_WATER          ( 16384 )
+#define SIM_DEFAULT_CONNECT_DELAY   ( 500 )
+
+/*******************************************************************************
+ *                               STRUCTURES AND ENUMERATIONS
+ *******************************************************************************/
+typedef enum
+{
+    SIM_LINK_IDLE,           /* waiting for page scan */
+    SIM_LINK_PAGING,         /* connection request sent */
+    SIM_LINK_ACL,            /* ACL up, L2CAP connect sent */
+    SIM_LINK_L2CAP_CONFIG,   /* L2CAP channel configuring */
+    SIM_LINK_MUX,            /* SABM on DLCI 0 sent */
+    SIM_LINK_PN,             /* parameter negotiation sent */
+    SIM_LINK_DLC,            /* SABM on the SPP DLCI sent */
+    SIM_LINK_OPEN,           /* DLC open, data flows */
+    SIM_LINK_DONE,           /* script finished */
+} sim_link_state_t;
+
+typedef struct
+{
+    const char *link_path;   /* symlink created to the PTY slave */
+    uint8_t peer_bda[6];     /* in HCI (little endian) order */
+    uint8_t scn;
+    uint32_t rate;           /* peer payload bytes/s, 0 as fast as credits allow */
+    uint16_t frame_size;     /* RFCOMM N1 asked for */
+    uint64_t total_bytes;    /* stop after this much peer data, 0 never */
+    uint32_t duration_s;     /* stop after this long, 0 never */
+    uint32_t connect_delay_ms;
+    int echo;
+    int verbose;
+} sim_config_t;
+
+typedef struct
+{
+    uint64_t wire_in;        /* H4 bytes written by the application */
+    uint64_t wire_out;       /* H4 bytes read by the application */
+    uint64_t payload_in;     /* SPP payload sent by the application */
+    uint64_t payload_out;    /* SPP payload sent by the peer */
+    uint32_t commands;
+    uint32_t events;
+    uint32_t acl_in;
+    uint32_t acl_out;
+    uint32_t unknown_bytes;  /* H4 resynchronisation */
+    uint32_t credit_stalls;
+    uint32_t echo_dropped;   /* reflected frames dropped for lack of credits */
+} sim_counters_t;
+
+typedef struct
+{
+    int master_fd;
+    int slave_fd;
+    sim_link_state_t state;
+    uint8_t scan_enable;
+    uint64_t page_at_us;     /* when the peer pages, 0 if not scheduled */
+    uint16_t host_acl_size;  /* largest ACL packet the host accepts */
+    uint16_t remote_cid;
+    uint16_t remote_mtu;
+    int local_config_done;
+    int remote_config_done;
+    uint8_t signal_id;
+    uint8_t dlci;
+    uint16_t frame_size;     /* negotiated N1 */
+    int tx_credits;          /* frames the peer may still send */
+    int rx_credits;          /* frames the host may still send */
+    int msc_sent;
+    uint64_t next_send_us;
+    uint64_t open_us;
+    uint8_t tx_pattern;
+    uint8_t in[SIM_MAX_PACKET];
+    uint32_t in_len;
+    uint8_t *p_out;
+    uint32_t out_len;
+    uint32_t out_size;
+    uint8_t acl_rx[65536 + 4];
+    uint32_t acl_rx_len;
+    uint32_t acl_rx_expected;
+    uint32_t completed_packets;
+    uint32_t ram_hash;       /* of the patch being written */
+    uint32_t patch_build;    /* of the running patch, 0 for the ROM */
+    sim_counters_t counters;
+    sim_counters_t last;
+    uint64_t last_us;
+} sim_state_t;
+
+/******************************************************************************
+ *                               GLOBAL VARIABLES
+ ******************************************************************************/
+static sim_config_t sim_config =
+{
+    .peer_bda = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 },
+    .scn = 2,
+    .frame_size = SIM_RFCOMM_DEFAULT_FRAME,
+    .connect_delay_ms = SIM_DEFAULT_CONNECT_DELAY,
+};
+static sim_state_t sim;
+static volatile sig_atomic_t sim_stop = 0;
+static uint8_t sim_crc8_table[256];
+
+static const char sim_usage[] = "\n\
+Usage: spp_hci_sim [options]\n\
+    -l <link>        create a symlink to the PTY, e.g. /tmp/ttySIM\n\
+    -a <bd_addr>     address of the simulated peer, xx:xx:xx:xx:xx:xx\n\
+    -s <scn>         RFCOMM server channel of the application, default 2\n\
+    -r <bytes/s>     peer data rate, 0 (default) as fast as credits allow\n\
+    -f <bytes>       RFCOMM frame size to negotiate, default 1011\n\
+    -n <bytes>       stop the peer data after this many bytes\n\
+    -t <seconds>     stop the peer data after this many seconds\n\
+    -d <ms>          delay from page scan enable to the peer connecting\n\
+    -e               reflect data sent by the application back to it\n\
+    -v               trace HCI commands and events\n";
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+static void sim_handle_rfcomm(uint8_t *p, uint32_t len);
+
+/******************************************************************************
+ *                               FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+static uint64_t sim_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sim_put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t sim_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/*******************************************************************************
+ * Function Name: sim_write
+ *******************************************************************************
+ * Summary:
+ *   Queues bytes for the PTY. The queue is drained by the main loop, so a
+ *   slow reader never blocks the simulator.
+ *
+ * Parameters:
+ *   const uint8_t *p_data : bytes
+ *   uint32_t len : number of bytes
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_write(const uint8_t *p_data, uint32_t len)
+{
+    if (sim.out_len + len > sim.out_size)
+    {
+        sim.out_size = (sim.out_len + len) * 2;
+        sim.p_out = realloc(sim.p_out, sim.out_size);
+        if (NULL == sim.p_out)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(sim.p_out + sim.out_len, p_data, len);
+    sim.out_len += len;
+    sim.counters.wire_out += len;
+}
+
+static void sim_flush(void)
+{
+    ssize_t written;
+
+    while (0 != sim.out_len)
+    {
+        written = write(sim.master_fd, sim.p_out, sim.out_len);
+        if (written <= 0)
+        {
+            return;
+        }
+        memmove(sim.p_out, sim.p_out + written, sim.out_len - written);
+        sim.out_len -= (uint32_t)written;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_send_event
+ *******************************************************************************
+ * Summary:
+ *   Sends an HCI event
+ *
+ * Parameters:
+ *   uint8_t code : event code
+ *   const uint8_t *p_params : parameters
+ *   uint8_t len : parameter length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_send_event(uint8_t code, const uint8_t *p_params, uint8_t len)
+{
+    uint8_t header[3] = { SIM_H4_EVT, code, len };
+
+    if (sim_config.verbose)
+    {
+        fprintf(stdout, "sim: < event 0x%02x len %u\n", code, len);
+    }
+    sim_write(header, sizeof(header));
+    sim_write(p_params, len);
+    sim.counters.events++;
+}
+
+static void sim_command_complete(uint16_t opcode, const uint8_t *p_params, uint8_t len)
+{
+    uint8_t event[3 + 255];
+
+    event[0] = 1; /* commands the host may send */
+    sim_put16(&event[1], opcode);
+    memcpy(&event[3], p_params, len);
+    sim_send_event(SIM_EVT_CMD_COMPLETE, event, (uint8_t)(3 + len));
+}
+
+static void sim_command_status(uint16_t opcode, uint8_t status)
+{
+    uint8_t event[4] = { status, 1 };
+
+    sim_put16(&event[2], opcode);
+    sim_send_event(SIM_EVT_CMD_STATUS, event, sizeof(event));
+}
+
+/* Command Complete carrying the status and the peer address */
+static void sim_complete_bda(uint16_t opcode)
+{
+    uint8_t params[7] = { 0 };
+
+    memcpy(&params[1], sim_config.peer_bda, 6);
+    sim_command_complete(opcode, params, sizeof(params));
+}
+
+static void sim_send_bda_event(uint8_t code)
+{
+    sim_send_event(code, sim_config.peer_bda, 6);
+}
+
+static void sim_send_handle_event(uint8_t code, const uint8_t *p_tail, uint8_t tail_len)
+{
+    uint8_t params[3 + 16] = { 0 };
+
+    sim_put16(&params[1], SIM_CONN_HANDLE);
+    memcpy(&params[3], p_tail, tail_len);
+    sim_send_event(code, params, (uint8_t)(3 + tail_len));
+}
+
+/*******************************************************************************
+ * Function Name: sim_send_acl
+ *******************************************************************************
+ * Summary:
+ *   Sends one L2CAP PDU to the host, cut into ACL packets no larger than the
+ *   host buffer size
+ *
+ * Parameters:
+ *   uint16_t cid : destination channel
+ *   const uint8_t *p_header : start of the payload, may be NULL
+ *   uint32_t header_len : length of p_header
+ *   const uint8_t *p_data : rest of the payload, may be NULL
+ *   uint32_t data_len : length of p_data
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_send_acl(uint16_t cid, const uint8_t *p_header, uint32_t header_len,
+                         const uint8_t *p_data, uint32_t data_len)
+{
+    static uint8_t pdu[4 + 65536];
+    uint8_t acl_header[5];
+    uint32_t pdu_len = 4 + header_len + data_len;
+    uint32_t offset = 0;
+    uint32_t chunk;
+
+    sim_put16(&pdu[0], (uint16_t)(header_len + data_len));
+    sim_put16(&pdu[2], cid);
+    if (0 != header_len)
+    {
+        memcpy(&pdu[4], p_header, header_len);
+    }
+    if (0 != data_len)
+    {
+        memcpy(&pdu[4 + header_len], p_data, data_len);
+    }
+
+    while (offset < pdu_len)
+    {
+        chunk = pdu_len - offset;
+        if (chunk > sim.host_acl_size)
+        {
+            chunk = sim.host_acl_size;
+        }
+        acl_header[0] = SIM_H4_ACL;
+        /* Packet boundary: 0x2 first automatically flushable, 0x1 continuation */
+        sim_put16(&acl_header[1], SIM_CONN_HANDLE | ((0 == offset) ? 0x2000 : 0x1000));
+        sim_put16(&acl_header[3], (uint16_t)chunk);
+        sim_write(acl_header, sizeof(acl_header));
+        sim_write(&pdu[offset], chunk);
+        sim.counters.acl_out++;
+        offset += chunk;
+    }
+}
+
+static void sim_send_signal(uint8_t code, uint8_t id, const uint8_t *p_data, uint16_t len)
+{
+    uint8_t header[4] = { code, id };
+
+    sim_put16(&header[2], len);
+    sim_send_acl(SIM_L2CAP_SIGNAL_CID, header, sizeof(header), p_data, len);
+}
+
+/*******************************************************************************
+ * Function Name: sim_rfcomm_fcs
+ *******************************************************************************
+ * Summary:
+ *   Computes the TS 07.10 frame check sequence
+ *
+ * Parameters:
+ *   const uint8_t *p : address field onwards
+ *   uint32_t len : 2 for UIH frames, 3 for the other frames
+ *
+ * Return:
+ *   uint8_t : FCS
+ *
+ ******************************************************************************/
+static uint8_t sim_rfcomm_fcs(const uint8_t *p, uint32_t len)
+{
+    uint8_t fcs = 0xFF;
+
+    while (0 != len--)
+    {
+        fcs = sim_crc8_table[fcs ^ *p++];
+    }
+    return (uint8_t)(0xFF - fcs);
+}
+
+static void sim_rfcomm_init_fcs(void)
+{
+    uint32_t i;
+    uint32_t bit;
+    uint8_t crc;
+
+    /* Reversed x^8 + x^2 + x + 1 */
+    for (i = 0; i < 256; i++)
+    {
+        crc = (uint8_t)i;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0xE0) : (uint8_t)(crc >> 1);
+        }
+        sim_crc8_table[i] = crc;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_send_rfcomm
+ *******************************************************************************
+ * Summary:
+ *   Sends an RFCOMM frame as the multiplexer initiator
+ *
+ * Parameters:
+ *   uint8_t dlci : data link
+ *   uint8_t control : frame type, P/F bit included
+ *   int command : 1 for a command, 0 for a response
+ *   int credits : credits given with a UIH frame, -1 for none
+ *   const uint8_t *p_data : information field
+ *   uint32_t len : information length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_send_rfcomm(uint8_t dlci, uint8_t control, int command, int credits,
+                            const uint8_t *p_data, uint32_t len)
+{
+    uint8_t header[6];
+    uint32_t header_len = 0;
+    uint8_t fcs;
+    int uih = ((control & ~SIM_RFCOMM_PF) == (SIM_RFCOMM_UIH & ~SIM_RFCOMM_PF));
+
+    /* Initiator: C/R set on commands and clear on responses */
+    header[header_len++] = (uint8_t)((dlci << 2) | (command ? 0x02 : 0x00) | 0x01);
+    if (uih && (credits >= 0))
+    {
+        control |= SIM_RFCOMM_PF;
+    }
+    else if (uih)
+    {
+        control &= (uint8_t)~SIM_RFCOMM_PF;
+    }
+    header[header_len++] = control;
+    if (len < 128)
+    {
+        header[header_len++] = (uint8_t)((len << 1) | 1);
+    }
+    else
+    {
+        header[header_len++] = (uint8_t)(len << 1);
+        header[header_len++] = (uint8_t)(len >> 7);
+    }
+    fcs = sim_rfcomm_fcs(header, uih ? 2 : 3);
+    if (uih && (credits >= 0))
+    {
+        header[header_len++] = (uint8_t)credits;
+    }
+
+    {
+        static uint8_t frame[6 + 65536];
+
+        memcpy(frame, header, header_len);
+        if (0 != len)
+        {
+            memcpy(&frame[header_len], p_data, len);
+        }
+        frame[header_len + len] = fcs;
+        sim_send_acl(sim.remote_cid, NULL, 0, frame, header_len + len + 1);
+    }
+}
+
+static void sim_send_mux(uint8_t type, int command, const uint8_t *p_values, uint8_t len)
+{
+    uint8_t msg[2 + 16];
+
+    msg[0] = (uint8_t)((type << 2) | (command ? 0x02 : 0x00) | 0x01);
+    msg[1] = (uint8_t)((len << 1) | 1);
+    memcpy(&msg[2], p_values, len);
+    sim_send_rfcomm(0, SIM_RFCOMM_UIH, 1, -1, msg, (uint32_t)(2 + len));
+}
+
+/*******************************************************************************
+ * Function Name: sim_reset_link
+ *******************************************************************************
+ * Summary:
+ *   Forgets the simulated connection, after an HCI_Reset or a disconnect
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_reset_link(void)
+{
+    sim.state = SIM_LINK_IDLE;
+    sim.page_at_us = 0;
+    sim.local_config_done = 0;
+    sim.remote_config_done = 0;
+    sim.tx_credits = 0;
+    sim.rx_credits = 0;
+    sim.msc_sent = 0;
+    sim.acl_rx_len = 0;
+    sim.acl_rx_expected = 0;
+    sim.remote_mtu = 672;
+}
+
+/*******************************************************************************
+ * Function Name: sim_handle_command
+ *******************************************************************************
+ * Summary:
+ *   Answers an HCI command. Commands which start a procedure on the link are
+ *   answered with Command Status and then the event of the procedure. Every
+ *   other command completes with a success status and, for the ones the
+ *   stack reads at init, the controller properties.
+ *
+ * Parameters:
+ *   uint16_t opcode : command opcode
+ *   const uint8_t *p : parameters
+ *   uint8_t len : parameter length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_handle_command(uint16_t opcode, const uint8_t *p, uint8_t len)
+{
+    uint8_t params[80];
+    uint8_t tail[16];
+    uint32_t i;
+
+    sim.counters.commands++;
+    if (sim_config.verbose)
+    {
+        fprintf(stdout, "sim: > command 0x%04x len %u\n", opcode, len);
+    }
+    memset(params, 0, sizeof(params));
+
+    switch (opcode)
+    {
+    case SIM_OP_RESET:
+        sim_reset_link();
+        sim.scan_enable = 0;
+        sim_command_complete(opcode, params, 1);
+        break;
+
+    case SIM_OP_WRITE_RAM:
+        /* The build of the launched patch is derived from its content */
+        for (i = 0; i < len; i++)
+        {
+            sim.ram_hash = (sim.ram_hash ^ p[i]) * 0x01000193u;
+        }
+        sim_command_complete(opcode, params, 1);
+        break;
+
+    case SIM_OP_LAUNCH_RAM:
+        sim.patch_build = sim.ram_hash | 1;
+        sim.ram_hash = 0x811C9DC5u;
+        sim_command_complete(opcode, params, 1);
+        break;
+
+    case SIM_OP_READ_BUILD:
+        /* chip, target, build base and build number, which an HCI_Reset
+         * keeps, as the patch stays in RAM
+         */
+        params[1] = 0x55;
+        params[2] = 0x57;
+        sim_put16(&params[3], (uint16_t)(sim.patch_build >> 16));
+        sim_put16(&params[5], (uint16_t)sim.patch_build);
+        sim_command_complete(opcode, params, 7);
+        break;
+
+    case SIM_OP_WRITE_SCAN_ENABLE:
+        sim.scan_enable = (len >= 1) ? p[0] : 0;
+        sim_command_complete(opcode, params, 1);
+        if ((sim.scan_enable & 0x02) && (SIM_LINK_IDLE == sim.state) && (0 == sim.page_at_us))
+        {
+            sim.page_at_us = sim_now_us() + (uint64_t)sim_config.connect_delay_ms * 1000;
+        }
+        break;
+
+    case SIM_OP_HOST_BUFFER_SIZE:
+        if ((len >= 2) && (sim_get16(p) >= 27))
+        {
+            sim.host_acl_size = sim_get16(p);
+        }
+        sim_command_complete(opcode, params, 1);
+        break;
+
+    case SIM_OP_READ_LOCAL_VERSION:
+        params[1] = 0x0B;                  /* HCI 5.2 */
+        sim_put16(&params[2], 0x0100);
+        params[4] = 0x0B;                  /* LMP 5.2 */
+        sim_put16(&params[5], 0x0009);     /* Infineon */
+        sim_put16(&params[7], 0x2209);
+        sim_command_complete(opcode, params, 9);
+        break;
+
+    case SIM_OP_READ_LOCAL_COMMANDS:
+        memset(&params[1], 0xFF, 64);
+        sim_command_complete(opcode, params, 65);
+        break;
+
+    case SIM_OP_READ_LOCAL_FEATURES:
+        /* 3 and 5 slot packets, encryption, sniff, EDR, SSP, LE */
+        memcpy(&params[1], "\xBF\xFE\xCF\xFE\xDB\xFF\x7B\x87", 8);
+        sim_command_complete(opcode, params, 9);
+        break;
+
+    case SIM_OP_READ_LOCAL_EXT_FEATURES:
+        params[1] = (len >= 1) ? p[0] : 0;
+        params[2] = 1;
+        if (0 == params[1])
+        {
+            memcpy(&params[3], "\xBF\xFE\xCF\xFE\xDB\xFF\x7B\x87", 8);
+        }
+        sim_command_complete(opcode, params, 11);
+        break;
+
+    case SIM_OP_READ_BUFFER_SIZE:
+        sim_put16(&params[1], SIM_ACL_BUFFER_SIZE);
+        params[3] = 64;
+        sim_put16(&params[4], SIM_ACL_BUFFER_COUNT);
+        sim_put16(&params[6], 0);
+        sim_command_complete(opcode, params, 8);
+        break;
+
+    case SIM_OP_READ_BD_ADDR:
+        /* The porting layer writes the address given with -d, this is the
+         * address before that
+         */
+        memcpy(&params[1], "\x01\x00\x00\xA0\x50\x00", 6);
+        sim_command_complete(opcode, params, 7);
+        break;
+
+    case SIM_OP_READ_ENC_KEY_SIZE:
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        params[3] = 16;
+        sim_command_complete(opcode, params, 4);
+        break;
+
+    case SIM_OP_LE_READ_BUFFER_SIZE:
+        sim_put16(&params[1], SIM_LE_BUFFER_SIZE);
+        params[3] = SIM_LE_BUFFER_COUNT;
+        sim_command_complete(opcode, params, 4);
+        break;
+
+    case SIM_OP_LE_READ_FEATURES:
+        params[1] = 0xFF;
+        params[2] = 0x79;
+        sim_command_complete(opcode, params, 9);
+        break;
+
+    case SIM_OP_LE_READ_SUPPORTED_STATES:
+        memset(&params[1], 0xFF, 8);
+        sim_command_complete(opcode, params, 9);
+        break;
+
+    case SIM_OP_LE_READ_WHITE_LIST_SIZE:
+    case SIM_OP_LE_READ_RESOLV_LIST_SIZE:
+        params[1] = 16;
+        sim_command_complete(opcode, params, 2);
+        break;
+
+    case SIM_OP_LE_READ_ADV_TX_POWER:
+        params[1] = 4;
+        sim_command_complete(opcode, params, 2);
+        break;
+
+    case SIM_OP_LE_READ_NUM_ADV_SETS:
+        params[1] = 4;
+        sim_command_complete(opcode, params, 2);
+        break;
+
+    case SIM_OP_LE_READ_MAX_ADV_DATA_LEN:
+        sim_put16(&params[1], 1650);
+        sim_command_complete(opcode, params, 3);
+        break;
+
+    case SIM_OP_LE_READ_DEFAULT_DATA_LEN:
+        sim_put16(&params[1], 251);
+        sim_put16(&params[3], 2120);
+        sim_command_complete(opcode, params, 5);
+        break;
+
+    case SIM_OP_LE_READ_MAX_DATA_LEN:
+        sim_put16(&params[1], 251);
+        sim_put16(&params[3], 17040);
+        sim_put16(&params[5], 251);
+        sim_put16(&params[7], 17040);
+        sim_command_complete(opcode, params, 9);
+        break;
+
+    case SIM_OP_ACCEPT_CONN:
+        sim_command_status(opcode, 0);
+        /* status, handle, peer address, ACL link, encryption off */
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        memcpy(&params[3], sim_config.peer_bda, 6);
+        params[9] = 1;
+        sim_send_event(SIM_EVT_CONN_COMPLETE, params, 11);
+        sim.state = SIM_LINK_ACL;
+        {
+            /* The peer opens the L2CAP channel to RFCOMM at once */
+            uint8_t req[4];
+
+            sim_put16(&req[0], SIM_PSM_RFCOMM);
+            sim_put16(&req[2], SIM_L2CAP_LOCAL_CID);
+            sim_send_signal(0x02, ++sim.signal_id, req, sizeof(req));
+        }
+        break;
+
+    case SIM_OP_REJECT_CONN:
+        sim_command_status(opcode, 0);
+        params[0] = (len >= 7) ? p[6] : 0x0F;
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        memcpy(&params[3], sim_config.peer_bda, 6);
+        params[9] = 1;
+        sim_send_event(SIM_EVT_CONN_COMPLETE, params, 11);
+        sim_reset_link();
+        sim.state = SIM_LINK_DONE;
+        break;
+
+    case SIM_OP_DISCONNECT:
+        sim_command_status(opcode, 0);
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        params[3] = 0x16; /* connection terminated by local host */
+        sim_send_event(SIM_EVT_DISCONN_COMPLETE, params, 4);
+        sim_reset_link();
+        sim.state = SIM_LINK_DONE;
+        break;
+
+    case SIM_OP_LINK_KEY_REPLY:
+        /* Any stored key is accepted */
+        sim_complete_bda(opcode);
+        sim_send_handle_event(SIM_EVT_AUTH_COMPLETE, NULL, 0);
+        break;
+
+    case SIM_OP_LINK_KEY_NEG_REPLY:
+        sim_complete_bda(opcode);
+        sim_send_bda_event(SIM_EVT_IO_CAP_REQUEST);
+        break;
+
+    case SIM_OP_IO_CAP_REPLY:
+        sim_complete_bda(opcode);
+        /* The peer has no input and no output: Just Works */
+        memcpy(params, sim_config.peer_bda, 6);
+        params[6] = 0x03;
+        params[7] = 0x00;
+        params[8] = 0x00;
+        sim_send_event(SIM_EVT_IO_CAP_RESPONSE, params, 9);
+        memset(&params[6], 0, 4);
+        sim_send_event(SIM_EVT_USER_CONFIRM_REQUEST, params, 10);
+        break;
+
+    case SIM_OP_USER_CONFIRM_REPLY:
+        sim_complete_bda(opcode);
+        memcpy(&params[1], sim_config.peer_bda, 6);
+        sim_send_event(SIM_EVT_SIMPLE_PAIRING_COMPLETE, params, 7);
+        memcpy(params, sim_config.peer_bda, 6);
+        memset(&params[6], 0x5A, 16);
+        params[22] = 0x07; /* unauthenticated P-256 */
+        sim_send_event(SIM_EVT_LINK_KEY_NOTIFICATION, params, 23);
+        sim_send_handle_event(SIM_EVT_AUTH_COMPLETE, NULL, 0);
+        break;
+
+    case SIM_OP_USER_CONFIRM_NEG_REPLY:
+        sim_complete_bda(opcode);
+        params[0] = 0x05; /* authentication failure */
+        memcpy(&params[1], sim_config.peer_bda, 6);
+        sim_send_event(SIM_EVT_SIMPLE_PAIRING_COMPLETE, params, 7);
+        break;
+
+    case SIM_OP_AUTH_REQUESTED:
+        sim_command_status(opcode, 0);
+        sim_send_bda_event(SIM_EVT_LINK_KEY_REQUEST);
+        break;
+
+    case SIM_OP_SET_ENCRYPTION:
+        sim_command_status(opcode, 0);
+        tail[0] = (len >= 3) ? p[2] : 1;
+        sim_send_handle_event(SIM_EVT_ENCRYPTION_CHANGE, tail, 1);
+        break;
+
+    case SIM_OP_REMOTE_NAME:
+    {
+        static uint8_t name_event[255];
+
+        sim_command_status(opcode, 0);
+        memset(name_event, 0, sizeof(name_event));
+        memcpy(&name_event[1], sim_config.peer_bda, 6);
+        strcpy((char *)&name_event[7], "SPP Sim Peer");
+        sim_send_event(SIM_EVT_REMOTE_NAME, name_event, 255);
+        break;
+    }
+
+    case SIM_OP_REMOTE_FEATURES:
+        sim_command_status(opcode, 0);
+        sim_send_handle_event(SIM_EVT_REMOTE_FEATURES, (const uint8_t *)"\xBF\xFE\xCF\xFE\xDB\xFF\x7B\x87", 8);
+        break;
+
+    case SIM_OP_REMOTE_EXT_FEATURES:
+        sim_command_status(opcode, 0);
+        memset(tail, 0, sizeof(tail));
+        tail[0] = (len >= 3) ? p[2] : 0;
+        tail[1] = 1;
+        if (0 == tail[0])
+        {
+            memcpy(&tail[2], "\xBF\xFE\xCF\xFE\xDB\xFF\x7B\x87", 8);
+        }
+        else
+        {
+            tail[2] = 0x01; /* secure simple pairing host support */
+        }
+        sim_send_handle_event(SIM_EVT_REMOTE_EXT_FEATURES, tail, 10);
+        break;
+
+    case SIM_OP_REMOTE_VERSION:
+        sim_command_status(opcode, 0);
+        tail[0] = 0x0B;
+        sim_put16(&tail[1], 0x0009);
+        sim_put16(&tail[3], 0x2209);
+        sim_send_handle_event(SIM_EVT_REMOTE_VERSION, tail, 5);
+        break;
+
+    case SIM_OP_CHANGE_PACKET_TYPE:
+        sim_command_status(opcode, 0);
+        sim_send_handle_event(SIM_EVT_PACKET_TYPE_CHANGED, (len >= 4) ? &p[2] : params, 2);
+        break;
+
+    case SIM_OP_SWITCH_ROLE:
+        sim_command_status(opcode, 0);
+        memcpy(&params[1], sim_config.peer_bda, 6);
+        params[7] = (len >= 7) ? p[6] : 0;
+        sim_send_event(SIM_EVT_ROLE_CHANGE, params, 8);
+        break;
+
+    case SIM_OP_SNIFF_MODE:
+    case SIM_OP_EXIT_SNIFF_MODE:
+        sim_command_status(opcode, 0);
+        tail[0] = (SIM_OP_SNIFF_MODE == opcode) ? 2 : 0;
+        sim_put16(&tail[1], (len >= 4) ? sim_get16(&p[2]) : 0);
+        sim_send_handle_event(SIM_EVT_MODE_CHANGE, tail, 3);
+        break;
+
+    case SIM_OP_WRITE_LINK_POLICY:
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        sim_command_complete(opcode, params, 3);
+        break;
+
+    case SIM_OP_INQUIRY:
+        sim_command_status(opcode, 0);
+        sim_send_event(SIM_EVT_INQUIRY_COMPLETE, params, 1);
+        break;
+
+    case SIM_OP_CREATE_CONN:
+        /* Outgoing connections are not simulated, the page times out */
+        sim_command_status(opcode, 0);
+        params[0] = 0x04;
+        memcpy(&params[3], (len >= 6) ? p : params, 6);
+        params[9] = 1;
+        sim_send_event(SIM_EVT_CONN_COMPLETE, params, 11);
+        break;
+
+    default:
+        /* Init, minidriver download (0xFC2E), baud rate and
+         * configuration commands only need a success status
+         */
+        sim_command_complete(opcode, params, 1);
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_handle_signal
+ *******************************************************************************
+ * Summary:
+ *   Handles the L2CAP signalling channel. The peer opens one channel to the
+ *   RFCOMM PSM and starts the RFCOMM multiplexer once both directions are
+ *   configured.
+ *
+ * Parameters:
+ *   const uint8_t *p : signalling commands
+ *   uint32_t len : length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_handle_signal(const uint8_t *p, uint32_t len)
+{
+    uint8_t rsp[16];
+    uint8_t code;
+    uint8_t id;
+    uint16_t cmd_len;
+    uint32_t i;
+
+    while (len >= 4)
+    {
+        code = p[0];
+        id = p[1];
+        cmd_len = sim_get16(&p[2]);
+        if (cmd_len + 4u > len)
+        {
+            return;
+        }
+        memset(rsp, 0, sizeof(rsp));
+        switch (code)
+        {
+        case 0x03: /* connection response */
+            if ((cmd_len >= 8) && (0 == sim_get16(&p[8])))
+            {
+                sim.remote_cid = sim_get16(&p[4]);
+                sim.state = SIM_LINK_L2CAP_CONFIG;
+                sim_put16(&rsp[0], sim.remote_cid);
+                rsp[4] = 0x01; /* MTU option */
+                rsp[5] = 2;
+                sim_put16(&rsp[6], SIM_L2CAP_MTU);
+                sim_send_signal(0x04, ++sim.signal_id, rsp, 8);
+            }
+            else if ((cmd_len >= 8) && (1 != sim_get16(&p[8])))
+            {
+                fprintf(stdout, "sim: L2CAP connection refused, result %u\n", sim_get16(&p[8]));
+                sim.state = SIM_LINK_DONE;
+            }
+            break;
+
+        case 0x04: /* configuration request */
+            for (i = 8; i + 2 <= cmd_len + 4u; i += 2 + p[i + 1])
+            {
+                if ((0x01 == (p[i] & 0x7F)) && (2 == p[i + 1]))
+                {
+                    sim.remote_mtu = sim_get16(&p[i + 2]);
+                }
+            }
+            sim_put16(&rsp[0], sim.remote_cid);
+            sim_send_signal(0x05, id, rsp, 6);
+            sim.remote_config_done = 1;
+            break;
+
+        case 0x05: /* configuration response */
+            sim.local_config_done = 1;
+            break;
+
+        case 0x06: /* disconnection request */
+            memcpy(rsp, &p[4], 4);
+            sim_send_signal(0x07, id, rsp, 4);
+            sim.state = SIM_LINK_DONE;
+            break;
+
+        case 0x08: /* echo request */
+            sim_send_signal(0x09, id, NULL, 0);
+            break;
+
+        case 0x0A: /* information request */
+            memcpy(rsp, &p[4], 2);
+            if (2 == sim_get16(&p[4]))
+            {
+                /* extended features: none */
+                sim_send_signal(0x0B, id, rsp, 8);
+            }
+            else if (3 == sim_get16(&p[4]))
+            {
+                /* fixed channels: signalling only */
+                rsp[4] = 0x02;
+                sim_send_signal(0x0B, id, rsp, 12);
+            }
+            else
+            {
+                sim_put16(&rsp[2], 1);
+                sim_send_signal(0x0B, id, rsp, 4);
+            }
+            break;
+
+        case 0x01: /* command reject */
+        case 0x07: /* disconnection response */
+        case 0x0B: /* information response */
+            break;
+
+        default:
+            /* command not understood */
+            sim_send_signal(0x01, id, rsp, 2);
+            break;
+        }
+        p += 4 + cmd_len;
+        len -= 4 + cmd_len;
+    }
+
+    if ((SIM_LINK_L2CAP_CONFIG == sim.state) && sim.local_config_done && sim.remote_config_done)
+    {
+        sim.state = SIM_LINK_MUX;
+        sim_send_rfcomm(0, SIM_RFCOMM_SABM, 1, -1, NULL, 0);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_handle_mux
+ *******************************************************************************
+ * Summary:
+ *   Handles a multiplexer control message received on DLCI 0
+ *
+ * Parameters:
+ *   const uint8_t *p : message
+ *   uint32_t len : length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_handle_mux(const uint8_t *p, uint32_t len)
+{
+    uint8_t type;
+    uint8_t value_len;
+    int command;
+    uint8_t values[8];
+
+    if (len < 2)
+    {
+        return;
+    }
+    type = p[0] >> 2;
+    command = (p[0] & 0x02) ? 1 : 0;
+    value_len = p[1] >> 1;
+    if ((uint32_t)value_len + 2 > len)
+    {
+        return;
+    }
+    p += 2;
+
+    switch (type)
+    {
+    case SIM_RFCOMM_MUX_PN:
+        if (!command && (SIM_LINK_PN == sim.state) && (value_len >= 8))
+        {
+            sim.frame_size = sim_get16(&p[4]);
+            sim.tx_credits = (0xE0 == p[1]) ? (p[7] & 0x07) : 1000000;
+            sim.state = SIM_LINK_DLC;
+            sim_send_rfcomm(sim.dlci, SIM_RFCOMM_SABM, 1, -1, NULL, 0);
+        }
+        break;
+
+    case SIM_RFCOMM_MUX_MSC:
+        if (command)
+        {
+            sim_send_mux(SIM_RFCOMM_MUX_MSC, 0, p, value_len);
+            if ((SIM_LINK_DLC == sim.state) && sim.msc_sent)
+            {
+                sim.state = SIM_LINK_OPEN;
+                sim.open_us = sim_now_us();
+                sim.next_send_us = sim.open_us;
+                fprintf(stdout, "sim: DLC %u open, frame size %u, %d credits\n",
+                        sim.dlci, sim.frame_size, sim.tx_credits);
+            }
+        }
+        break;
+
+    case SIM_RFCOMM_MUX_RPN:
+    case SIM_RFCOMM_MUX_RLS:
+        if (command)
+        {
+            sim_send_mux(type, 0, p, value_len);
+        }
+        break;
+
+    default:
+        if (command)
+        {
+            values[0] = p[-2];
+            sim_send_mux(SIM_RFCOMM_MUX_NSC, 0, values, 1);
+        }
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_handle_rfcomm
+ *******************************************************************************
+ * Summary:
+ *   Handles an RFCOMM frame from the application
+ *
+ * Parameters:
+ *   uint8_t *p : frame, FCS included
+ *   uint32_t len : length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_handle_rfcomm(uint8_t *p, uint32_t len)
+{
+    uint8_t dlci;
+    uint8_t control;
+    uint32_t info_len;
+    uint32_t offset = 3;
+    uint8_t values[2];
+
+    if (len < 4)
+    {
+        return;
+    }
+    dlci = p[0] >> 2;
+    control = p[1];
+    info_len = p[2] >> 1;
+    if (0 == (p[2] & 1))
+    {
+        info_len |= (uint32_t)p[3] << 7;
+        offset = 4;
+    }
+
+    switch (control & ~SIM_RFCOMM_PF)
+    {
+    case SIM_RFCOMM_UA & ~SIM_RFCOMM_PF:
+        if ((0 == dlci) && (SIM_LINK_MUX == sim.state))
+        {
+            uint8_t pn[8] = { 0 };
+
+            sim.dlci = (uint8_t)(sim_config.scn << 1);
+            pn[0] = sim.dlci;
+            pn[1] = 0xF0; /* credit based flow control */
+            pn[2] = 7;
+            sim_put16(&pn[4], sim_config.frame_size);
+            pn[7] = SIM_RFCOMM_CREDITS;
+            sim.rx_credits = SIM_RFCOMM_CREDITS;
+            sim.state = SIM_LINK_PN;
+            sim_send_mux(SIM_RFCOMM_MUX_PN, 1, pn, sizeof(pn));
+        }
+        else if ((dlci == sim.dlci) && (SIM_LINK_DLC == sim.state))
+        {
+            values[0] = (uint8_t)((sim.dlci << 2) | 0x03);
+            values[1] = 0x8D; /* RTC, RTR, DV */
+            sim_send_mux(SIM_RFCOMM_MUX_MSC, 1, values, 2);
+            sim.msc_sent = 1;
+        }
+        break;
+
+    case SIM_RFCOMM_DM & ~SIM_RFCOMM_PF:
+        fprintf(stdout, "sim: DLCI %u refused, is the server channel %u?\n", dlci, sim_config.scn);
+        sim.state = SIM_LINK_DONE;
+        break;
+
+    case SIM_RFCOMM_DISC & ~SIM_RFCOMM_PF:
+        sim_send_rfcomm(dlci, SIM_RFCOMM_UA, 0, -1, NULL, 0);
+        if (dlci == sim.dlci)
+        {
+            sim.state = SIM_LINK_DONE;
+        }
+        break;
+
+    case SIM_RFCOMM_UIH & ~SIM_RFCOMM_PF:
+        if ((control & SIM_RFCOMM_PF) && (0 != dlci))
+        {
+            sim.tx_credits += p[offset++];
+        }
+        if (offset + info_len + 1 > len)
+        {
+            return;
+        }
+        if (0 == dlci)
+        {
+            sim_handle_mux(&p[offset], info_len);
+        }
+        else if (0 != info_len)
+        {
+            sim.counters.payload_in += info_len;
+            if (sim_config.echo && (SIM_LINK_OPEN == sim.state) && (sim.tx_credits <= 0))
+            {
+                sim.counters.echo_dropped++;
+            }
+            else if (sim_config.echo && (SIM_LINK_OPEN == sim.state))
+            {
+                sim_send_rfcomm(sim.dlci, SIM_RFCOMM_UIH, 1, -1, &p[offset], info_len);
+                sim.counters.payload_out += info_len;
+                sim.tx_credits--;
+            }
+            /* Give the credit back once half of them are used */
+            if (--sim.rx_credits <= SIM_RFCOMM_CREDITS / 2)
+            {
+                sim_send_rfcomm(sim.dlci, SIM_RFCOMM_UIH, 1, SIM_RFCOMM_CREDITS - sim.rx_credits, NULL, 0);
+                sim.rx_credits = SIM_RFCOMM_CREDITS;
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_handle_acl
+ *******************************************************************************
+ * Summary:
+ *   Reassembles L2CAP PDUs from ACL packets sent by the application
+ *
+ * Parameters:
+ *   uint16_t handle_flags : handle and packet boundary flags
+ *   uint8_t *p : ACL payload
+ *   uint16_t len : length
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_handle_acl(uint16_t handle_flags, uint8_t *p, uint16_t len)
+{
+    uint16_t cid;
+
+    sim.counters.acl_in++;
+    sim.completed_packets++;
+    if (0x1000 != (handle_flags & 0x3000))
+    {
+        sim.acl_rx_len = 0;
+        sim.acl_rx_expected = (len >= 2) ? 4u + sim_get16(p) : 0;
+    }
+    if ((0 == sim.acl_rx_expected) || (sim.acl_rx_len + len > sizeof(sim.acl_rx)))
+    {
+        sim.acl_rx_expected = 0;
+        return;
+    }
+    memcpy(&sim.acl_rx[sim.acl_rx_len], p, len);
+    sim.acl_rx_len += len;
+    if (sim.acl_rx_len < sim.acl_rx_expected)
+    {
+        return;
+    }
+
+    cid = sim_get16(&sim.acl_rx[2]);
+    if (SIM_L2CAP_SIGNAL_CID == cid)
+    {
+        sim_handle_signal(&sim.acl_rx[4], sim.acl_rx_expected - 4);
+    }
+    else if (SIM_L2CAP_LOCAL_CID == cid)
+    {
+        sim_handle_rfcomm(&sim.acl_rx[4], sim.acl_rx_expected - 4);
+    }
+    sim.acl_rx_expected = 0;
+}
+
+/*******************************************************************************
+ * Function Name: sim_parse_input
+ *******************************************************************************
+ * Summary:
+ *   Splits the bytes read from the PTY into H4 packets
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_parse_input(void)
+{
+    uint32_t offset = 0;
+    uint32_t header;
+    uint32_t payload;
+
+    while (offset < sim.in_len)
+    {
+        uint8_t *p = &sim.in[offset];
+        uint32_t avail = sim.in_len - offset;
+
+        switch (p[0])
+        {
+        case SIM_H4_CMD:
+            header = 4;
+            payload = (avail >= header) ? p[3] : 0;
+            break;
+        case SIM_H4_ACL:
+            header = 5;
+            payload = (avail >= header) ? sim_get16(&p[3]) : 0;
+            break;
+        case SIM_H4_SCO:
+            header = 4;
+            payload = (avail >= header) ? p[3] : 0;
+            break;
+        default:
+            /* Lost sync, skip to the next byte */
+            sim.counters.unknown_bytes++;
+            offset++;
+            continue;
+        }
+        if (avail < header + payload)
+        {
+            break;
+        }
+        if (SIM_H4_CMD == p[0])
+        {
+            sim_handle_command(sim_get16(&p[1]), &p[4], p[3]);
+        }
+        else if (SIM_H4_ACL == p[0])
+        {
+            sim_handle_acl(sim_get16(&p[1]), &p[5], (uint16_t)payload);
+        }
+        offset += header + payload;
+    }
+    memmove(sim.in, &sim.in[offset], sim.in_len - offset);
+    sim.in_len -= offset;
+
+    if (0 != sim.completed_packets)
+    {
+        /* One Number Of Completed Packets event for all ACL packets read */
+        uint8_t params[5] = { 1 };
+
+        sim_put16(&params[1], SIM_CONN_HANDLE);
+        sim_put16(&params[3], (uint16_t)sim.completed_packets);
+        sim_send_event(SIM_EVT_NUM_COMPLETED_PACKETS, params, sizeof(params));
+        sim.completed_packets = 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sim_run_peer
+ *******************************************************************************
+ * Summary:
+ *   Runs the scripted peer: pages the application when it is due, then
+ *   sends data while credits, the rate and the limits allow
+ *
+ * Parameters:
+ *   uint64_t now_us : current time
+ *
+ * Return:
+ *   uint64_t : time of the next action, 0 if none
+ *
+ ******************************************************************************/
+static uint64_t sim_run_peer(uint64_t now_us)
+{
+    static uint8_t frame[65536];
+    uint8_t params[10];
+    uint32_t len;
+    uint32_t i;
+
+    if ((SIM_LINK_IDLE == sim.state) && (0 != sim.page_at_us))
+    {
+        if (now_us < sim.page_at_us)
+        {
+            return sim.page_at_us;
+        }
+        fprintf(stdout, "sim: peer paging\n");
+        memcpy(params, sim_config.peer_bda, 6);
+        memcpy(&params[6], "\x0C\x01\x1F", 3); /* computer, laptop */
+        params[9] = 1;
+        sim_send_event(SIM_EVT_CONN_REQUEST, params, sizeof(params));
+        sim.state = SIM_LINK_PAGING;
+        sim.page_at_us = 0;
+        return 0;
+    }
+    if (SIM_LINK_OPEN != sim.state)
+    {
+        return 0;
+    }
+    if (((0 != sim_config.total_bytes) && (sim.counters.payload_out >= sim_config.total_bytes)) ||
+        ((0 != sim_config.duration_s) && (now_us - sim.open_us >= sim_config.duration_s * 1000000ULL)))
+    {
+        return 0;
+    }
+
+    len = sim.frame_size;
+    if ((uint32_t)sim.remote_mtu < len + 5)
+    {
+        len = sim.remote_mtu - 5;
+    }
+    while ((sim.out_len < SIM_OUT_HIGH_WATER) && (now_us >= sim.next_send_us))
+    {
+        if (sim.tx_credits <= 0)
+        {
+            sim.counters.credit_stalls++;
+            return 0;
+        }
+        for (i = 0; i < len; i++)
+        {
+            frame[i] = sim.tx_pattern++;
+        }
+        sim_send_rfcomm(sim.dlci, SIM_RFCOMM_UIH, 1, -1, frame, len);
+        sim.tx_credits--;
+        sim.counters.payload_out += len;
+        if (0 != sim_config.rate)
+        {
+            sim.next_send_us += (uint64_t)len * 1000000ULL / sim_config.rate;
+        }
+    }
+    return (0 != sim_config.rate) ? sim.next_send_us : 0;
+}
+
+/*******************************************************************************
+ * Function Name: sim_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the payload rate in each direction and the framing overhead
+ *
+ * Parameters:
+ *   uint64_t now_us : current time
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void sim_print_stats(uint64_t now_us)
+{
+    sim_counters_t *p_now = &sim.counters;
+    sim_counters_t *p_last = &sim.last;
+    uint64_t elapsed_us = now_us - sim.last_us;
+    uint64_t wire;
+    uint64_t payload;
+
+    if (0 == elapsed_us)
+    {
+        return;
+    }
+    wire = (p_now->wire_in - p_last->wire_in) + (p_now->wire_out - p_last->wire_out);
+    payload = (p_now->payload_in - p_last->payload_in) + (p_now->payload_out - p_last->payload_out);
+    fprintf(stdout, "sim: peer->app %llu B/s, app->peer %llu B/s, wire %llu B/s, framing %llu.%llu%%, "
+            "%u cmds %u evts %u/%u acl in/out\n",
+            (unsigned long long)((p_now->payload_out - p_last->payload_out) * 1000000ULL / elapsed_us),
+            (unsigned long long)((p_now->payload_in - p_last->payload_in) * 1000000ULL / elapsed_us),
+            (unsigned long long)(wire * 1000000ULL / elapsed_us),
+            (unsigned long long)((0 != wire) ? (wire - payload) * 100 / wire : 0),
+            (unsigned long long)((0 != wire) ? (wire - payload) * 1000 / wire % 10 : 0),
+            p_now->commands - p_last->commands, p_now->events - p_last->events,
+            p_now->acl_in - p_last->acl_in, p_now->acl_out - p_last->acl_out);
+    *p_last = *p_now;
+    sim.last_us = now_us;
+}
+
+static void sim_print_totals(void)
+{
+    fprintf(stdout, "sim: total peer->app %llu bytes, app->peer %llu bytes, wire in %llu out %llu, "
+            "%u credit stalls, %u echoes dropped, %u bytes out of sync\n",
+            (unsigned long long)sim.counters.payload_out, (unsigned long long)sim.counters.payload_in,
+            (unsigned long long)sim.counters.wire_in, (unsigned long long)sim.counters.wire_out,
+            sim.counters.credit_stalls, sim.counters.echo_dropped, sim.counters.unknown_bytes);
+}
+
+static void sim_signal_handler(int sig)
+{
+    sim_stop = 1;
+}
+
+/*******************************************************************************
+ * Function Name: sim_open_pty
+ *******************************************************************************
+ * Summary:
+ *   Opens a raw PTY pair. The slave is kept open so the master does not
+ *   report a hang-up before the application opens it, or between runs.
+ *
+ * Parameters:
+ *   NONE
+ *
+ * Return:
+ *   int : 0 on success, -1 on error
+ *
+ ******************************************************************************/
+static int sim_open_pty(void)
+{
+    struct termios tio;
+    const char *p_name;
+
+    sim.master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((sim.master_fd < 0) || (0 != grantpt(sim.master_fd)) || (0 != unlockpt(sim.master_fd)))
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+    p_name = ptsname(sim.master_fd);
+    sim.slave_fd = open(p_name, O_RDWR | O_NOCTTY);
+    if (sim.slave_fd < 0)
+    {
+        perror(p_name);
+        return -1;
+    }
+    tcgetattr(sim.slave_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(sim.slave_fd, TCSANOW, &tio);
+    fcntl(sim.master_fd, F_SETFL, fcntl(sim.master_fd, F_GETFL) | O_NONBLOCK);
+
+    if (NULL != sim_config.link_path)
+    {
+        unlink(sim_config.link_path);
+        if (0 != symlink(p_name, sim_config.link_path))
+        {
+            perror(sim_config.link_path);
+            return -1;
+        }
+    }
+    fprintf(stdout, "sim: controller on %s%s%s\n", p_name,
+            (NULL != sim_config.link_path) ? " linked from " : "",
+            (NULL != sim_config.link_path) ? sim_config.link_path : "");
+    return 0;
+}
+
+static int sim_parse_bda(const char *p_text, uint8_t *p_bda)
+{
+    unsigned int b[6];
+    int i;
+
+    if (6 != sscanf(p_text, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]))
+    {
+        return -1;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        p_bda[5 - i] = (uint8_t)b[i];
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: main
+ *******************************************************************************
+ * Summary:
+ *   Parses the options, opens the PTY and runs the controller until SIGINT
+ *
+ * Parameters:
+ *   int argc : argument count
+ *   char *argv[] : arguments
+ *
+ * Return:
+ *   int : exit status
+ *
+ ******************************************************************************/
+int main(int argc, char *argv[])
+{
+    struct pollfd pfd;
+    struct timespec timeout;
+    uint64_t now_us;
+    uint64_t next_us;
+    uint64_t stats_us;
+    ssize_t got;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "l:a:s:r:f:n:t:d:evh")))
+    {
+        switch (opt)
+        {
+        case 'l': sim_config.link_path = optarg; break;
+        case 'a':
+            if (0 != sim_parse_bda(optarg, sim_config.peer_bda))
+            {
+                fprintf(stderr, "Invalid address %s\n%s", optarg, sim_usage);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's': sim_config.scn = (uint8_t)strtoul(optarg, NULL, 0); break;
+        case 'r': sim_config.rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': sim_config.frame_size = (uint16_t)strtoul(optarg, NULL, 0); break;
+        case 'n': sim_config.total_bytes = strtoull(optarg, NULL, 0); break;
+        case 't': sim_config.duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'd': sim_config.connect_delay_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'e': sim_config.echo = 1; break;
+        case 'v': sim_config.verbose = 1; break;
+        default:
+            fprintf(stderr, "%s", sim_usage);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((0 == sim_config.scn) || (sim_config.scn > 30) || (sim_config.frame_size < 23) ||
+        (sim_config.frame_size > 32767))
+    {
+        fprintf(stderr, "%s", sim_usage);
+        return EXIT_FAILURE;
+    }
+
+    sim_rfcomm_init_fcs();
+    sim.host_acl_size = SIM_ACL_BUFFER_SIZE;
+    sim.ram_hash = 0x811C9DC5u;
+    sim_reset_link();
+    if (0 != sim_open_pty())
+    {
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, sim_signal_handler);
+    signal(SIGTERM, sim_signal_handler);
+
+    sim.last_us = sim_now_us();
+    stats_us = sim.last_us + 1000000;
+    while (!sim_stop)
+    {
+        now_us = sim_now_us();
+        next_us = sim_run_peer(now_us);
+        if (now_us >= stats_us)
+        {
+            if (SIM_LINK_IDLE != sim.state)
+            {
+                sim_print_stats(now_us);
+            }
+            stats_us += 1000000;
+        }
+        if ((0 == next_us) || (next_us > stats_us))
+        {
+            next_us = stats_us;
+        }
+
+        pfd.fd = sim.master_fd;
+        pfd.events = POLLIN | ((0 != sim.out_len) ? POLLOUT : 0);
+        pfd.revents = 0;
+        now_us = sim_now_us();
+        next_us = (next_us > now_us) ? next_us - now_us : 0;
+        timeout.tv_sec = (time_t)(next_us / 1000000);
+        timeout.tv_nsec = (long)(next_us % 1000000) * 1000;
+        if (ppoll(&pfd, 1, &timeout, NULL) < 0)
+        {
+            continue;
+        }
+        if (pfd.revents & POLLIN)
+        {
+            got = read(sim.master_fd, &sim.in[sim.in_len], sizeof(sim.in) - sim.in_len);
+            if (got > 0)
+            {
+                sim.in_len += (uint32_t)got;
+                sim.counters.wire_in += (uint64_t)got;
+                sim_parse_input();
+            }
+        }
+        sim_flush();
+    }
+
+    sim_print_totals();
+    if (NULL != sim_config.link_path)
+    {
+        unlink(sim_config.link_path);
+    }
+    return EXIT_SUCCESS;
+}
+
+/* END OF FILE [] */